@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "client_stats.h"
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int64_t kStartUs = 1000000000;
+
+RTSPClientStats snapshot(const ClientStats& stats, int64_t nowUs) {
+    RTSPClientStats result;
+    stats.snapshot(result, nowUs);
+    return result;
+}
+
+} // namespace
+
+TEST(ClientStatsTest, LatencyBucketsCoverRange) {
+    for (uint64_t value : {0ull, 1ull, 3ull, 4ull, 7ull, 8ull, 9ull, 100ull, 999ull, 12345ull, 1000000ull}) {
+        int bucket = ClientStats::latencyBucket(value);
+        EXPECT_GE(ClientStats::latencyBucketUpperBound(bucket), value) << value;
+        // Погрешность верхней границы не больше 25%
+        EXPECT_LE(ClientStats::latencyBucketUpperBound(bucket), value + value / 4 + 1) << value;
+        if (bucket > 0) {
+            EXPECT_LT(ClientStats::latencyBucketUpperBound(bucket - 1), value) << value;
+        }
+    }
+    EXPECT_EQ(ClientStats::latencyBucket(UINT64_MAX), ClientStats::kLatencyBuckets - 1);
+}
+
+TEST(ClientStatsTest, CallbackPercentiles) {
+    ClientStats stats;
+    for (int i = 0; i < 90; i++) stats.recordCallbackLatency(100);
+    for (int i = 0; i < 9; i++) stats.recordCallbackLatency(2000);
+    stats.recordCallbackLatency(50000);
+
+    RTSPClientStats result = snapshot(stats, kStartUs);
+    EXPECT_EQ(result.callbacks, 100u);
+    EXPECT_GE(result.callbackP50Us, 100);
+    EXPECT_LE(result.callbackP50Us, 125);
+    EXPECT_GE(result.callbackP95Us, 2000);
+    EXPECT_LE(result.callbackP95Us, 2500);
+    EXPECT_GE(result.callbackP99Us, 2000);
+    EXPECT_LE(result.callbackP99Us, 2500);
+    EXPECT_EQ(result.callbackMaxUs, 50000);
+}
+
+TEST(ClientStatsTest, RatesPerWindow) {
+    ClientStats stats;
+    EXPECT_FALSE(stats.onPacket(1000, kStartUs));
+
+    // Секунда потока: 25 кадров по 4 пакета в 1000 байт
+    for (int frame = 0; frame < 25; frame++) {
+        for (int packet = 0; packet < 4; packet++) {
+            EXPECT_FALSE(stats.onPacket(1000, kStartUs + frame * 40000 + packet * 100));
+        }
+        stats.onFrame(true);
+    }
+    stats.onFrame(false);       // Аудио не входит в fps
+
+    EXPECT_TRUE(stats.onPacket(1000, kStartUs + ClientStats::kRateWindowUs));
+    RTSPClientStats result = snapshot(stats, kStartUs + ClientStats::kRateWindowUs);
+    EXPECT_EQ(result.packetsReceived, 102u);
+    EXPECT_EQ(result.bytesReceived, 102000u);
+    EXPECT_EQ(result.framesAssembled, 26u);
+    EXPECT_DOUBLE_EQ(result.fps, 25.0);
+    EXPECT_DOUBLE_EQ(result.bitrateKbps, 816.0);    // 102 пакета * 8000 бит за окно
+
+    // Поток остановился: скорость не показывается устаревшей
+    result = snapshot(stats, kStartUs + 4 * ClientStats::kRateWindowUs);
+    EXPECT_DOUBLE_EQ(result.bitrateKbps, 0.0);
+    EXPECT_DOUBLE_EQ(result.fps, 0.0);
+}
+
+TEST(ClientStatsTest, LossJitterAndReconnects) {
+    ClientStats stats;
+    for (int i = 0; i < 99; i++) stats.onPacket(100, kStartUs + i);
+    stats.publishStreamState(1, 2500);
+    stats.onReconnect();
+    stats.onReconnect();
+
+    RTSPClientStats result = snapshot(stats, kStartUs);
+    EXPECT_EQ(result.packetsLost, 1u);
+    EXPECT_DOUBLE_EQ(result.lossPercent, 1.0);
+    EXPECT_DOUBLE_EQ(result.jitterMs, 2.5);
+    EXPECT_EQ(result.reconnects, 2u);
+}
+
+TEST(ClientStatsTest, ConcurrentWritersAndReader) {
+    ClientStats stats;
+    std::atomic<bool> done(false);
+    std::thread reader([&]() {
+        while (!done) snapshot(stats, kStartUs);
+    });
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 2; t++) {
+        writers.emplace_back([&stats]() {
+            for (int i = 0; i < 10000; i++) {
+                stats.onPacket(100, kStartUs + i * 1000);
+                stats.recordCallbackLatency(i % 500);
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+
+    RTSPClientStats result = snapshot(stats, kStartUs);
+    EXPECT_EQ(result.packetsReceived, 20000u);
+    EXPECT_EQ(result.callbacks, 20000u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
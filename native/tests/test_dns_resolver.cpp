@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "dns_resolver.h"
+
+#include <arpa/inet.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+DNSResolver::Stats resolver_stats() {
+    DNSResolver::Stats stats = {};
+    DNSResolver::instance().getStats(stats);
+    return stats;
+}
+
+// Результат асинхронного разрешения; при blocked обработчик ждет release(),
+// занимая поток резолвера
+struct Resolution {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    bool success = false;
+    struct sockaddr_in addr = {};
+    bool blocked = false;
+    std::thread::id thread;
+
+    static void onResolved(bool success, const struct sockaddr_in& addr, void* context) {
+        Resolution* resolution = static_cast<Resolution*>(context);
+        std::unique_lock<std::mutex> lock(resolution->mutex);
+        resolution->done = true;
+        resolution->success = success;
+        resolution->addr = addr;
+        resolution->thread = std::this_thread::get_id();
+        resolution->condition.notify_all();
+        resolution->condition.wait(lock, [resolution] { return !resolution->blocked; });
+    }
+
+    bool wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(5), [this] { return done; });
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        blocked = false;
+        condition.notify_all();
+    }
+};
+
+bool is_loopback(const struct sockaddr_in& addr) {
+    return addr.sin_family == AF_INET && addr.sin_addr.s_addr == htonl(INADDR_LOOPBACK);
+}
+
+class DNSResolverTest : public ::testing::Test {
+protected:
+    void SetUp() override { DNSResolver::instance().clear(); }
+
+    void TearDown() override {
+        DNSResolver::instance().setTtl(DNSResolver::kDefaultTtlMs);
+        DNSResolver::instance().clear();
+    }
+};
+
+} // namespace
+
+TEST_F(DNSResolverTest, IpLiteralBypassesCache) {
+    DNSResolver& resolver = DNSResolver::instance();
+    DNSResolver::Stats before = resolver_stats();
+
+    // Обработчик вызывается сразу в вызывающем потоке
+    Resolution resolution;
+    resolver.resolveAsync("127.0.0.1", Resolution::onResolved, &resolution);
+    EXPECT_TRUE(resolution.done);
+    EXPECT_TRUE(resolution.success);
+    EXPECT_TRUE(is_loopback(resolution.addr));
+    EXPECT_EQ(resolution.thread, std::this_thread::get_id());
+
+    struct sockaddr_in addr = {};
+    EXPECT_TRUE(resolver.resolve("10.1.2.3", addr, 1000));
+    EXPECT_EQ(addr.sin_addr.s_addr, inet_addr("10.1.2.3"));
+
+    DNSResolver::Stats after = resolver_stats();
+    EXPECT_EQ(after.hits, before.hits);
+    EXPECT_EQ(after.misses, before.misses);
+    EXPECT_EQ(after.cachedHosts, 0);
+}
+
+TEST_F(DNSResolverTest, CountsHitsAndMisses) {
+    DNSResolver& resolver = DNSResolver::instance();
+    DNSResolver::Stats before = resolver_stats();
+
+    struct sockaddr_in addr = {};
+    ASSERT_TRUE(resolver.resolve("localhost", addr, 5000));
+    EXPECT_TRUE(is_loopback(addr));
+    DNSResolver::Stats stats = resolver_stats();
+    EXPECT_EQ(stats.misses, before.misses + 1);
+    EXPECT_EQ(stats.hits, before.hits);
+    EXPECT_EQ(stats.cachedHosts, 1);
+
+    // Повторный запрос отвечается из кэша сразу
+    Resolution cached;
+    resolver.resolveAsync("localhost", Resolution::onResolved, &cached);
+    EXPECT_TRUE(cached.done);
+    EXPECT_TRUE(cached.success);
+    EXPECT_TRUE(is_loopback(cached.addr));
+    stats = resolver_stats();
+    EXPECT_EQ(stats.misses, before.misses + 1);
+    EXPECT_EQ(stats.hits, before.hits + 1);
+}
+
+TEST_F(DNSResolverTest, ZeroTtlDisablesCache) {
+    DNSResolver& resolver = DNSResolver::instance();
+    resolver.setTtl(0);
+    DNSResolver::Stats before = resolver_stats();
+
+    // Каждый запрос - новое разрешение, устаревший адрес не выдается
+    struct sockaddr_in addr = {};
+    ASSERT_TRUE(resolver.resolve("localhost", addr, 5000));
+    ASSERT_TRUE(resolver.resolve("localhost", addr, 5000));
+    EXPECT_TRUE(is_loopback(addr));
+
+    DNSResolver::Stats after = resolver_stats();
+    EXPECT_EQ(after.misses, before.misses + 2);
+    EXPECT_EQ(after.hits, before.hits);
+}
+
+TEST_F(DNSResolverTest, StaleEntryIsServedWhileRevalidating) {
+    DNSResolver& resolver = DNSResolver::instance();
+    resolver.setTtl(50);
+
+    struct sockaddr_in addr = {};
+    ASSERT_TRUE(resolver.resolve("localhost", addr, 5000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Устаревший адрес выдается сразу, обновление идет в фоне
+    DNSResolver::Stats before = resolver_stats();
+    Resolution stale;
+    resolver.resolveAsync("localhost", Resolution::onResolved, &stale);
+    EXPECT_TRUE(stale.done);
+    EXPECT_TRUE(stale.success);
+    EXPECT_TRUE(is_loopback(stale.addr));
+    DNSResolver::Stats stats = resolver_stats();
+    EXPECT_EQ(stats.hits, before.hits + 1);
+    EXPECT_EQ(stats.misses, before.misses);
+}
+
+TEST_F(DNSResolverTest, CachesFailureForNegativeTtl) {
+    DNSResolver& resolver = DNSResolver::instance();
+    DNSResolver::Stats before = resolver_stats();
+
+    struct sockaddr_in addr = {};
+    EXPECT_FALSE(resolver.resolve("camera.invalid", addr, 5000));
+    DNSResolver::Stats stats = resolver_stats();
+    EXPECT_EQ(stats.failures, before.failures + 1);
+    EXPECT_EQ(stats.misses, before.misses + 1);
+
+    // Пока действует отрицательный ttl, повторный запрос не уходит в DNS
+    Resolution cached;
+    resolver.resolveAsync("camera.invalid", Resolution::onResolved, &cached);
+    EXPECT_TRUE(cached.done);
+    EXPECT_FALSE(cached.success);
+    stats = resolver_stats();
+    EXPECT_EQ(stats.failures, before.failures + 1);
+    EXPECT_EQ(stats.hits, before.hits + 1);
+}
+
+TEST_F(DNSResolverTest, ClearKeepsInFlightEntries) {
+    DNSResolver& resolver = DNSResolver::instance();
+
+    // Обработчики занимают все потоки резолвера
+    Resolution busy[DNSResolver::kWorkerCount];
+    for (int i = 0; i < DNSResolver::kWorkerCount; i++) {
+        busy[i].blocked = true;
+        resolver.resolveAsync("busy" + std::to_string(i) + ".invalid", Resolution::onResolved, &busy[i]);
+    }
+    for (auto& resolution : busy) {
+        ASSERT_TRUE(resolution.wait());
+    }
+
+    // Запрос в очереди переживает очистку, и его ожидающий получает результат
+    Resolution pending;
+    resolver.resolveAsync("localhost", Resolution::onResolved, &pending);
+    EXPECT_FALSE(pending.done);
+    resolver.clear();
+    EXPECT_EQ(resolver_stats().cachedHosts, 1);
+
+    for (auto& resolution : busy) {
+        resolution.release();
+    }
+    ASSERT_TRUE(pending.wait());
+    EXPECT_TRUE(pending.success);
+    EXPECT_TRUE(is_loopback(pending.addr));
+    EXPECT_EQ(resolver_stats().cachedHosts, 1);
+
+    resolver.clear();
+    EXPECT_EQ(resolver_stats().cachedHosts, 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "frame_pool.h"
+
+#include <cstring>
+
+namespace {
+
+RTSPFramePoolStats pool_stats(const FramePool* pool) {
+    RTSPFramePoolStats stats = {};
+    pool->getStats(&stats);
+    return stats;
+}
+
+} // namespace
+
+TEST(FramePoolTest, RetainReleaseCountsReferences) {
+    FramePool* pool = FramePool::create();
+    RTSPFrame* frame = pool->acquire(1000);
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->size, 1000);
+    EXPECT_EQ(pool_stats(pool).inUse, 1);
+
+    // Две ссылки: кадр возвращается в пул только после второго release
+    EXPECT_EQ(FramePool::retain(frame), frame);
+    FramePool::release(frame);
+    EXPECT_EQ(pool_stats(pool).inUse, 1);
+    memset(frame->data, 0xAB, frame->size);
+
+    FramePool::release(frame);
+    EXPECT_EQ(pool_stats(pool).inUse, 0);
+    EXPECT_EQ(pool_stats(pool).highWaterMark, 1);
+
+    EXPECT_EQ(FramePool::retain(nullptr), nullptr);
+    FramePool::release(nullptr);
+    pool->detach();
+}
+
+TEST(FramePoolTest, RecyclesBuffersOfSizeClass) {
+    FramePool* pool = FramePool::create();
+
+    // Первый кадр класса выделяет slab, следующие берутся из пула без аллокатора
+    RTSPFrame* first = pool->acquire(1000);
+    RTSPFramePoolStats stats = pool_stats(pool);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_GT(stats.allocatedBytes, 0u);
+    FramePool::release(first);
+
+    RTSPFrame* second = pool->acquire(2000);
+    stats = pool_stats(pool);
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(second->size, 2000);
+
+    // Кадр другого класса - новый slab
+    uint64_t allocated = stats.allocatedBytes;
+    RTSPFrame* large = pool->acquire(100 * 1024);
+    EXPECT_EQ(pool_stats(pool).misses, 2u);
+    EXPECT_GT(pool_stats(pool).allocatedBytes, allocated);
+
+    FramePool::release(second);
+    FramePool::release(large);
+    pool->detach();
+}
+
+TEST(FramePoolTest, OutstandingFramesOutliveDetachedPool) {
+    FramePool* pool = FramePool::create();
+    RTSPFrame* frame = pool->acquire(4096);
+    RTSPFrame* shared = FramePool::retain(pool->acquire(512));
+
+    // Владелец отказался от пула: выданные кадры остаются действительными
+    pool->detach();
+    memset(frame->data, 1, frame->size);
+    memset(shared->data, 2, shared->size);
+    FramePool::release(frame);
+    FramePool::release(shared);
+    EXPECT_EQ(shared->data[0], 2);
+
+    // Последний release удаляет пул (проверяется санитайзерами)
+    FramePool::release(shared);
+}
+
+TEST(FramePoolTest, FallsBackToOneOffAllocationAboveLimit) {
+    // Лимит меньше одного slab'а: все кадры выделяются разово
+    FramePool* pool = FramePool::create(1024);
+    RTSPFrame* frame = pool->acquire(1000);
+    ASSERT_NE(frame, nullptr);
+    memset(frame->data, 3, frame->size);
+    RTSPFramePoolStats stats = pool_stats(pool);
+    EXPECT_EQ(stats.allocatedBytes, 0u);
+    EXPECT_EQ(stats.misses, 1u);
+    FramePool::release(frame);
+
+    // Разовые кадры не возвращаются в пул
+    frame = pool->acquire(1000);
+    EXPECT_EQ(pool_stats(pool).hits, 0u);
+    EXPECT_EQ(pool_stats(pool).misses, 2u);
+    FramePool::release(frame);
+    pool->detach();
+
+    // Кадр больше наибольшего класса - разово и при свободном лимите
+    pool = FramePool::create();
+    frame = pool->acquire(9 * 1024 * 1024);
+    ASSERT_NE(frame, nullptr);
+    frame->data[frame->size - 1] = 4;
+    EXPECT_EQ(pool_stats(pool).allocatedBytes, 0u);
+    EXPECT_EQ(pool_stats(pool).inUse, 1);
+    FramePool::release(frame);
+    EXPECT_EQ(pool_stats(pool).inUse, 0);
+    pool->detach();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include "frame_queue.h"
+#include "frame_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Пул на время теста; кадры помечаются номером в timestamp
+class FrameQueueTest : public ::testing::Test {
+protected:
+    FrameQueueTest() : pool_(FramePool::create()) {}
+    ~FrameQueueTest() override { pool_->detach(); }
+
+    RTSPFrame* frame(int64_t number, bool keyframe = false) {
+        RTSPFrame* result = pool_->acquire(16);
+        result->timestamp = number;
+        result->keyframe = keyframe;
+        return result;
+    }
+
+    std::vector<int64_t> drain(FrameQueue& queue) {
+        std::vector<int64_t> numbers;
+        while (RTSPFrame* popped = queue.pop()) {
+            numbers.push_back(popped->timestamp);
+            FramePool::release(popped);
+        }
+        return numbers;
+    }
+
+    int framesInUse() const {
+        RTSPFramePoolStats stats;
+        pool_->getStats(&stats);
+        return stats.inUse;
+    }
+
+    FramePool* pool_;
+};
+
+} // namespace
+
+TEST_F(FrameQueueTest, DeliversInOrder) {
+    FrameQueue queue(4, RTSP_FRAME_QUEUE_DROP_OLDEST);
+    queue.open();
+    for (int i = 1; i <= 3; i++) {
+        EXPECT_TRUE(queue.push(frame(i)));
+    }
+
+    EXPECT_EQ(queue.size(), 3);
+    EXPECT_EQ(drain(queue), (std::vector<int64_t>{1, 2, 3}));
+    EXPECT_EQ(queue.pop(), nullptr);
+}
+
+TEST_F(FrameQueueTest, CapacityRoundsUpToPowerOfTwo) {
+    EXPECT_EQ(FrameQueue(5, RTSP_FRAME_QUEUE_BLOCK).capacity(), 8);
+    EXPECT_EQ(FrameQueue(0, RTSP_FRAME_QUEUE_BLOCK).capacity(), FrameQueue::kDefaultCapacity);
+}
+
+TEST_F(FrameQueueTest, DropOldestEvictsHead) {
+    FrameQueue queue(4, RTSP_FRAME_QUEUE_DROP_OLDEST);
+    queue.open();
+    for (int i = 1; i <= 6; i++) {
+        EXPECT_TRUE(queue.push(frame(i)));
+    }
+
+    RTSPFrameQueueStats stats;
+    queue.getStats(&stats);
+    EXPECT_EQ(stats.depth, 4);
+    EXPECT_EQ(stats.highWaterMark, 4);
+    EXPECT_EQ(stats.enqueued, 6u);
+    EXPECT_EQ(stats.dropped, 2u);
+
+    EXPECT_EQ(drain(queue), (std::vector<int64_t>{3, 4, 5, 6}));
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+TEST_F(FrameQueueTest, DropNonKeyframeSkipsToNextKeyframe) {
+    FrameQueue queue(2, RTSP_FRAME_QUEUE_DROP_NON_KEYFRAME);
+    queue.open();
+    EXPECT_TRUE(queue.push(frame(1, true)));
+    EXPECT_TRUE(queue.push(frame(2)));
+
+    // Переполнение: неключевой кадр отброшен
+    EXPECT_FALSE(queue.push(frame(3)));
+
+    // Место есть, но кадр зависит от отброшенного
+    EXPECT_EQ(drain(queue), (std::vector<int64_t>{1, 2}));
+    EXPECT_FALSE(queue.push(frame(4)));
+
+    EXPECT_TRUE(queue.push(frame(5, true)));
+    EXPECT_TRUE(queue.push(frame(6)));
+
+    // Ключевой кадр при переполнении вытесняет старые
+    EXPECT_TRUE(queue.push(frame(7, true)));
+    EXPECT_EQ(drain(queue), (std::vector<int64_t>{6, 7}));
+
+    RTSPFrameQueueStats stats;
+    queue.getStats(&stats);
+    EXPECT_EQ(stats.dropped, 3u);
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+TEST_F(FrameQueueTest, BlockWaitsForConsumer) {
+    FrameQueue queue(2, RTSP_FRAME_QUEUE_BLOCK);
+    queue.open();
+    queue.push(frame(1));
+    queue.push(frame(2));
+
+    RTSPFrame* extra = frame(3);
+    std::atomic<bool> pushed(false);
+    std::thread producer([&] {
+        queue.push(extra);
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(pushed);
+
+    RTSPFrame* first = queue.pop();
+    ASSERT_NE(first, nullptr);
+    FramePool::release(first);
+    producer.join();
+
+    EXPECT_TRUE(pushed);
+    EXPECT_EQ(drain(queue), (std::vector<int64_t>{2, 3}));
+
+    RTSPFrameQueueStats stats;
+    queue.getStats(&stats);
+    EXPECT_EQ(stats.blocked, 1u);
+    EXPECT_EQ(stats.dropped, 0u);
+}
+
+TEST_F(FrameQueueTest, CloseReleasesBlockedProducer) {
+    FrameQueue queue(2, RTSP_FRAME_QUEUE_BLOCK);
+    queue.open();
+    queue.push(frame(1));
+    queue.push(frame(2));
+
+    RTSPFrame* extra = frame(3);
+    std::thread producer([&] { EXPECT_FALSE(queue.push(extra)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.close();
+    producer.join();
+
+    EXPECT_FALSE(queue.push(frame(4)));
+    EXPECT_EQ(queue.size(), 2);
+
+    // Повторное открытие освобождает оставшиеся кадры
+    queue.open();
+    EXPECT_EQ(queue.size(), 0);
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+TEST_F(FrameQueueTest, ConcurrentDropOldestKeepsOrder) {
+    FrameQueue queue(8, RTSP_FRAME_QUEUE_DROP_OLDEST);
+    queue.open();
+    const int kFrames = 20000;
+
+    // Кадры берутся из пула только в потоке производителя
+    std::thread producer([&] {
+        for (int i = 1; i <= kFrames; i++) {
+            queue.push(frame(i));
+        }
+        queue.close();
+    });
+
+    std::vector<int64_t> received;
+    while (true) {
+        if (!queue.waitForFrames(10) && queue.isClosed() && queue.size() == 0) break;
+        while (RTSPFrame* popped = queue.pop()) {
+            received.push_back(popped->timestamp);
+            FramePool::release(popped);
+        }
+    }
+    producer.join();
+    std::vector<int64_t> rest = drain(queue);
+    received.insert(received.end(), rest.begin(), rest.end());
+
+    for (size_t i = 1; i < received.size(); i++) {
+        ASSERT_LT(received[i - 1], received[i]);
+    }
+    ASSERT_FALSE(received.empty());
+    EXPECT_EQ(received.back(), kFrames);
+
+    RTSPFrameQueueStats stats;
+    queue.getStats(&stats);
+    EXPECT_EQ(stats.enqueued, static_cast<uint64_t>(kFrames));
+    EXPECT_EQ(received.size() + stats.dropped, static_cast<size_t>(kFrames));
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "gop_cache.h"
+#include "frame_pool.h"
+
+#include <vector>
+
+namespace {
+
+class GopCacheTest : public ::testing::Test {
+protected:
+    GopCacheTest() : pool_(FramePool::create()) {
+        cache_.setLimits(GopCache::kDefaultMaxFrames, GopCache::kDefaultMaxBytes);
+    }
+    ~GopCacheTest() override {
+        cache_.clear();
+        pool_->detach();
+    }
+
+    // Кадр передается в кэш и освобождается, как после доставки подписчику
+    void deliver(int64_t number, bool keyframe = false, int size = 100) {
+        RTSPFrame* frame = pool_->acquire(size);
+        frame->size = size;
+        frame->timestamp = number;
+        frame->keyframe = keyframe;
+        cache_.push(frame);
+        FramePool::release(frame);
+    }
+
+    std::vector<int64_t> replay() {
+        std::vector<RTSPFrame*> frames;
+        cache_.snapshot(frames);
+        std::vector<int64_t> numbers;
+        for (RTSPFrame* frame : frames) {
+            numbers.push_back(frame->timestamp);
+            FramePool::release(frame);
+        }
+        return numbers;
+    }
+
+    int framesInUse() const {
+        RTSPFramePoolStats stats;
+        pool_->getStats(&stats);
+        return stats.inUse;
+    }
+
+    FramePool* pool_;
+    GopCache cache_;
+};
+
+} // namespace
+
+TEST_F(GopCacheTest, KeepsFramesFromLastKeyframe) {
+    deliver(1);                 // До первого ключевого кадра - не кэшируется
+    deliver(2, true);
+    deliver(3);
+    deliver(4);
+    EXPECT_EQ(replay(), (std::vector<int64_t>{2, 3, 4}));
+
+    deliver(5, true);
+    deliver(6);
+    EXPECT_EQ(replay(), (std::vector<int64_t>{5, 6}));
+
+    // Кэш держит ссылки только на текущий GOP
+    EXPECT_EQ(framesInUse(), 2);
+}
+
+TEST_F(GopCacheTest, SnapshotSurvivesNewGop) {
+    deliver(1, true);
+    deliver(2);
+
+    std::vector<RTSPFrame*> frames;
+    ASSERT_EQ(cache_.snapshot(frames), 2u);
+    deliver(3, true);
+
+    // Выданные кадры действительны, пока подписчик их не освободит
+    EXPECT_EQ(frames[0]->timestamp, 1);
+    EXPECT_EQ(frames[1]->timestamp, 2);
+    for (RTSPFrame* frame : frames) {
+        FramePool::release(frame);
+    }
+    EXPECT_EQ(framesInUse(), 1);
+}
+
+TEST_F(GopCacheTest, ClearWaitsForNextKeyframe) {
+    deliver(1, true);
+    deliver(2);
+    cache_.clear();
+
+    deliver(3);
+    EXPECT_TRUE(replay().empty());
+
+    deliver(4, true);
+    EXPECT_EQ(replay(), (std::vector<int64_t>{4}));
+}
+
+TEST_F(GopCacheTest, GopOverLimitIsDropped) {
+    cache_.setLimits(3, 1000);
+    deliver(1, true);
+    deliver(2);
+    deliver(3);
+    deliver(4);                 // Четвертый кадр превышает лимит
+    deliver(5);
+    EXPECT_TRUE(replay().empty());
+    EXPECT_EQ(framesInUse(), 0);
+
+    deliver(6, true, 600);
+    deliver(7, false, 600);     // Превышение лимита по байтам
+    EXPECT_TRUE(replay().empty());
+
+    deliver(8, true, 600);
+    int frames = 0;
+    size_t bytes = 0;
+    cache_.getStats(frames, bytes);
+    EXPECT_EQ(frames, 1);
+    EXPECT_EQ(bytes, 600u);
+}
+
+TEST_F(GopCacheTest, DisabledCacheHoldsNothing) {
+    deliver(1, true);
+    cache_.setLimits(0, 0);
+    EXPECT_FALSE(cache_.enabled());
+    EXPECT_EQ(framesInUse(), 0);
+
+    deliver(2, true);
+    EXPECT_TRUE(replay().empty());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
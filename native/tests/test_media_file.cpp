@@ -0,0 +1,494 @@
+#include <gtest/gtest.h>
+#include "media_file.h"
+#include "file_source.h"
+#include "frame_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+const Bytes kSps = {0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9, 0x40, 0x78};
+const Bytes kPps = {0x68, 0xEB, 0xE3, 0xCB};
+
+// NAL-единицы кадра H.264: IDR или P-слайс (first_mb_in_slice = 0), номер в данных
+Bytes slice_nal(bool keyframe, int number) {
+    return {static_cast<uint8_t>(keyframe ? 0x65 : 0x41), 0x88, static_cast<uint8_t>(number), 0x11, 0x22};
+}
+
+void append(Bytes& output, const Bytes& data) {
+    output.insert(output.end(), data.begin(), data.end());
+}
+
+void append_annexb(Bytes& output, const Bytes& nal) {
+    append(output, {0x00, 0x00, 0x00, 0x01});
+    append(output, nal);
+}
+
+void append_u16(Bytes& output, uint32_t value) {
+    output.push_back(static_cast<uint8_t>(value >> 8));
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+void append_u32(Bytes& output, uint32_t value) {
+    append_u16(output, value >> 16);
+    append_u16(output, value & 0xFFFF);
+}
+
+void append_prefixed(Bytes& output, const Bytes& nal) {
+    append_u32(output, static_cast<uint32_t>(nal.size()));
+    append(output, nal);
+}
+
+Bytes avc_configuration() {
+    Bytes config = {0x01, 0x64, 0x00, 0x28, 0xFF, 0xE1};
+    append_u16(config, static_cast<uint32_t>(kSps.size()));
+    append(config, kSps);
+    config.push_back(0x01);
+    append_u16(config, static_cast<uint32_t>(kPps.size()));
+    append(config, kPps);
+    return config;
+}
+
+Bytes box(const char* type, const Bytes& payload) {
+    Bytes output;
+    append_u32(output, static_cast<uint32_t>(payload.size() + 8));
+    output.insert(output.end(), type, type + 4);
+    append(output, payload);
+    return output;
+}
+
+Bytes full_box(const char* type, const std::vector<uint32_t>& values) {
+    Bytes payload(4, 0);
+    for (uint32_t value : values) {
+        append_u32(payload, value);
+    }
+    return box(type, payload);
+}
+
+// Элемент EBML: ID как есть, размер - 8-байтовый vint (или неизвестный)
+Bytes element(uint32_t id, const Bytes& payload, bool unknownSize = false) {
+    Bytes output;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if ((id >> shift) != 0) output.push_back(static_cast<uint8_t>(id >> shift));
+    }
+    output.push_back(0x01);
+    for (int shift = 48; shift >= 0; shift -= 8) {
+        output.push_back(unknownSize ? 0xFF : static_cast<uint8_t>(payload.size() >> shift));
+    }
+    append(output, payload);
+    return output;
+}
+
+Bytes uint_element(uint32_t id, uint32_t value) {
+    Bytes payload;
+    append_u32(payload, value);
+    return element(id, payload);
+}
+
+Bytes mkv_block(uint8_t id, int16_t relativeTime, bool keyframe, const Bytes& frame) {
+    Bytes payload = {0x81};
+    append_u16(payload, static_cast<uint16_t>(relativeTime));
+    payload.push_back(keyframe ? 0x80 : 0x00);
+    append(payload, frame);
+    return element(id, payload);
+}
+
+class MediaFileTest : public ::testing::Test {
+protected:
+    ~MediaFileTest() override {
+        for (const std::string& path : paths_) {
+            std::remove(path.c_str());
+        }
+    }
+
+    std::string write(const std::string& name, const Bytes& data) {
+        std::string path = ::testing::TempDir() + name;
+        FILE* file = fopen(path.c_str(), "wb");
+        EXPECT_NE(file, nullptr);
+        fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+        paths_.push_back(path);
+        return path;
+    }
+
+    // Элементарный поток: SPS, PPS, IDR, затем P-кадры; кадр 2 из двух слайсов
+    std::string writeElementaryStream(const std::string& name, int frames) {
+        Bytes stream;
+        for (int i = 0; i < frames; i++) {
+            if (i == 0) {
+                append_annexb(stream, kSps);
+                append_annexb(stream, kPps);
+            }
+            append_annexb(stream, slice_nal(i == 0, i));
+            if (i == 2) {
+                append_annexb(stream, {0x41, 0x2A, 0x02});  // first_mb_in_slice != 0
+            }
+        }
+        return write(name, stream);
+    }
+
+    Bytes frame(const MediaFile& file, size_t index) {
+        Bytes output(file.frameSize(file.sample(index)));
+        output.resize(file.writeFrame(file.sample(index), output.data()));
+        return output;
+    }
+
+    std::vector<std::string> paths_;
+};
+
+} // namespace
+
+TEST_F(MediaFileTest, ElementaryStreamSplitsAccessUnits) {
+    std::string path = writeElementaryStream("clip.bin", 5);
+    MediaFile file;
+    std::string error;
+    ASSERT_TRUE(file.open(path, 50, error)) << error;
+
+    EXPECT_EQ(file.container(), MediaFile::Container::AnnexB);
+    EXPECT_EQ(file.codec(), RTPPayloadCodec::H264);
+    ASSERT_EQ(file.sampleCount(), 5u);
+    EXPECT_EQ(file.durationUs(), 100000);
+    for (size_t i = 0; i < file.sampleCount(); i++) {
+        EXPECT_EQ(file.sample(i).keyframe, i == 0);
+        EXPECT_EQ(file.sample(i).decodeTimeUs, static_cast<int64_t>(i) * 20000);
+    }
+
+    // Кадры передаются как есть: наборы параметров с ключевым кадром, слайсы вместе
+    Bytes expected;
+    append_annexb(expected, kSps);
+    append_annexb(expected, kPps);
+    append_annexb(expected, slice_nal(true, 0));
+    EXPECT_EQ(frame(file, 0), expected);
+    EXPECT_EQ(frame(file, 2).size(), 4 + 5 + 4 + 3u);
+}
+
+TEST_F(MediaFileTest, DetectsH265ElementaryStream) {
+    Bytes stream;
+    append_annexb(stream, {0x40, 0x01, 0x0C});              // VPS
+    append_annexb(stream, {0x42, 0x01, 0x01});              // SPS
+    append_annexb(stream, {0x44, 0x01, 0xC1});              // PPS
+    append_annexb(stream, {0x26, 0x01, 0xAF, 0x10});        // IDR_W_RADL
+    append_annexb(stream, {0x02, 0x01, 0xD0, 0x20});        // TRAIL_R
+    MediaFile file;
+    std::string error;
+    ASSERT_TRUE(file.open(write("clip.es", stream), 0, error)) << error;
+
+    EXPECT_EQ(file.codec(), RTPPayloadCodec::H265);
+    ASSERT_EQ(file.sampleCount(), 2u);
+    EXPECT_TRUE(file.sample(0).keyframe);
+    EXPECT_FALSE(file.sample(1).keyframe);
+    EXPECT_EQ(file.sample(1).decodeTimeUs, 1000000 / MediaFile::kDefaultFps);
+}
+
+TEST_F(MediaFileTest, SkipsLongRunsOfEmptyNalUnits) {
+    // Миллион пустых NAL-единиц подряд (3 МБ стартовых кодов) перед потоком и
+    // между кадрами: пропуск не должен расходовать стек
+    const size_t kEmptyNals = 1000000;
+    Bytes emptyNals;
+    emptyNals.reserve(kEmptyNals * 3);
+    for (size_t i = 0; i < kEmptyNals; i++) {
+        append(emptyNals, {0x00, 0x00, 0x01});
+    }
+
+    Bytes stream(emptyNals);
+    append_annexb(stream, kSps);
+    append_annexb(stream, kPps);
+    append_annexb(stream, slice_nal(true, 0));
+    append(stream, emptyNals);
+    append_annexb(stream, slice_nal(false, 1));
+    MediaFile file;
+    std::string error;
+    ASSERT_TRUE(file.open(write("empty_nals.bin", stream), 50, error)) << error;
+
+    EXPECT_EQ(file.codec(), RTPPayloadCodec::H264);
+    ASSERT_EQ(file.sampleCount(), 2u);
+    EXPECT_TRUE(file.sample(0).keyframe);
+    EXPECT_FALSE(file.sample(1).keyframe);
+
+    Bytes expected;
+    append_annexb(expected, kSps);
+    append_annexb(expected, kPps);
+    append_annexb(expected, slice_nal(true, 0));
+    Bytes first = frame(file, 0);
+    ASSERT_GE(first.size(), expected.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), first.begin()));
+}
+
+TEST_F(MediaFileTest, Mp4ConvertsSamplesToAnnexB) {
+    const int kFrames = 6;
+    std::vector<Bytes> samples;
+    for (int i = 0; i < kFrames; i++) {
+        Bytes sample;
+        append_prefixed(sample, slice_nal(i % 3 == 0, i));
+        samples.push_back(sample);
+    }
+
+    // Видеодорожка 90 кГц, 25 кадров/с, сдвиг показа на кадр, два чанка по три кадра
+    auto moov = [&](uint32_t mdatData) {
+        Bytes entry(78, 0);
+        entry[7] = 1;
+        entry[24] = 0x07; entry[25] = 0x80;     // 1920
+        entry[26] = 0x04; entry[27] = 0x38;     // 1080
+        append(entry, box("avcC", avc_configuration()));
+
+        Bytes stsd(4, 0);
+        append_u32(stsd, 1);
+        append(stsd, box("avc1", entry));
+
+        std::vector<uint32_t> sizes = {0, kFrames};
+        uint32_t chunk2 = mdatData;
+        for (int i = 0; i < kFrames; i++) {
+            sizes.push_back(static_cast<uint32_t>(samples[i].size()));
+            if (i < 3) chunk2 += static_cast<uint32_t>(samples[i].size());
+        }
+
+        Bytes stbl = box("stsd", stsd);
+        append(stbl, full_box("stts", {1, kFrames, 3600}));
+        append(stbl, full_box("ctts", {1, kFrames, 3600}));
+        append(stbl, full_box("stss", {2, 1, 4}));
+        append(stbl, full_box("stsz", sizes));
+        append(stbl, full_box("stsc", {1, 1, 3, 1}));
+        append(stbl, full_box("stco", {2, mdatData, chunk2}));
+
+        Bytes hdlr(8, 0);
+        hdlr.insert(hdlr.end(), {'v', 'i', 'd', 'e'});
+        hdlr.resize(hdlr.size() + 13, 0);
+        Bytes mdhd = full_box("mdhd", {0, 0, 90000, kFrames * 3600, 0});
+
+        Bytes mdia = mdhd;
+        append(mdia, box("hdlr", hdlr));
+        append(mdia, box("minf", box("stbl", stbl)));
+        return box("moov", box("trak", box("mdia", mdia)));
+    };
+
+    Bytes data = box("ftyp", {'i', 's', 'o', 'm', 0, 0, 0, 0, 'i', 's', 'o', 'm'});
+    uint32_t mdatData = static_cast<uint32_t>(data.size() + moov(0).size() + 8);
+    append(data, moov(mdatData));
+    Bytes mdat;
+    for (const Bytes& sample : samples) {
+        append(mdat, sample);
+    }
+    append(data, box("mdat", mdat));
+
+    MediaFile file;
+    std::string error;
+    ASSERT_TRUE(file.open(write("clip.mp4", data), 0, error)) << error;
+
+    EXPECT_EQ(file.container(), MediaFile::Container::Mp4);
+    EXPECT_EQ(file.codec(), RTPPayloadCodec::H264);
+    EXPECT_EQ(file.width(), 1920);
+    EXPECT_EQ(file.height(), 1080);
+    ASSERT_EQ(file.sampleCount(), static_cast<size_t>(kFrames));
+    EXPECT_EQ(file.durationUs(), kFrames * 40000);
+    for (int i = 0; i < kFrames; i++) {
+        EXPECT_EQ(file.sample(i).keyframe, i % 3 == 0);
+        EXPECT_EQ(file.sample(i).decodeTimeUs, i * 40000);
+        EXPECT_EQ(file.sample(i).presentationTimeUs, i * 40000 + 40000);
+    }
+
+    // Ключевой кадр получает SPS/PPS из avcC, длины заменены стартовыми кодами
+    Bytes expected;
+    append_annexb(expected, kSps);
+    append_annexb(expected, kPps);
+    append_annexb(expected, slice_nal(true, 3));
+    EXPECT_EQ(frame(file, 3), expected);
+
+    expected.clear();
+    append_annexb(expected, slice_nal(false, 4));
+    EXPECT_EQ(frame(file, 4), expected);
+}
+
+TEST_F(MediaFileTest, MatroskaUnknownSizeClustersAndBFrames) {
+    Bytes video = uint_element(0xB0, 640);
+    append(video, uint_element(0xBA, 360));
+    Bytes track = uint_element(0xD7, 1);
+    append(track, uint_element(0x83, 1));
+    append(track, element(0x86, {'V', '_', 'M', 'P', 'E', 'G', '4', '/', 'I', 'S', 'O', '/', 'A', 'V', 'C'}));
+    append(track, element(0x63A2, avc_configuration()));
+    append(track, element(0xE0, video));
+
+    auto sample = [](bool keyframe, int number) {
+        Bytes data;
+        append_prefixed(data, slice_nal(keyframe, number));
+        return data;
+    };
+
+    // Порядок декодирования I P B (показ 0, 80, 40 мс), затем кластер с BlockGroup
+    Bytes cluster = uint_element(0xE7, 0);
+    append(cluster, mkv_block(0xA3, 0, true, sample(true, 0)));
+    append(cluster, mkv_block(0xA3, 80, false, sample(false, 1)));
+    append(cluster, mkv_block(0xA3, 40, false, sample(false, 2)));
+    Bytes group = mkv_block(0xA1, 0, false, sample(false, 3));
+    append(group, uint_element(0xFB, 40));
+    Bytes second = uint_element(0xE7, 120);
+    append(second, element(0xA0, group));
+
+    Bytes segment = element(0x1549A966, uint_element(0x2AD7B1, 1000000));
+    append(segment, element(0x1654AE6B, element(0xAE, track)));
+    append(segment, element(0x1F43B675, cluster, true));
+    append(segment, element(0x1F43B675, second));
+
+    Bytes data = element(0x1A45DFA3, element(0x4282, {'m', 'a', 't', 'r', 'o', 's', 'k', 'a'}));
+    append(data, element(0x18538067, segment, true));
+
+    MediaFile file;
+    std::string error;
+    ASSERT_TRUE(file.open(write("clip.mkv", data), 0, error)) << error;
+
+    EXPECT_EQ(file.container(), MediaFile::Container::Matroska);
+    EXPECT_EQ(file.width(), 640);
+    EXPECT_EQ(file.height(), 360);
+    ASSERT_EQ(file.sampleCount(), 4u);
+    const int64_t decode[] = {0, 40000, 80000, 120000};
+    const int64_t presentation[] = {0, 80000, 40000, 120000};
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_EQ(file.sample(i).keyframe, i == 0);
+        EXPECT_EQ(file.sample(i).decodeTimeUs, decode[i]);
+        EXPECT_EQ(file.sample(i).presentationTimeUs, presentation[i]);
+    }
+
+    Bytes expected;
+    append_annexb(expected, kSps);
+    append_annexb(expected, kPps);
+    append_annexb(expected, slice_nal(true, 0));
+    EXPECT_EQ(frame(file, 0), expected);
+}
+
+TEST_F(MediaFileTest, RejectsUnsupportedFiles) {
+    MediaFile file;
+    std::string error;
+    EXPECT_FALSE(file.open(::testing::TempDir() + "missing.mp4", 0, error));
+    EXPECT_FALSE(error.empty());
+
+    // Фрагментированный MP4 без moov
+    Bytes data = box("ftyp", {'i', 's', 'o', '6', 0, 0, 0, 0});
+    append(data, box("moof", Bytes(16, 0)));
+    error.clear();
+    EXPECT_FALSE(file.open(write("fragmented.mp4", data), 0, error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_FALSE(file.isOpen());
+
+    // Нет кадров
+    error.clear();
+    EXPECT_FALSE(file.open(write("empty.h264", {0x00, 0x00, 0x01, 0x67, 0x64}), 0, error));
+}
+
+namespace {
+
+// Получатель кадров источника файла
+struct Playback {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> arrivalsUs;
+    bool finished = false;
+
+    static void onFrame(RTSPFrame* frame, void* userData) {
+        Playback* playback = static_cast<Playback*>(userData);
+        int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        {
+            std::lock_guard<std::mutex> lock(playback->mutex);
+            playback->timestamps.push_back(frame->timestamp);
+            playback->arrivalsUs.push_back(nowUs);
+        }
+        FramePool::release(frame);
+        playback->condition.notify_all();
+    }
+
+    static void onStatus(StreamStatus status, const char*, void* userData) {
+        Playback* playback = static_cast<Playback*>(userData);
+        std::lock_guard<std::mutex> lock(playback->mutex);
+        playback->finished = status == STREAM_STATUS_CONNECTED;
+        playback->condition.notify_all();
+    }
+
+    bool waitFinished() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(3), [&] { return finished; });
+    }
+
+    bool waitFrames(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(3), [&] { return timestamps.size() >= count; });
+    }
+
+    int64_t spanUs() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return arrivalsUs.back() - arrivalsUs.front();
+    }
+};
+
+StreamConfig file_config(const std::string& path, StreamPlaybackMode mode, double speed, bool loop) {
+    StreamConfig config = {};
+    config.type = STREAM_TYPE_FILE;
+    snprintf(config.url, sizeof(config.url), "file://%s", path.c_str());
+    config.playbackMode = mode;
+    config.playbackSpeed = speed;
+    config.playbackLoop = loop;
+    config.fileFps = 50;
+    return config;
+}
+
+} // namespace
+
+TEST_F(MediaFileTest, PlaysAtFileRate) {
+    std::string path = writeElementaryStream("paced.h264", 10);
+
+    // 10 кадров по 20 мс: между первым и последним 180 мс, вчетверо быстрее - 45 мс
+    const StreamPlaybackMode modes[] = {STREAM_PLAYBACK_REALTIME, STREAM_PLAYBACK_SCALED};
+    const int64_t expectedSpanUs[] = {180000, 45000};
+    for (int i = 0; i < 2; i++) {
+        Playback playback;
+        FileSource source(Playback::onFrame, Playback::onStatus, &playback);
+        std::string error;
+        ASSERT_TRUE(source.open(file_config(path, modes[i], 4.0, false), error)) << error;
+        ASSERT_TRUE(source.play());
+        ASSERT_TRUE(playback.waitFinished());
+
+        ASSERT_EQ(playback.timestamps.size(), 10u);
+        EXPECT_GE(playback.spanUs(), expectedSpanUs[i] - 5000);
+        EXPECT_LT(playback.spanUs(), expectedSpanUs[i] + 100000);
+        // Время кадров - по файлу, независимо от темпа
+        EXPECT_EQ(playback.timestamps.back() - playback.timestamps.front(), 180000);
+
+        RTSPClientStats stats;
+        source.getStats(&stats);
+        EXPECT_EQ(stats.framesAssembled, 10u);
+        EXPECT_EQ(stats.callbacks, 10u);
+    }
+}
+
+TEST_F(MediaFileTest, LoopsAsFastAsPossible) {
+    std::string path = writeElementaryStream("loop.h264", 4);
+    Playback playback;
+    FileSource source(Playback::onFrame, Playback::onStatus, &playback);
+    std::string error;
+    ASSERT_TRUE(source.open(file_config(path, STREAM_PLAYBACK_AS_FAST_AS_POSSIBLE, 0, true), error)) << error;
+
+    ASSERT_TRUE(source.play());
+    ASSERT_TRUE(playback.waitFrames(40));
+    source.pause();
+
+    std::lock_guard<std::mutex> lock(playback.mutex);
+    EXPECT_FALSE(playback.finished);
+    // При повторе время кадров продолжает расти с шагом кадра
+    for (size_t i = 1; i < 40; i++) {
+        EXPECT_EQ(playback.timestamps[i] - playback.timestamps[i - 1], 20000);
+    }
+    EXPECT_LT(playback.arrivalsUs[39] - playback.arrivalsUs[0], 500000);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
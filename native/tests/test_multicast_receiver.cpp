@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "multicast_receiver.h"
+#include "rtp_reactor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Группа и интерфейс loopback: тесты не зависят от сети узла
+const char* kGroup = "239.255.42.1";
+const char* kLoopback = "127.0.0.1";
+const int kPort = 25400;
+
+struct Counter {
+    std::atomic<int> packets{0};
+    std::atomic<int> bytes{0};
+    uint64_t subscription = 0;
+};
+
+void count_packet(const uint8_t* data, int size, void* context) {
+    (void)data;
+    Counter* counter = static_cast<Counter*>(context);
+    counter->bytes += size;
+    counter->packets++;
+}
+
+// Подписчик, отменяющий подписку на первом пакете
+void unsubscribe_on_packet(const uint8_t* data, int size, void* context) {
+    count_packet(data, size, context);
+    MulticastReceiver::instance().unsubscribe(static_cast<Counter*>(context)->subscription);
+}
+
+class MulticastReceiverTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (!MulticastReceiver::isSupported()) {
+            GTEST_SKIP() << "Reactor is not supported on this platform";
+        }
+        sender_ = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(sender_, 0);
+        struct in_addr loopback;
+        inet_pton(AF_INET, kLoopback, &loopback);
+        setsockopt(sender_, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+        int loop = 1;
+        setsockopt(sender_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+
+    void TearDown() override {
+        if (sender_ >= 0) close(sender_);
+    }
+
+    void send(int port, int size) {
+        char payload[1500];
+        memset(payload, 0x5A, sizeof(payload));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        inet_pton(AF_INET, kGroup, &addr.sin_addr);
+        sendto(sender_, payload, size, 0, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+
+    static bool waitFor(const std::atomic<int>& value, int expected) {
+        for (int i = 0; i < 200 && value.load() < expected; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return value.load() >= expected;
+    }
+
+    uint64_t subscribe(Counter& counter, int port = kPort,
+                       MulticastReceiver::PacketHandler handler = count_packet) {
+        counter.subscription = MulticastReceiver::instance().subscribe(kGroup, port, kLoopback, 1,
+                                                                        handler, &counter);
+        return counter.subscription;
+    }
+
+    MulticastReceiver::Stats stats() {
+        MulticastReceiver::Stats result;
+        MulticastReceiver::instance().getStats(result);
+        return result;
+    }
+
+    int sender_ = -1;
+};
+
+} // namespace
+
+TEST(MulticastAddressTest, RecognizesGroupAddresses) {
+    EXPECT_TRUE(multicast_is_group_address("224.0.0.1"));
+    EXPECT_TRUE(multicast_is_group_address("239.255.42.1"));
+    EXPECT_FALSE(multicast_is_group_address("192.168.1.10"));
+    EXPECT_FALSE(multicast_is_group_address("240.0.0.1"));
+    EXPECT_FALSE(multicast_is_group_address("camera.local"));
+    EXPECT_FALSE(multicast_is_group_address(""));
+}
+
+TEST_F(MulticastReceiverTest, SharesOneSocketBetweenSubscribers) {
+    Counter first, second;
+    ASSERT_NE(subscribe(first), 0u);
+    ASSERT_NE(subscribe(second), 0u);
+
+    MulticastReceiver::Stats before = stats();
+    EXPECT_EQ(before.groups, 1);
+    EXPECT_EQ(before.subscribers, 2);
+
+    send(kPort, 100);
+    send(kPort, 200);
+    ASSERT_TRUE(waitFor(first.packets, 2));
+    ASSERT_TRUE(waitFor(second.packets, 2));
+    EXPECT_EQ(first.bytes.load(), 300);
+    EXPECT_EQ(second.bytes.load(), 300);
+
+    // Датаграмма принята один раз и выдана обоим подписчикам
+    MulticastReceiver::Stats after = stats();
+    EXPECT_EQ(after.datagrams - before.datagrams, 2u);
+    EXPECT_EQ(after.deliveries - before.deliveries, 4u);
+
+    MulticastReceiver::instance().unsubscribe(first.subscription);
+    MulticastReceiver::instance().unsubscribe(second.subscription);
+    EXPECT_EQ(stats().groups, 0);
+}
+
+TEST_F(MulticastReceiverTest, UnsubscribedHandlerIsNotCalled) {
+    Counter staying, leaving;
+    ASSERT_NE(subscribe(staying), 0u);
+    ASSERT_NE(subscribe(leaving), 0u);
+
+    MulticastReceiver::instance().unsubscribe(leaving.subscription);
+    send(kPort, 64);
+    ASSERT_TRUE(waitFor(staying.packets, 1));
+    EXPECT_EQ(leaving.packets.load(), 0);
+
+    MulticastReceiver::instance().unsubscribe(staying.subscription);
+    EXPECT_EQ(stats().groups, 0);
+}
+
+TEST_F(MulticastReceiverTest, UnsubscribeFromHandler) {
+    Counter counter;
+    ASSERT_NE(subscribe(counter, kPort, unsubscribe_on_packet), 0u);
+
+    send(kPort, 32);
+    ASSERT_TRUE(waitFor(counter.packets, 1));
+
+    // Последний подписчик ушел из обработчика: сокет группы закрыт
+    for (int i = 0; i < 200 && stats().groups != 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(stats().groups, 0);
+
+    send(kPort, 32);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(counter.packets.load(), 1);
+}
+
+TEST_F(MulticastReceiverTest, SendsToGroupPort) {
+    // Отчет в RTCP порт группы получают и локальные подписчики этого порта
+    Counter rtp, rtcp;
+    ASSERT_NE(subscribe(rtp, kPort), 0u);
+    ASSERT_NE(subscribe(rtcp, kPort + 1), 0u);
+    EXPECT_EQ(stats().groups, 2);
+
+    const uint8_t report[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+    EXPECT_TRUE(MulticastReceiver::instance().send(rtp.subscription, kPort + 1, 1, report, sizeof(report)));
+    ASSERT_TRUE(waitFor(rtcp.packets, 1));
+    EXPECT_EQ(rtcp.bytes.load(), 8);
+    EXPECT_EQ(rtp.packets.load(), 0);
+
+    MulticastReceiver::instance().unsubscribe(rtp.subscription);
+    MulticastReceiver::instance().unsubscribe(rtcp.subscription);
+    EXPECT_FALSE(MulticastReceiver::instance().send(rtp.subscription, kPort + 1, 1, report, sizeof(report)));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    RTPReactor::instance().shutdown();
+    return result;
+}
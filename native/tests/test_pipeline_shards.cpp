@@ -0,0 +1,264 @@
+#include <gtest/gtest.h>
+#include "pipeline_shards.h"
+#include "frame_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+// Обработчик очереди: запоминает номера кадров (timestamp), потоки и ядра
+struct LaneLog {
+    std::mutex mutex;
+    std::vector<int64_t> numbers;
+    std::set<std::thread::id> threads;
+    std::set<int> cpus;
+    std::atomic<size_t> count{0};
+    int delayMs = 0;
+    PipelineShards* shards = nullptr;       // Отключение своей очереди из обработчика
+    std::shared_ptr<PipelineLane> lane;
+
+    static void onFrame(RTSPFrame* frame, void* context) {
+        LaneLog* log = static_cast<LaneLog*>(context);
+        if (log->delayMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(log->delayMs));
+        }
+        {
+            std::lock_guard<std::mutex> lock(log->mutex);
+            log->numbers.push_back(frame->timestamp);
+            log->threads.insert(std::this_thread::get_id());
+#ifdef __linux__
+            log->cpus.insert(sched_getcpu());
+#endif
+        }
+        FramePool::release(frame);
+        if (log->shards) {
+            log->shards->detach(log->lane);
+        }
+        log->count++;
+    }
+
+    bool waitFor(size_t frames) {
+        for (int i = 0; i < 500 && count < frames; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return count >= frames;
+    }
+
+    bool inOrder() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::is_sorted(numbers.begin(), numbers.end());
+    }
+
+    std::thread::id thread() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return threads.size() == 1 ? *threads.begin() : std::thread::id();
+    }
+};
+
+PipelineShards::Params shard_params(int count, bool pin) {
+    PipelineShards::Params params;
+    params.shardCount = count;
+    params.pinThreads = pin;
+    params.numaAware = false;
+    return params;
+}
+
+void push_frames(FramePool* pool, PipelineLane& lane, int64_t first, int count) {
+    for (int i = 0; i < count; i++) {
+        RTSPFrame* frame = pool->acquire(64);
+        frame->size = 64;
+        frame->timestamp = first + i;
+        lane.push(frame);
+    }
+}
+
+} // namespace
+
+TEST(PipelineShardsTest, LaneFramesStayOnOneShardThreadInOrder) {
+    PipelineShards shards(shard_params(3, false));
+    ASSERT_EQ(shards.shardCount(), 3);
+
+    std::vector<std::unique_ptr<LaneLog>> logs;
+    std::vector<std::shared_ptr<PipelineLane>> lanes;
+    for (int i = 0; i < 6; i++) {
+        logs.emplace_back(new LaneLog());
+        lanes.push_back(std::make_shared<PipelineLane>(
+            256, RTSP_FRAME_QUEUE_BLOCK, LaneLog::onFrame, logs.back().get()));
+        shards.attach(lanes.back());
+    }
+
+    // Очереди распределены поровну
+    for (int s = 0; s < 3; s++) {
+        PipelineShardStats stats;
+        ASSERT_TRUE(shards.getStats(s, &stats));
+        EXPECT_EQ(stats.lanes, 2);
+    }
+
+    // Каждой очереди - свой производитель
+    std::vector<std::thread> producers;
+    for (auto& lane : lanes) {
+        producers.emplace_back([&lane] {
+            FramePool* pool = FramePool::create();
+            push_frames(pool, *lane, 0, 500);
+            pool->detach();
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    for (size_t i = 0; i < lanes.size(); i++) {
+        ASSERT_TRUE(logs[i]->waitFor(500));
+        EXPECT_TRUE(logs[i]->inOrder());
+        EXPECT_NE(logs[i]->thread(), std::thread::id());
+        EXPECT_EQ(lanes[i]->frames(), 500u);
+    }
+
+    // Очереди одного шарда обрабатывает один поток, разных - разные
+    for (size_t i = 0; i < lanes.size(); i++) {
+        for (size_t j = i + 1; j < lanes.size(); j++) {
+            EXPECT_EQ(lanes[i]->shard() == lanes[j]->shard(), logs[i]->thread() == logs[j]->thread());
+        }
+    }
+
+    for (auto& lane : lanes) {
+        shards.detach(lane);
+    }
+}
+
+TEST(PipelineShardsTest, PinsShardThreadsToCpus) {
+    PipelineShards shards(shard_params(2, true));
+    std::vector<std::unique_ptr<LaneLog>> logs;
+    std::vector<std::shared_ptr<PipelineLane>> lanes;
+    FramePool* pool = FramePool::create();
+    for (int i = 0; i < 2; i++) {
+        logs.emplace_back(new LaneLog());
+        lanes.push_back(std::make_shared<PipelineLane>(
+            64, RTSP_FRAME_QUEUE_BLOCK, LaneLog::onFrame, logs.back().get()));
+        shards.attach(lanes.back());
+        push_frames(pool, *lanes.back(), 0, 50);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        ASSERT_TRUE(logs[i]->waitFor(50));
+        PipelineShardStats stats;
+        ASSERT_TRUE(shards.getStats(lanes[i]->shard(), &stats));
+#ifdef __linux__
+        // Все кадры обработаны на ядре шарда
+        EXPECT_GE(stats.cpu, 0);
+        EXPECT_EQ(logs[i]->cpus, std::set<int>{stats.cpu});
+#endif
+        shards.detach(lanes[i]);
+    }
+    pool->detach();
+}
+
+TEST(PipelineShardsTest, NumaOrderCoversAllowedCpus) {
+    std::vector<int> nodes;
+    std::vector<int> plain = PipelineShards::shardCpus(false, nullptr);
+    std::vector<int> numa = PipelineShards::shardCpus(true, &nodes);
+    ASSERT_FALSE(plain.empty());
+    EXPECT_EQ(nodes.size(), numa.size());
+
+    std::sort(numa.begin(), numa.end());
+    EXPECT_EQ(numa, plain);
+}
+
+TEST(PipelineShardsTest, RebalanceMovesLoadFromBusiestShard) {
+    PipelineShards shards(shard_params(2, false));
+
+    // Тяжелые очереди 0 и 2 оказываются на одном шарде
+    std::vector<std::unique_ptr<LaneLog>> logs;
+    std::vector<std::shared_ptr<PipelineLane>> lanes;
+    for (int i = 0; i < 4; i++) {
+        logs.emplace_back(new LaneLog());
+        logs.back()->delayMs = i % 2 == 0 ? 2 : 0;
+        lanes.push_back(std::make_shared<PipelineLane>(
+            64, RTSP_FRAME_QUEUE_BLOCK, LaneLog::onFrame, logs.back().get()));
+        shards.attach(lanes.back());
+    }
+    ASSERT_EQ(lanes[0]->shard(), lanes[2]->shard());
+    ASSERT_NE(lanes[0]->shard(), lanes[1]->shard());
+
+    FramePool* pool = FramePool::create();
+    for (size_t i = 0; i < lanes.size(); i++) {
+        push_frames(pool, *lanes[i], 0, 20);
+    }
+    for (auto& log : logs) {
+        ASSERT_TRUE(log->waitFor(20));
+    }
+
+    // Одна тяжелая очередь переносится на свободный шард
+    EXPECT_EQ(shards.rebalance(), 1);
+    EXPECT_NE(lanes[0]->shard(), lanes[2]->shard());
+
+    // Кадры перенесенной очереди обрабатываются по порядку потоком нового шарда
+    for (size_t i = 0; i < lanes.size(); i += 2) {
+        push_frames(pool, *lanes[i], 20, 20);
+    }
+    for (size_t i = 0; i < lanes.size(); i += 2) {
+        ASSERT_TRUE(logs[i]->waitFor(40));
+        EXPECT_TRUE(logs[i]->inOrder());
+    }
+    size_t moved = lanes[0]->shard() == lanes[1]->shard() ? 0 : 2;
+    EXPECT_EQ(logs[moved]->threads.size(), 2u);
+
+    // Нагрузка выровнена: повторная балансировка ничего не переносит
+    EXPECT_EQ(shards.rebalance(), 0);
+
+    for (auto& lane : lanes) {
+        shards.detach(lane);
+    }
+    pool->detach();
+}
+
+TEST(PipelineShardsTest, DetachStopsHandler) {
+    PipelineShards shards(shard_params(1, false));
+    FramePool* pool = FramePool::create();
+
+    LaneLog log;
+    auto lane = std::make_shared<PipelineLane>(64, RTSP_FRAME_QUEUE_BLOCK, LaneLog::onFrame, &log);
+    shards.attach(lane);
+    push_frames(pool, *lane, 0, 5);
+    ASSERT_TRUE(log.waitFor(5));
+
+    shards.detach(lane);
+    EXPECT_EQ(lane->shard(), -1);
+    RTSPFrame* frame = pool->acquire(64);
+    EXPECT_FALSE(lane->push(frame));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(log.count, 5u);
+
+    // Отключение из обработчика своей очереди: следующие кадры не обрабатываются
+    LaneLog self;
+    self.shards = &shards;
+    self.lane = std::make_shared<PipelineLane>(64, RTSP_FRAME_QUEUE_BLOCK, LaneLog::onFrame, &self);
+    shards.attach(self.lane);
+    push_frames(pool, *self.lane, 0, 10);
+    ASSERT_TRUE(self.waitFor(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(self.count, 1u);
+    EXPECT_EQ(self.lane->shard(), -1);
+
+    PipelineShardStats stats;
+    ASSERT_TRUE(shards.getStats(0, &stats));
+    EXPECT_EQ(stats.lanes, 0);
+    EXPECT_EQ(stats.frames, 6u);
+    pool->detach();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include "rtcp_session.h"
+
+#include <vector>
+
+namespace {
+
+const uint32_t kSourceSsrc = 0x11223344;
+const int64_t kNowUs = 1700000000LL * 1000000;
+
+uint32_t read32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// SR без блоков отчетов, NTP время соответствует unixSeconds
+std::vector<uint8_t> sender_report(uint32_t ssrc, uint32_t unixSeconds, uint32_t rtpTimestamp) {
+    std::vector<uint8_t> packet = {0x80, 200, 0, 6};
+    put32(packet, ssrc);
+    put32(packet, unixSeconds + 2208988800u);
+    put32(packet, 0x80000000u);     // 0.5 секунды
+    put32(packet, rtpTimestamp);
+    put32(packet, 100);
+    put32(packet, 10000);
+    return packet;
+}
+
+} // namespace
+
+TEST(RTCPSessionTest, SenderReportMapsRtpTimeToWallClock) {
+    RTCPSession session;
+    session.setClockRate(90000);
+    session.onRtpPacket(kSourceSsrc, 1, 1000, kNowUs);
+
+    std::vector<uint8_t> sr = sender_report(kSourceSsrc, 1700000000u, 90000);
+    ASSERT_TRUE(session.onRtcpPacket(sr.data(), sr.size(), kNowUs));
+
+    bool synchronized = false;
+    EXPECT_EQ(session.frameTime(90000, synchronized), 1700000000500000LL);
+    EXPECT_TRUE(synchronized);
+
+    // Секундой позже по RTP времени
+    EXPECT_EQ(session.frameTime(180000, synchronized), 1700000001500000LL);
+}
+
+TEST(RTCPSessionTest, FrameTimeUnwrapsRtpTimestamp) {
+    RTCPSession session;
+    session.setClockRate(90000);
+    session.onRtpPacket(kSourceSsrc, 1, 0xFFFFFF00u, kNowUs);
+
+    bool synchronized = true;
+    int64_t before = session.frameTime(0xFFFFFF00u, synchronized);
+    EXPECT_FALSE(synchronized);
+    EXPECT_EQ(before, kNowUs);
+
+    // Переполнение 32-битного timestamp не возвращает время назад
+    int64_t after = session.frameTime(0x00000100u, synchronized);
+    EXPECT_EQ(after - before, 0x200 * 1000000LL / 90000);
+}
+
+TEST(RTCPSessionTest, IgnoresSenderReportOfOtherSource) {
+    RTCPSession session;
+    session.onRtpPacket(kSourceSsrc, 1, 1000, kNowUs);
+
+    std::vector<uint8_t> sr = sender_report(0x55555555, 1700000000u, 1000);
+    EXPECT_FALSE(session.onRtcpPacket(sr.data(), sr.size(), kNowUs));
+}
+
+TEST(RTCPSessionTest, ReceiverReportCountsLoss) {
+    RTCPSession session;
+    // 10 пакетов с 65530 с переходом через 0, два потеряны
+    for (uint32_t i = 0; i < 10; i++) {
+        if (i == 3 || i == 7) continue;
+        session.onRtpPacket(kSourceSsrc, static_cast<uint16_t>(65530 + i), i * 3000, kNowUs + i * 33333);
+    }
+
+    uint8_t report[128];
+    size_t size = session.buildReceiverReport(report, sizeof(report), kNowUs + 1000000);
+    ASSERT_EQ(size, 52u);
+
+    EXPECT_EQ(report[0], 0x81);
+    EXPECT_EQ(report[1], 201);
+    EXPECT_EQ(read32(report + 4), session.localSsrc());
+
+    const uint8_t* block = report + 8;
+    EXPECT_EQ(read32(block), kSourceSsrc);
+    EXPECT_EQ(block[4], (2 << 8) / 10);                     // fraction lost
+    EXPECT_EQ(read32(block + 4) & 0xFFFFFF, 2u);            // cumulative lost
+    EXPECT_EQ(read32(block + 8), 0x10000u + 3);             // extended highest sequence
+    EXPECT_EQ(read32(block + 16), 0u);                      // SR еще не было
+
+    // SDES CNAME
+    const uint8_t* sdes = report + 32;
+    EXPECT_EQ(sdes[1], 202);
+    EXPECT_EQ(sdes[8], 1);
+
+    // Следующий интервал без потерь
+    session.onRtpPacket(kSourceSsrc, 4, 30000, kNowUs + 1100000);
+    session.buildReceiverReport(report, sizeof(report), kNowUs + 2000000);
+    EXPECT_EQ(report[8 + 4], 0);
+}
+
+TEST(RTCPSessionTest, ReceiverReportEchoesSenderReport) {
+    RTCPSession session;
+    session.onRtpPacket(kSourceSsrc, 1, 1000, kNowUs);
+    std::vector<uint8_t> sr = sender_report(kSourceSsrc, 1700000000u, 1000);
+    session.onRtcpPacket(sr.data(), sr.size(), kNowUs);
+
+    uint8_t report[128];
+    ASSERT_GT(session.buildReceiverReport(report, sizeof(report), kNowUs + 500000), 0u);
+
+    const uint8_t* block = report + 8;
+    uint32_t expectedLsr = ((1700000000u + 2208988800u) << 16) | 0x8000;
+    EXPECT_EQ(read32(block + 16), expectedLsr);
+    EXPECT_EQ(read32(block + 20), 32768u);                  // 0.5 секунды в 1/65536
+}
+
+TEST(RTCPSessionTest, ReceiverReportWithoutSourceHasNoBlocks) {
+    RTCPSession session;
+    uint8_t report[128];
+    size_t size = session.buildReceiverReport(report, sizeof(report), kNowUs);
+    EXPECT_EQ(size, 28u);
+    EXPECT_EQ(report[0], 0x80);
+    EXPECT_EQ(session.buildReceiverReport(report, 16, kNowUs), 0u);
+}
+
+TEST(RTCPSessionTest, KeyframeRequestAfterLoss) {
+    RTCPSession session;
+    session.onRtpPacket(kSourceSsrc, 1, 1000, kNowUs);
+
+    uint8_t packet[128];
+    EXPECT_FALSE(session.keyframeRequestDue(kNowUs));
+    EXPECT_EQ(session.buildKeyframeRequest(packet, sizeof(packet), kNowUs), 0u);
+
+    session.onFrameLoss(kNowUs);
+    ASSERT_TRUE(session.keyframeRequestDue(kNowUs));
+
+    // RR + SDES + PLI
+    size_t size = session.buildKeyframeRequest(packet, sizeof(packet), kNowUs);
+    ASSERT_EQ(size, 52u + 12u);
+    const uint8_t* pli = packet + 52;
+    EXPECT_EQ(pli[0], 0x81);
+    EXPECT_EQ(pli[1], 206);
+    EXPECT_EQ(pli[3], 2);
+    EXPECT_EQ(read32(pli + 4), session.localSsrc());
+    EXPECT_EQ(read32(pli + 8), kSourceSsrc);
+
+    // Ограничение частоты
+    EXPECT_FALSE(session.keyframeRequestDue(kNowUs + 100000));
+    EXPECT_EQ(session.buildKeyframeRequest(packet, sizeof(packet), kNowUs + 100000), 0u);
+
+    // Камера не ответила: FIR с номером команды
+    int64_t retryUs = kNowUs + RTCPSession::kKeyframeRequestIntervalUs;
+    size = session.buildKeyframeRequest(packet, sizeof(packet), retryUs);
+    ASSERT_EQ(size, 52u + 20u);
+    const uint8_t* fir = packet + 52;
+    EXPECT_EQ(fir[0], 0x84);
+    EXPECT_EQ(fir[1], 206);
+    EXPECT_EQ(fir[3], 4);
+    EXPECT_EQ(read32(fir + 8), 0u);
+    EXPECT_EQ(read32(fir + 12), kSourceSsrc);
+    EXPECT_EQ(fir[16], 0);
+
+    size = session.buildKeyframeRequest(packet, sizeof(packet), retryUs + RTCPSession::kKeyframeRequestIntervalUs);
+    ASSERT_EQ(size, 52u + 20u);
+    EXPECT_EQ(packet[52 + 16], 1);
+
+    RTCPSession::KeyframeRequestStats stats;
+    session.getKeyframeRequestStats(stats);
+    EXPECT_EQ(stats.pliSent, 1u);
+    EXPECT_EQ(stats.firSent, 2u);
+    EXPECT_EQ(stats.recoveries, 0u);
+}
+
+TEST(RTCPSessionTest, KeyframeEndsRecovery) {
+    RTCPSession session;
+    session.onRtpPacket(kSourceSsrc, 1, 1000, kNowUs);
+    session.onFrameLoss(kNowUs);
+
+    uint8_t packet[128];
+    ASSERT_GT(session.buildKeyframeRequest(packet, sizeof(packet), kNowUs), 0u);
+
+    // Повторная потеря до ключевого кадра не сдвигает начало восстановления
+    session.onFrameLoss(kNowUs + 50000);
+    session.onFrame(false, kNowUs + 100000);
+    session.onFrame(true, kNowUs + 250000);
+    EXPECT_FALSE(session.keyframeRequestDue(kNowUs + 10000000));
+
+    RTCPSession::KeyframeRequestStats stats;
+    session.getKeyframeRequestStats(stats);
+    EXPECT_EQ(stats.recoveries, 1u);
+    EXPECT_EQ(stats.lastRecoveryUs, 250000);
+    EXPECT_EQ(stats.maxRecoveryUs, 250000);
+
+    // Следующая потеря снова начинается с PLI
+    session.onFrameLoss(kNowUs + 20000000);
+    size_t size = session.buildKeyframeRequest(packet, sizeof(packet), kNowUs + 20000000);
+    ASSERT_EQ(size, 52u + 12u);
+    EXPECT_EQ(packet[52], 0x81);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
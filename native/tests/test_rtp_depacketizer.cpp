@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "rtp_depacketizer.h"
+
+#include <vector>
+
+namespace {
+
+struct CollectedUnits {
+    std::vector<std::vector<uint8_t>> units;
+    std::vector<bool> keyframes;
+    std::vector<uint32_t> timestamps;
+};
+
+void collect_unit(const AccessUnit& au, void* context) {
+    CollectedUnits* collected = static_cast<CollectedUnits*>(context);
+    collected->units.emplace_back(au.data, au.data + au.size);
+    collected->keyframes.push_back(au.keyframe);
+    collected->timestamps.push_back(au.rtpTimestamp);
+}
+
+void push(RTPDepacketizer& depacketizer, const std::vector<uint8_t>& payload,
+          uint32_t timestamp, bool marker, CollectedUnits& collected) {
+    depacketizer.push(payload.data(), payload.size(), timestamp, marker, collect_unit, &collected);
+}
+
+} // namespace
+
+TEST(RTPDepacketizerTest, CodecFromName) {
+    EXPECT_EQ(rtp_payload_codec_from_name("H264"), RTPPayloadCodec::H264);
+    EXPECT_EQ(rtp_payload_codec_from_name("h265"), RTPPayloadCodec::H265);
+    EXPECT_EQ(rtp_payload_codec_from_name("HEVC"), RTPPayloadCodec::H265);
+    EXPECT_EQ(rtp_payload_codec_from_name("PCMU"), RTPPayloadCodec::Unknown);
+}
+
+TEST(RTPDepacketizerTest, H264SingleNalUnitsFormOneAccessUnit) {
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H264);
+    CollectedUnits collected;
+
+    push(depacketizer, {0x67, 0x42}, 1000, false, collected);  // SPS
+    push(depacketizer, {0x68, 0xCE}, 1000, false, collected);  // PPS
+    push(depacketizer, {0x65, 0x88}, 1000, true, collected);   // IDR
+
+    ASSERT_EQ(collected.units.size(), 1u);
+    std::vector<uint8_t> expected = {
+        0, 0, 0, 1, 0x67, 0x42,
+        0, 0, 0, 1, 0x68, 0xCE,
+        0, 0, 0, 1, 0x65, 0x88
+    };
+    EXPECT_EQ(collected.units[0], expected);
+    EXPECT_TRUE(collected.keyframes[0]);
+    EXPECT_EQ(collected.timestamps[0], 1000u);
+}
+
+TEST(RTPDepacketizerTest, H264StapA) {
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H264);
+    CollectedUnits collected;
+
+    push(depacketizer, {0x18, 0x00, 0x02, 0x67, 0x42, 0x00, 0x02, 0x68, 0xCE}, 10, true, collected);
+
+    ASSERT_EQ(collected.units.size(), 1u);
+    std::vector<uint8_t> expected = {0, 0, 0, 1, 0x67, 0x42, 0, 0, 0, 1, 0x68, 0xCE};
+    EXPECT_EQ(collected.units[0], expected);
+    EXPECT_FALSE(collected.keyframes[0]);
+}
+
+TEST(RTPDepacketizerTest, H264FuAReassembly) {
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H264);
+    CollectedUnits collected;
+
+    // FU индикатор 0x7C (NRI=3, тип 28), заголовки FU: S|IDR, IDR, E|IDR
+    push(depacketizer, {0x7C, 0x85, 0x01, 0x02}, 20, false, collected);
+    push(depacketizer, {0x7C, 0x05, 0x03}, 20, false, collected);
+    push(depacketizer, {0x7C, 0x45, 0x04}, 20, true, collected);
+
+    ASSERT_EQ(collected.units.size(), 1u);
+    std::vector<uint8_t> expected = {0, 0, 0, 1, 0x65, 0x01, 0x02, 0x03, 0x04};
+    EXPECT_EQ(collected.units[0], expected);
+    EXPECT_TRUE(collected.keyframes[0]);
+}
+
+TEST(RTPDepacketizerTest, H264FuAWithoutStartIsDropped) {
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H264);
+    CollectedUnits collected;
+
+    push(depacketizer, {0x7C, 0x01, 0x03}, 30, false, collected);
+    push(depacketizer, {0x7C, 0x41, 0x04}, 30, true, collected);
+
+    EXPECT_TRUE(collected.units.empty());
+}
+
+TEST(RTPDepacketizerTest, TimestampChangeFlushesAccessUnit) {
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H264);
+    CollectedUnits collected;
+
+    push(depacketizer, {0x41, 0x01}, 100, false, collected);
+    push(depacketizer, {0x41, 0x02}, 200, true, collected);
+
+    ASSERT_EQ(collected.units.size(), 2u);
+    EXPECT_EQ(collected.timestamps[0], 100u);
+    EXPECT_EQ(collected.timestamps[1], 200u);
+}
+
+TEST(RTPDepacketizerTest, H265FuReassembly) {
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H265);
+    CollectedUnits collected;
+
+    // Заголовок FU: тип 49 -> 0x62 0x01, FU заголовок: S|IDR_W_RADL(19), E|19
+    push(depacketizer, {0x62, 0x01, 0x93, 0xAA}, 40, false, collected);
+    push(depacketizer, {0x62, 0x01, 0x53, 0xBB}, 40, true, collected);
+
+    ASSERT_EQ(collected.units.size(), 1u);
+    std::vector<uint8_t> expected = {0, 0, 0, 1, 0x26, 0x01, 0xAA, 0xBB};
+    EXPECT_EQ(collected.units[0], expected);
+    EXPECT_TRUE(collected.keyframes[0]);
+}
+
+TEST(RTPDepacketizerTest, H265AggregationPacket) {
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H265);
+    CollectedUnits collected;
+
+    // AP (тип 48): VPS (0x40 0x01) и SPS (0x42 0x01)
+    push(depacketizer, {0x60, 0x01, 0x00, 0x03, 0x40, 0x01, 0x0C, 0x00, 0x02, 0x42, 0x01},
+         50, true, collected);
+
+    ASSERT_EQ(collected.units.size(), 1u);
+    std::vector<uint8_t> expected = {0, 0, 0, 1, 0x40, 0x01, 0x0C, 0, 0, 0, 1, 0x42, 0x01};
+    EXPECT_EQ(collected.units[0], expected);
+    EXPECT_FALSE(collected.keyframes[0]);
+}
+
+TEST(RTPDepacketizerTest, UnknownCodecPassesPayloadThrough) {
+    RTPDepacketizer depacketizer;
+    CollectedUnits collected;
+
+    push(depacketizer, {0x01, 0x02, 0x03}, 60, false, collected);
+
+    ASSERT_EQ(collected.units.size(), 1u);
+    EXPECT_EQ(collected.units[0], (std::vector<uint8_t>{0x01, 0x02, 0x03}));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "rtp_jitter_buffer.h"
+#include "rtp_depacketizer.h"
+
+#include <vector>
+
+namespace {
+
+struct Output {
+    std::vector<uint16_t> sequences;
+    std::vector<bool> discontinuities;
+};
+
+void collect_packet(const RTPOrderedPacket& packet, bool discontinuity, void* context) {
+    Output* output = static_cast<Output*>(context);
+    output->sequences.push_back(packet.sequence);
+    output->discontinuities.push_back(discontinuity);
+}
+
+void insert(RTPJitterBuffer& buffer, uint16_t sequence, int64_t nowUs, Output& output) {
+    uint8_t payload[2] = {static_cast<uint8_t>(sequence >> 8), static_cast<uint8_t>(sequence)};
+    buffer.insert(payload, sizeof(payload), sequence, 1000, false, nowUs, collect_packet, &output);
+}
+
+} // namespace
+
+TEST(RTPJitterBufferTest, InOrderPacketsPassThrough) {
+    RTPJitterBuffer buffer;
+    Output output;
+
+    for (uint16_t seq = 10; seq < 15; seq++) {
+        insert(buffer, seq, 1000000, output);
+    }
+
+    EXPECT_EQ(output.sequences, (std::vector<uint16_t>{10, 11, 12, 13, 14}));
+    EXPECT_EQ(buffer.counters().packetsLost.load(), 0u);
+    EXPECT_EQ(buffer.counters().packetsReordered.load(), 0u);
+}
+
+TEST(RTPJitterBufferTest, ReordersWithinDepth) {
+    RTPJitterBuffer buffer;
+    buffer.setDepth(50);
+    Output output;
+
+    insert(buffer, 1, 1000000, output);
+    insert(buffer, 3, 1001000, output);
+    insert(buffer, 2, 1002000, output);
+
+    EXPECT_EQ(output.sequences, (std::vector<uint16_t>{1, 2, 3}));
+    EXPECT_EQ(output.discontinuities, (std::vector<bool>{false, false, false}));
+    EXPECT_EQ(buffer.counters().packetsReordered.load(), 1u);
+    EXPECT_EQ(buffer.counters().packetsLost.load(), 0u);
+}
+
+TEST(RTPJitterBufferTest, SequenceWraparound) {
+    RTPJitterBuffer buffer;
+    Output output;
+
+    insert(buffer, 65534, 1000000, output);
+    insert(buffer, 0, 1001000, output);
+    insert(buffer, 65535, 1002000, output);
+    insert(buffer, 1, 1003000, output);
+
+    EXPECT_EQ(output.sequences, (std::vector<uint16_t>{65534, 65535, 0, 1}));
+    EXPECT_EQ(buffer.counters().packetsLost.load(), 0u);
+}
+
+TEST(RTPJitterBufferTest, GapDeclaredLostAfterDepth) {
+    RTPJitterBuffer buffer;
+    buffer.setDepth(20);
+    Output output;
+
+    insert(buffer, 1, 1000000, output);
+    insert(buffer, 3, 1005000, output);
+    EXPECT_EQ(output.sequences.size(), 1u);
+
+    // Через 20 мс после обнаружения пропуска пакет 2 считается потерянным
+    insert(buffer, 4, 1026000, output);
+
+    EXPECT_EQ(output.sequences, (std::vector<uint16_t>{1, 3, 4}));
+    EXPECT_EQ(output.discontinuities, (std::vector<bool>{false, true, false}));
+    EXPECT_EQ(buffer.counters().packetsLost.load(), 1u);
+
+    // Опоздавший пакет 2 уже не выдается
+    insert(buffer, 2, 1027000, output);
+    EXPECT_EQ(output.sequences.size(), 3u);
+    EXPECT_EQ(buffer.counters().packetsLate.load(), 1u);
+}
+
+TEST(RTPJitterBufferTest, ZeroDepthReportsLossImmediately) {
+    RTPJitterBuffer buffer;
+    buffer.setDepth(0);
+    Output output;
+
+    insert(buffer, 100, 1000000, output);
+    insert(buffer, 103, 1000000, output);
+
+    EXPECT_EQ(output.sequences, (std::vector<uint16_t>{100, 103}));
+    EXPECT_EQ(output.discontinuities, (std::vector<bool>{false, true}));
+    EXPECT_EQ(buffer.counters().packetsLost.load(), 2u);
+}
+
+TEST(RTPJitterBufferTest, DuplicatesAreCounted) {
+    RTPJitterBuffer buffer;
+    Output output;
+
+    insert(buffer, 1, 1000000, output);
+    insert(buffer, 3, 1000000, output);
+    insert(buffer, 3, 1000000, output);
+
+    EXPECT_EQ(buffer.counters().packetsDuplicate.load(), 1u);
+}
+
+namespace {
+
+// Сборка кадров H.264 за буфером без ожидания, как в потоке приема клиента
+struct FrameAssembly {
+    RTPJitterBuffer buffer;
+    RTPDepacketizer depacketizer{RTPPayloadCodec::H264};
+    std::vector<uint32_t> frames;   // RTP timestamp собранных кадров
+
+    FrameAssembly() { buffer.setDepth(0); }
+
+    static void onFrame(const AccessUnit& au, void* context) {
+        static_cast<FrameAssembly*>(context)->frames.push_back(au.rtpTimestamp);
+    }
+
+    static void onPacket(const RTPOrderedPacket& packet, bool discontinuity, void* context) {
+        FrameAssembly* self = static_cast<FrameAssembly*>(context);
+        if (discontinuity) {
+            int dropped = self->depacketizer.onPacketLoss(packet.payload, packet.size, packet.timestamp);
+            self->buffer.counters().framesDropped.fetch_add(static_cast<uint64_t>(dropped));
+        }
+        self->depacketizer.push(packet.payload, packet.size, packet.timestamp, packet.marker,
+                                onFrame, self);
+    }
+
+    void insert(const std::vector<uint8_t>& payload, uint16_t sequence, uint32_t timestamp,
+                bool marker) {
+        buffer.insert(payload.data(), payload.size(), sequence, timestamp, marker, 1000000,
+                      onPacket, this);
+    }
+};
+
+// FU-A фрагменты IDR: начало, середина, конец
+const std::vector<uint8_t> kFuStart = {0x7C, 0x85, 0x01};
+const std::vector<uint8_t> kFuMiddle = {0x7C, 0x05, 0x02};
+const std::vector<uint8_t> kFuEnd = {0x7C, 0x45, 0x03};
+const std::vector<uint8_t> kSlice = {0x41, 0x9A};
+
+} // namespace
+
+TEST(RTPJitterBufferTest, LossInsideFrameDropsItOnce) {
+    FrameAssembly assembly;
+
+    assembly.insert(kFuStart, 1, 1000, false);
+    // 2 (kFuMiddle) потерян
+    assembly.insert(kFuEnd, 3, 1000, true);
+    assembly.insert(kSlice, 4, 2000, true);
+
+    EXPECT_EQ(assembly.buffer.counters().packetsLost.load(), 1u);
+    EXPECT_EQ(assembly.buffer.counters().framesDropped.load(), 1u);
+    EXPECT_EQ(assembly.frames, (std::vector<uint32_t>{2000}));
+}
+
+TEST(RTPJitterBufferTest, LossAtFrameBoundaryKeepsNextFrame) {
+    FrameAssembly assembly;
+
+    assembly.insert(kSlice, 1, 1000, false);
+    // 2 (последний пакет кадра 1000 с marker битом) потерян
+    assembly.insert(kSlice, 3, 2000, true);
+    assembly.insert(kSlice, 4, 3000, true);
+
+    EXPECT_EQ(assembly.buffer.counters().framesDropped.load(), 1u);
+    EXPECT_EQ(assembly.frames, (std::vector<uint32_t>{2000, 3000}));
+}
+
+TEST(RTPJitterBufferTest, LossOfFrameStartDropsRestOfFrame) {
+    FrameAssembly assembly;
+
+    assembly.insert(kSlice, 1, 1000, true);
+    // 2 (начало кадра 2000) потерян
+    assembly.insert(kFuMiddle, 3, 2000, false);
+    assembly.insert(kFuEnd, 4, 2000, true);
+    assembly.insert(kSlice, 5, 3000, true);
+
+    EXPECT_EQ(assembly.buffer.counters().framesDropped.load(), 1u);
+    EXPECT_EQ(assembly.frames, (std::vector<uint32_t>{1000, 3000}));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
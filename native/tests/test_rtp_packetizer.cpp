@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "media_source.h"
+#include "rtp_depacketizer.h"
+#include "rtp_packetizer.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CollectedUnits {
+    std::vector<std::vector<uint8_t>> units;
+    std::vector<bool> keyframes;
+};
+
+void collect_unit(const AccessUnit& au, void* context) {
+    CollectedUnits* collected = static_cast<CollectedUnits*>(context);
+    collected->units.emplace_back(au.data, au.data + au.size);
+    collected->keyframes.push_back(au.keyframe);
+}
+
+// Упаковка кадра и сборка обратно депакетизатором клиента
+void round_trip(RTPPacketizer& packetizer, RTPDepacketizer& depacketizer,
+                const std::vector<uint8_t>& frame, uint32_t timestamp, CollectedUnits& collected) {
+    size_t count = packetizer.packetize(frame.data(), frame.size(), timestamp);
+    for (size_t i = 0; i < count; i++) {
+        const std::vector<uint8_t>& packet = packetizer.packet(i);
+        ASSERT_LE(packet.size(), RTPPacketizer::kDefaultMaxPacketSize);
+        bool marker = (packet[1] & 0x80) != 0;
+        EXPECT_EQ(marker, i + 1 == count);
+        depacketizer.push(packet.data() + RTPPacketizer::kHeaderSize,
+                          packet.size() - RTPPacketizer::kHeaderSize,
+                          timestamp, marker, collect_unit, &collected);
+    }
+}
+
+std::vector<uint8_t> nal_unit(std::initializer_list<uint8_t> header, size_t size) {
+    std::vector<uint8_t> unit = {0, 0, 0, 1};
+    unit.insert(unit.end(), header);
+    for (size_t i = header.size(); i < size; i++) {
+        unit.push_back(static_cast<uint8_t>(0x80 | (i & 0x7F)));
+    }
+    return unit;
+}
+
+} // namespace
+
+TEST(RTPPacketizerTest, SplitsAnnexB) {
+    std::vector<uint8_t> stream = {0, 0, 0, 1, 0x67, 0x42, 0, 0, 1, 0x68, 0xCE, 0, 0, 0, 0, 1, 0x65, 0x88};
+    size_t offset = 0;
+    const uint8_t* nal = nullptr;
+    size_t size = 0;
+
+    ASSERT_TRUE(annexb_next_nal(stream.data(), stream.size(), offset, nal, size));
+    EXPECT_EQ(std::vector<uint8_t>(nal, nal + size), std::vector<uint8_t>({0x67, 0x42}));
+    ASSERT_TRUE(annexb_next_nal(stream.data(), stream.size(), offset, nal, size));
+    EXPECT_EQ(std::vector<uint8_t>(nal, nal + size), std::vector<uint8_t>({0x68, 0xCE}));
+    ASSERT_TRUE(annexb_next_nal(stream.data(), stream.size(), offset, nal, size));
+    EXPECT_EQ(std::vector<uint8_t>(nal, nal + size), std::vector<uint8_t>({0x65, 0x88}));
+    EXPECT_FALSE(annexb_next_nal(stream.data(), stream.size(), offset, nal, size));
+}
+
+TEST(RTPPacketizerTest, H264RoundTrip) {
+    RTPPacketizer packetizer(RTPPayloadCodec::H264, 96, 0x1234, 65530);
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H264);
+    CollectedUnits collected;
+
+    std::vector<uint8_t> frame = nal_unit({0x67, 0x64}, 10);
+    std::vector<uint8_t> pps = nal_unit({0x68, 0xEB}, 6);
+    std::vector<uint8_t> idr = nal_unit({0x65, 0x88}, 5000);     // FU-A
+    frame.insert(frame.end(), pps.begin(), pps.end());
+    frame.insert(frame.end(), idr.begin(), idr.end());
+    round_trip(packetizer, depacketizer, frame, 3000, collected);
+
+    std::vector<uint8_t> slice = nal_unit({0x41, 0x9A}, 800);    // Single NAL
+    round_trip(packetizer, depacketizer, slice, 6600, collected);
+
+    ASSERT_EQ(collected.units.size(), 2u);
+    EXPECT_EQ(collected.units[0], frame);
+    EXPECT_TRUE(collected.keyframes[0]);
+    EXPECT_EQ(collected.units[1], slice);
+    EXPECT_FALSE(collected.keyframes[1]);
+
+    // Номера последовательности продолжаются через переполнение
+    EXPECT_EQ(packetizer.nextSequence(), static_cast<uint16_t>(65530 + 2 + 4 + 1));
+}
+
+TEST(RTPPacketizerTest, H265RoundTrip) {
+    RTPPacketizer packetizer(RTPPayloadCodec::H265, 96, 0x1234, 0, 500);
+    RTPDepacketizer depacketizer(RTPPayloadCodec::H265);
+    CollectedUnits collected;
+
+    std::vector<uint8_t> frame = nal_unit({0x40, 0x01}, 20);
+    std::vector<uint8_t> idr = nal_unit({0x26, 0x01, 0xAF}, 3000);   // FU
+    frame.insert(frame.end(), idr.begin(), idr.end());
+    round_trip(packetizer, depacketizer, frame, 90000, collected);
+
+    ASSERT_EQ(collected.units.size(), 1u);
+    EXPECT_EQ(collected.units[0], frame);
+    EXPECT_TRUE(collected.keyframes[0]);
+}
+
+TEST(MediaSourceTest, SyntheticStreamMatchesBitrate) {
+    MediaSource source;
+    source.setFps(25);
+    source.generateSynthetic(RTPPayloadCodec::H264, 50, 4000);
+
+    ASSERT_EQ(source.frameCount(), 50u);
+    EXPECT_TRUE(source.frame(0).keyframe);
+    EXPECT_FALSE(source.frame(1).keyframe);
+    EXPECT_NEAR(source.averageBitrateKbps(), 4000, 40);
+    EXPECT_NE(source.formatParameters().find("sprop-parameter-sets="), std::string::npos);
+}
+
+TEST(MediaSourceTest, SplitsElementaryStreamIntoFrames) {
+    // Кадр 1: AUD, SPS, PPS, два слайса IDR; кадр 2: P-слайс; кадр 3: P-слайс
+    std::vector<uint8_t> stream;
+    for (const std::vector<uint8_t>& nal : {
+             nal_unit({0x09, 0xF0}, 2), nal_unit({0x67, 0x64}, 10), nal_unit({0x68, 0xEB}, 6),
+             nal_unit({0x65, 0x88}, 100), nal_unit({0x65, 0x40}, 100),
+             nal_unit({0x41, 0x9A}, 50), nal_unit({0x41, 0x9A}, 50)}) {
+        stream.insert(stream.end(), nal.begin(), nal.end());
+    }
+
+    std::string path = ::testing::TempDir() + "media_source_test.h264";
+    FILE* file = fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fwrite(stream.data(), 1, stream.size(), file);
+    fclose(file);
+
+    MediaSource source;
+    std::string error;
+    ASSERT_TRUE(source.load(path, error)) << error;
+    remove(path.c_str());
+
+    ASSERT_EQ(source.frameCount(), 3u);
+    EXPECT_TRUE(source.frame(0).keyframe);
+    EXPECT_EQ(source.frame(0).data.size(), 4u * 5 + 2 + 10 + 6 + 100 + 100);
+    EXPECT_FALSE(source.frame(1).keyframe);
+    EXPECT_EQ(source.frame(2).data.size(), 4u + 50);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include "rtp_reactor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// UDP сокет на loopback со случайным портом
+class LoopbackSocket {
+public:
+    LoopbackSocket() : fd_(socket(AF_INET, SOCK_DGRAM, 0)), port_(0) {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+        if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &length) == 0) {
+            port_ = ntohs(addr.sin_port);
+        }
+    }
+
+    ~LoopbackSocket() { close(fd_); }
+
+    int fd() const { return fd_; }
+
+    void sendTo(const LoopbackSocket& target, const char* payload) const {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(target.port_);
+        sendto(fd_, payload, strlen(payload), 0, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+
+private:
+    int fd_;
+    int port_;
+};
+
+// Обработчик готовности: вычитывает датаграммы сокета
+struct Receiver {
+    std::mutex mutex;
+    std::set<int> fds;
+    std::set<std::thread::id> threads;
+    std::atomic<int> datagrams{0};
+    bool unregisterSelf = false;
+
+    static void onReady(int fd, void* context) {
+        Receiver* receiver = static_cast<Receiver*>(context);
+        char buffer[1500];
+        while (recv(fd, buffer, sizeof(buffer), 0) > 0) {
+            {
+                std::lock_guard<std::mutex> lock(receiver->mutex);
+                receiver->fds.insert(fd);
+                receiver->threads.insert(std::this_thread::get_id());
+            }
+            receiver->datagrams++;
+        }
+        if (receiver->unregisterSelf) {
+            RTPReactor::instance().unregisterSocket(fd);
+        }
+    }
+
+    bool waitFor(int count) {
+        for (int i = 0; i < 200 && datagrams < count; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return datagrams >= count;
+    }
+};
+
+} // namespace
+
+TEST(RTPReactorTest, DispatchesDatagramsToSocketHandler) {
+    ASSERT_TRUE(RTPReactor::isSupported());
+    RTPReactor& reactor = RTPReactor::instance();
+    ASSERT_TRUE(reactor.start(2));
+    EXPECT_TRUE(reactor.isRunning());
+    EXPECT_EQ(reactor.threadCount(), 2);
+
+    LoopbackSocket sender;
+    LoopbackSocket first;
+    LoopbackSocket second;
+    Receiver firstReceiver;
+    Receiver secondReceiver;
+    ASSERT_TRUE(reactor.registerSocket(first.fd(), 1, Receiver::onReady, &firstReceiver));
+    ASSERT_TRUE(reactor.registerSocket(second.fd(), 2, Receiver::onReady, &secondReceiver));
+    EXPECT_FALSE(reactor.registerSocket(first.fd(), 1, Receiver::onReady, &firstReceiver));
+
+    for (int i = 0; i < 5; i++) sender.sendTo(first, "rtp");
+    for (int i = 0; i < 3; i++) sender.sendTo(second, "rtcp");
+    ASSERT_TRUE(firstReceiver.waitFor(5));
+    ASSERT_TRUE(secondReceiver.waitFor(3));
+
+    // Каждый обработчик получил только свой сокет
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(firstReceiver.datagrams, 5);
+    EXPECT_EQ(secondReceiver.datagrams, 3);
+    EXPECT_EQ(firstReceiver.fds, std::set<int>{first.fd()});
+    EXPECT_EQ(secondReceiver.fds, std::set<int>{second.fd()});
+
+    // Сокеты клиента обслуживаются потоком его ключа
+    EXPECT_EQ(reactor.threadForKey(1), reactor.threadForKey(1));
+    EXPECT_EQ(firstReceiver.threads.size(), 1u);
+
+    reactor.unregisterSocket(first.fd());
+    reactor.unregisterSocket(second.fd());
+    reactor.shutdown();
+}
+
+TEST(RTPReactorTest, UnregisteredSocketIsNotDispatched) {
+    RTPReactor& reactor = RTPReactor::instance();
+    ASSERT_TRUE(reactor.start(1));
+
+    LoopbackSocket sender;
+    LoopbackSocket target;
+    Receiver receiver;
+    ASSERT_TRUE(reactor.registerSocket(target.fd(), 7, Receiver::onReady, &receiver));
+    sender.sendTo(target, "one");
+    ASSERT_TRUE(receiver.waitFor(1));
+
+    // После возврата обработчик для сокета не вызывается
+    reactor.unregisterSocket(target.fd());
+    sender.sendTo(target, "two");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(receiver.datagrams, 1);
+
+    // Снятие из самого обработчика
+    LoopbackSocket self;
+    Receiver selfReceiver;
+    selfReceiver.unregisterSelf = true;
+    ASSERT_TRUE(reactor.registerSocket(self.fd(), 8, Receiver::onReady, &selfReceiver));
+    sender.sendTo(self, "one");
+    ASSERT_TRUE(selfReceiver.waitFor(1));
+    sender.sendTo(self, "two");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(selfReceiver.datagrams, 1);
+    EXPECT_TRUE(reactor.registerSocket(self.fd(), 8, Receiver::onReady, &selfReceiver));
+    reactor.unregisterSocket(self.fd());
+
+    reactor.shutdown();
+}
+
+TEST(RTPReactorTest, ShutdownStopsServiceAndAllowsRestart) {
+    RTPReactor& reactor = RTPReactor::instance();
+    ASSERT_TRUE(reactor.start(2));
+
+    LoopbackSocket sender;
+    LoopbackSocket target;
+    Receiver receiver;
+    ASSERT_TRUE(reactor.registerSocket(target.fd(), 3, Receiver::onReady, &receiver));
+
+    // Число потоков не меняется, пока есть сокеты
+    EXPECT_FALSE(reactor.start(3));
+    EXPECT_TRUE(reactor.start(2));
+
+    reactor.shutdown();
+    EXPECT_FALSE(reactor.isRunning());
+    EXPECT_EQ(reactor.threadCount(), 0);
+    EXPECT_FALSE(reactor.registerSocket(target.fd(), 3, Receiver::onReady, &receiver));
+    sender.sendTo(target, "late");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(receiver.datagrams, 0);
+
+    // Снятие после остановки безопасно; перезапуск с другим числом потоков
+    reactor.unregisterSocket(target.fd());
+    ASSERT_TRUE(reactor.start(3));
+    EXPECT_EQ(reactor.threadCount(), 3);
+    ASSERT_TRUE(reactor.registerSocket(target.fd(), 3, Receiver::onReady, &receiver));
+    ASSERT_TRUE(receiver.waitFor(1));
+    reactor.unregisterSocket(target.fd());
+    reactor.shutdown();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "rtsp_auth.h"
+
+#include <string>
+
+namespace {
+
+// Пример из RFC 7616, 3.9.1
+const char kUsername[] = "Mufasa";
+const char kPassword[] = "Circle of Life";
+const char kNonce[] = "7ypf/xlj9XXwfDPEoM4URrv/xwf94BcCAzFZH4GiTo0v";
+const char kCnonce[] = "f2/wE4q74E6zIJEtWaHKaf5wv/H5QzzpXusqGemxURZJ";
+
+std::string unauthorized(const std::string& challenges) {
+    return "RTSP/1.0 401 Unauthorized\r\nCSeq: 2\r\n" + challenges + "\r\n";
+}
+
+std::string rfc7616_challenge(const std::string& algorithm) {
+    return "WWW-Authenticate: Digest realm=\"http-auth@example.org\", qop=\"auth, auth-int\", "
+           "algorithm=" + algorithm + ", nonce=\"" + kNonce + "\", "
+           "opaque=\"FQhe/qaU925kfnzjCev0ciny7QMkPqMAFRtzCUYo5tdS\"\r\n";
+}
+
+std::string parameter(const std::string& header, const std::string& name) {
+    size_t pos = header.find(" " + name + "=");
+    if (pos == std::string::npos) return "";
+    pos += name.size() + 2;
+    bool isQuoted = header[pos] == '"';
+    if (isQuoted) pos++;
+    size_t end = header.find(isQuoted ? '"' : ',', pos);
+    return header.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+}
+
+} // namespace
+
+TEST(RTSPAuthTest, HashKnownVectors) {
+    EXPECT_EQ(RTSPAuthenticator::md5Hex(""), "d41d8cd98f00b204e9800998ecf8427e");
+    EXPECT_EQ(RTSPAuthenticator::md5Hex("The quick brown fox jumps over the lazy dog"),
+              "9e107d9d372bb6826bd81d3542a419d6");
+    EXPECT_EQ(RTSPAuthenticator::sha256Hex(""),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(RTSPAuthenticator::sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(RTSPAuthTest, BasicBeforeChallenge) {
+    RTSPAuthenticator auth;
+    EXPECT_EQ(auth.authorization("OPTIONS", "/cam"), "");
+
+    auth.setCredentials("admin", "12345");
+    EXPECT_EQ(auth.authorization("OPTIONS", "/cam"), "Basic YWRtaW46MTIzNDU=");
+
+    // Basic уже отправлен: 401 с Basic означает неверный пароль
+    EXPECT_FALSE(auth.handleUnauthorized(unauthorized("WWW-Authenticate: Basic realm=\"cam\"\r\n")));
+}
+
+TEST(RTSPAuthTest, DigestMd5MatchesRfc7616) {
+    RTSPAuthenticator auth;
+    auth.setCredentials(kUsername, kPassword);
+    ASSERT_TRUE(auth.handleUnauthorized(unauthorized(rfc7616_challenge("MD5"))));
+    auth.setClientNonce(kCnonce);
+
+    std::string header = auth.authorization("GET", "/dir/index.html");
+    EXPECT_EQ(header.compare(0, 7, "Digest "), 0);
+    EXPECT_EQ(parameter(header, "response"), "8ca523f5e9506fed4657c9700eebdbec");
+    EXPECT_EQ(parameter(header, "nc"), "00000001");
+    EXPECT_EQ(parameter(header, "qop"), "auth");
+    EXPECT_EQ(parameter(header, "opaque"), "FQhe/qaU925kfnzjCev0ciny7QMkPqMAFRtzCUYo5tdS");
+
+    // Вызов используется повторно, счетчик растет
+    header = auth.authorization("GET", "/dir/index.html");
+    EXPECT_EQ(parameter(header, "nc"), "00000002");
+}
+
+TEST(RTSPAuthTest, PrefersSha256Challenge) {
+    RTSPAuthenticator auth;
+    auth.setCredentials(kUsername, kPassword);
+    ASSERT_TRUE(auth.handleUnauthorized(
+        unauthorized(rfc7616_challenge("MD5") + rfc7616_challenge("SHA-256"))));
+    auth.setClientNonce(kCnonce);
+
+    std::string header = auth.authorization("GET", "/dir/index.html");
+    EXPECT_EQ(parameter(header, "algorithm"), "SHA-256");
+    EXPECT_EQ(parameter(header, "response"),
+              "753927fa0e85d155564e2e272a28d1802ca10daf4496794697cf8db5856cb6c1");
+}
+
+TEST(RTSPAuthTest, LegacyDigestWithoutQop) {
+    // RFC 2069: response = H(HA1:nonce:HA2)
+    RTSPAuthenticator auth;
+    auth.setCredentials("admin", "secret");
+    ASSERT_TRUE(auth.handleUnauthorized(
+        unauthorized("WWW-Authenticate: Digest realm=\"IP Camera\", nonce=\"abc123\"\r\n")));
+
+    std::string ha1 = RTSPAuthenticator::md5Hex("admin:IP Camera:secret");
+    std::string ha2 = RTSPAuthenticator::md5Hex("DESCRIBE:/stream1");
+    std::string header = auth.authorization("DESCRIBE", "/stream1");
+    EXPECT_EQ(parameter(header, "response"), RTSPAuthenticator::md5Hex(ha1 + ":abc123:" + ha2));
+    EXPECT_EQ(parameter(header, "nc"), "");
+    EXPECT_EQ(parameter(header, "algorithm"), "");
+}
+
+TEST(RTSPAuthTest, StaleNonceRetriesRejectedPasswordFails) {
+    RTSPAuthenticator auth;
+    auth.setCredentials("admin", "secret");
+    std::string challenge = "WWW-Authenticate: Digest realm=\"cam\", nonce=\"n1\", qop=\"auth\"\r\n";
+    ASSERT_TRUE(auth.handleUnauthorized(unauthorized(challenge)));
+
+    // Тот же nonce - пароль отвергнут
+    EXPECT_FALSE(auth.handleUnauthorized(unauthorized(challenge)));
+
+    // Устаревший nonce заменяется, счетчик начинается заново
+    auth.authorization("PLAY", "/cam");
+    ASSERT_TRUE(auth.handleUnauthorized(unauthorized(
+        "WWW-Authenticate: Digest realm=\"cam\", nonce=\"n2\", qop=\"auth\", stale=TRUE\r\n")));
+    EXPECT_EQ(auth.nonce(), "n2");
+    EXPECT_EQ(parameter(auth.authorization("PLAY", "/cam"), "nc"), "00000001");
+
+    // Смена учетных данных сбрасывает вызов
+    auth.setCredentials("admin", "other");
+    EXPECT_EQ(auth.scheme(), RTSPAuthenticator::Scheme::None);
+}
+
+TEST(RTSPAuthTest, IgnoresUnsupportedChallenges) {
+    RTSPAuthenticator auth;
+    auth.setCredentials("admin", "secret");
+    EXPECT_FALSE(auth.handleUnauthorized(unauthorized(
+        "WWW-Authenticate: Digest realm=\"cam\", nonce=\"n1\", algorithm=SHA-512-256\r\n")));
+    EXPECT_FALSE(auth.handleUnauthorized(unauthorized("")));
+    EXPECT_EQ(auth.scheme(), RTSPAuthenticator::Scheme::None);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+#include "rtsp_connector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const char kOptions[] = "OPTIONS rtsp://127.0.0.1/ RTSP/1.0\r\nCSeq: 1\r\n\r\n";
+const char kReply[] = "RTSP/1.0 200 OK\r\nCSeq: 1\r\n\r\n";
+
+// RTSP сервер на loopback: отвечает на запрос через replyDelayMs
+// (отрицательное значение - не отвечает) и считает запросы без ответа
+class LoopbackServer {
+public:
+    explicit LoopbackServer(int replyDelayMs)
+        : fd_(socket(AF_INET, SOCK_STREAM, 0)), port_(0), replyDelayMs_(replyDelayMs),
+          stopping_(false), waiting_(0), maxWaiting_(0) {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            listen(fd_, 64) == 0 &&
+            getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &length) == 0) {
+            port_ = ntohs(addr.sin_port);
+        }
+        thread_ = std::thread(&LoopbackServer::acceptLoop, this);
+    }
+
+    ~LoopbackServer() {
+        stopping_ = true;
+        thread_.join();
+        for (auto& connection : connections_) {
+            connection.join();
+        }
+        close(fd_);
+    }
+
+    int port() const { return port_; }
+    int maxWaiting() const { return maxWaiting_; }
+
+private:
+    void acceptLoop() {
+        while (!stopping_) {
+            struct pollfd listenFd = {fd_, POLLIN, 0};
+            if (poll(&listenFd, 1, 10) <= 0) continue;
+            int client = accept(fd_, nullptr, nullptr);
+            if (client < 0) continue;
+            connections_.emplace_back(&LoopbackServer::serve, this, client);
+        }
+    }
+
+    // Ответ на запрос и ожидание закрытия соединения клиентом
+    void serve(int client) {
+        std::string request;
+        char buffer[512];
+        auto started = std::chrono::steady_clock::now();
+        bool received = false;
+        bool replied = false;
+        while (!stopping_) {
+            struct pollfd clientFd = {client, POLLIN, 0};
+            if (poll(&clientFd, 1, 5) > 0) {
+                ssize_t length = recv(client, buffer, sizeof(buffer), 0);
+                if (length <= 0) break;
+                request.append(buffer, static_cast<size_t>(length));
+                started = std::chrono::steady_clock::now();
+            }
+            if (!received && request.find("\r\n\r\n") != std::string::npos) {
+                received = true;
+                int waiting = ++waiting_;
+                int seen = maxWaiting_;
+                while (waiting > seen && !maxWaiting_.compare_exchange_weak(seen, waiting)) {}
+            }
+            if (received && !replied && replyDelayMs_ >= 0 &&
+                std::chrono::steady_clock::now() - started >= std::chrono::milliseconds(replyDelayMs_)) {
+                waiting_--;
+                send(client, kReply, strlen(kReply), 0);
+                replied = true;
+            }
+        }
+        close(client);
+    }
+
+    int fd_;
+    int port_;
+    const int replyDelayMs_;
+    std::atomic<bool> stopping_;
+    std::atomic<int> waiting_;
+    std::atomic<int> maxWaiting_;
+    std::thread thread_;
+    std::vector<std::thread> connections_;   // Только поток приема
+};
+
+// Результаты операций: ответы и завершения
+struct ExchangeLog {
+    std::mutex mutex;
+    std::condition_variable condition;
+    int responses = 0;
+    int succeeded = 0;
+    std::vector<std::string> errors;
+    std::chrono::steady_clock::time_point finishedAt;
+
+    static bool onResponse(const std::string& response, std::string& nextRequest,
+                           std::string& error, void* context) {
+        ExchangeLog* log = static_cast<ExchangeLog*>(context);
+        std::lock_guard<std::mutex> lock(log->mutex);
+        log->responses++;
+        nextRequest.clear();
+        if (response.compare(0, 15, "RTSP/1.0 200 OK") != 0) {
+            error = "Unexpected response";
+            return false;
+        }
+        return true;
+    }
+
+    static void onDone(RTSPSocket sock, const char* error, void* context) {
+        ExchangeLog* log = static_cast<ExchangeLog*>(context);
+        if (sock >= 0) close(sock);
+        std::lock_guard<std::mutex> lock(log->mutex);
+        if (error) {
+            log->errors.push_back(error);
+        } else {
+            log->succeeded++;
+        }
+        log->finishedAt = std::chrono::steady_clock::now();
+        log->condition.notify_all();
+    }
+
+    int done() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return succeeded + static_cast<int>(errors.size());
+    }
+
+    bool waitFor(int count, int timeoutMs = 5000) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, count] {
+            return succeeded + static_cast<int>(errors.size()) >= count;
+        });
+    }
+};
+
+RTSPConnectRequest exchange(int port, int timeoutMs, ExchangeLog* log) {
+    RTSPConnectRequest request;
+    request.host = "127.0.0.1";
+    request.port = port;
+    request.timeoutMs = timeoutMs;
+    request.firstRequest = kOptions;
+    request.onResponse = ExchangeLog::onResponse;
+    request.onDone = ExchangeLog::onDone;
+    request.context = log;
+    return request;
+}
+
+} // namespace
+
+TEST(RTSPConnectorTest, CompletesExchangeWithServer) {
+    LoopbackServer server(0);
+    ExchangeLog log;
+    ASSERT_NE(RTSPConnector::instance().submit(exchange(server.port(), 2000, &log)), 0u);
+    ASSERT_TRUE(log.waitFor(1));
+    EXPECT_EQ(log.succeeded, 1);
+    EXPECT_EQ(log.responses, 1);
+    EXPECT_TRUE(log.errors.empty());
+}
+
+TEST(RTSPConnectorTest, RespectsMaxConcurrent) {
+    RTSPConnector& connector = RTSPConnector::instance();
+    connector.setMaxConcurrent(2);
+    EXPECT_EQ(connector.maxConcurrent(), 2);
+
+    LoopbackServer server(100);
+    ExchangeLog log;
+    const int operations = 6;
+    for (int i = 0; i < operations; i++) {
+        ASSERT_NE(connector.submit(exchange(server.port(), 3000, &log)), 0u);
+    }
+
+    // Сверх лимита операции ждут в очереди
+    int maxActive = 0;
+    while (log.done() < operations) {
+        maxActive = std::max(maxActive, connector.activeCount());
+        EXPECT_LE(connector.activeCount(), 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    EXPECT_EQ(maxActive, 2);
+    EXPECT_EQ(server.maxWaiting(), 2);
+    EXPECT_EQ(log.succeeded, operations);
+    EXPECT_EQ(connector.pendingCount(), 0);
+
+    connector.setMaxConcurrent(RTSPConnector::kDefaultMaxConcurrent);
+}
+
+TEST(RTSPConnectorTest, CancelSuppressesDone) {
+    RTSPConnector& connector = RTSPConnector::instance();
+    LoopbackServer server(-1);
+    ExchangeLog log;
+
+    // Отмена выполняющейся операции
+    uint64_t active = connector.submit(exchange(server.port(), 300, &log));
+    ASSERT_NE(active, 0u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    connector.cancel(active);
+
+    // Отмена операции в очереди
+    connector.setMaxConcurrent(1);
+    ExchangeLog blocker;
+    ASSERT_NE(connector.submit(exchange(server.port(), 300, &blocker)), 0u);
+    for (int i = 0; i < 200 && connector.pendingCount() > 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    uint64_t queued = connector.submit(exchange(server.port(), 300, &log));
+    EXPECT_EQ(connector.pendingCount(), 1);
+    connector.cancel(queued);
+    EXPECT_EQ(connector.pendingCount(), 0);
+
+    // Таймауты истекли, но отмененные операции не завершаются обработчиком
+    ASSERT_TRUE(blocker.waitFor(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    EXPECT_EQ(log.done(), 0);
+    EXPECT_EQ(connector.activeCount(), 0);
+
+    connector.setMaxConcurrent(RTSPConnector::kDefaultMaxConcurrent);
+}
+
+TEST(RTSPConnectorTest, ReportsResponseTimeout) {
+    LoopbackServer server(-1);
+    ExchangeLog log;
+    auto submitted = std::chrono::steady_clock::now();
+    ASSERT_NE(RTSPConnector::instance().submit(exchange(server.port(), 200, &log)), 0u);
+    ASSERT_TRUE(log.waitFor(1));
+
+    ASSERT_EQ(log.errors.size(), 1u);
+    EXPECT_EQ(log.errors[0], "RTSP response timed out");
+    EXPECT_EQ(log.responses, 0);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(log.finishedAt - submitted).count();
+    EXPECT_GE(elapsed, 200);
+    EXPECT_LT(elapsed, 2000);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
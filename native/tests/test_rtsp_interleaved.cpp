@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "rtsp_interleaved.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Packet {
+    uint8_t channel;
+    std::vector<uint8_t> data;
+};
+
+void collect_packet(uint8_t channel, const uint8_t* data, size_t size, void* context) {
+    std::vector<Packet>* packets = static_cast<std::vector<Packet>*>(context);
+    packets->push_back({channel, std::vector<uint8_t>(data, data + size)});
+}
+
+std::vector<uint8_t> frame(uint8_t channel, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> out = {'$', channel, static_cast<uint8_t>(payload.size() >> 8),
+                                static_cast<uint8_t>(payload.size())};
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+void feed(RTSPInterleavedReader& reader, const std::vector<uint8_t>& bytes, std::vector<Packet>& packets) {
+    reader.append(bytes.data(), bytes.size());
+    reader.parse(collect_packet, &packets);
+}
+
+} // namespace
+
+TEST(RTSPInterleavedReaderTest, DemultiplexesChannels) {
+    RTSPInterleavedReader reader;
+    std::vector<Packet> packets;
+
+    std::vector<uint8_t> bytes = frame(0, {1, 2, 3});
+    std::vector<uint8_t> rtcp = frame(1, {9});
+    bytes.insert(bytes.end(), rtcp.begin(), rtcp.end());
+    feed(reader, bytes, packets);
+
+    ASSERT_EQ(packets.size(), 2u);
+    EXPECT_EQ(packets[0].channel, 0);
+    EXPECT_EQ(packets[0].data, (std::vector<uint8_t>{1, 2, 3}));
+    EXPECT_EQ(packets[1].channel, 1);
+    EXPECT_EQ(packets[1].data, (std::vector<uint8_t>{9}));
+}
+
+TEST(RTSPInterleavedReaderTest, PacketSplitAcrossReads) {
+    RTSPInterleavedReader reader;
+    std::vector<Packet> packets;
+
+    std::vector<uint8_t> bytes = frame(2, std::vector<uint8_t>(1000, 0x55));
+    feed(reader, std::vector<uint8_t>(bytes.begin(), bytes.begin() + 3), packets);
+    EXPECT_TRUE(packets.empty());
+    feed(reader, std::vector<uint8_t>(bytes.begin() + 3, bytes.begin() + 500), packets);
+    EXPECT_TRUE(packets.empty());
+    feed(reader, std::vector<uint8_t>(bytes.begin() + 500, bytes.end()), packets);
+
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0].channel, 2);
+    EXPECT_EQ(packets[0].data.size(), 1000u);
+}
+
+TEST(RTSPInterleavedReaderTest, SkipsRTSPResponses) {
+    RTSPInterleavedReader reader;
+    std::vector<Packet> packets;
+
+    std::string response = "RTSP/1.0 200 OK\r\nCSeq: 7\r\nContent-Length: 4\r\n\r\nbody";
+    std::vector<uint8_t> bytes(response.begin(), response.end());
+    std::vector<uint8_t> rtp = frame(0, {7, 7});
+    bytes.insert(bytes.end(), rtp.begin(), rtp.end());
+    feed(reader, bytes, packets);
+
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0].data, (std::vector<uint8_t>{7, 7}));
+    EXPECT_EQ(reader.skippedBytes(), 0u);
+}
+
+TEST(RTSPInterleavedReaderTest, ResynchronizesAfterGarbage) {
+    RTSPInterleavedReader reader;
+    std::vector<Packet> packets;
+
+    std::vector<uint8_t> bytes = {0x01, 0x02, 0x03};
+    std::vector<uint8_t> rtp = frame(0, {4, 5});
+    bytes.insert(bytes.end(), rtp.begin(), rtp.end());
+    feed(reader, bytes, packets);
+
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0].data, (std::vector<uint8_t>{4, 5}));
+    EXPECT_EQ(reader.skippedBytes(), 3u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
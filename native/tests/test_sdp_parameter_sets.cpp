@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "sdp_parameter_sets.h"
+
+#include <vector>
+
+namespace {
+
+// SPS/PPS камеры H.264 (Baseline, 1280x720)
+const std::vector<uint8_t> kH264Sps = {0x67, 0x42, 0x00, 0x1F, 0x95, 0xA8, 0x14, 0x01, 0x6E, 0x40};
+const std::vector<uint8_t> kH264Pps = {0x68, 0xCE, 0x3C, 0x80};
+
+} // namespace
+
+TEST(SDPParameterSetsTest, Base64Decode) {
+    std::vector<uint8_t> output;
+    ASSERT_TRUE(base64_decode("aM48gA==", output));
+    EXPECT_EQ(output, kH264Pps);
+
+    ASSERT_TRUE(base64_decode("Z0IAH5WoFAFuQA", output));
+    EXPECT_EQ(output, kH264Sps);
+
+    EXPECT_FALSE(base64_decode("a*b", output));
+    EXPECT_TRUE(output.empty());
+}
+
+TEST(SDPParameterSetsTest, ParsesH264SpropParameterSets) {
+    SDPParameterSets sets;
+    ASSERT_TRUE(sdp_parse_parameter_sets(
+        "96 packetization-mode=1; profile-level-id=42001F; sprop-parameter-sets=Z0IAH5WoFAFuQA==,aM48gA==",
+        RTPPayloadCodec::H264, sets));
+
+    ASSERT_EQ(sets.sps.size(), 1u);
+    ASSERT_EQ(sets.pps.size(), 1u);
+    EXPECT_TRUE(sets.vps.empty());
+    EXPECT_EQ(sets.sps[0], kH264Sps);
+    EXPECT_EQ(sets.pps[0], kH264Pps);
+}
+
+TEST(SDPParameterSetsTest, ClassifiesByNalTypeNotOrder) {
+    SDPParameterSets sets;
+    ASSERT_TRUE(sdp_parse_parameter_sets("96 sprop-parameter-sets=aM48gA==,Z0IAH5WoFAFuQA==",
+                                         RTPPayloadCodec::H264, sets));
+    ASSERT_EQ(sets.sps.size(), 1u);
+    EXPECT_EQ(sets.sps[0], kH264Sps);
+}
+
+TEST(SDPParameterSetsTest, ParsesH265SpropParameters) {
+    // VPS (тип 32), SPS (33), PPS (34) - заголовки NAL и по байту данных
+    SDPParameterSets sets;
+    ASSERT_TRUE(sdp_parse_parameter_sets(
+        "96 sprop-vps=QAEM; sprop-sps=QgEM; sprop-pps=RAHA",
+        RTPPayloadCodec::H265, sets));
+
+    ASSERT_EQ(sets.vps.size(), 1u);
+    ASSERT_EQ(sets.sps.size(), 1u);
+    ASSERT_EQ(sets.pps.size(), 1u);
+    EXPECT_EQ(sets.vps[0], (std::vector<uint8_t>{0x40, 0x01, 0x0C}));
+    EXPECT_EQ(sets.sps[0], (std::vector<uint8_t>{0x42, 0x01, 0x0C}));
+    EXPECT_EQ(sets.pps[0], (std::vector<uint8_t>{0x44, 0x01, 0xC0}));
+
+    std::vector<uint8_t> extradata = sdp_build_annexb_extradata(sets);
+    EXPECT_EQ(extradata, (std::vector<uint8_t>{0, 0, 0, 1, 0x40, 0x01, 0x0C,
+                                               0, 0, 0, 1, 0x42, 0x01, 0x0C,
+                                               0, 0, 0, 1, 0x44, 0x01, 0xC0}));
+}
+
+TEST(SDPParameterSetsTest, BuildsAnnexBExtradata) {
+    SDPParameterSets sets;
+    sets.sps.push_back(kH264Sps);
+    sets.pps.push_back(kH264Pps);
+
+    std::vector<uint8_t> expected = {0, 0, 0, 1};
+    expected.insert(expected.end(), kH264Sps.begin(), kH264Sps.end());
+    expected.insert(expected.end(), {0, 0, 0, 1});
+    expected.insert(expected.end(), kH264Pps.begin(), kH264Pps.end());
+    EXPECT_EQ(sdp_build_annexb_extradata(sets), expected);
+}
+
+TEST(SDPParameterSetsTest, NoParameterSets) {
+    SDPParameterSets sets;
+    EXPECT_FALSE(sdp_parse_parameter_sets("96 packetization-mode=1", RTPPayloadCodec::H264, sets));
+    EXPECT_FALSE(sdp_parse_parameter_sets("96", RTPPayloadCodec::H264, sets));
+    EXPECT_FALSE(sdp_parse_parameter_sets("", RTPPayloadCodec::H264, sets));
+    EXPECT_FALSE(sdp_parse_parameter_sets("96 sprop-parameter-sets=Z0IAH5WoFAFuQA==",
+                                          RTPPayloadCodec::Unknown, sets));
+    EXPECT_TRUE(sdp_build_annexb_extradata(sets).empty());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
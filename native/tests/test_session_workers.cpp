@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "session_workers.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Задача, которая ждет release() и записывает порядок выполнения
+struct GatedTask {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool open = false;
+    int started = 0;
+    int finished = 0;
+    std::vector<int>* order = nullptr;
+    int number = 0;
+    bool cancelSelf = false;
+
+    static void run(void* context) {
+        GatedTask* task = static_cast<GatedTask*>(context);
+        std::unique_lock<std::mutex> lock(task->mutex);
+        task->started++;
+        task->condition.notify_all();
+        task->condition.wait(lock, [task] { return task->open; });
+        if (task->order) {
+            task->order->push_back(task->number);
+        }
+        if (task->cancelSelf) {
+            // Отмена своего ключа из задачи не ждет ее саму
+            lock.unlock();
+            SessionWorkers::instance().cancel(task);
+            lock.lock();
+        }
+        task->finished++;
+        task->condition.notify_all();
+    }
+
+    bool waitStarted() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(5), [this] { return started > 0; });
+    }
+
+    bool waitFinished(int count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(5), [this, count] { return finished >= count; });
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+        condition.notify_all();
+    }
+
+    int startedCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return started;
+    }
+};
+
+} // namespace
+
+TEST(SessionWorkersTest, RunsDifferentKeysInParallel) {
+    SessionWorkers& workers = SessionWorkers::instance();
+
+    // Остановившиеся задачи не задерживают задачи других ключей
+    GatedTask stalled[3];
+    for (auto& task : stalled) {
+        workers.post(&task, GatedTask::run, &task);
+    }
+    for (auto& task : stalled) {
+        ASSERT_TRUE(task.waitStarted());
+    }
+
+    GatedTask quick;
+    quick.open = true;
+    workers.post(&quick, GatedTask::run, &quick);
+    ASSERT_TRUE(quick.waitFinished(1));
+
+    for (auto& task : stalled) {
+        task.release();
+        ASSERT_TRUE(task.waitFinished(1));
+    }
+}
+
+TEST(SessionWorkersTest, RunsTasksOfOneKeyInOrder) {
+    SessionWorkers& workers = SessionWorkers::instance();
+    std::vector<int> order;
+    int key = 0;
+
+    GatedTask tasks[4];
+    for (int i = 0; i < 4; i++) {
+        tasks[i].order = &order;
+        tasks[i].number = i;
+        workers.post(&key, GatedTask::run, &tasks[i]);
+    }
+
+    // Следующая задача ключа не начинается, пока выполняется предыдущая
+    ASSERT_TRUE(tasks[0].waitStarted());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(tasks[1].startedCount(), 0);
+
+    for (auto& task : tasks) {
+        task.release();
+    }
+    for (auto& task : tasks) {
+        ASSERT_TRUE(task.waitFinished(1));
+    }
+    workers.cancel(&key);
+    EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3}));
+}
+
+TEST(SessionWorkersTest, CancelDropsQueuedAndWaitsForRunning) {
+    SessionWorkers& workers = SessionWorkers::instance();
+    int key = 0;
+
+    GatedTask running;
+    GatedTask queued;
+    queued.open = true;
+    workers.post(&key, GatedTask::run, &running);
+    workers.post(&key, GatedTask::run, &queued);
+    ASSERT_TRUE(running.waitStarted());
+
+    std::atomic<bool> cancelled(false);
+    std::thread canceller([&workers, &key, &cancelled] {
+        workers.cancel(&key);
+        cancelled = true;
+    });
+
+    // Отмена ждет выполняемую задачу
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(cancelled);
+    running.release();
+    canceller.join();
+    EXPECT_TRUE(cancelled);
+    EXPECT_EQ(running.finished, 1);
+
+    // Задача в очереди не выполняется
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(queued.startedCount(), 0);
+
+    // Отмена из задачи своего ключа
+    GatedTask self;
+    self.open = true;
+    self.cancelSelf = true;
+    workers.post(&self, GatedTask::run, &self);
+    ASSERT_TRUE(self.waitFinished(1));
+    workers.cancel(&self);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,1039 @@
+#include <gtest/gtest.h>
+#include "stream_manager.h"
+#include "camera_simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Камера, которая принимает TCP подключения, но не отвечает на запросы
+class SilentCamera {
+public:
+    SilentCamera() : fd_(socket(AF_INET, SOCK_STREAM, 0)), port_(0) {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            listen(fd_, 16) == 0 &&
+            getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &length) == 0) {
+            port_ = ntohs(addr.sin_port);
+        }
+    }
+
+    ~SilentCamera() { close(fd_); }
+
+    int port() const { return port_; }
+
+private:
+    int fd_;
+    int port_;
+};
+
+StreamConfig rtsp_config(int port, int timeoutMs) {
+    StreamConfig config = {};
+    config.type = STREAM_TYPE_RTSP;
+    snprintf(config.url, sizeof(config.url), "rtsp://127.0.0.1:%d/cam", port);
+    config.timeoutMs = timeoutMs;
+    config.enableVideo = true;
+    config.transport = RTSP_TRANSPORT_TCP;
+    return config;
+}
+
+bool wait_for_status(StreamManager* manager, int streamId, StreamStatus status) {
+    for (int i = 0; i < 200; i++) {
+        if (stream_manager_get_status(manager, streamId) == status) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+TEST(StreamManagerTest, StatusDoesNotWaitForBlockingConnect) {
+    SilentCamera camera;
+    ASSERT_GT(camera.port(), 0);
+
+    StreamManager* manager = stream_manager_create();
+    StreamConfig config = rtsp_config(camera.port(), 1000);
+    int slow = stream_manager_add_stream(manager, &config);
+    int other = stream_manager_add_stream(manager, &config);
+
+    std::thread connect([&] { EXPECT_FALSE(stream_manager_connect_stream(manager, slow)); });
+    ASSERT_TRUE(wait_for_status(manager, slow, STREAM_STATUS_CONNECTING));
+
+    // Запросы и операции с другими потоками не ждут сетевого обмена
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(stream_manager_get_status(manager, slow), STREAM_STATUS_CONNECTING);
+    EXPECT_EQ(stream_manager_get_status(manager, other), STREAM_STATUS_IDLE);
+    EXPECT_EQ(stream_manager_get_stream_count(manager), 2);
+    EXPECT_TRUE(stream_manager_remove_stream(manager, other));
+    int added = stream_manager_add_stream(manager, &config);
+    EXPECT_NE(added, other);
+    EXPECT_LT(elapsed_ms(start), 200.0);
+
+    connect.join();
+    EXPECT_EQ(stream_manager_get_status(manager, slow), STREAM_STATUS_ERROR);
+    EXPECT_EQ(stream_manager_get_status(manager, other), STREAM_STATUS_ERROR);
+    stream_manager_destroy(manager);
+}
+
+TEST(StreamManagerTest, ConnectsDifferentStreamsInParallel) {
+    SilentCamera camera;
+    ASSERT_GT(camera.port(), 0);
+
+    StreamManager* manager = stream_manager_create();
+    StreamConfig config = rtsp_config(camera.port(), 500);
+    const int kStreams = 4;
+    int ids[kStreams];
+    for (int& id : ids) {
+        id = stream_manager_add_stream(manager, &config);
+    }
+
+    // Каждое подключение ждет таймаута ответа; по очереди это заняло бы 2 с
+    auto start = std::chrono::steady_clock::now();
+    std::thread threads[kStreams];
+    for (int i = 0; i < kStreams; i++) {
+        threads[i] = std::thread([manager, &ids, i] { stream_manager_connect_stream(manager, ids[i]); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_LT(elapsed_ms(start), 1500.0);
+
+    for (int id : ids) {
+        EXPECT_EQ(stream_manager_get_status(manager, id), STREAM_STATUS_ERROR);
+    }
+    stream_manager_destroy(manager);
+}
+
+TEST(StreamManagerTest, RemoveDuringConnect) {
+    SilentCamera camera;
+    ASSERT_GT(camera.port(), 0);
+
+    StreamManager* manager = stream_manager_create();
+    StreamConfig config = rtsp_config(camera.port(), 300);
+    int id = stream_manager_add_stream(manager, &config);
+
+    std::thread connect([&] { stream_manager_connect_stream(manager, id); });
+    ASSERT_TRUE(wait_for_status(manager, id, STREAM_STATUS_CONNECTING));
+
+    // Удаление ждет завершения операции, после него поток недоступен
+    EXPECT_TRUE(stream_manager_remove_stream(manager, id));
+    EXPECT_EQ(stream_manager_get_status(manager, id), STREAM_STATUS_ERROR);
+    EXPECT_FALSE(stream_manager_play_stream(manager, id));
+    EXPECT_FALSE(stream_manager_remove_stream(manager, id));
+    EXPECT_EQ(stream_manager_get_stream_count(manager), 0);
+
+    connect.join();
+    stream_manager_destroy(manager);
+}
+
+void release_frame(RTSPFrame* frame, void*) {
+    rtsp_frame_release(frame);
+}
+
+TEST(StreamManagerTest, SubscribersFollowStreamLifetime) {
+    StreamManager* manager = stream_manager_create();
+    StreamConfig config = rtsp_config(554, 1000);
+    int id = stream_manager_add_stream(manager, &config);
+
+    StreamSubscriberParams params = {};
+    params.callback = release_frame;
+    params.policy = RTSP_FRAME_QUEUE_DROP_NON_KEYFRAME;
+    EXPECT_EQ(stream_manager_subscribe(manager, id + 100, &params), -1);
+
+    int live = stream_manager_subscribe(manager, id, &params);
+    params.queueCapacity = 64;
+    int recording = stream_manager_subscribe(manager, id, &params);
+    ASSERT_GT(live, 0);
+    ASSERT_GT(recording, 0);
+    EXPECT_NE(live, recording);
+
+    RTSPFrameQueueStats stats;
+    ASSERT_TRUE(stream_manager_get_subscriber_stats(manager, id, recording, &stats));
+    EXPECT_EQ(stats.capacity, 64);
+    EXPECT_EQ(stats.enqueued, 0u);
+
+    EXPECT_TRUE(stream_manager_unsubscribe(manager, id, live));
+    EXPECT_FALSE(stream_manager_unsubscribe(manager, id, live));
+    EXPECT_FALSE(stream_manager_get_subscriber_stats(manager, id, live, &stats));
+
+    // Удаление потока закрывает оставшихся подписчиков
+    EXPECT_TRUE(stream_manager_remove_stream(manager, id));
+    EXPECT_FALSE(stream_manager_unsubscribe(manager, id, recording));
+    EXPECT_EQ(stream_manager_subscribe(manager, id, &params), -1);
+    stream_manager_destroy(manager);
+}
+
+namespace {
+
+// Callback статуса: статусы и сообщения в порядке получения
+struct StatusLog {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::pair<StreamStatus, std::string>> events;
+
+    static void onStatus(StreamStatus status, const char* message, void* userData) {
+        StatusLog* log = static_cast<StatusLog*>(userData);
+        std::lock_guard<std::mutex> lock(log->mutex);
+        log->events.push_back(std::make_pair(status, message ? message : ""));
+        log->condition.notify_all();
+    }
+
+    // Ожидание статуса; message - его сообщение
+    bool waitFor(StreamStatus status, std::string* message = nullptr) {
+        std::unique_lock<std::mutex> lock(mutex);
+        bool found = condition.wait_for(lock, std::chrono::seconds(5), [&] {
+            for (const auto& event : events) {
+                if (event.first == status) return true;
+            }
+            return false;
+        });
+        if (found && message) {
+            for (const auto& event : events) {
+                if (event.first == status) *message = event.second;
+            }
+        }
+        return found;
+    }
+
+    size_t count(StreamStatus status) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t result = 0;
+        for (const auto& event : events) {
+            if (event.first == status) result++;
+        }
+        return result;
+    }
+};
+
+} // namespace
+
+TEST(StreamManagerTest, AsyncConnectReportsResultThroughStatusCallbacks) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+    SilentCamera silent;
+
+    StreamManager* manager = stream_manager_create();
+    StatusLog all;
+    stream_manager_set_status_callback(manager, StatusLog::onStatus, &all);
+
+    StreamConfig good = rtsp_config(simulator.port(), 2000);
+    StreamConfig stalled = rtsp_config(silent.port(), 300);
+    int goodId = stream_manager_add_stream(manager, &good);
+    int stalledId = stream_manager_add_stream(manager, &stalled);
+    StatusLog goodLog;
+    StatusLog stalledLog;
+    stream_manager_set_stream_status_callback(manager, goodId, StatusLog::onStatus, &goodLog);
+    stream_manager_set_stream_status_callback(manager, stalledId, StatusLog::onStatus, &stalledLog);
+
+    ASSERT_TRUE(stream_manager_connect_stream_async(manager, goodId));
+    ASSERT_TRUE(stream_manager_connect_stream_async(manager, stalledId));
+
+    // Результат каждого подключения приходит callback'у своего потока
+    EXPECT_TRUE(goodLog.waitFor(STREAM_STATUS_CONNECTED));
+    std::string reason;
+    EXPECT_TRUE(stalledLog.waitFor(STREAM_STATUS_ERROR, &reason));
+    EXPECT_FALSE(reason.empty());
+    EXPECT_EQ(goodLog.count(STREAM_STATUS_ERROR), 0u);
+    EXPECT_EQ(stalledLog.count(STREAM_STATUS_CONNECTED), 0u);
+
+    // и callback'у менеджера
+    EXPECT_TRUE(all.waitFor(STREAM_STATUS_CONNECTED));
+    EXPECT_TRUE(all.waitFor(STREAM_STATUS_ERROR));
+
+    stream_manager_destroy(manager);
+    simulator.stop();
+}
+
+namespace {
+
+// Callback статуса, запускающий воспроизведение своего же потока
+struct PlayOnConnect {
+    StreamManager* manager = nullptr;
+    int streamId = -1;
+    std::atomic<int> playResult{-1};
+    StatusLog log;
+
+    static void onStatus(StreamStatus status, const char* message, void* userData) {
+        PlayOnConnect* self = static_cast<PlayOnConnect*>(userData);
+        if (status == STREAM_STATUS_CONNECTED && self->playResult < 0) {
+            self->playResult = stream_manager_play_stream(self->manager, self->streamId) ? 1 : 0;
+        }
+        StatusLog::onStatus(status, message, &self->log);
+    }
+};
+
+} // namespace
+
+TEST(StreamManagerTest, StatusCallbackCanControlItsStream) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+
+    StreamManager* manager = stream_manager_create();
+    StreamConfig config = rtsp_config(simulator.port(), 2000);
+    PlayOnConnect player;
+    player.manager = manager;
+    player.streamId = stream_manager_add_stream(manager, &config);
+    stream_manager_set_stream_status_callback(manager, player.streamId,
+                                              PlayOnConnect::onStatus, &player);
+
+    // Callback вызывается без блокировок клиента, поэтому PLAY из него не зависает
+    ASSERT_TRUE(stream_manager_connect_stream_async(manager, player.streamId));
+    ASSERT_TRUE(player.log.waitFor(STREAM_STATUS_CONNECTED));
+    EXPECT_EQ(player.playResult.load(), 1);
+    EXPECT_TRUE(wait_for_status(manager, player.streamId, STREAM_STATUS_PLAYING));
+
+    stream_manager_destroy(manager);
+    simulator.stop();
+}
+
+namespace {
+
+// Callback кадров, который во время перезапуска сессии обращается к клиенту
+// (захватывает его мьютекс)
+struct ClientQueryingReceiver {
+    RTSPClient* client = nullptr;
+    std::atomic<bool> inCallback{false};
+    std::atomic<bool> restarting{false};
+
+    static void onFrame(RTSPFrame* frame, void* userData) {
+        ClientQueryingReceiver* self = static_cast<ClientQueryingReceiver*>(userData);
+        if (!self->inCallback.exchange(true)) {
+            while (!self->restarting) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            // Перезапуск успевает захватить мьютекс клиента до запроса
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            rtsp_client_get_stream_count(self->client);
+        }
+        rtsp_frame_release(frame);
+    }
+};
+
+} // namespace
+
+TEST(RTSPClientTest, ReconnectStopsReceptionWithoutClientLock) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+    std::string url = "rtsp://127.0.0.1:" + std::to_string(simulator.port()) + "/cam";
+
+    ClientQueryingReceiver receiver;
+    receiver.client = rtsp_client_create();
+    rtsp_client_set_transport(receiver.client, RTSP_TRANSPORT_TCP, 0);
+    rtsp_client_set_frame_callback(receiver.client, RTSP_STREAM_VIDEO,
+                                   ClientQueryingReceiver::onFrame, &receiver);
+    ASSERT_TRUE(rtsp_client_connect(receiver.client, url.c_str(), nullptr, nullptr, 2000));
+    ASSERT_TRUE(rtsp_client_play(receiver.client));
+    for (int i = 0; i < 1000 && !receiver.inCallback; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_TRUE(receiver.inCallback);
+
+    // Прием прежней сессии останавливается без мьютекса клиента, иначе
+    // подключение и callback ждали бы друг друга
+    receiver.restarting = true;
+    EXPECT_TRUE(rtsp_client_connect(receiver.client, url.c_str(), nullptr, nullptr, 2000));
+    EXPECT_TRUE(rtsp_client_play(receiver.client));
+
+    rtsp_client_destroy(receiver.client);
+    simulator.stop();
+}
+
+TEST(RTSPClientTest, ExternalDispatchCallbackCanQueryClient) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+    std::string url = "rtsp://127.0.0.1:" + std::to_string(simulator.port()) + "/cam";
+
+    ClientQueryingReceiver receiver;
+    receiver.client = rtsp_client_create();
+    rtsp_client_set_transport(receiver.client, RTSP_TRANSPORT_TCP, 0);
+    rtsp_client_set_frame_callback(receiver.client, RTSP_STREAM_VIDEO,
+                                   ClientQueryingReceiver::onFrame, &receiver);
+    RTSPFrameQueueParams params = {};
+    params.enabled = true;
+    params.policy = RTSP_FRAME_QUEUE_DROP_OLDEST;
+    params.externalDispatch = true;
+    ASSERT_TRUE(rtsp_client_set_frame_queue(receiver.client, &params));
+    ASSERT_TRUE(rtsp_client_connect(receiver.client, url.c_str(), nullptr, nullptr, 2000));
+    ASSERT_TRUE(rtsp_client_play(receiver.client));
+
+    std::atomic<bool> done{false};
+    std::thread dispatcher([&] {
+        while (!done) {
+            rtsp_client_dispatch_frames(receiver.client, 16, 100);
+        }
+    });
+    for (int i = 0; i < 1000 && !receiver.inCallback; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(receiver.inCallback);
+
+    // Callback в потоке приложения ждет мьютекс клиента, который держит
+    // rtsp_client_play, пока открывает очередь
+    EXPECT_TRUE(rtsp_client_stop(receiver.client));
+    receiver.restarting = true;
+    EXPECT_TRUE(rtsp_client_play(receiver.client));
+
+    done = true;
+    dispatcher.join();
+    rtsp_client_destroy(receiver.client);
+    simulator.stop();
+}
+
+namespace {
+
+// Callback статуса клиента, который обращается к клиенту (захватывает его
+// мьютекс) и запоминает статус, видимый приложению при уведомлении
+struct ClientStatusLog {
+    RTSPClient* client = nullptr;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::pair<std::string, RTSPStatus>> events;
+
+    static void onStatus(RTSPStatus, const char* message, void* userData) {
+        ClientStatusLog* log = static_cast<ClientStatusLog*>(userData);
+        rtsp_client_get_stream_count(log->client);
+        RTSPStatus current = rtsp_client_get_status(log->client);
+
+        std::lock_guard<std::mutex> lock(log->mutex);
+        log->events.push_back(std::make_pair(message ? message : "", current));
+        log->condition.notify_all();
+    }
+
+    // Ожидание уведомления с сообщением message; observed - статус клиента в нем
+    bool waitFor(const std::string& message, RTSPStatus* observed) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(5), [&] {
+            for (const auto& event : events) {
+                if (event.first == message) {
+                    *observed = event.second;
+                    return true;
+                }
+            }
+            return false;
+        });
+    }
+};
+
+} // namespace
+
+TEST(RTSPClientTest, FailedPlayReportsWithoutClientLock) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+    std::string url = "rtsp://127.0.0.1:" + std::to_string(simulator.port()) + "/cam";
+
+    ClientStatusLog log;
+    log.client = rtsp_client_create();
+    rtsp_client_set_transport(log.client, RTSP_TRANSPORT_TCP, 0);
+    ASSERT_TRUE(rtsp_client_connect(log.client, url.c_str(), nullptr, nullptr, 1000));
+    rtsp_client_set_status_callback(log.client, ClientStatusLog::onStatus, &log);
+
+    // Камера закрыла соединение до PLAY: callback ошибки обращается к клиенту
+    simulator.stop();
+    EXPECT_FALSE(rtsp_client_play(log.client));
+    RTSPStatus observed;
+    EXPECT_TRUE(log.waitFor("Failed to send PLAY request", &observed));
+
+    rtsp_client_disconnect(log.client);
+    EXPECT_TRUE(log.waitFor("Disconnected", &observed));
+    EXPECT_EQ(observed, RTSP_STATUS_DISCONNECTED);
+
+    rtsp_client_destroy(log.client);
+}
+
+TEST(RTSPClientTest, AutoTransportFallsBackToTcpInBackground) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    simulatorConfig.lossPercent = 100.0;    // UDP пакеты не доходят
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+    std::string url = "rtsp://127.0.0.1:" + std::to_string(simulator.port()) + "/cam";
+
+    ClientStatusLog log;
+    log.client = rtsp_client_create();
+    rtsp_client_set_transport(log.client, RTSP_TRANSPORT_AUTO, 500);
+    rtsp_client_set_frame_callback(log.client, RTSP_STREAM_VIDEO, release_frame, nullptr);
+    ASSERT_TRUE(rtsp_client_connect(log.client, url.c_str(), nullptr, nullptr, 1000));
+    EXPECT_EQ(rtsp_client_get_transport(log.client), RTSP_TRANSPORT_UDP);
+    rtsp_client_set_status_callback(log.client, ClientStatusLog::onStatus, &log);
+
+    // PLAY не ждет UDP пакетов
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(rtsp_client_play(log.client));
+    EXPECT_LT(elapsed_ms(start), 400.0);
+
+    // Переход на TCP и возобновление воспроизведения выполняются в фоне
+    RTSPStatus observed;
+    EXPECT_TRUE(log.waitFor("No RTP packets over UDP, switching to TCP", &observed));
+    bool playingOverTcp = false;
+    for (int i = 0; i < 1000 && !playingOverTcp; i++) {
+        playingOverTcp = rtsp_client_get_transport(log.client) == RTSP_TRANSPORT_TCP &&
+                         rtsp_client_get_status(log.client) == RTSP_STATUS_PLAYING;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(playingOverTcp);
+
+    rtsp_client_destroy(log.client);
+    simulator.stop();
+}
+
+TEST(RTSPClientTest, ReconnectReportsErrorAfterMaxRetries) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+    std::string url = "rtsp://127.0.0.1:" + std::to_string(simulator.port()) + "/cam";
+
+    ClientStatusLog log;
+    log.client = rtsp_client_create();
+    rtsp_client_set_transport(log.client, RTSP_TRANSPORT_TCP, 0);
+    rtsp_client_set_frame_callback(log.client, RTSP_STREAM_VIDEO, release_frame, nullptr);
+    RTSPReconnectParams reconnect = {true, 1, 20, 50, 2.0f};
+    rtsp_client_set_reconnect_params(log.client, &reconnect);
+    ASSERT_TRUE(rtsp_client_connect(log.client, url.c_str(), nullptr, nullptr, 1000));
+    rtsp_client_set_status_callback(log.client, ClientStatusLog::onStatus, &log);
+    ASSERT_TRUE(rtsp_client_play(log.client));
+
+    // Камера пропала: единственная попытка переподключения не удается
+    simulator.stop();
+    RTSPStatus observed;
+    EXPECT_TRUE(log.waitFor("RTSP connection closed by server", &observed));
+    EXPECT_EQ(observed, RTSP_STATUS_ERROR);
+    EXPECT_TRUE(log.waitFor("Max reconnection attempts reached", &observed));
+    EXPECT_EQ(observed, RTSP_STATUS_ERROR);
+    EXPECT_EQ(rtsp_client_get_status(log.client), RTSP_STATUS_ERROR);
+
+    rtsp_client_destroy(log.client);
+}
+
+namespace {
+
+// Результаты пакетного запуска
+struct BatchResults {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<StreamStartResult> results;
+    int calls = 0;
+
+    static void onComplete(const StreamStartResult* results, int count, void* userData) {
+        BatchResults* batch = static_cast<BatchResults*>(userData);
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->results.assign(results, results + count);
+        batch->calls++;
+        batch->condition.notify_all();
+    }
+
+    bool wait(int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return calls > 0; });
+    }
+};
+
+// Элементарный поток H.264 из ключевого и трех P-кадров
+std::string write_clip() {
+    const uint8_t clip[] = {
+        0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0xAC,
+        0, 0, 0, 1, 0x68, 0xEB, 0xE3, 0xCB,
+        0, 0, 0, 1, 0x65, 0x88, 0x01,
+        0, 0, 0, 1, 0x41, 0x9A, 0x02,
+        0, 0, 0, 1, 0x41, 0x9A, 0x03,
+        0, 0, 0, 1, 0x41, 0x9A, 0x04,
+    };
+    std::string path = ::testing::TempDir() + "batch_clip.h264";
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file) {
+        fwrite(clip, 1, sizeof(clip), file);
+        fclose(file);
+    }
+    return path;
+}
+
+StreamConfig file_config(const std::string& path) {
+    StreamConfig config = {};
+    config.type = STREAM_TYPE_FILE;
+    snprintf(config.url, sizeof(config.url), "%s", path.c_str());
+    config.playbackLoop = true;
+    return config;
+}
+
+} // namespace
+
+TEST(StreamManagerTest, BatchStartReportsEveryStream) {
+    std::string clip = write_clip();
+    std::vector<StreamConfig> configs(4, file_config(clip));
+    configs.push_back(file_config(::testing::TempDir() + "missing.h264"));
+    configs.push_back(StreamConfig());
+    configs.back().type = STREAM_TYPE_NETWORK;
+
+    StreamManager* manager = stream_manager_create();
+    BatchResults batch;
+    StreamBatchParams params = {};
+    params.maxConcurrent = 2;
+    params.staggerMs = 20;
+    params.play = true;
+    params.callback = BatchResults::onComplete;
+    params.userData = &batch;
+
+    int ids[6];
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(stream_manager_start_streams(manager, configs.data(), 6, &params, ids));
+    EXPECT_EQ(stream_manager_get_stream_count(manager), 6);
+    ASSERT_TRUE(batch.wait(3000));
+
+    // Начала подключений разнесены на staggerMs
+    EXPECT_GE(elapsed_ms(start), 5 * 20 - 10.0);
+    ASSERT_EQ(batch.results.size(), 6u);
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(batch.results[i].streamId, ids[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(batch.results[i].success) << batch.results[i].message;
+        EXPECT_EQ(batch.results[i].status, STREAM_STATUS_PLAYING);
+        EXPECT_EQ(stream_manager_get_status(manager, ids[i]), STREAM_STATUS_PLAYING);
+    }
+    EXPECT_FALSE(batch.results[4].success);
+    EXPECT_EQ(batch.results[4].status, STREAM_STATUS_ERROR);
+    EXPECT_NE(std::string(batch.results[4].message), "");
+    EXPECT_FALSE(batch.results[5].success);
+    EXPECT_STREQ(batch.results[5].message, "Failed to start connection");
+
+    EXPECT_FALSE(stream_manager_start_streams(manager, configs.data(), 0, &params, ids));
+    stream_manager_destroy(manager);
+    EXPECT_EQ(batch.calls, 1);
+    std::remove(clip.c_str());
+}
+
+TEST(StreamManagerTest, BatchStartLimitsConcurrentHandshakes) {
+    SilentCamera camera;
+    ASSERT_GT(camera.port(), 0);
+
+    StreamManager* manager = stream_manager_create();
+    std::vector<StreamConfig> configs(4, rtsp_config(camera.port(), 300));
+    BatchResults batch;
+    StreamBatchParams params = {};
+    params.maxConcurrent = 2;
+    params.play = true;
+    params.callback = BatchResults::onComplete;
+    params.userData = &batch;
+
+    int ids[4];
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(stream_manager_start_streams(manager, configs.data(), 4, &params, ids));
+
+    // Не больше двух сессий устанавливается одновременно
+    int maxConnecting = 0;
+    while (!batch.wait(5)) {
+        int connecting = 0;
+        for (int id : ids) {
+            connecting += stream_manager_get_status(manager, id) == STREAM_STATUS_CONNECTING;
+        }
+        maxConnecting = std::max(maxConnecting, connecting);
+        ASSERT_LT(elapsed_ms(start), 5000.0);
+    }
+    EXPECT_EQ(maxConnecting, 2);
+
+    // Каждая сессия ждет таймаута ответа: две волны
+    EXPECT_GE(elapsed_ms(start), 550.0);
+    for (const StreamStartResult& result : batch.results) {
+        EXPECT_FALSE(result.success);
+        EXPECT_EQ(result.status, STREAM_STATUS_ERROR);
+    }
+    stream_manager_destroy(manager);
+}
+
+TEST(StreamManagerTest, UdpFallbackDoesNotHoldBackBatch) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator fast(source, simulatorConfig);
+    // Камера без RTP: в режиме AUTO переход на TCP через 3 с после PLAY
+    simulatorConfig.lossPercent = 100.0;
+    CameraSimulator stalled(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(fast.start(error)) << error;
+    ASSERT_TRUE(stalled.start(error)) << error;
+
+    std::vector<StreamConfig> configs(1, rtsp_config(stalled.port(), 2000));
+    configs[0].transport = RTSP_TRANSPORT_AUTO;
+    configs.resize(5, rtsp_config(fast.port(), 2000));
+
+    StreamManager* manager = stream_manager_create();
+    BatchResults batch;
+    StreamBatchParams params = {};
+    params.maxConcurrent = 2;
+    params.play = true;
+    params.callback = BatchResults::onComplete;
+    params.userData = &batch;
+
+    int ids[5];
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(stream_manager_start_streams(manager, configs.data(), 5, &params, ids));
+
+    // PLAY первой камеры не ждет UDP пакетов: пакет завершается до перехода на TCP
+    ASSERT_TRUE(batch.wait(5000));
+    EXPECT_LT(elapsed_ms(start), 2000.0);
+    for (const StreamStartResult& result : batch.results) {
+        EXPECT_TRUE(result.success) << result.message;
+        EXPECT_EQ(result.status, STREAM_STATUS_PLAYING);
+    }
+
+    // Удаление не ждет запланированного перехода на TCP
+    stream_manager_destroy(manager);
+    fast.stop();
+    stalled.stop();
+}
+
+TEST(StreamManagerTest, DestroyFinishesBatchStart) {
+    SilentCamera camera;
+    ASSERT_GT(camera.port(), 0);
+
+    StreamManager* manager = stream_manager_create();
+    std::vector<StreamConfig> configs(3, rtsp_config(camera.port(), 2000));
+    BatchResults batch;
+    StreamBatchParams params = {};
+    params.maxConcurrent = 1;
+    params.callback = BatchResults::onComplete;
+    params.userData = &batch;
+
+    int ids[3];
+    ASSERT_TRUE(stream_manager_start_streams(manager, configs.data(), 3, &params, ids));
+    ASSERT_TRUE(wait_for_status(manager, ids[0], STREAM_STATUS_CONNECTING));
+
+    auto start = std::chrono::steady_clock::now();
+    stream_manager_destroy(manager);
+    EXPECT_LT(elapsed_ms(start), 1000.0);
+
+    ASSERT_EQ(batch.calls, 1);
+    for (const StreamStartResult& result : batch.results) {
+        EXPECT_FALSE(result.success);
+        EXPECT_STREQ(result.message, "Stream manager destroyed");
+    }
+}
+
+namespace {
+
+// Подписчик, отмечающий время кадров (для проверки непрерывности потока)
+struct FrameLog {
+    std::mutex mutex;
+    std::vector<int64_t> arrivalsUs;
+
+    static void onFrame(RTSPFrame* frame, void* userData) {
+        FrameLog* log = static_cast<FrameLog*>(userData);
+        int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        {
+            std::lock_guard<std::mutex> lock(log->mutex);
+            log->arrivalsUs.push_back(nowUs);
+        }
+        rtsp_frame_release(frame);
+    }
+
+    size_t count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return arrivalsUs.size();
+    }
+
+    int64_t maxGapUs() {
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t gap = 0;
+        for (size_t i = 1; i < arrivalsUs.size(); i++) {
+            gap = std::max(gap, arrivalsUs[i] - arrivalsUs[i - 1]);
+        }
+        return gap;
+    }
+};
+
+bool wait_for_profile(StreamManager* manager, int streamId, int profile) {
+    for (int i = 0; i < 1000; i++) {
+        if (stream_manager_get_active_profile(manager, streamId) == profile) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+uint64_t playing_sessions(const CameraSimulator& simulator) {
+    CameraSimulator::Stats stats;
+    simulator.getStats(stats);
+    return stats.playing;
+}
+
+} // namespace
+
+TEST(StreamManagerTest, ProfileFollowsSubscriberDemand) {
+    MediaSource source;
+    source.generateSynthetic(RTPPayloadCodec::H264, 5, 500);
+    CameraSimulatorConfig simulatorConfig;
+    simulatorConfig.port = 0;
+    CameraSimulator simulator(source, simulatorConfig);
+    std::string error;
+    ASSERT_TRUE(simulator.start(error)) << error;
+
+    StreamConfig config = rtsp_config(simulator.port(), 2000);
+    snprintf(config.url, sizeof(config.url), "rtsp://127.0.0.1:%d/main", simulator.port());
+    snprintf(config.profiles[0].url, sizeof(config.profiles[0].url), "rtsp://127.0.0.1:%d/sub", simulator.port());
+    config.profiles[0].width = 640;
+    config.profiles[0].height = 360;
+    snprintf(config.profiles[1].url, sizeof(config.profiles[1].url), "rtsp://127.0.0.1:%d/cif", simulator.port());
+    config.profiles[1].width = 352;
+    config.profiles[1].height = 288;
+    config.profileCount = 2;
+
+    StreamManager* manager = stream_manager_create();
+    int id = stream_manager_add_stream(manager, &config);
+    EXPECT_EQ(stream_manager_get_active_profile(manager, id), 0);
+
+    // Плитка мозаики: достаточно 640x360, подключается дополнительный поток
+    FrameLog tile;
+    StreamSubscriberParams params = {};
+    params.callback = FrameLog::onFrame;
+    params.userData = &tile;
+    params.width = 640;
+    params.height = 360;
+    int tileId = stream_manager_subscribe(manager, id, &params);
+    ASSERT_GT(tileId, 0);
+    ASSERT_TRUE(stream_manager_connect_stream(manager, id));
+    ASSERT_TRUE(stream_manager_play_stream(manager, id));
+    EXPECT_EQ(stream_manager_get_active_profile(manager, id), 1);
+    for (int i = 0; i < 200 && tile.count() < 5; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_GE(tile.count(), 5u);
+
+    // Полноэкранный просмотр: переключение на основной поток, прежняя сессия закрывается
+    FrameLog fullscreen;
+    params.userData = &fullscreen;
+    params.width = 0;
+    params.height = 0;
+    int fullscreenId = stream_manager_subscribe(manager, id, &params);
+    ASSERT_TRUE(wait_for_profile(manager, id, 0));
+    size_t beforeUnsubscribe = tile.count();
+
+    // Без него - обратно на дополнительный
+    EXPECT_TRUE(stream_manager_unsubscribe(manager, id, fullscreenId));
+    ASSERT_TRUE(wait_for_profile(manager, id, 1));
+    for (int i = 0; i < 200 && playing_sessions(simulator) != 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(playing_sessions(simulator), 1u);
+    EXPECT_EQ(stream_manager_get_status(manager, id), STREAM_STATUS_PLAYING);
+
+    // Плитка получала кадры без перерыва на всех переключениях
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_GT(tile.count(), beforeUnsubscribe);
+    EXPECT_GT(fullscreen.count(), 0u);
+    EXPECT_LT(tile.maxGapUs(), 300000);
+
+    stream_manager_destroy(manager);
+    simulator.stop();
+}
+
+namespace {
+
+// Callback кадров потока: потоки, в которых он вызывался, и порядок кадров
+struct ShardLog {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    size_t frames = 0;
+    int64_t lastTimestamp = 0;
+    bool ordered = true;
+
+    static void onFrame(RTSPFrame* frame, void* userData) {
+        ShardLog* log = static_cast<ShardLog*>(userData);
+        {
+            std::lock_guard<std::mutex> lock(log->mutex);
+            log->threads.insert(std::this_thread::get_id());
+            log->ordered = log->ordered && frame->timestamp > log->lastTimestamp;
+            log->lastTimestamp = frame->timestamp;
+            log->frames++;
+        }
+        rtsp_frame_release(frame);
+    }
+
+    size_t count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return frames;
+    }
+
+    bool waitFor(size_t count) {
+        for (int i = 0; i < 300 && this->count() < count; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return this->count() >= count;
+    }
+
+    std::set<std::thread::id> threadSet() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return threads;
+    }
+};
+
+} // namespace
+
+TEST(StreamManagerTest, ShardedStreamsRunOnTheirShard) {
+    StreamManager* plain = stream_manager_create();
+    StreamConfig plainConfig = rtsp_config(554, 1000);
+    int plainId = stream_manager_add_stream(plain, &plainConfig);
+    EXPECT_EQ(stream_manager_get_shard_count(plain), 0);
+    EXPECT_EQ(stream_manager_get_stream_shard(plain, plainId), -1);
+    EXPECT_EQ(stream_manager_rebalance_shards(plain), 0);
+    stream_manager_destroy(plain);
+
+    StreamShardParams shardParams = {};
+    shardParams.shardCount = 2;
+    shardParams.pinThreads = true;
+    shardParams.numaAware = true;
+    shardParams.policy = RTSP_FRAME_QUEUE_DROP_OLDEST;
+    StreamManager* manager = stream_manager_create_sharded(&shardParams);
+    ASSERT_NE(manager, nullptr);
+    ASSERT_EQ(stream_manager_get_shard_count(manager), 2);
+
+    std::string clip = write_clip();
+    StreamConfig config = file_config(clip);
+    config.fileFps = 200;
+    int ids[4];
+    ShardLog logs[4];
+    for (int i = 0; i < 4; i++) {
+        ids[i] = stream_manager_add_stream(manager, &config);
+        stream_manager_set_frame_callback(manager, ids[i], ShardLog::onFrame, &logs[i]);
+        ASSERT_TRUE(stream_manager_connect_stream(manager, ids[i]));
+        ASSERT_TRUE(stream_manager_play_stream(manager, ids[i]));
+    }
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(logs[i].waitFor(20));
+    }
+
+    // Потоки поровну по шардам; кадры потока - в потоке его шарда, по порядку
+    for (int s = 0; s < 2; s++) {
+        StreamShardStats stats;
+        ASSERT_TRUE(stream_manager_get_shard_stats(manager, s, &stats));
+        EXPECT_EQ(stats.streams, 2);
+        EXPECT_GT(stats.frames, 0u);
+    }
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(logs[i].threadSet().size(), 1u);
+        for (int j = i + 1; j < 4; j++) {
+            bool sameShard = stream_manager_get_stream_shard(manager, ids[i]) ==
+                             stream_manager_get_stream_shard(manager, ids[j]);
+            EXPECT_EQ(sameShard, logs[i].threadSet() == logs[j].threadSet());
+        }
+    }
+
+    // Потоки одного шарда удалены: балансировка переносит на него один из оставшихся
+    int emptied = stream_manager_get_stream_shard(manager, ids[0]);
+    std::vector<int> remaining;
+    for (int i = 0; i < 4; i++) {
+        if (stream_manager_get_stream_shard(manager, ids[i]) == emptied) {
+            EXPECT_TRUE(stream_manager_remove_stream(manager, ids[i]));
+        } else {
+            remaining.push_back(i);
+        }
+    }
+    ASSERT_EQ(remaining.size(), 2u);
+    EXPECT_EQ(stream_manager_rebalance_shards(manager), 1);
+    EXPECT_NE(stream_manager_get_stream_shard(manager, ids[remaining[0]]),
+              stream_manager_get_stream_shard(manager, ids[remaining[1]]));
+
+    // Перенесенный поток продолжает получать кадры по порядку в потоке нового шарда
+    for (int i : remaining) {
+        size_t before = logs[i].count();
+        ASSERT_TRUE(logs[i].waitFor(before + 20));
+    }
+    size_t threads = logs[remaining[0]].threadSet().size() + logs[remaining[1]].threadSet().size();
+    EXPECT_EQ(threads, 3u);
+
+    stream_manager_destroy(manager);
+    for (const ShardLog& log : logs) {
+        EXPECT_TRUE(log.ordered);
+    }
+}
+
+TEST(StreamManagerTest, FileEndIsReportedThroughStatusCallbacks) {
+    std::string clip = write_clip();
+    StreamConfig config = file_config(clip);
+    config.playbackLoop = false;
+    config.fileFps = 200;
+
+    StreamManager* manager = stream_manager_create();
+    StatusLog all;
+    stream_manager_set_status_callback(manager, StatusLog::onStatus, &all);
+    int id = stream_manager_add_stream(manager, &config);
+    StatusLog log;
+    stream_manager_set_stream_status_callback(manager, id, StatusLog::onStatus, &log);
+
+    ASSERT_TRUE(stream_manager_connect_stream(manager, id));
+    ASSERT_TRUE(stream_manager_play_stream(manager, id));
+
+    // Без повтора воспроизведение заканчивается: поток возвращается в CONNECTED
+    auto endOfFile = [](StatusLog& statusLog) {
+        std::unique_lock<std::mutex> lock(statusLog.mutex);
+        return statusLog.condition.wait_for(lock, std::chrono::seconds(5), [&statusLog] {
+            for (const auto& event : statusLog.events) {
+                if (event.first == STREAM_STATUS_CONNECTED && event.second == "End of file") return true;
+            }
+            return false;
+        });
+    };
+    EXPECT_TRUE(endOfFile(log));
+    EXPECT_TRUE(endOfFile(all));
+    EXPECT_EQ(stream_manager_get_status(manager, id), STREAM_STATUS_CONNECTED);
+
+    stream_manager_destroy(manager);
+    std::remove(clip.c_str());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
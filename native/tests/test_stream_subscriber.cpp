@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include "stream_subscriber.h"
+#include "frame_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Потребитель: запоминает номера кадров (timestamp) и адреса буферов
+struct Consumer {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<int64_t> numbers;
+    std::vector<const uint8_t*> buffers;
+    std::atomic<bool> blocked{false};
+    StreamSubscriber* self = nullptr;       // Для отписки из callback
+
+    static void onFrame(RTSPFrame* frame, void* userData) {
+        Consumer* consumer = static_cast<Consumer*>(userData);
+        while (consumer->blocked.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        {
+            std::lock_guard<std::mutex> lock(consumer->mutex);
+            consumer->numbers.push_back(frame->timestamp);
+            consumer->buffers.push_back(frame->data);
+        }
+        FramePool::release(frame);
+        if (consumer->self) {
+            consumer->self->close();
+        }
+        consumer->condition.notify_all();
+    }
+
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(2), [&] { return numbers.size() >= count; });
+    }
+
+    bool waitForNumber(int64_t number) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(2), [&] {
+            return !numbers.empty() && numbers.back() == number;
+        });
+    }
+};
+
+StreamSubscriberParams params(Consumer& consumer, int capacity, RTSPFrameQueuePolicy policy) {
+    StreamSubscriberParams result = {};
+    result.callback = Consumer::onFrame;
+    result.userData = &consumer;
+    result.queueCapacity = capacity;
+    result.policy = policy;
+    return result;
+}
+
+class StreamSubscriberTest : public ::testing::Test {
+protected:
+    StreamSubscriberTest() : pool_(FramePool::create()) {}
+    ~StreamSubscriberTest() override { pool_->detach(); }
+
+    // Кадр от производителя: подписчики берут свои ссылки, своя освобождается
+    void produce(const std::vector<std::shared_ptr<StreamSubscriber>>& subscribers,
+                 int64_t number, bool keyframe) {
+        RTSPFrame* frame = pool_->acquire(16);
+        frame->timestamp = number;
+        frame->keyframe = keyframe;
+        for (const auto& subscriber : subscribers) {
+            subscriber->offer(frame);
+        }
+        FramePool::release(frame);
+    }
+
+    int framesInUse() const {
+        RTSPFramePoolStats stats;
+        pool_->getStats(&stats);
+        return stats.inUse;
+    }
+
+    FramePool* pool_;
+};
+
+} // namespace
+
+TEST_F(StreamSubscriberTest, SubscribersShareFrameBuffer) {
+    Consumer first, second;
+    std::vector<std::shared_ptr<StreamSubscriber>> subscribers = {
+        StreamSubscriber::create(1, params(first, 8, RTSP_FRAME_QUEUE_DROP_OLDEST)),
+        StreamSubscriber::create(2, params(second, 8, RTSP_FRAME_QUEUE_DROP_OLDEST)),
+    };
+
+    for (int i = 0; i < 4; i++) {
+        produce(subscribers, i, i == 0);
+    }
+    ASSERT_TRUE(first.waitFor(4));
+    ASSERT_TRUE(second.waitFor(4));
+
+    EXPECT_EQ(first.numbers, (std::vector<int64_t>{0, 1, 2, 3}));
+    EXPECT_EQ(second.numbers, first.numbers);
+    // Один и тот же буфер, без копий
+    EXPECT_EQ(second.buffers, first.buffers);
+
+    for (const auto& subscriber : subscribers) {
+        subscriber->close();
+    }
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+TEST_F(StreamSubscriberTest, StartsAtKeyframe) {
+    Consumer consumer;
+    std::vector<std::shared_ptr<StreamSubscriber>> subscribers = {
+        StreamSubscriber::create(1, params(consumer, 8, RTSP_FRAME_QUEUE_DROP_OLDEST)),
+    };
+
+    produce(subscribers, 0, false);
+    produce(subscribers, 1, false);
+    produce(subscribers, 2, true);
+    produce(subscribers, 3, false);
+    ASSERT_TRUE(consumer.waitFor(2));
+    subscribers[0]->close();
+
+    EXPECT_EQ(consumer.numbers, (std::vector<int64_t>{2, 3}));
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+TEST_F(StreamSubscriberTest, SlowSubscriberDoesNotDelayOthers) {
+    Consumer slow, fast;
+    slow.blocked = true;
+    std::vector<std::shared_ptr<StreamSubscriber>> subscribers = {
+        StreamSubscriber::create(1, params(slow, 2, RTSP_FRAME_QUEUE_DROP_OLDEST)),
+        StreamSubscriber::create(2, params(fast, 32, RTSP_FRAME_QUEUE_DROP_OLDEST)),
+    };
+
+    for (int i = 0; i < 20; i++) {
+        produce(subscribers, i, i == 0);
+    }
+    ASSERT_TRUE(fast.waitFor(20));
+
+    RTSPFrameQueueStats stats;
+    subscribers[0]->getStats(&stats);
+    EXPECT_GT(stats.dropped, 0u);
+    subscribers[1]->getStats(&stats);
+    EXPECT_EQ(stats.dropped, 0u);
+    EXPECT_EQ(stats.enqueued, 20u);
+
+    // Медленный подписчик получает самые свежие кадры
+    slow.blocked = false;
+    ASSERT_TRUE(slow.waitForNumber(19));
+    EXPECT_LE(slow.numbers.size(), 3u);
+
+    for (const auto& subscriber : subscribers) {
+        subscriber->close();
+    }
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+TEST_F(StreamSubscriberTest, CloseFromCallback) {
+    Consumer consumer;
+    std::vector<std::shared_ptr<StreamSubscriber>> subscribers = {
+        StreamSubscriber::create(1, params(consumer, 8, RTSP_FRAME_QUEUE_DROP_OLDEST)),
+    };
+    consumer.self = subscribers[0].get();
+
+    produce(subscribers, 0, true);
+    ASSERT_TRUE(consumer.waitFor(1));
+
+    // После закрытия кадры отбрасываются, последняя ссылка уходит в потоке доставки
+    produce(subscribers, 1, false);
+    subscribers.clear();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::lock_guard<std::mutex> lock(consumer.mutex);
+    EXPECT_EQ(consumer.numbers, (std::vector<int64_t>{0}));
+    EXPECT_EQ(framesInUse(), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "timer_wheel.h"
+
+#include <vector>
+
+namespace {
+
+std::vector<uint64_t> advance(HierarchicalTimerWheel& wheel, uint64_t tick) {
+    std::vector<uint64_t> expired;
+    wheel.advance(tick, expired);
+    return expired;
+}
+
+} // namespace
+
+TEST(HierarchicalTimerWheelTest, ExpiresOnScheduledTick) {
+    HierarchicalTimerWheel wheel;
+    wheel.add(1, 5);
+    wheel.add(2, 3);
+
+    EXPECT_TRUE(advance(wheel, 2).empty());
+    EXPECT_EQ(advance(wheel, 3), (std::vector<uint64_t>{2}));
+    EXPECT_TRUE(advance(wheel, 4).empty());
+    EXPECT_EQ(advance(wheel, 5), (std::vector<uint64_t>{1}));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(HierarchicalTimerWheelTest, CascadesFromUpperLevels) {
+    HierarchicalTimerWheel wheel(100);
+    wheel.add(1, 100 + 300);          // Уровень 1
+    wheel.add(2, 100 + 70000);        // Уровень 2
+    wheel.add(3, 100 + 255);          // Уровень 0
+
+    EXPECT_EQ(advance(wheel, 354), (std::vector<uint64_t>{}));
+    EXPECT_EQ(advance(wheel, 355), (std::vector<uint64_t>{3}));
+    EXPECT_TRUE(advance(wheel, 399).empty());
+    EXPECT_EQ(advance(wheel, 400), (std::vector<uint64_t>{1}));
+    EXPECT_TRUE(advance(wheel, 70099).empty());
+    EXPECT_EQ(advance(wheel, 70100), (std::vector<uint64_t>{2}));
+}
+
+TEST(HierarchicalTimerWheelTest, ExpiresInTickOrderWhenAdvancingFar) {
+    HierarchicalTimerWheel wheel;
+    wheel.add(1, 1000);
+    wheel.add(2, 10);
+    wheel.add(3, 600);
+
+    EXPECT_EQ(advance(wheel, 5000), (std::vector<uint64_t>{2, 3, 1}));
+}
+
+TEST(HierarchicalTimerWheelTest, TimersBeyondRangeAreRescheduled) {
+    HierarchicalTimerWheel wheel;
+    const uint64_t far = (1ull << 24) + 12345;
+    wheel.add(1, far);
+
+    EXPECT_TRUE(advance(wheel, far - 1).empty());
+    EXPECT_EQ(advance(wheel, far), (std::vector<uint64_t>{1}));
+}
+
+TEST(HierarchicalTimerWheelTest, RemoveAndReplace) {
+    HierarchicalTimerWheel wheel;
+    wheel.add(1, 10);
+    wheel.add(2, 20);
+
+    EXPECT_TRUE(wheel.remove(1));
+    EXPECT_FALSE(wheel.remove(1));
+
+    // Повторное добавление переносит таймер
+    wheel.add(2, 5);
+    EXPECT_EQ(advance(wheel, 30), (std::vector<uint64_t>{2}));
+}
+
+TEST(HierarchicalTimerWheelTest, PastExpiryFiresOnNextTick) {
+    HierarchicalTimerWheel wheel(50);
+    wheel.add(1, 10);
+
+    EXPECT_EQ(wheel.nextEventTick(), 51u);
+    EXPECT_EQ(advance(wheel, 51), (std::vector<uint64_t>{1}));
+}
+
+TEST(HierarchicalTimerWheelTest, NextEventTick) {
+    HierarchicalTimerWheel wheel;
+    EXPECT_EQ(wheel.nextEventTick(), HierarchicalTimerWheel::kNoTimers);
+
+    wheel.add(1, 40);
+    EXPECT_EQ(wheel.nextEventTick(), 40u);
+
+    // Дальний таймер: следующее событие - перенос на границе блока
+    wheel.remove(1);
+    wheel.add(2, 1000);
+    EXPECT_EQ(wheel.nextEventTick(), 256u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "udp_batch_receiver.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Пара сокетов на loopback: sender_ отправляет датаграммы на receiver_
+class UDPBatchReceiverTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        receiver_ = socket(AF_INET, SOCK_DGRAM, 0);
+        sender_ = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(receiver_, 0);
+        ASSERT_GE(sender_, 0);
+
+        memset(&address_, 0, sizeof(address_));
+        address_.sin_family = AF_INET;
+        address_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ASSERT_EQ(bind(receiver_, reinterpret_cast<struct sockaddr*>(&address_), sizeof(address_)), 0);
+        socklen_t length = sizeof(address_);
+        getsockname(receiver_, reinterpret_cast<struct sockaddr*>(&address_), &length);
+    }
+
+    void TearDown() override {
+        close(receiver_);
+        close(sender_);
+    }
+
+    void send(int count, int size) {
+        char payload[1400];
+        memset(payload, 0x47, sizeof(payload));
+        for (int i = 0; i < count; i++) {
+            sendto(sender_, payload, size, 0, reinterpret_cast<struct sockaddr*>(&address_), sizeof(address_));
+        }
+    }
+
+    int drain(UDPBatchReceiver& batch) {
+        int total = 0;
+        int count;
+        while ((count = batch.receive(receiver_)) > 0) total += count;
+        return total;
+    }
+
+    int receiver_ = -1;
+    int sender_ = -1;
+    struct sockaddr_in address_;
+};
+
+} // namespace
+
+TEST(UDPReceiveBufferTest, SizedFromBitrate) {
+    EXPECT_EQ(UDPBatchReceiver::receiveBufferForBitrate(0), UDPBatchReceiver::kDefaultReceiveBuffer);
+
+    // Секунда потока 16 Мбит/с (4K камера)
+    EXPECT_EQ(UDPBatchReceiver::receiveBufferForBitrate(16000), 2000000);
+
+    // Аудио и ошибочно большие значения ограничены
+    EXPECT_EQ(UDPBatchReceiver::receiveBufferForBitrate(64), UDPBatchReceiver::kMinReceiveBuffer);
+    EXPECT_EQ(UDPBatchReceiver::receiveBufferForBitrate(10000000), UDPBatchReceiver::kMaxReceiveBuffer);
+}
+
+TEST_F(UDPBatchReceiverTest, ReceivesBatch) {
+    UDPBatchReceiver batch;
+    send(10, 1200);
+
+    int total = drain(batch);
+    EXPECT_EQ(total, 10);
+    EXPECT_EQ(batch.datagram(0).size, 1200);
+    EXPECT_FALSE(batch.datagram(0).truncated);
+}
+
+TEST_F(UDPBatchReceiverTest, ReceivesUpToMaxBatchPerCall) {
+    UDPBatchReceiver batch;
+    EXPECT_EQ(batch.receive(receiver_), 0);
+
+    // Датаграммы разного размера: порядок сохраняется
+    for (int i = 0; i < 40; i++) {
+        send(1, 100 + i);
+    }
+
+    int first = batch.receive(receiver_);
+#ifdef __linux__
+    int maxBatch = UDPBatchReceiver::kMaxBatch;
+    ASSERT_EQ(first, maxBatch);
+#else
+    ASSERT_EQ(first, 1);
+#endif
+    for (int i = 0; i < first; i++) {
+        EXPECT_EQ(batch.datagram(i).size, 100 + i);
+    }
+    EXPECT_EQ(first + drain(batch), 40);
+    EXPECT_EQ(batch.receive(receiver_), 0);
+}
+
+#ifdef __linux__
+TEST_F(UDPBatchReceiverTest, CountsTruncatedDatagrams) {
+    // Датаграмма больше слота обрезается и помечается
+    std::vector<uint8_t> large(UDPBatchReceiver::kSlotSize + 100, 0x47);
+    sendto(sender_, large.data(), large.size(), 0, reinterpret_cast<struct sockaddr*>(&address_), sizeof(address_));
+    send(1, 500);
+
+    UDPBatchReceiver batch;
+    ASSERT_EQ(batch.receive(receiver_), 2);
+    EXPECT_TRUE(batch.datagram(0).truncated);
+    EXPECT_EQ(batch.datagram(0).size, static_cast<int>(UDPBatchReceiver::kSlotSize));
+    EXPECT_FALSE(batch.datagram(1).truncated);
+    EXPECT_EQ(batch.datagram(1).size, 500);
+    EXPECT_EQ(batch.truncatedCount(), 1u);
+}
+#endif
+
+TEST(UDPBatchReceiverThreadTest, BuffersArePerThread) {
+    UDPBatchReceiver* mine = &UDPBatchReceiver::forCurrentThread();
+    EXPECT_EQ(mine, &UDPBatchReceiver::forCurrentThread());
+
+    UDPBatchReceiver* other = nullptr;
+    std::thread thread([&other] { other = &UDPBatchReceiver::forCurrentThread(); });
+    thread.join();
+    EXPECT_NE(mine, other);
+}
+
+TEST_F(UDPBatchReceiverTest, SetsReceiveBuffer) {
+    int small = UDPBatchReceiver::setReceiveBufferSize(receiver_, 64 * 1024);
+    int large = UDPBatchReceiver::setReceiveBufferSize(receiver_, 128 * 1024);
+    EXPECT_GT(small, 0);
+    EXPECT_GE(large, small);
+    EXPECT_EQ(UDPBatchReceiver::setReceiveBufferSize(receiver_, 0), 0);
+}
+
+#ifdef __linux__
+TEST_F(UDPBatchReceiverTest, ReportsKernelDrops) {
+    ASSERT_TRUE(UDPBatchReceiver::enableDropCounter(receiver_));
+    UDPBatchReceiver::setReceiveBufferSize(receiver_, 4096);
+
+    // Переполнение буфера: ядро отбрасывает датаграммы, которые никто не читает
+    send(200, 1000);
+
+    UDPBatchReceiver batch;
+    int received = drain(batch);
+    EXPECT_GT(received, 0);
+    EXPECT_LT(received, 200);
+
+    uint32_t drops = 0;
+    send(1, 100);
+    ASSERT_EQ(batch.receive(receiver_), 1);
+    ASSERT_TRUE(batch.dropCounter(drops));
+    EXPECT_EQ(static_cast<int>(drops), 200 - received);
+}
+#endif
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,753 @@
+#include "camera_simulator.h"
+#include "rtsp_interleaved.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const uint8_t kPayloadType = 96;
+const int kClockRate = 90000;
+const int64_t kSenderReportIntervalUs = 1000000;
+const int kMaxEvents = 64;
+const size_t kMaxRequestSize = 64 * 1024;
+const size_t kMaxBatch = 256;
+
+// Секунды между эпохами NTP (1900) и Unix (1970)
+const int64_t kNtpUnixOffsetSec = 2208988800LL;
+
+int64_t steady_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wall_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void write32(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// UDP сокет на адресе симулятора с произвольным портом
+int open_udp_socket(const in_addr& address, int& port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr = address;
+    socklen_t length = sizeof(local);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) != 0 ||
+        getsockname(fd, reinterpret_cast<struct sockaddr*>(&local), &length) != 0 ||
+        !set_nonblocking(fd)) {
+        close(fd);
+        return -1;
+    }
+
+    // Сотни сессий отправляют кадры пачками
+    int bufferSize = 8 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+    port = ntohs(local.sin_port);
+    return fd;
+}
+
+// Значение заголовка RTSP запроса (без учета регистра имени), "" - нет заголовка
+std::string header_value(const std::string& message, const char* name) {
+    size_t nameLength = strlen(name);
+    size_t lineStart = message.find("\r\n");
+    while (lineStart != std::string::npos) {
+        lineStart += 2;
+        size_t lineEnd = message.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos || lineEnd == lineStart) break;
+
+        if (lineEnd - lineStart > nameLength && message[lineStart + nameLength] == ':' &&
+            strncasecmp(message.c_str() + lineStart, name, nameLength) == 0) {
+            size_t valueStart = lineStart + nameLength + 1;
+            while (valueStart < lineEnd && message[valueStart] == ' ') valueStart++;
+            return message.substr(valueStart, lineEnd - valueStart);
+        }
+        lineStart = lineEnd;
+    }
+    return "";
+}
+
+// Пара портов/каналов параметра Transport (name=a-b)
+bool transport_pair(const std::string& transport, const char* name, int& first, int& second) {
+    size_t pos = transport.find(name);
+    if (pos == std::string::npos) return false;
+    pos += strlen(name);
+    if (sscanf(transport.c_str() + pos, "%d-%d", &first, &second) == 2) return true;
+    if (sscanf(transport.c_str() + pos, "%d", &first) == 1) {
+        second = first + 1;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+struct CameraSimulator::Session {
+    std::string id;
+    bool interleaved = false;
+    uint8_t rtpChannel = 0;
+    uint8_t rtcpChannel = 1;
+    struct sockaddr_in rtpAddress;
+    struct sockaddr_in rtcpAddress;
+    std::unique_ptr<RTPPacketizer> packetizer;
+
+    bool playing = false;
+    uint64_t generation = 0;
+    uint32_t timestampBase = 0;
+    uint64_t frameIndex = 0;        // Кадры с начала сессии (источник повторяется по кругу)
+    int64_t startUs = 0;            // Номинальное время кадра 0 (steady)
+    int64_t startWallUs = 0;        // То же по часам Unix, для sender report
+    int64_t lastSendUs = 0;
+    int64_t lastReportUs = 0;
+    uint32_t packetCount = 0;
+    uint32_t octetCount = 0;
+
+    std::vector<uint8_t> heldPacket;    // Пакет, задержанный для перестановки
+    bool holding = false;
+};
+
+struct CameraSimulator::Connection {
+    int fd = -1;
+    uint64_t serial = 0;
+    struct in_addr peer;
+    std::string input;
+    std::string output;
+    size_t outputOffset = 0;
+    bool wantWrite = false;
+    std::unique_ptr<Session> session;
+};
+
+CameraSimulator::CameraSimulator(const MediaSource& source, const CameraSimulatorConfig& config)
+    : source_(source), config_(config), port_(config.port),
+      frameIntervalUs_(1000000 / std::max(1, source.fps())),
+      listenFd_(-1), rtpFd_(-1), rtcpFd_(-1), wakeFd_(-1), epollFd_(-1),
+      serverRtpPort_(0), serverRtcpPort_(0), running_(false), nextSerial_(1),
+      random_(std::random_device()()),
+      connectionCount_(0), playingCount_(0), frames_(0), packets_(0), bytes_(0),
+      lostPackets_(0), reorderedPackets_(0), overflowFrames_(0), rtcpPackets_(0) {}
+
+CameraSimulator::~CameraSimulator() {
+    stop();
+}
+
+bool CameraSimulator::start(std::string& error) {
+    if (running_) return true;
+    if (source_.frameCount() == 0) {
+        error = "Media source is empty";
+        return false;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(config_.port));
+    if (inet_pton(AF_INET, config_.bindAddress.c_str(), &address.sin_addr) != 1) {
+        error = "Invalid bind address " + config_.bindAddress;
+        return false;
+    }
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    socklen_t length = sizeof(address);
+    if (listenFd_ < 0 ||
+        bind(listenFd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd_, SOMAXCONN) != 0 ||
+        getsockname(listenFd_, reinterpret_cast<struct sockaddr*>(&address), &length) != 0 ||
+        !set_nonblocking(listenFd_)) {
+        error = "Failed to listen on " + config_.bindAddress + ":" + std::to_string(config_.port) +
+                ": " + strerror(errno);
+        stop();
+        return false;
+    }
+    port_ = ntohs(address.sin_port);
+
+    rtpFd_ = open_udp_socket(address.sin_addr, serverRtpPort_);
+    rtcpFd_ = open_udp_socket(address.sin_addr, serverRtcpPort_);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK);
+    epollFd_ = epoll_create1(0);
+    if (rtpFd_ < 0 || rtcpFd_ < 0 || wakeFd_ < 0 || epollFd_ < 0) {
+        error = std::string("Failed to create server sockets: ") + strerror(errno);
+        stop();
+        return false;
+    }
+
+    for (int fd : {listenFd_, rtpFd_, rtcpFd_, wakeFd_}) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    running_ = true;
+    thread_ = std::thread(&CameraSimulator::run, this);
+    return true;
+}
+
+void CameraSimulator::stop() {
+    if (running_.exchange(false)) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd_, &one, sizeof(one));
+        (void)written;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    while (!connections_.empty()) {
+        closeConnection(connections_.begin()->first);
+    }
+    for (int* fd : {&listenFd_, &rtpFd_, &rtcpFd_, &wakeFd_, &epollFd_}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void CameraSimulator::getStats(Stats& stats) const {
+    stats.connections = connectionCount_.load(std::memory_order_relaxed);
+    stats.playing = playingCount_.load(std::memory_order_relaxed);
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    stats.packets = packets_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.lostPackets = lostPackets_.load(std::memory_order_relaxed);
+    stats.reorderedPackets = reorderedPackets_.load(std::memory_order_relaxed);
+    stats.overflowFrames = overflowFrames_.load(std::memory_order_relaxed);
+    stats.rtcpPackets = rtcpPackets_.load(std::memory_order_relaxed);
+}
+
+void CameraSimulator::run() {
+    struct epoll_event events[kMaxEvents];
+
+    while (running_) {
+        int timeoutMs = 100;
+        if (!deadlines_.empty()) {
+            int64_t waitUs = deadlines_.top().timeUs - steady_now_us();
+            timeoutMs = waitUs <= 0 ? 0 : static_cast<int>(std::min<int64_t>((waitUs + 999) / 1000, 100));
+        }
+
+        int count = epoll_wait(epollFd_, events, kMaxEvents, timeoutMs);
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd_) {
+                acceptConnections();
+            } else if (fd == rtpFd_ || fd == rtcpFd_) {
+                drainDatagrams(fd);
+            } else if (fd == wakeFd_) {
+                uint64_t value;
+                ssize_t readBytes = read(wakeFd_, &value, sizeof(value));
+                (void)readBytes;
+            } else {
+                auto it = connections_.find(fd);
+                if (it == connections_.end()) continue;
+                Connection& connection = *it->second;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    closeConnection(fd);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    writeConnection(connection);
+                }
+                if (events[i].events & EPOLLIN) {
+                    readConnection(connection);
+                }
+            }
+        }
+
+        sendDueFrames(steady_now_us());
+    }
+}
+
+void CameraSimulator::acceptConnections() {
+    while (true) {
+        struct sockaddr_in peer;
+        socklen_t length = sizeof(peer);
+        int fd = accept(listenFd_, reinterpret_cast<struct sockaddr*>(&peer), &length);
+        if (fd < 0) return;
+
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        set_nonblocking(fd);
+
+        std::unique_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        connection->serial = nextSerial_++;
+        connection->peer = peer.sin_addr;
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+
+        connections_[fd] = std::move(connection);
+        connectionCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CameraSimulator::closeConnection(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) return;
+
+    if (it->second->session && it->second->session->playing) {
+        playingCount_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(it);
+    connectionCount_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void CameraSimulator::drainDatagrams(int fd) {
+    uint8_t buffer[2048];
+    while (recv(fd, buffer, sizeof(buffer), 0) >= 0) {
+        if (fd == rtcpFd_) {
+            rtcpPackets_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void CameraSimulator::readConnection(Connection& connection) {
+    int fd = connection.fd;
+    char buffer[16 * 1024];
+    while (true) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            closeConnection(fd);
+            return;
+        }
+        if (received < 0) break;
+        connection.input.append(buffer, static_cast<size_t>(received));
+    }
+
+    // Запросы RTSP и RTCP клиента в канале interleaved
+    size_t offset = 0;
+    while (offset < connection.input.size()) {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(connection.input.data()) + offset;
+        size_t available = connection.input.size() - offset;
+
+        if (data[0] == '$') {
+            if (available < 4) break;
+            size_t length = 4 + ((static_cast<size_t>(data[2]) << 8) | data[3]);
+            if (available < length) break;
+            rtcpPackets_.fetch_add(1, std::memory_order_relaxed);
+            offset += length;
+            continue;
+        }
+
+        size_t length = rtsp_message_length(data, available);
+        if (length == 0) {
+            if (available > kMaxRequestSize) {
+                closeConnection(fd);
+                return;
+            }
+            break;
+        }
+        if (!handleRequest(connection, connection.input.substr(offset, length))) {
+            closeConnection(fd);
+            return;
+        }
+        offset += length;
+    }
+    connection.input.erase(0, offset);
+
+    writeConnection(connection);
+}
+
+void CameraSimulator::writeConnection(Connection& connection) {
+    while (connection.outputOffset < connection.output.size()) {
+        ssize_t sent = send(connection.fd, connection.output.data() + connection.outputOffset,
+                            connection.output.size() - connection.outputOffset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+            closeConnection(connection.fd);
+            return;
+        }
+        connection.outputOffset += static_cast<size_t>(sent);
+    }
+
+    if (connection.outputOffset == connection.output.size()) {
+        connection.output.clear();
+        connection.outputOffset = 0;
+    } else if (connection.outputOffset > connection.output.size() / 2) {
+        connection.output.erase(0, connection.outputOffset);
+        connection.outputOffset = 0;
+    }
+    updateEvents(connection);
+}
+
+void CameraSimulator::updateEvents(Connection& connection) {
+    bool wantWrite = !connection.output.empty();
+    if (wantWrite == connection.wantWrite) return;
+    connection.wantWrite = wantWrite;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.fd = connection.fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+bool CameraSimulator::handleRequest(Connection& connection, const std::string& request) {
+    char method[32];
+    char url[1024];
+    if (sscanf(request.c_str(), "%31s %1023s", method, url) != 2) {
+        return false;
+    }
+    std::string cseq = header_value(request, "CSeq");
+    std::string sessionId = header_value(request, "Session");
+    sessionId = sessionId.substr(0, sessionId.find(';'));
+
+    int status = 200;
+    const char* reason = "OK";
+    std::string headers;
+    std::string body;
+
+    bool needsSession = strcmp(method, "PLAY") == 0 || strcmp(method, "PAUSE") == 0 ||
+                        strcmp(method, "TEARDOWN") == 0;
+    if (needsSession && (!connection.session || connection.session->id != sessionId)) {
+        status = 454;
+        reason = "Session Not Found";
+    } else if (strcmp(method, "OPTIONS") == 0) {
+        headers = "Public: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, GET_PARAMETER, SET_PARAMETER\r\n";
+    } else if (strcmp(method, "DESCRIBE") == 0) {
+        std::string base(url);
+        if (base.empty() || base.back() != '/') base += '/';
+        body = describe(url);
+        headers = "Content-Base: " + base + "\r\nContent-Type: application/sdp\r\n";
+    } else if (strcmp(method, "SETUP") == 0) {
+        if (!setup(connection, header_value(request, "Transport"), headers)) {
+            status = 461;
+            reason = "Unsupported Transport";
+            headers.clear();
+        }
+    } else if (strcmp(method, "PLAY") == 0) {
+        play(connection, headers, url);
+    } else if (strcmp(method, "PAUSE") == 0) {
+        Session& session = *connection.session;
+        if (session.playing) {
+            session.playing = false;
+            session.generation++;
+            playingCount_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    } else if (strcmp(method, "TEARDOWN") == 0) {
+        if (connection.session->playing) {
+            playingCount_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        connection.session.reset();
+    } else if (strcmp(method, "GET_PARAMETER") != 0 && strcmp(method, "SET_PARAMETER") != 0) {
+        status = 501;
+        reason = "Not Implemented";
+    }
+
+    if (connection.session && status == 200 && strcmp(method, "SETUP") != 0) {
+        headers += "Session: " + connection.session->id + "\r\n";
+    }
+
+    std::ostringstream response;
+    response << "RTSP/1.0 " << status << " " << reason << "\r\n"
+             << "CSeq: " << cseq << "\r\n"
+             << "Server: IP-CSS camera simulator\r\n"
+             << headers
+             << "Content-Length: " << body.size() << "\r\n\r\n"
+             << body;
+    connection.output += response.str();
+    return true;
+}
+
+std::string CameraSimulator::describe(const std::string& url) {
+    (void)url;
+    std::ostringstream sdp;
+    sdp << "v=0\r\n"
+        << "o=- " << (random_() & 0x7FFFFFFF) << " 1 IN IP4 " << config_.bindAddress << "\r\n"
+        << "s=IP-CSS camera simulator\r\n"
+        << "c=IN IP4 0.0.0.0\r\n"
+        << "t=0 0\r\n"
+        << "a=control:*\r\n"
+        << "a=range:npt=0-\r\n"
+        << "m=video 0 RTP/AVP " << static_cast<int>(kPayloadType) << "\r\n";
+    int bitrate = source_.averageBitrateKbps();
+    if (bitrate > 0) {
+        sdp << "b=AS:" << bitrate << "\r\n";
+    }
+    sdp << "a=rtpmap:" << static_cast<int>(kPayloadType) << " " << source_.encodingName() << "/" << kClockRate << "\r\n";
+    std::string parameters = source_.formatParameters();
+    if (!parameters.empty()) {
+        sdp << "a=fmtp:" << static_cast<int>(kPayloadType) << " " << parameters << "\r\n";
+    }
+    sdp << "a=framerate:" << source_.fps() << "\r\n"
+        << "a=control:trackID=0\r\n";
+    return sdp.str();
+}
+
+bool CameraSimulator::setup(Connection& connection, const std::string& transport, std::string& responseHeaders) {
+    if (transport.find("multicast") != std::string::npos) {
+        return false;
+    }
+
+    std::unique_ptr<Session> session(new Session());
+    int first = 0;
+    int second = 1;
+    if (transport.find("/TCP") != std::string::npos || transport.find("interleaved=") != std::string::npos) {
+        transport_pair(transport, "interleaved=", first, second);
+        if (first < 0 || first > 255 || second < 0 || second > 255) return false;
+        session->interleaved = true;
+        session->rtpChannel = static_cast<uint8_t>(first);
+        session->rtcpChannel = static_cast<uint8_t>(second);
+    } else {
+        if (!transport_pair(transport, "client_port=", first, second) ||
+            first <= 0 || first > 65535 || second <= 0 || second > 65535) {
+            return false;
+        }
+        memset(&session->rtpAddress, 0, sizeof(session->rtpAddress));
+        session->rtpAddress.sin_family = AF_INET;
+        session->rtpAddress.sin_addr = connection.peer;
+        session->rtcpAddress = session->rtpAddress;
+        session->rtpAddress.sin_port = htons(static_cast<uint16_t>(first));
+        session->rtcpAddress.sin_port = htons(static_cast<uint16_t>(second));
+    }
+
+    // Повторный SETUP (смена транспорта) сохраняет идентификатор сессии
+    char id[17];
+    if (connection.session) {
+        if (connection.session->playing) {
+            playingCount_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        session->id = connection.session->id;
+    } else {
+        snprintf(id, sizeof(id), "%08X%08X", static_cast<unsigned>(random_()), static_cast<unsigned>(random_()));
+        session->id = id;
+    }
+
+    uint32_t ssrc = static_cast<uint32_t>(random_());
+    session->packetizer.reset(new RTPPacketizer(source_.codec(), kPayloadType, ssrc,
+                                                static_cast<uint16_t>(random_()), config_.maxPacketSize));
+    session->timestampBase = static_cast<uint32_t>(random_());
+    connection.session = std::move(session);
+
+    char ssrcText[9];
+    snprintf(ssrcText, sizeof(ssrcText), "%08X", ssrc);
+    std::ostringstream headers;
+    if (connection.session->interleaved) {
+        headers << "Transport: RTP/AVP/TCP;unicast;interleaved=" << first << "-" << second;
+    } else {
+        headers << "Transport: RTP/AVP;unicast;client_port=" << first << "-" << second
+                << ";server_port=" << serverRtpPort_ << "-" << serverRtcpPort_;
+    }
+    headers << ";ssrc=" << ssrcText << "\r\n"
+            << "Session: " << connection.session->id << ";timeout=" << config_.sessionTimeoutSec << "\r\n";
+    responseHeaders = headers.str();
+    return true;
+}
+
+void CameraSimulator::play(Connection& connection, std::string& responseHeaders, const std::string& url) {
+    Session& session = *connection.session;
+    int64_t nowUs = steady_now_us();
+
+    if (!session.playing) {
+        // Возобновление после PAUSE продолжает отсчет кадров
+        session.playing = true;
+        session.generation++;
+        session.startUs = nowUs - static_cast<int64_t>(session.frameIndex) * frameIntervalUs_;
+        session.startWallUs = wall_now_us() - static_cast<int64_t>(session.frameIndex) * frameIntervalUs_;
+        session.lastSendUs = nowUs;
+        session.lastReportUs = 0;
+        playingCount_.fetch_add(1, std::memory_order_relaxed);
+        schedule(connection, session);
+    }
+
+    uint32_t rtpTime = session.timestampBase +
+                       static_cast<uint32_t>(session.frameIndex * kClockRate / static_cast<uint64_t>(source_.fps()));
+    std::string trackUrl(url);
+    if (trackUrl.empty() || trackUrl.back() != '/') trackUrl += '/';
+    responseHeaders = "Range: npt=0.000-\r\nRTP-Info: url=" + trackUrl + "trackID=0;seq=" +
+                      std::to_string(session.packetizer->nextSequence()) + ";rtptime=" +
+                      std::to_string(rtpTime) + "\r\n";
+}
+
+void CameraSimulator::schedule(Connection& connection, Session& session) {
+    int64_t deadline = session.startUs + static_cast<int64_t>(session.frameIndex) * frameIntervalUs_;
+    if (config_.jitterMs > 0) {
+        std::uniform_int_distribution<int64_t> jitter(0, static_cast<int64_t>(config_.jitterMs) * 1000);
+        deadline += jitter(random_);
+    }
+    // Задержка не переставляет кадры: перестановку задает reorderPercent
+    deadline = std::max(deadline, session.lastSendUs);
+
+    Deadline entry = {deadline, connection.fd, connection.serial, session.generation};
+    deadlines_.push(entry);
+}
+
+void CameraSimulator::sendDueFrames(int64_t nowUs) {
+    while (!deadlines_.empty() && deadlines_.top().timeUs <= nowUs) {
+        Deadline entry = deadlines_.top();
+        deadlines_.pop();
+
+        auto it = connections_.find(entry.fd);
+        if (it == connections_.end() || it->second->serial != entry.serial) continue;
+        Connection& connection = *it->second;
+        Session* session = connection.session.get();
+        if (!session || !session->playing || session->generation != entry.generation) continue;
+
+        sendFrame(connection, *session, nowUs);
+
+        // sendFrame мог закрыть соединение при ошибке записи
+        it = connections_.find(entry.fd);
+        if (it != connections_.end() && it->second->serial == entry.serial && it->second->session.get() == session) {
+            schedule(connection, *session);
+        }
+    }
+}
+
+void CameraSimulator::sendFrame(Connection& connection, Session& session, int64_t nowUs) {
+    const uint64_t fps = static_cast<uint64_t>(source_.fps());
+    const MediaFrame& frame = source_.frame(static_cast<size_t>(session.frameIndex % source_.frameCount()));
+    uint32_t rtpTimestamp = session.timestampBase + static_cast<uint32_t>(session.frameIndex * kClockRate / fps);
+    int64_t captureWallUs = session.startWallUs + static_cast<int64_t>(session.frameIndex) * frameIntervalUs_;
+    session.frameIndex++;
+    session.lastSendUs = nowUs;
+
+    if (session.lastReportUs == 0 || nowUs - session.lastReportUs >= kSenderReportIntervalUs) {
+        session.lastReportUs = nowUs;
+        sendSenderReport(connection, session, rtpTimestamp, captureWallUs);
+    }
+
+    // Пакеты interleaved соединения, которое не успевает читать, отбрасываются целым кадром
+    if (session.interleaved && connection.output.size() - connection.outputOffset > config_.tcpOutputLimit) {
+        overflowFrames_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t count = session.packetizer->packetize(frame.data.data(), frame.data.size(), rtpTimestamp);
+
+    std::vector<const std::vector<uint8_t>*> packets;
+    packets.reserve(count + 1);
+    std::deque<std::vector<uint8_t>> released;      // Задержанные пакеты, отправляемые в этом кадре
+    std::uniform_real_distribution<double> percent(0.0, 100.0);
+    for (size_t i = 0; i < count; i++) {
+        const std::vector<uint8_t>& packet = session.packetizer->packet(i);
+        session.packetCount++;
+        session.octetCount += static_cast<uint32_t>(packet.size() - RTPPacketizer::kHeaderSize);
+
+        if (config_.lossPercent > 0.0 && percent(random_) < config_.lossPercent) {
+            lostPackets_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        packets.push_back(&packet);
+        if (session.holding) {
+            // Задержанный пакет уходит после следующего
+            released.push_back(std::move(session.heldPacket));
+            packets.push_back(&released.back());
+            session.holding = false;
+        } else if (config_.reorderPercent > 0.0 && percent(random_) < config_.reorderPercent) {
+            session.heldPacket = packet;
+            session.holding = true;
+            packets.pop_back();
+            reorderedPackets_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    sendPackets(connection, session, packets);
+    frames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CameraSimulator::sendPackets(Connection& connection, Session& session,
+                                  const std::vector<const std::vector<uint8_t>*>& packets) {
+    uint64_t bytes = 0;
+    for (const std::vector<uint8_t>* packet : packets) {
+        bytes += packet->size();
+    }
+
+    if (session.interleaved) {
+        for (const std::vector<uint8_t>* packet : packets) {
+            queueInterleaved(connection, session.rtpChannel, packet->data(), packet->size());
+        }
+        writeConnection(connection);
+    } else {
+        // Пакеты кадра уходят одним системным вызовом
+        struct mmsghdr messages[kMaxBatch];
+        struct iovec vectors[kMaxBatch];
+        size_t offset = 0;
+        while (offset < packets.size()) {
+            size_t batch = std::min(packets.size() - offset, kMaxBatch);
+            for (size_t i = 0; i < batch; i++) {
+                const std::vector<uint8_t>* packet = packets[offset + i];
+                vectors[i].iov_base = const_cast<uint8_t*>(packet->data());
+                vectors[i].iov_len = packet->size();
+                memset(&messages[i], 0, sizeof(messages[i]));
+                messages[i].msg_hdr.msg_name = &session.rtpAddress;
+                messages[i].msg_hdr.msg_namelen = sizeof(session.rtpAddress);
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            // Переполнение буфера отправки учитывается клиентом как потеря
+            sendmmsg(rtpFd_, messages, static_cast<unsigned>(batch), 0);
+            offset += batch;
+        }
+    }
+
+    packets_.fetch_add(packets.size(), std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void CameraSimulator::sendSenderReport(Connection& connection, Session& session, uint32_t rtpTimestamp,
+                                       int64_t captureWallUs) {
+    // SR (RFC 3550, 6.4.1) без блоков отчетов
+    uint8_t report[28];
+    report[0] = 0x80;
+    report[1] = 200;
+    report[2] = 0;
+    report[3] = 6;
+    write32(report + 4, session.packetizer->ssrc());
+    uint64_t seconds = static_cast<uint64_t>(captureWallUs / 1000000 + kNtpUnixOffsetSec);
+    uint64_t fraction = (static_cast<uint64_t>(captureWallUs % 1000000) << 32) / 1000000;
+    write32(report + 8, static_cast<uint32_t>(seconds));
+    write32(report + 12, static_cast<uint32_t>(fraction));
+    write32(report + 16, rtpTimestamp);
+    write32(report + 20, session.packetCount);
+    write32(report + 24, session.octetCount);
+
+    if (session.interleaved) {
+        queueInterleaved(connection, session.rtcpChannel, report, sizeof(report));
+    } else {
+        sendto(rtcpFd_, report, sizeof(report), 0,
+               reinterpret_cast<struct sockaddr*>(&session.rtcpAddress), sizeof(session.rtcpAddress));
+    }
+}
+
+void CameraSimulator::queueInterleaved(Connection& connection, uint8_t channel, const uint8_t* data, size_t size) {
+    char header[4] = {'$', static_cast<char>(channel), static_cast<char>(size >> 8), static_cast<char>(size & 0xFF)};
+    connection.output.append(header, sizeof(header));
+    connection.output.append(reinterpret_cast<const char*>(data), size);
+}
@@ -0,0 +1,135 @@
+#ifndef CAMERA_SIMULATOR_H
+#define CAMERA_SIMULATOR_H
+
+#include "media_source.h"
+#include "rtp_packetizer.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+
+// Параметры симулятора камер
+struct CameraSimulatorConfig {
+    std::string bindAddress = "127.0.0.1";
+    int port = 8554;
+    size_t maxPacketSize = RTPPacketizer::kDefaultMaxPacketSize;
+
+    // Искажения сети, применяются к каждой сессии независимо
+    double lossPercent = 0.0;       // Доля отбрасываемых RTP пакетов
+    double reorderPercent = 0.0;    // Доля пакетов, отправляемых после следующего
+    int jitterMs = 0;               // Случайная задержка кадра 0..jitterMs
+
+    int sessionTimeoutSec = 60;
+    size_t tcpOutputLimit = 4 * 1024 * 1024;   // Очередь interleaved соединения, сверх нее кадры отбрасываются
+};
+
+// Заменитель RTSP камеры для нагрузочных тестов: один поток обслуживает все
+// сессии (epoll), каждая сессия - отдельная "камера" с собственными SSRC,
+// номерами и временными метками, кадры общего MediaSource повторяются по кругу.
+// Поддерживаются RTP/UDP (unicast) и RTP поверх RTSP (interleaved TCP),
+// RTCP sender report раз в секунду содержит номинальное время захвата кадра,
+// так что клиент может измерить задержку доставки. Любой путь в URL
+// (rtsp://host:port/cam1, /cam2...) открывает новую камеру.
+class CameraSimulator {
+public:
+    struct Stats {
+        uint64_t connections;       // Открытые RTSP соединения
+        uint64_t playing;           // Сессии в состоянии PLAY
+        uint64_t frames;
+        uint64_t packets;
+        uint64_t bytes;
+        uint64_t lostPackets;       // Отброшены симуляцией потерь
+        uint64_t reorderedPackets;
+        uint64_t overflowFrames;    // Не поместились в очередь interleaved соединения
+        uint64_t rtcpPackets;       // Получено RTCP от клиентов
+    };
+
+    CameraSimulator(const MediaSource& source, const CameraSimulatorConfig& config);
+    ~CameraSimulator();
+
+    bool start(std::string& error);
+    void stop();
+
+    // Фактический порт RTSP (если в конфигурации 0)
+    int port() const { return port_; }
+
+    void getStats(Stats& stats) const;
+
+private:
+    struct Session;
+    struct Connection;
+
+    // Момент отправки следующего кадра сессии
+    struct Deadline {
+        int64_t timeUs;
+        int fd;
+        uint64_t serial;        // Соединение (fd переиспользуются)
+        uint64_t generation;    // Устаревает при PAUSE/TEARDOWN
+        bool operator>(const Deadline& other) const { return timeUs > other.timeUs; }
+    };
+
+    CameraSimulator(const CameraSimulator&) = delete;
+    CameraSimulator& operator=(const CameraSimulator&) = delete;
+
+    void run();
+    void acceptConnections();
+    void readConnection(Connection& connection);
+    void writeConnection(Connection& connection);
+    void closeConnection(int fd);
+    void drainDatagrams(int fd);
+
+    bool handleRequest(Connection& connection, const std::string& request);
+    std::string describe(const std::string& url);
+    bool setup(Connection& connection, const std::string& transport, std::string& responseHeaders);
+    void play(Connection& connection, std::string& responseHeaders, const std::string& url);
+
+    void sendDueFrames(int64_t nowUs);
+    void sendFrame(Connection& connection, Session& session, int64_t nowUs);
+    void sendSenderReport(Connection& connection, Session& session, uint32_t rtpTimestamp,
+                          int64_t captureWallUs);
+    void sendPackets(Connection& connection, Session& session,
+                     const std::vector<const std::vector<uint8_t>*>& packets);
+    void queueInterleaved(Connection& connection, uint8_t channel, const uint8_t* data, size_t size);
+    void updateEvents(Connection& connection);
+    void schedule(Connection& connection, Session& session);
+
+    const MediaSource& source_;
+    CameraSimulatorConfig config_;
+    int port_;
+    int64_t frameIntervalUs_;
+
+    int listenFd_;
+    int rtpFd_;
+    int rtcpFd_;
+    int wakeFd_;
+    int epollFd_;
+    int serverRtpPort_;
+    int serverRtcpPort_;
+
+    std::thread thread_;
+    std::atomic<bool> running_;
+
+    std::map<int, std::unique_ptr<Connection>> connections_;
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines_;
+    uint64_t nextSerial_;
+    std::mt19937 random_;
+
+    std::atomic<uint64_t> connectionCount_;
+    std::atomic<uint64_t> playingCount_;
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> packets_;
+    std::atomic<uint64_t> bytes_;
+    std::atomic<uint64_t> lostPackets_;
+    std::atomic<uint64_t> reorderedPackets_;
+    std::atomic<uint64_t> overflowFrames_;
+    std::atomic<uint64_t> rtcpPackets_;
+};
+
+#endif // CAMERA_SIMULATOR_H
@@ -0,0 +1,140 @@
+// Симулятор RTSP камер для нагрузочного тестирования приема видео.
+//
+//   rtsp_camera_simulator [--port 8554] [--bind 127.0.0.1]
+//                         [--source file.h264|file.h265|file.mp4] [--codec h264|h265]
+//                         [--fps 25] [--bitrate 4000] [--gop 50]
+//                         [--loss 0.5] [--reorder 0.1] [--jitter 20] [--mtu 1400]
+//
+// Без --source передается синтетический поток заданного битрейта.
+// Камеры доступны по любому пути: rtsp://127.0.0.1:8554/cam1 ... /camN.
+
+#include "camera_simulator.h"
+#include "media_source.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<bool> g_stop(false);
+
+void on_signal(int) {
+    g_stop = true;
+}
+
+void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--port N] [--bind ADDRESS] [--source FILE] [--codec h264|h265]\n"
+            "          [--fps N] [--bitrate KBPS] [--gop N] [--loss PERCENT] [--reorder PERCENT]\n"
+            "          [--jitter MS] [--mtu BYTES] [--report SECONDS]\n",
+            program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CameraSimulatorConfig config;
+    std::string sourcePath;
+    RTPPayloadCodec codec = RTPPayloadCodec::H264;
+    int fps = 0;
+    int bitrateKbps = 4000;
+    int gopLength = 50;
+    int reportSec = 5;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (option == "--help" || option == "-h") {
+            usage(argv[0]);
+            return 0;
+        }
+        if (!value) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        if (option == "--port") config.port = atoi(value);
+        else if (option == "--bind") config.bindAddress = value;
+        else if (option == "--source") sourcePath = value;
+        else if (option == "--codec") codec = rtp_payload_codec_from_name(value);
+        else if (option == "--fps") fps = atoi(value);
+        else if (option == "--bitrate") bitrateKbps = atoi(value);
+        else if (option == "--gop") gopLength = atoi(value);
+        else if (option == "--loss") config.lossPercent = atof(value);
+        else if (option == "--reorder") config.reorderPercent = atof(value);
+        else if (option == "--jitter") config.jitterMs = atoi(value);
+        else if (option == "--mtu") config.maxPacketSize = static_cast<size_t>(atoi(value));
+        else if (option == "--report") reportSec = atoi(value);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    MediaSource source;
+    if (sourcePath.empty()) {
+        source.setFps(fps);
+        source.generateSynthetic(codec, gopLength, bitrateKbps);
+    } else {
+        std::string error;
+        if (!source.load(sourcePath, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        // Частота кадров элементарного потока в файле не записана
+        source.setFps(fps);
+    }
+
+    CameraSimulator simulator(source, config);
+    std::string error;
+    if (!simulator.start(error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    printf("Serving %s %d fps, %zu frames, ~%d kbit/s at rtsp://%s:%d/<camera>\n",
+           source.encodingName(), source.fps(), source.frameCount(), source.averageBitrateKbps(),
+           config.bindAddress.c_str(), simulator.port());
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    CameraSimulator::Stats previous;
+    simulator.getStats(previous);
+    auto lastReport = std::chrono::steady_clock::now();
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastReport).count();
+        if (reportSec <= 0 || elapsed < reportSec) continue;
+
+        CameraSimulator::Stats stats;
+        simulator.getStats(stats);
+        printf("connections %llu playing %llu | %.0f frames/s %.0f packets/s %.1f Mbit/s | "
+               "lost %llu reordered %llu overflow %llu rtcp %llu\n",
+               static_cast<unsigned long long>(stats.connections),
+               static_cast<unsigned long long>(stats.playing),
+               (stats.frames - previous.frames) / elapsed,
+               (stats.packets - previous.packets) / elapsed,
+               (stats.bytes - previous.bytes) * 8 / elapsed / 1e6,
+               static_cast<unsigned long long>(stats.lostPackets),
+               static_cast<unsigned long long>(stats.reorderedPackets),
+               static_cast<unsigned long long>(stats.overflowFrames),
+               static_cast<unsigned long long>(stats.rtcpPackets));
+        fflush(stdout);
+        previous = stats;
+        lastReport = now;
+    }
+
+    simulator.stop();
+    return 0;
+}
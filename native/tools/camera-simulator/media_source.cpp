@@ -0,0 +1,356 @@
+#include "media_source.h"
+#include "rtp_packetizer.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#ifdef ENABLE_FFMPEG
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+#endif
+
+const int MediaSource::kDefaultFps;
+
+namespace {
+
+const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+
+// Типы NAL H.264
+const int kH264NalIdr = 5;
+const int kH264NalSps = 7;
+const int kH264NalPps = 8;
+
+// Типы NAL H.265
+const int kH265NalIrapFirst = 16;
+const int kH265NalIrapLast = 21;
+const int kH265NalVps = 32;
+const int kH265NalSps = 33;
+const int kH265NalPps = 34;
+
+// Синтетические наборы параметров: декодировать их не нужно,
+// они только передаются в SDP и в ключевых кадрах
+const uint8_t kSyntheticH264Sps[] = {0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9, 0x40, 0x78, 0x02, 0x27, 0xE5, 0x80};
+const uint8_t kSyntheticH264Pps[] = {0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0};
+const uint8_t kSyntheticH265Vps[] = {0x40, 0x01, 0x0C, 0x01, 0xFF, 0xFF, 0x01, 0x60, 0x90};
+const uint8_t kSyntheticH265Sps[] = {0x42, 0x01, 0x01, 0x01, 0x60, 0x90, 0x00, 0x5D, 0xA0};
+const uint8_t kSyntheticH265Pps[] = {0x44, 0x01, 0xC1, 0x72, 0xB4, 0x62, 0x40};
+
+std::string lower_extension(const std::string& path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos) return "";
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+std::string base64_encode(const std::vector<uint8_t>& data) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output;
+    output.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t value = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < data.size()) value |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < data.size()) value |= data[i + 2];
+        output += kAlphabet[(value >> 18) & 0x3F];
+        output += kAlphabet[(value >> 12) & 0x3F];
+        output += i + 1 < data.size() ? kAlphabet[(value >> 6) & 0x3F] : '=';
+        output += i + 2 < data.size() ? kAlphabet[value & 0x3F] : '=';
+    }
+    return output;
+}
+
+void append_nal(std::vector<uint8_t>& unit, const uint8_t* nal, size_t size) {
+    unit.insert(unit.end(), kStartCode, kStartCode + sizeof(kStartCode));
+    unit.insert(unit.end(), nal, nal + size);
+}
+
+// NAL-единица синтетического слайса: заголовок и заполнитель без нулевых байт
+// (нет эмуляции стартового кода)
+void append_filler_nal(std::vector<uint8_t>& unit, const uint8_t* header, size_t headerSize,
+                       size_t size, uint32_t& seed) {
+    unit.insert(unit.end(), kStartCode, kStartCode + sizeof(kStartCode));
+    unit.insert(unit.end(), header, header + headerSize);
+    for (size_t i = headerSize; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unit.push_back(static_cast<uint8_t>(0x80 | (seed >> 24)));
+    }
+}
+
+} // namespace
+
+MediaSource::MediaSource()
+    : codec_(RTPPayloadCodec::H264), fps_(kDefaultFps), totalBytes_(0) {}
+
+bool MediaSource::load(const std::string& path, std::string& error) {
+    std::string extension = lower_extension(path);
+    if (extension == "mp4" || extension == "mov" || extension == "mkv") {
+        return loadMp4(path, error);
+    }
+    if (extension == "h264" || extension == "264" || extension == "avc") {
+        return loadElementaryStream(path, RTPPayloadCodec::H264, error);
+    }
+    if (extension == "h265" || extension == "265" || extension == "hevc") {
+        return loadElementaryStream(path, RTPPayloadCodec::H265, error);
+    }
+    error = "Unknown media file type: " + path;
+    return false;
+}
+
+bool MediaSource::loadElementaryStream(const std::string& path, RTPPayloadCodec codec, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "Failed to open " + path;
+        return false;
+    }
+    std::vector<uint8_t> stream((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    codec_ = codec;
+    clear();
+    splitElementaryStream(stream);
+
+    if (frames_.empty()) {
+        error = "No video frames in " + path;
+        return false;
+    }
+    return true;
+}
+
+bool MediaSource::loadMp4(const std::string& path, std::string& error) {
+#ifdef ENABLE_FFMPEG
+    AVFormatContext* format = nullptr;
+    if (avformat_open_input(&format, path.c_str(), nullptr, nullptr) < 0) {
+        error = "Failed to open " + path;
+        return false;
+    }
+    if (avformat_find_stream_info(format, nullptr) < 0) {
+        avformat_close_input(&format);
+        error = "Failed to read stream info from " + path;
+        return false;
+    }
+
+    int index = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    AVStream* stream = index >= 0 ? format->streams[index] : nullptr;
+    const char* filterName = nullptr;
+    if (stream && stream->codecpar->codec_id == AV_CODEC_ID_H264) {
+        codec_ = RTPPayloadCodec::H264;
+        filterName = "h264_mp4toannexb";
+    } else if (stream && stream->codecpar->codec_id == AV_CODEC_ID_HEVC) {
+        codec_ = RTPPayloadCodec::H265;
+        filterName = "hevc_mp4toannexb";
+    } else {
+        avformat_close_input(&format);
+        error = "No H.264/H.265 video track in " + path;
+        return false;
+    }
+    if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
+        fps_ = std::max(1, static_cast<int>(av_q2d(stream->avg_frame_rate) + 0.5));
+    }
+
+    // Длины NAL-единиц MP4 заменяются стартовыми кодами, наборы параметров
+    // из avcC/hvcC вставляются перед ключевыми кадрами
+    AVBSFContext* filter = nullptr;
+    const AVBitStreamFilter* bitstreamFilter = av_bsf_get_by_name(filterName);
+    if (!bitstreamFilter || av_bsf_alloc(bitstreamFilter, &filter) < 0 ||
+        avcodec_parameters_copy(filter->par_in, stream->codecpar) < 0 ||
+        (filter->time_base_in = stream->time_base, av_bsf_init(filter)) < 0) {
+        av_bsf_free(&filter);
+        avformat_close_input(&format);
+        error = "Failed to initialize Annex-B conversion";
+        return false;
+    }
+
+    clear();
+    AVPacket* packet = av_packet_alloc();
+    bool draining = false;
+    while (!draining) {
+        if (av_read_frame(format, packet) < 0) {
+            draining = true;
+            av_bsf_send_packet(filter, nullptr);
+        } else if (packet->stream_index != index || av_bsf_send_packet(filter, packet) < 0) {
+            av_packet_unref(packet);
+            continue;
+        }
+        while (av_bsf_receive_packet(filter, packet) == 0) {
+            addAccessUnit(packet->data, static_cast<size_t>(packet->size));
+            av_packet_unref(packet);
+        }
+    }
+
+    av_packet_free(&packet);
+    av_bsf_free(&filter);
+    avformat_close_input(&format);
+
+    if (frames_.empty()) {
+        error = "No video frames in " + path;
+        return false;
+    }
+    return true;
+#else
+    (void)path;
+    error = "MP4 sources require a build with FFmpeg (ENABLE_FFMPEG)";
+    return false;
+#endif
+}
+
+void MediaSource::generateSynthetic(RTPPayloadCodec codec, int gopLength, int bitrateKbps) {
+    codec_ = codec == RTPPayloadCodec::H265 ? RTPPayloadCodec::H265 : RTPPayloadCodec::H264;
+    gopLength = std::max(1, gopLength);
+    clear();
+
+    // На GOP приходится gopLength средних кадров; IDR в 4 раза больше P-кадра
+    size_t averageFrame = static_cast<size_t>(std::max(1, bitrateKbps)) * 1000 / 8 / static_cast<size_t>(fps_);
+    size_t predictedSize = std::max<size_t>(16, averageFrame * gopLength / (gopLength + 3));
+    size_t keySize = predictedSize * 4;
+
+    uint32_t seed = 1;
+    for (int i = 0; i < gopLength; i++) {
+        std::vector<uint8_t> unit;
+        if (codec_ == RTPPayloadCodec::H264) {
+            const uint8_t idr[] = {0x65, 0x88};
+            const uint8_t slice[] = {0x41, 0x9A};
+            if (i == 0) {
+                append_nal(unit, kSyntheticH264Sps, sizeof(kSyntheticH264Sps));
+                append_nal(unit, kSyntheticH264Pps, sizeof(kSyntheticH264Pps));
+                append_filler_nal(unit, idr, sizeof(idr), keySize, seed);
+            } else {
+                append_filler_nal(unit, slice, sizeof(slice), predictedSize, seed);
+            }
+        } else {
+            const uint8_t idr[] = {0x26, 0x01, 0xAF};      // IDR_W_RADL, первый слайс
+            const uint8_t slice[] = {0x02, 0x01, 0xD0};    // TRAIL_R, первый слайс
+            if (i == 0) {
+                append_nal(unit, kSyntheticH265Vps, sizeof(kSyntheticH265Vps));
+                append_nal(unit, kSyntheticH265Sps, sizeof(kSyntheticH265Sps));
+                append_nal(unit, kSyntheticH265Pps, sizeof(kSyntheticH265Pps));
+                append_filler_nal(unit, idr, sizeof(idr), keySize, seed);
+            } else {
+                append_filler_nal(unit, slice, sizeof(slice), predictedSize, seed);
+            }
+        }
+        addAccessUnit(unit.data(), unit.size());
+    }
+}
+
+const char* MediaSource::encodingName() const {
+    return codec_ == RTPPayloadCodec::H265 ? "H265" : "H264";
+}
+
+std::string MediaSource::formatParameters() const {
+    std::string parameters;
+    if (codec_ == RTPPayloadCodec::H264) {
+        parameters = "packetization-mode=1";
+        if (sps_.size() >= 4) {
+            char profile[32];
+            snprintf(profile, sizeof(profile), ";profile-level-id=%02X%02X%02X", sps_[1], sps_[2], sps_[3]);
+            parameters += profile;
+        }
+        if (!sps_.empty() && !pps_.empty()) {
+            parameters += ";sprop-parameter-sets=" + base64_encode(sps_) + "," + base64_encode(pps_);
+        }
+    } else {
+        if (!vps_.empty()) parameters += "sprop-vps=" + base64_encode(vps_) + ";";
+        if (!sps_.empty()) parameters += "sprop-sps=" + base64_encode(sps_) + ";";
+        if (!pps_.empty()) parameters += "sprop-pps=" + base64_encode(pps_) + ";";
+        if (!parameters.empty()) parameters.pop_back();
+    }
+    return parameters;
+}
+
+int MediaSource::averageBitrateKbps() const {
+    if (frames_.empty()) return 0;
+    return static_cast<int>(totalBytes_ * 8 * static_cast<size_t>(fps_) / frames_.size() / 1000);
+}
+
+void MediaSource::clear() {
+    frames_.clear();
+    totalBytes_ = 0;
+    vps_.clear();
+    sps_.clear();
+    pps_.clear();
+}
+
+int MediaSource::nalType(const uint8_t* nal) const {
+    return codec_ == RTPPayloadCodec::H264 ? (nal[0] & 0x1F) : ((nal[0] >> 1) & 0x3F);
+}
+
+bool MediaSource::isVcl(int type) const {
+    return codec_ == RTPPayloadCodec::H264 ? (type >= 1 && type <= 5) : (type < 32);
+}
+
+bool MediaSource::isKeyframe(int type) const {
+    return codec_ == RTPPayloadCodec::H264 ? type == kH264NalIdr
+                                           : (type >= kH265NalIrapFirst && type <= kH265NalIrapLast);
+}
+
+bool MediaSource::startsAccessUnit(const uint8_t* nal, size_t size) const {
+    int type = nalType(nal);
+    if (codec_ == RTPPayloadCodec::H264) {
+        // first_mb_in_slice == 0: ue(v) со значением 0 - единичный старший бит
+        if (isVcl(type)) return size > 1 && (nal[1] & 0x80) != 0;
+        return (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+    }
+    // first_slice_segment_in_pic_flag
+    if (isVcl(type)) return size > 2 && (nal[2] & 0x80) != 0;
+    return (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44) ||
+           (type >= 48 && type <= 55);
+}
+
+void MediaSource::splitElementaryStream(const std::vector<uint8_t>& stream) {
+    std::vector<uint8_t> unit;
+    bool haveVcl = false;
+
+    size_t offset = 0;
+    const uint8_t* nal = nullptr;
+    size_t nalSize = 0;
+    while (annexb_next_nal(stream.data(), stream.size(), offset, nal, nalSize)) {
+        if (nalSize < (codec_ == RTPPayloadCodec::H264 ? 1u : 2u)) continue;
+
+        if (haveVcl && startsAccessUnit(nal, nalSize)) {
+            addAccessUnit(unit.data(), unit.size());
+            unit.clear();
+            haveVcl = false;
+        }
+        append_nal(unit, nal, nalSize);
+        haveVcl = haveVcl || isVcl(nalType(nal));
+    }
+
+    if (haveVcl) {
+        addAccessUnit(unit.data(), unit.size());
+    }
+}
+
+void MediaSource::addAccessUnit(const uint8_t* data, size_t size) {
+    MediaFrame frame;
+    frame.data.assign(data, data + size);
+    frame.keyframe = false;
+
+    size_t offset = 0;
+    const uint8_t* nal = nullptr;
+    size_t nalSize = 0;
+    while (annexb_next_nal(data, size, offset, nal, nalSize)) {
+        int type = nalType(nal);
+        frame.keyframe = frame.keyframe || isKeyframe(type);
+
+        // Для SDP сохраняются первые встреченные наборы параметров
+        std::vector<uint8_t>* parameterSet = nullptr;
+        if (codec_ == RTPPayloadCodec::H264) {
+            if (type == kH264NalSps) parameterSet = &sps_;
+            if (type == kH264NalPps) parameterSet = &pps_;
+        } else {
+            if (type == kH265NalVps) parameterSet = &vps_;
+            if (type == kH265NalSps) parameterSet = &sps_;
+            if (type == kH265NalPps) parameterSet = &pps_;
+        }
+        if (parameterSet && parameterSet->empty()) {
+            parameterSet->assign(nal, nal + nalSize);
+        }
+    }
+
+    totalBytes_ += size;
+    frames_.push_back(std::move(frame));
+}
@@ -0,0 +1,76 @@
+#ifndef MEDIA_SOURCE_H
+#define MEDIA_SOURCE_H
+
+#include "rtp_depacketizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Кадр источника в формате Annex-B (4-байтовые стартовые коды)
+struct MediaFrame {
+    std::vector<uint8_t> data;
+    bool keyframe;
+};
+
+// Видео для симулятора камер: кадры целиком загружаются в память и
+// разделяются всеми сессиями, поэтому сотни камер не читают диск.
+// Источники: элементарный поток H.264/H.265 (Annex-B), MP4 (через FFmpeg,
+// сборка с ENABLE_FFMPEG) и синтетический поток заданного битрейта.
+class MediaSource {
+public:
+    static const int kDefaultFps = 25;
+
+    MediaSource();
+
+    // Загрузка файла по расширению: .h264/.264, .h265/.265/.hevc, .mp4
+    bool load(const std::string& path, std::string& error);
+
+    // Элементарный поток Annex-B. Границы кадров определяются по первому
+    // слайсу картинки и NAL-единицам, открывающим новый кадр (AUD, SPS, SEI...).
+    bool loadElementaryStream(const std::string& path, RTPPayloadCodec codec, std::string& error);
+
+    // MP4: кадры передаются в порядке декодирования, частота - avg_frame_rate трека
+    bool loadMp4(const std::string& path, std::string& error);
+
+    // Синтетический поток: IDR раз в gopLength кадров, NAL-единицы с
+    // заполнителем вместо данных (нагрузка на сеть и сборку кадров без декодера)
+    void generateSynthetic(RTPPayloadCodec codec, int gopLength, int bitrateKbps);
+
+    RTPPayloadCodec codec() const { return codec_; }
+    int fps() const { return fps_; }
+    void setFps(int fps) { if (fps > 0) fps_ = fps; }
+
+    size_t frameCount() const { return frames_.size(); }
+    const MediaFrame& frame(size_t index) const { return frames_[index]; }
+
+    // Имя кодека для a=rtpmap
+    const char* encodingName() const;
+
+    // Параметры a=fmtp: sprop-parameter-sets (H.264) или sprop-vps/sps/pps (H.265)
+    std::string formatParameters() const;
+
+    // Средний битрейт источника (для b=AS)
+    int averageBitrateKbps() const;
+
+private:
+    void clear();
+
+    // Добавление кадра: признак ключевого кадра и наборы параметров по NAL-единицам
+    void addAccessUnit(const uint8_t* data, size_t size);
+    void splitElementaryStream(const std::vector<uint8_t>& stream);
+    int nalType(const uint8_t* nal) const;
+    bool isVcl(int type) const;
+    bool isKeyframe(int type) const;
+    bool startsAccessUnit(const uint8_t* nal, size_t size) const;
+
+    RTPPayloadCodec codec_;
+    int fps_;
+    std::vector<MediaFrame> frames_;
+    size_t totalBytes_;
+    std::vector<uint8_t> vps_;
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+};
+
+#endif // MEDIA_SOURCE_H
@@ -0,0 +1,106 @@
+#include "rtp_packetizer.h"
+#include <cstring>
+
+const size_t RTPPacketizer::kHeaderSize;
+const size_t RTPPacketizer::kDefaultMaxPacketSize;
+
+namespace {
+
+const uint8_t kRtpVersion = 0x80;
+const uint8_t kMarkerBit = 0x80;
+const uint8_t kFuStart = 0x80;
+const uint8_t kFuEnd = 0x40;
+
+const int kH264FuA = 28;
+const int kH265Fu = 49;
+
+} // namespace
+
+RTPPacketizer::RTPPacketizer(RTPPayloadCodec codec, uint8_t payloadType, uint32_t ssrc,
+                             uint16_t initialSequence, size_t maxPacketSize)
+    : codec_(codec), payloadType_(payloadType), ssrc_(ssrc), sequence_(initialSequence),
+      maxPayloadSize_(maxPacketSize > kHeaderSize + 16 ? maxPacketSize - kHeaderSize : 16),
+      count_(0) {}
+
+size_t RTPPacketizer::packetize(const uint8_t* accessUnit, size_t size, uint32_t timestamp) {
+    count_ = 0;
+
+    size_t offset = 0;
+    const uint8_t* nal = nullptr;
+    size_t nalSize = 0;
+    while (annexb_next_nal(accessUnit, size, offset, nal, nalSize)) {
+        if (nalSize <= maxPayloadSize_ || codec_ == RTPPayloadCodec::Unknown) {
+            addSingle(nal, nalSize, timestamp);
+        } else {
+            addFragments(nal, nalSize, timestamp);
+        }
+    }
+
+    if (count_ > 0) {
+        packets_[count_ - 1][1] |= kMarkerBit;
+    }
+    return count_;
+}
+
+std::vector<uint8_t>& RTPPacketizer::beginPacket(uint32_t timestamp) {
+    if (count_ == packets_.size()) {
+        packets_.emplace_back();
+    }
+    std::vector<uint8_t>& packet = packets_[count_++];
+
+    packet.resize(kHeaderSize);
+    packet[0] = kRtpVersion;
+    packet[1] = payloadType_ & 0x7F;
+    packet[2] = static_cast<uint8_t>(sequence_ >> 8);
+    packet[3] = static_cast<uint8_t>(sequence_);
+    packet[4] = static_cast<uint8_t>(timestamp >> 24);
+    packet[5] = static_cast<uint8_t>(timestamp >> 16);
+    packet[6] = static_cast<uint8_t>(timestamp >> 8);
+    packet[7] = static_cast<uint8_t>(timestamp);
+    packet[8] = static_cast<uint8_t>(ssrc_ >> 24);
+    packet[9] = static_cast<uint8_t>(ssrc_ >> 16);
+    packet[10] = static_cast<uint8_t>(ssrc_ >> 8);
+    packet[11] = static_cast<uint8_t>(ssrc_);
+    sequence_++;
+    return packet;
+}
+
+void RTPPacketizer::addSingle(const uint8_t* nal, size_t size, uint32_t timestamp) {
+    std::vector<uint8_t>& packet = beginPacket(timestamp);
+    packet.insert(packet.end(), nal, nal + size);
+}
+
+void RTPPacketizer::addFragments(const uint8_t* nal, size_t size, uint32_t timestamp) {
+    // Заголовок NAL не передается: его поля переносятся в заголовки FU
+    uint8_t prefix[3];
+    size_t prefixSize;
+    size_t headerSize;
+    if (codec_ == RTPPayloadCodec::H264) {
+        prefix[0] = static_cast<uint8_t>((nal[0] & 0xE0) | kH264FuA);
+        prefix[1] = static_cast<uint8_t>(nal[0] & 0x1F);
+        prefixSize = 2;
+        headerSize = 1;
+    } else {
+        prefix[0] = static_cast<uint8_t>((nal[0] & 0x81) | (kH265Fu << 1));
+        prefix[1] = nal[1];
+        prefix[2] = static_cast<uint8_t>((nal[0] >> 1) & 0x3F);
+        prefixSize = 3;
+        headerSize = 2;
+    }
+
+    const size_t chunk = maxPayloadSize_ - prefixSize;
+    size_t offset = headerSize;
+    while (offset < size) {
+        size_t length = size - offset < chunk ? size - offset : chunk;
+
+        std::vector<uint8_t>& packet = beginPacket(timestamp);
+        packet.insert(packet.end(), prefix, prefix + prefixSize);
+        packet.insert(packet.end(), nal + offset, nal + offset + length);
+
+        uint8_t& fuHeader = packet[kHeaderSize + prefixSize - 1];
+        if (offset == headerSize) fuHeader |= kFuStart;
+        if (offset + length == size) fuHeader |= kFuEnd;
+
+        offset += length;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef RTP_PACKETIZER_H
+#define RTP_PACKETIZER_H
+
+#include "rtp_depacketizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Упаковка кадров Annex-B в RTP пакеты: Single NAL, если NAL-единица
+// помещается в пакет, иначе FU-A (RFC 6184) / FU (RFC 7798).
+// Marker бит ставится на последнем пакете кадра.
+// Буферы пакетов переиспользуются между кадрами.
+class RTPPacketizer {
+public:
+    static const size_t kHeaderSize = 12;
+    static const size_t kDefaultMaxPacketSize = 1400;
+
+    RTPPacketizer(RTPPayloadCodec codec, uint8_t payloadType, uint32_t ssrc,
+                  uint16_t initialSequence, size_t maxPacketSize = kDefaultMaxPacketSize);
+
+    // Упаковка кадра. Возвращает число пакетов, доступных через packet(i)
+    // до следующего вызова.
+    size_t packetize(const uint8_t* accessUnit, size_t size, uint32_t timestamp);
+
+    const std::vector<uint8_t>& packet(size_t index) const { return packets_[index]; }
+    size_t packetCount() const { return count_; }
+
+    uint32_t ssrc() const { return ssrc_; }
+
+    // Номер последовательности следующего пакета
+    uint16_t nextSequence() const { return sequence_; }
+
+private:
+    void addSingle(const uint8_t* nal, size_t size, uint32_t timestamp);
+    void addFragments(const uint8_t* nal, size_t size, uint32_t timestamp);
+    std::vector<uint8_t>& beginPacket(uint32_t timestamp);
+
+    RTPPayloadCodec codec_;
+    uint8_t payloadType_;
+    uint32_t ssrc_;
+    uint16_t sequence_;
+    size_t maxPayloadSize_;
+
+    std::vector<std::vector<uint8_t>> packets_;
+    size_t count_;
+};
+
+#endif // RTP_PACKETIZER_H
@@ -0,0 +1,211 @@
+// Нагрузочный тест приема: N потоков через StreamManager, отчет о кадрах
+// в секунду, загрузке CPU на поток и задержке доставки кадров.
+//
+//   rtsp_stream_benchmark --url rtsp://127.0.0.1:8554/cam --streams 200
+//                         [--transport udp|tcp] [--duration 30] [--warmup 3]
+//
+// К URL добавляется номер потока (cam1 ... camN), так что каждый поток
+// открывает отдельную камеру rtsp_camera_simulator. Задержка - время от
+// захвата кадра по RTCP sender report камеры до вызова callback; на одной
+// машине с симулятором часы общие, на разных нужна синхронизация NTP/PTP.
+
+#include "stream_manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace {
+
+const size_t kMaxLatencySamples = 1000000;
+
+std::atomic<bool> g_measuring(false);
+
+struct BenchmarkStream {
+    int id = -1;
+    bool playing = false;
+    std::atomic<uint64_t> frames{0};
+    std::mutex mutex;
+    std::vector<int64_t> latenciesUs;
+};
+
+int64_t wall_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t process_cpu_us() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (static_cast<int64_t>(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000 +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+void on_frame(RTSPFrame* frame, void* userData) {
+    BenchmarkStream* stream = static_cast<BenchmarkStream*>(userData);
+    if (g_measuring.load(std::memory_order_relaxed)) {
+        stream->frames.fetch_add(1, std::memory_order_relaxed);
+        if (frame->timestampSynchronized) {
+            std::lock_guard<std::mutex> lock(stream->mutex);
+            if (stream->latenciesUs.size() < kMaxLatencySamples) {
+                stream->latenciesUs.push_back(wall_now_us() - frame->timestamp);
+            }
+        }
+    }
+    rtsp_frame_release(frame);
+}
+
+double percentile_ms(const std::vector<int64_t>& sorted, double percentile) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(percentile * static_cast<double>(sorted.size() - 1) + 0.5);
+    return static_cast<double>(sorted[index]) / 1000.0;
+}
+
+void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s --url RTSP_URL_PREFIX [--streams N] [--transport udp|tcp]\n"
+            "          [--duration SECONDS] [--warmup SECONDS] [--timeout MS]\n",
+            program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string urlPrefix;
+    int streamCount = 10;
+    int durationSec = 30;
+    int warmupSec = 3;
+    int timeoutMs = 5000;
+    RTSPTransport transport = RTSP_TRANSPORT_UDP;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        if (option == "--url") urlPrefix = value;
+        else if (option == "--streams") streamCount = atoi(value);
+        else if (option == "--duration") durationSec = atoi(value);
+        else if (option == "--warmup") warmupSec = atoi(value);
+        else if (option == "--timeout") timeoutMs = atoi(value);
+        else if (option == "--transport") {
+            transport = std::string(value) == "tcp" ? RTSP_TRANSPORT_TCP : RTSP_TRANSPORT_UDP;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (urlPrefix.empty() || streamCount <= 0 || durationSec <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    StreamManager* manager = stream_manager_create();
+    std::vector<BenchmarkStream> streams(static_cast<size_t>(streamCount));
+
+    // Подключение всех потоков параллельно
+    auto connectStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < streamCount; i++) {
+        StreamConfig config = {};
+        config.type = STREAM_TYPE_RTSP;
+        snprintf(config.url, sizeof(config.url), "%s%d", urlPrefix.c_str(), i + 1);
+        config.timeoutMs = timeoutMs;
+        config.enableVideo = true;
+        config.transport = transport;
+
+        BenchmarkStream& stream = streams[static_cast<size_t>(i)];
+        stream.id = stream_manager_add_stream(manager, &config);
+        stream_manager_set_frame_callback(manager, stream.id, on_frame, &stream);
+        stream_manager_connect_stream_async(manager, stream.id);
+    }
+
+    int connected = 0;
+    int pending = streamCount;
+    auto connectDeadline = connectStart + std::chrono::milliseconds(timeoutMs * 2);
+    while (pending > 0 && std::chrono::steady_clock::now() < connectDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        pending = 0;
+        for (BenchmarkStream& stream : streams) {
+            if (stream.playing) continue;
+            StreamStatus status = stream_manager_get_status(manager, stream.id);
+            if (status == STREAM_STATUS_CONNECTED) {
+                stream.playing = stream_manager_play_stream(manager, stream.id);
+                connected += stream.playing ? 1 : 0;
+            } else if (status == STREAM_STATUS_CONNECTING) {
+                pending++;
+            }
+        }
+    }
+    double connectSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - connectStart).count();
+    printf("connected %d/%d streams in %.2f s\n", connected, streamCount, connectSec);
+    fflush(stdout);
+
+    std::this_thread::sleep_for(std::chrono::seconds(warmupSec));
+
+    int64_t cpuStart = process_cpu_us();
+    auto measureStart = std::chrono::steady_clock::now();
+    g_measuring = true;
+    std::this_thread::sleep_for(std::chrono::seconds(durationSec));
+    g_measuring = false;
+    double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - measureStart).count();
+    int64_t cpuUs = process_cpu_us() - cpuStart;
+
+    // Сводка по потокам
+    uint64_t totalFrames = 0;
+    uint64_t minFrames = UINT64_MAX;
+    uint64_t maxFrames = 0;
+    uint64_t packetsReceived = 0;
+    uint64_t packetsLost = 0;
+    int64_t callbackP99Us = 0;
+    std::vector<int64_t> latencies;
+    for (BenchmarkStream& stream : streams) {
+        if (!stream.playing) continue;
+        uint64_t frames = stream.frames.load();
+        totalFrames += frames;
+        minFrames = std::min(minFrames, frames);
+        maxFrames = std::max(maxFrames, frames);
+
+        RTSPClientStats stats;
+        if (stream_manager_get_stream_stats(manager, stream.id, &stats)) {
+            packetsReceived += stats.packetsReceived;
+            packetsLost += stats.packetsLost;
+            callbackP99Us = std::max(callbackP99Us, stats.callbackP99Us);
+        }
+
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        latencies.insert(latencies.end(), stream.latenciesUs.begin(), stream.latenciesUs.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    double cpuPercent = 100.0 * static_cast<double>(cpuUs) / 1e6 / elapsedSec;
+    printf("frames: %.1f frames/s total, %.2f per stream (min %.2f, max %.2f)\n",
+           totalFrames / elapsedSec,
+           connected > 0 ? totalFrames / elapsedSec / connected : 0.0,
+           connected > 0 ? minFrames / elapsedSec : 0.0,
+           maxFrames / elapsedSec);
+    printf("cpu: %.1f%% of one core, %.3f%% per stream\n",
+           cpuPercent, connected > 0 ? cpuPercent / connected : 0.0);
+    printf("latency: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms (%zu frames)\n",
+           percentile_ms(latencies, 0.50), percentile_ms(latencies, 0.95),
+           percentile_ms(latencies, 0.99), percentile_ms(latencies, 1.0), latencies.size());
+    printf("rtp: %llu packets, %llu lost (%.3f%%), worst callback p99 %lld us\n",
+           static_cast<unsigned long long>(packetsReceived),
+           static_cast<unsigned long long>(packetsLost),
+           packetsReceived + packetsLost > 0 ? 100.0 * packetsLost / (packetsReceived + packetsLost) : 0.0,
+           static_cast<long long>(callbackP99Us));
+
+    stream_manager_destroy(manager);
+    return connected == streamCount ? 0 : 2;
+}
@@ -32,10 +32,12 @@ typedef enum {
 typedef struct {
     uint8_t* data;
     int size;
-    int64_t timestamp;
+    int64_t timestamp;          // Unix время кадра в микросекундах (развернутое RTP время)
     RTSPStreamType type;
     int width;
     int height;
+    bool timestampSynchronized; // timestamp получен по RTCP sender report и сопоставим между камерами
+    bool keyframe;              // Кадр декодируется независимо (IDR/IRAP, аудио, кодеки без межкадрового сжатия)
 } RTSPFrame;
 
 // Callback для получения кадров
@@ -57,6 +59,29 @@ bool rtsp_client_connect(
     int timeout_ms
 );
 
+// Результат асинхронного подключения (вызывается в общем пуле потоков RTSP
+// сессий после callback'а статуса, без блокировок клиента: из него можно
+// вызывать rtsp_client_play)
+typedef void (*RTSPConnectCallback)(RTSPClient* client, bool success, const char* message, void* userData);
+
+// Асинхронное подключение: OPTIONS/DESCRIBE/SETUP выполняются неблокирующим
+// конечным автоматом в общем цикле подключений, без удержания блокировок клиента.
+// Возвращает false, если подключение не удалось начать (callback не вызывается).
+// timeout_ms - таймаут каждого шага (подключения и ожидания ответа).
+bool rtsp_client_connect_async(
+    RTSPClient* client,
+    const char* url,
+    const char* username,
+    const char* password,
+    int timeout_ms,
+    RTSPConnectCallback callback,
+    void* userData
+);
+
+// Максимальное число одновременно устанавливаемых RTSP сессий (по умолчанию 64).
+// Остальные асинхронные подключения ожидают в очереди.
+void rtsp_set_max_concurrent_connects(int maxConnects);
+
 // Отключение от сервера
 void rtsp_client_disconnect(RTSPClient* client);
 
@@ -104,18 +129,53 @@ bool rtsp_client_get_stream_info(
     int codecBufferSize
 );
 
+// Получение параметров кодека потока из SDP (sprop-parameter-sets для H.264,
+// sprop-vps/sps/pps для H.265) в виде extradata для декодера: NAL-единицы
+// VPS, SPS, PPS со стартовыми кодами Annex-B (см. video_decoder_create_with_extradata).
+// Возвращает размер extradata (0 - параметров в SDP нет, -1 - ошибка); данные
+// копируются, если buffer не NULL и bufferSize не меньше размера.
+int rtsp_client_get_stream_extradata(
+    RTSPClient* client,
+    int streamIndex,
+    uint8_t* buffer,
+    int bufferSize
+);
+
 // Получение размера буфера кадра
 int rtsp_frame_get_size(RTSPFrame* frame);
 
 // Получение данных кадра
 const uint8_t* rtsp_frame_get_data(RTSPFrame* frame);
 
-// Получение временной метки кадра
+// Получение временной метки кадра: Unix время в микросекундах.
+// По RTCP sender report камеры, до его получения - от момента приема
+// первого пакета потока (см. rtsp_frame_is_timestamp_synchronized).
 int64_t rtsp_frame_get_timestamp(RTSPFrame* frame);
 
-// Освобождение кадра
+// Временная метка получена по RTCP sender report (часы камеры)
+bool rtsp_frame_is_timestamp_synchronized(RTSPFrame* frame);
+
+// Ключевой кадр (с него можно начать декодирование)
+bool rtsp_frame_is_keyframe(RTSPFrame* frame);
+
+// Захват дополнительной ссылки на кадр (кадр передается нескольким потребителям)
+RTSPFrame* rtsp_frame_retain(RTSPFrame* frame);
+
+// Освобождение кадра (уменьшение счетчика ссылок, при нуле буфер возвращается в пул)
 void rtsp_frame_release(RTSPFrame* frame);
 
+// Статистика пула буферов кадров
+typedef struct {
+    uint64_t hits;          // Кадры, выданные из пула без выделения памяти
+    uint64_t misses;        // Кадры, потребовавшие выделения памяти
+    int inUse;              // Кадры, выданные и еще не освобожденные
+    int highWaterMark;      // Максимальное число одновременно выданных кадров
+    uint64_t allocatedBytes; // Память, занятая slab'ами пула
+} RTSPFramePoolStats;
+
+// Получение статистики пула буферов кадров клиента
+bool rtsp_client_get_pool_stats(RTSPClient* client, RTSPFramePoolStats* stats);
+
 // Параметры автоматического переподключения
 typedef struct {
     bool enabled;           // Включить автоматическое переподключение
@@ -125,9 +185,211 @@ typedef struct {
     float backoffMultiplier; // Множитель для экспоненциальной задержки
 } RTSPReconnectParams;
 
-// Установка параметров автоматического переподключения
+// Установка параметров автоматического переподключения.
+// Переподключение начинается при потере RTSP соединения (включая неудачный
+// keepalive): общий сервис таймеров отсчитывает задержку, а попытку через
+// асинхронное подключение и PLAY выполняет общий пул потоков сессий.
+// Задержка растет экспоненциально со случайным разбросом в пределах половины
+// интервала. Воспроизведение после переподключения возобновляется.
+// Keepalive (GET_PARAMETER или OPTIONS) отправляется всегда, с интервалом
+// в половину таймаута сессии, объявленного сервером.
 void rtsp_client_set_reconnect_params(RTSPClient* client, const RTSPReconnectParams* params);
 
+// Глубина jitter буфера RTP потоков в миллисекундах (по умолчанию 50).
+// Пропущенный пакет ожидается не дольше этого времени, затем считается потерянным,
+// а неполный кадр отбрасывается. 0 - без ожидания (только учет потерь).
+void rtsp_client_set_jitter_buffer_depth(RTSPClient* client, int depthMs);
+
+// Счетчики RTP потока (позволяют отличить проблемы сети от проблем декодера)
+typedef struct {
+    uint64_t packetsReceived;
+    uint64_t packetsLost;       // Пропуски номеров, признанные потерей
+    uint64_t packetsReordered;  // Пришли не по порядку, но вовремя
+    uint64_t packetsLate;       // Пришли после того, как их номер признан потерянным
+    uint64_t packetsDuplicate;
+    uint64_t framesDropped;     // Неполные кадры, отброшенные из-за потерь
+    uint64_t pliSent;           // Запросы ключевого кадра после потерь (RTCP PLI)
+    uint64_t firSent;           // Повторные запросы (RTCP FIR), если PLI остался без ответа
+    uint64_t keyframeRecoveries; // Ключевые кадры, завершившие восстановление после потери
+    int lastRecoveryMs;         // Время от обнаружения потери до ключевого кадра
+    int maxRecoveryMs;
+    uint64_t kernelDrops;       // Отброшены ядром при переполнении буфера сокета (только Linux).
+                                // Входят в packetsLost: потери в сети = packetsLost - kernelDrops
+    int receiveBufferBytes;     // Фактический приемный буфер RTP сокета (0 - системный)
+} RTSPStreamRTPStats;
+
+// Получение счетчиков RTP потока. После потери пакетов видео клиент
+// запрашивает ключевой кадр (PLI, затем FIR) не чаще раза в 500 мс,
+// пока ключевой кадр не придет.
+bool rtsp_client_get_rtp_stats(RTSPClient* client, int streamIndex, RTSPStreamRTPStats* stats);
+
+// Живая статистика клиента (снимок, все потоки вместе)
+typedef struct {
+    uint64_t packetsReceived;   // RTP пакеты
+    uint64_t bytesReceived;     // Байты RTP пакетов с заголовками
+    uint64_t framesAssembled;   // Собранные кадры (включая не переданные подписчику)
+    uint64_t packetsLost;       // Пропуски номеров RTP (обновляется раз в секунду)
+    double lossPercent;         // packetsLost от ожидаемого числа пакетов
+    double jitterMs;            // Межпакетный jitter видео по RFC 3550
+    double bitrateKbps;         // За последнюю секунду (0 - пакеты не приходят)
+    double fps;                 // Кадры видео за последнюю секунду
+    uint64_t callbacks;         // Вызовы callback кадров
+    int64_t callbackP50Us;      // Время выполнения callback: перцентили (точность 25%) и максимум
+    int64_t callbackP95Us;
+    int64_t callbackP99Us;
+    int64_t callbackMaxUs;
+    uint32_t reconnects;        // Успешные автоматические переподключения
+} RTSPClientStats;
+
+// Снимок статистики клиента. Счетчики обновляются без блокировок, чтение
+// не ждет ни потока приема, ни подключения - можно опрашивать каждую секунду.
+// Счетчики накапливаются за все время жизни клиента.
+bool rtsp_client_get_stats(RTSPClient* client, RTSPClientStats* stats);
+
+// Приемный буфер (SO_RCVBUF) UDP сокетов RTP для потоков данного типа.
+// 0 (по умолчанию) - по битрейту из SDP (b=AS/b=TIAS): секунда потока,
+// от 256 КБ до 16 МБ, 2 МБ при неизвестном битрейте; -1 - системный размер.
+// Без CAP_NET_ADMIN размер ограничен net.core.rmem_max.
+// Применяется при следующем rtsp_client_connect.
+void rtsp_client_set_receive_buffer_size(RTSPClient* client, RTSPStreamType type, int bytes);
+
+// Запуск общего реактора приема RTP (epoll, только Linux).
+// threadCount = 0 - по числу ядер. Повторный вызов с другим числом потоков
+// возможен только когда ни один клиент не воспроизводит поток.
+bool rtsp_reactor_start(int threadCount);
+
+// Остановка общего реактора (после остановки всех клиентов)
+void rtsp_reactor_shutdown(void);
+
+// Прием RTP клиента через общий реактор вместо отдельного потока.
+// Применяется при следующем rtsp_client_play. Если реактор недоступен,
+// используется отдельный поток.
+void rtsp_client_set_shared_reactor(RTSPClient* client, bool enabled);
+
+// Транспорт RTP
+typedef enum {
+    RTSP_TRANSPORT_UDP,     // RTP/AVP/UDP (по умолчанию)
+    RTSP_TRANSPORT_TCP,     // RTP/AVP/TCP;interleaved - внутри RTSP соединения
+    RTSP_TRANSPORT_AUTO,    // UDP, переход на TCP, если пакеты не приходят
+    RTSP_TRANSPORT_UDP_MULTICAST    // RTP/AVP;multicast - группа, общая для всех клиентов камеры
+} RTSPTransport;
+
+// Выбор транспорта RTP. Применяется при следующем rtsp_client_connect.
+// udpTimeoutMs - время ожидания первого пакета по UDP в режиме AUTO
+// (0 - по умолчанию, 3000 мс). rtsp_client_play пакетов не ждет: если они
+// не пришли за это время, сессия в фоне (общий сервис таймеров и пул потоков
+// сессий) переустанавливается с interleaved TCP и воспроизведение
+// возобновляется; callback статуса получает CONNECTING, CONNECTED и PLAYING.
+void rtsp_client_set_transport(RTSPClient* client, RTSPTransport transport, int udpTimeoutMs);
+
+// Фактически используемый транспорт (RTSP_TRANSPORT_UDP, RTSP_TRANSPORT_TCP
+// или RTSP_TRANSPORT_UDP_MULTICAST)
+RTSPTransport rtsp_client_get_transport(RTSPClient* client);
+
+// Конвейер запросов установки сессии (по умолчанию включен): OPTIONS
+// отправляется вместе с DESCRIBE, SETUP второй и следующих дорожек - одной
+// группой, так что сессия с одной дорожкой устанавливается за два RTT.
+// Если сервер не принял конвейер, клиент переходит на запросы по одному.
+// Применяется при следующем подключении.
+void rtsp_client_set_request_pipelining(RTSPClient* client, bool enabled);
+
+// Интерфейс для приема multicast (IPv4 адрес, например "10.0.0.5";
+// NULL или "" - по таблице маршрутизации). Применяется при следующем rtsp_client_play.
+// В режиме RTSP_TRANSPORT_UDP_MULTICAST клиент присоединяется к группе из ответа
+// SETUP (destination, port). На Linux группа принимается одним сокетом в общем
+// реакторе, и каждая датаграмма выдается всем клиентам процесса, смотрящим ее;
+// на других платформах клиент открывает собственный сокет группы.
+// RTCP отчеты отправляются в RTCP порт группы.
+void rtsp_client_set_multicast_interface(RTSPClient* client, const char* interfaceAddress);
+
+// Статистика общего для процесса приема multicast
+typedef struct {
+    int groups;             // Сокеты групп (группа, порт)
+    int subscribers;        // Подписки RTP/RTCP потоков клиентов
+    uint64_t datagrams;     // Датаграммы, принятые из сети
+    uint64_t deliveries;    // Датаграммы, выданные клиентам
+} RTSPMulticastStats;
+
+bool rtsp_multicast_get_stats(RTSPMulticastStats* stats);
+
+// Статистика общего для процесса кэша DNS имен камер
+typedef struct {
+    uint64_t hits;          // Адреса, выданные из кэша (включая устаревшие, обновляемые в фоне)
+    uint64_t misses;        // Запросы, ожидавшие getaddrinfo
+    uint64_t failures;      // Неудачные getaddrinfo
+    int cachedHosts;        // Имена в кэше
+} RTSPResolverStats;
+
+// Получение статистики DNS кэша, через который подключается клиент.
+// Кэш общий для всех клиентов, поэтому счетчики общие.
+bool rtsp_client_get_resolver_stats(RTSPClient* client, RTSPResolverStats* stats);
+
+// Время жизни записей DNS кэша в миллисекундах (по умолчанию 60000).
+// 0 - адрес запрашивается при каждом подключении.
+void rtsp_resolver_set_ttl(int ttlMs);
+
+// Кэш последней группы кадров (GOP) видео: от последнего ключевого кадра.
+// Новый подписчик (установка callback видео или rtsp_client_request_gop_replay)
+// получает GOP перед следующим живым кадром и показывает картинку сразу,
+// не дожидаясь IDR от камеры. Кадры кэшируются и без callback.
+// maxFrames = 0 - кэш выключен (по умолчанию); maxBytes = 0 - 16 МБ.
+// GOP длиннее лимитов не кэшируется. При очереди кадров ее глубина должна
+// вмещать GOP, иначе часть выдачи будет отброшена политикой переполнения.
+void rtsp_client_set_gop_cache(RTSPClient* client, int maxFrames, int maxBytes);
+
+// Выдать кэшированный GOP текущему callback видео (например, когда вызывающий
+// сам распределяет кадры между потребителями и подключил нового)
+void rtsp_client_request_gop_replay(RTSPClient* client);
+
+// Состояние кэша GOP
+typedef struct {
+    int frames;             // Кадры в кэше
+    int64_t bytes;
+    uint64_t replays;       // Выдачи GOP новым подписчикам
+} RTSPGopCacheStats;
+
+bool rtsp_client_get_gop_cache_stats(RTSPClient* client, RTSPGopCacheStats* stats);
+
+// Поведение очереди кадров при переполнении
+typedef enum {
+    RTSP_FRAME_QUEUE_DROP_OLDEST,       // Вытеснить самый старый кадр
+    RTSP_FRAME_QUEUE_DROP_NON_KEYFRAME, // Отбросить новый неключевой кадр и зависимые от него
+                                        // до следующего ключевого; ключевой кадр вытесняет старые
+    RTSP_FRAME_QUEUE_BLOCK              // Ждать места (прием RTP останавливается)
+} RTSPFrameQueuePolicy;
+
+// Доставка кадров через очередь вместо вызова callback в потоке приема
+typedef struct {
+    bool enabled;
+    int capacity;                   // Глубина очереди в кадрах (округляется до степени двойки, 0 - 16)
+    RTSPFrameQueuePolicy policy;
+    bool externalDispatch;          // Кадры выдает rtsp_client_dispatch_frames в потоке приложения,
+                                    // иначе - отдельный поток доставки клиента
+} RTSPFrameQueueParams;
+
+// Настройка очереди кадров. Callback кадров вызывается в потоке доставки,
+// медленный потребитель не задерживает чтение сокетов.
+// Нельзя менять во время воспроизведения (возвращает false).
+bool rtsp_client_set_frame_queue(RTSPClient* client, const RTSPFrameQueueParams* params);
+
+// Доставка накопленных кадров в callback в вызывающем потоке (externalDispatch).
+// Ждет первый кадр не дольше timeoutMs. Возвращает число доставленных кадров.
+// Callback вызывается без блокировок клиента.
+int rtsp_client_dispatch_frames(RTSPClient* client, int maxFrames, int timeoutMs);
+
+// Счетчики очереди кадров
+typedef struct {
+    int depth;              // Кадры в очереди сейчас
+    int capacity;
+    int highWaterMark;      // Максимальная глубина
+    uint64_t enqueued;      // Кадры, поставленные в очередь
+    uint64_t dropped;       // Кадры, отброшенные по переполнению (и после остановки)
+    uint64_t blocked;       // Кадры, ожидавшие места (RTSP_FRAME_QUEUE_BLOCK)
+} RTSPFrameQueueStats;
+
+// Получение счетчиков очереди кадров (false - очередь не настроена)
+bool rtsp_client_get_frame_queue_stats(RTSPClient* client, RTSPFrameQueueStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,10 +26,27 @@ typedef enum {
     STREAM_STATUS_ERROR
 } StreamStatus;
 
+// Темп воспроизведения файлов (STREAM_TYPE_FILE)
+typedef enum {
+    STREAM_PLAYBACK_REALTIME,               // В темпе записи
+    STREAM_PLAYBACK_SCALED,                 // В темпе записи с множителем playbackSpeed
+    STREAM_PLAYBACK_AS_FAST_AS_POSSIBLE     // Без пауз между кадрами
+} StreamPlaybackMode;
+
 // Callback для получения кадров
 typedef void (*StreamFrameCallback)(RTSPFrame* frame, void* userData);
 typedef void (*StreamStatusCallback)(StreamStatus status, const char* message, void* userData);
 
+// Максимальное число альтернативных профилей RTSP потока
+#define STREAM_MAX_PROFILES 4
+
+// Альтернативный профиль камеры (дополнительный поток меньшего разрешения)
+typedef struct {
+    char url[512];
+    int width;
+    int height;
+} StreamProfile;
+
 // Конфигурация потока
 typedef struct {
     StreamType type;
@@ -39,14 +56,53 @@ typedef struct {
     int timeoutMs;
     bool enableVideo;
     bool enableAudio;
+    RTSPTransport transport;        // Транспорт RTP для RTSP потоков (по умолчанию UDP)
+
+    // Альтернативные профили RTSP потока (url - основной профиль наибольшего
+    // разрешения). Менеджер подключает профиль наименьшего разрешения, которого
+    // достаточно всем потребителям, и переключает его при изменении спроса.
+    StreamProfile profiles[STREAM_MAX_PROFILES];
+    int profileCount;
+
+    // Воспроизведение файла (STREAM_TYPE_FILE): url - путь или file://путь к
+    // MP4/MOV, MKV/WebM или элементарному потоку H.264/H.265 (Annex-B)
+    StreamPlaybackMode playbackMode;
+    double playbackSpeed;           // Множитель STREAM_PLAYBACK_SCALED (2.0 - вдвое быстрее)
+    bool playbackLoop;              // Повторять файл с начала
+    int fileFps;                    // Частота кадров элементарного потока (0 - 25)
 } StreamConfig;
 
-// Структура менеджера потоков (opaque)
+// Структура менеджера потоков (opaque).
+// Функции потокобезопасны. Операции управления (подключение, воспроизведение,
+// остановка) с разными потоками выполняются параллельно: блокирующий сетевой
+// обмен удерживает только блокировку своего потока, а запросы статуса и
+// статистики не ждут сетевых операций.
 typedef struct StreamManager StreamManager;
 
 // Создание менеджера потоков
 StreamManager* stream_manager_create();
 
+// Параметры обработки потоков на потоках-шардах
+typedef struct {
+    int shardCount;                 // Число шардов (0 - по числу доступных процессу ядер)
+    bool pinThreads;                // Привязать поток каждого шарда к своему ядру (Linux)
+    bool numaAware;                 // Чередовать ядра шардов по узлам NUMA
+    int queueCapacity;              // Очередь кадров потока к шарду в кадрах (0 - 16)
+    RTSPFrameQueuePolicy policy;    // Поведение очереди при переполнении
+} StreamShardParams;
+
+// Создание менеджера с обработкой потоков на потоках-шардах (thread-per-core).
+// Каждый поток закрепляется за одним шардом: его кадры раздаются подписчикам
+// и передаются callback'у кадров потока в потоке шарда, так что вся обработка
+// кадров потока (разбор, декодирование, аналитика в callback) выполняется
+// одним потоком на одном ядре, а шарды не делят между собой состояние потоков.
+// Прием из сети остается в потоках клиентов (реакторе RTP); до шарда кадр
+// проходит через очередь потока. Новые потоки закрепляются за шардом с
+// наименьшим числом потоков. Из callback кадров нельзя удалять потоки других
+// шардов; при RTSP_FRAME_QUEUE_BLOCK - останавливать свой поток.
+// NULL - неверные параметры.
+StreamManager* stream_manager_create_sharded(const StreamShardParams* params);
+
 // Уничтожение менеджера потоков
 void stream_manager_destroy(StreamManager* manager);
 
@@ -56,25 +112,70 @@ int stream_manager_add_stream(StreamManager* manager, const StreamConfig* config
 // Удаление потока
 bool stream_manager_remove_stream(StreamManager* manager, int streamId);
 
-// Подключение к потоку
+// Подключение к потоку. Файл отображается в память и индексируется; конец
+// файла без повтора сообщается callback'ом статуса (STREAM_STATUS_CONNECTED).
 bool stream_manager_connect_stream(StreamManager* manager, int streamId);
 
+// Асинхронное подключение к потоку (не блокирует менеджер на время установки
+// сессии, результат сообщается через callback'и статуса потока и менеджера)
+bool stream_manager_connect_stream_async(StreamManager* manager, int streamId);
+
+// Результат запуска потока в пакете
+typedef struct {
+    int streamId;                   // Идентификатор добавленного потока
+    bool success;                   // Поток подключен (и воспроизводится, если запрошено)
+    StreamStatus status;            // Статус потока по завершении его запуска
+    char message[256];              // Сообщение последнего статуса (причина ошибки)
+} StreamStartResult;
+
+// Завершение пакетного запуска: результаты в порядке конфигураций
+typedef void (*StreamBatchCallback)(const StreamStartResult* results, int count, void* userData);
+
+// Параметры пакетного запуска
+typedef struct {
+    int maxConcurrent;              // Одновременно запускаемых потоков: подключение и PLAY (0 - 32)
+    int staggerMs;                  // Интервал между началами подключений (0 - без интервала)
+    bool play;                      // Начинать воспроизведение после подключения
+    StreamBatchCallback callback;   // Может быть NULL
+    void* userData;
+} StreamBatchParams;
+
+// Пакетный запуск потоков (поднятие всех камер узла). Потоки добавляются
+// сразу, их идентификаторы записываются в streamIds (если не NULL). Подключение
+// и воспроизведение выполняются в фоне: сессии устанавливаются асинхронно,
+// PLAY выполняется общим пулом потоков сессий, и не больше maxConcurrent
+// потоков одновременно находятся в подключении или PLAY; начала подключений
+// разнесены на staggerMs. Когда запуск всех потоков завершен,
+// callback один раз получает результаты; при уничтожении менеджера до
+// завершения незавершенные запуски сообщаются как ошибки.
+// Из callback нельзя уничтожать менеджер. Возвращает false при неверных параметрах.
+bool stream_manager_start_streams(
+    StreamManager* manager,
+    const StreamConfig* configs,
+    int count,
+    const StreamBatchParams* params,
+    int* streamIds
+);
+
 // Отключение от потока
 bool stream_manager_disconnect_stream(StreamManager* manager, int streamId);
 
 // Начало воспроизведения
 bool stream_manager_play_stream(StreamManager* manager, int streamId);
 
-// Остановка воспроизведения
+// Остановка воспроизведения (файл воспроизводится затем с начала)
 bool stream_manager_stop_stream(StreamManager* manager, int streamId);
 
 // Пауза воспроизведения
 bool stream_manager_pause_stream(StreamManager* manager, int streamId);
 
-// Получение статуса потока
+// Получение статуса потока (без ожидания операций с потоком)
 StreamStatus stream_manager_get_status(StreamManager* manager, int streamId);
 
-// Установка callback для кадров
+// Живая статистика потока (см. rtsp_client_get_stats; для файла пакеты - прочитанные кадры)
+bool stream_manager_get_stream_stats(StreamManager* manager, int streamId, RTSPClientStats* stats);
+
+// Установка callback для кадров (потребитель полного разрешения, см. профили ниже)
 void stream_manager_set_frame_callback(
     StreamManager* manager,
     int streamId,
@@ -82,16 +183,95 @@ void stream_manager_set_frame_callback(
     void* userData
 );
 
-// Установка callback для статуса
+// Параметры подписчика потока
+typedef struct {
+    StreamFrameCallback callback;   // Получает ссылку на кадр и освобождает ее (rtsp_frame_release)
+    void* userData;
+    int queueCapacity;              // Глубина очереди подписчика в кадрах (0 - 16)
+    RTSPFrameQueuePolicy policy;    // Поведение очереди подписчика при переполнении
+    int width;                      // Достаточное подписчику разрешение для выбора
+    int height;                     // профиля (0 - полное, основной профиль)
+} StreamSubscriberParams;
+
+// Подписка на кадры потока. Любое число потребителей (просмотр, запись,
+// аналитика) использует одну сессию с камерой: каждый получает ссылку на тот же
+// буфер кадра без копирования (данные только для чтения) через свою очередь и
+// свой поток доставки. Медленный подписчик теряет кадры по своей политике и не
+// задерживает остальных; RTSP_FRAME_QUEUE_BLOCK останавливает прием для всех.
+// Доставка начинается с ближайшего ключевого кадра.
+// Возвращает идентификатор подписчика (> 0) или -1.
+int stream_manager_subscribe(StreamManager* manager, int streamId, const StreamSubscriberParams* params);
+
+// Отписка. После возврата callback подписчика не вызывается (при отписке из
+// самого callback - после его завершения). Подписчики удаляются вместе с потоком.
+bool stream_manager_unsubscribe(StreamManager* manager, int streamId, int subscriberId);
+
+// Профиль потока выбирается по наибольшему разрешению, нужному подписчикам
+// (callback кадров потока требует полного). При смене спроса во время
+// воспроизведения сессия нового профиля устанавливается заранее, и он
+// становится активным на своем первом ключевом кадре, после чего сессия
+// прежнего профиля закрывается: потребители получают непрерывный поток
+// кадров, который после переключения начинается с ключевого кадра.
+// Кадры потока с профилями выдаются под блокировкой выдачи (кроме менеджера
+// с шардами): из callback кадров нельзя останавливать, отключать или удалять
+// этот поток.
+// Активный профиль: 0 - основной url, i + 1 - profiles[i]; -1 - нет потока.
+int stream_manager_get_active_profile(StreamManager* manager, int streamId);
+
+// Счетчики очереди подписчика
+bool stream_manager_get_subscriber_stats(
+    StreamManager* manager,
+    int streamId,
+    int subscriberId,
+    RTSPFrameQueueStats* stats
+);
+
+// Установка callback для статуса всех потоков менеджера. Вызывается при
+// каждой смене статуса (результат подключения, ошибка, конец файла) в потоке,
+// где она произошла, с userData менеджера; после stream_manager_destroy не вызывается.
 void stream_manager_set_status_callback(
     StreamManager* manager,
     StreamStatusCallback callback,
     void* userData
 );
 
+// Установка callback для статуса одного потока (вызывается перед callback'ом
+// менеджера, userData позволяет отличить поток)
+void stream_manager_set_stream_status_callback(
+    StreamManager* manager,
+    int streamId,
+    StreamStatusCallback callback,
+    void* userData
+);
+
 // Получение количества потоков
 int stream_manager_get_stream_count(StreamManager* manager);
 
+// Статистика шарда
+typedef struct {
+    int cpu;                        // Ядро потока шарда (-1 - без привязки)
+    int numaNode;                   // Узел NUMA ядра (-1 - неизвестен)
+    int streams;                    // Закрепленных потоков
+    uint64_t frames;                // Обработанных кадров
+    uint64_t busyUs;                // Время обработки кадров
+} StreamShardStats;
+
+// Число шардов (0 - менеджер без шардов)
+int stream_manager_get_shard_count(StreamManager* manager);
+
+// Шард потока (-1 - нет потока или менеджер без шардов)
+int stream_manager_get_stream_shard(StreamManager* manager, int streamId);
+
+bool stream_manager_get_shard_stats(StreamManager* manager, int shard, StreamShardStats* stats);
+
+// Перераспределение потоков между шардами: потоки переносятся с наиболее
+// загруженных шардов (по времени обработки кадров с прошлого вызова, без
+// нагрузки - по числу потоков) на наименее загруженные, пока разница
+// нагрузки шардов больше 1/8. Перенос дожидается обработки текущего кадра
+// потока, порядок кадров сохраняется. Из callback кадров не выполняется.
+// Возвращает число перенесенных потоков.
+int stream_manager_rebalance_shards(StreamManager* manager);
+
 #ifdef __cplusplus
 }
 #endif
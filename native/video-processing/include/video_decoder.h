@@ -5,6 +5,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -35,6 +36,17 @@ typedef struct VideoDecoder VideoDecoder;
 // Создание декодера
 VideoDecoder* video_decoder_create(VideoCodec codec, int width, int height);
 
+// Создание декодера с параметрами кодека (SPS/PPS, для H.265 также VPS)
+// в формате Annex-B, например из rtsp_client_get_stream_extradata.
+// Первый ключевой кадр декодируется без in-band наборов параметров.
+VideoDecoder* video_decoder_create_with_extradata(
+    VideoCodec codec,
+    int width,
+    int height,
+    const uint8_t* extradata,
+    size_t extradataSize
+);
+
 // Уничтожение декодера
 void video_decoder_destroy(VideoDecoder* decoder);
 
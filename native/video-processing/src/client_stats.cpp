@@ -0,0 +1,145 @@
+#include "client_stats.h"
+#include <cmath>
+
+const int64_t ClientStats::kRateWindowUs;
+const int ClientStats::kLatencyBuckets;
+
+namespace {
+
+// Окно старше двух периодов: поток стоит, скорость считается нулевой
+const int64_t kRateStaleUs = 2 * ClientStats::kRateWindowUs;
+
+} // namespace
+
+ClientStats::ClientStats()
+    : packetsReceived_(0), bytesReceived_(0), framesAssembled_(0), packetsLost_(0),
+      jitterUs_(0), reconnects_(0), windowStartUs_(0), windowBytes_(0), windowFrames_(0),
+      bitrateBps_(0), fpsMilli_(0), rateUpdatedUs_(0), latencyMaxUs_(0) {
+    for (auto& count : latencyCounts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+int ClientStats::latencyBucket(uint64_t durationUs) {
+    if (durationUs < 4) return static_cast<int>(durationUs);
+
+    int msb = 0;
+    for (uint64_t value = durationUs; value > 1; value >>= 1) msb++;
+
+    int bucket = 4 + (msb - 2) * 4 + static_cast<int>((durationUs >> (msb - 2)) & 3);
+    return bucket < kLatencyBuckets ? bucket : kLatencyBuckets - 1;
+}
+
+uint64_t ClientStats::latencyBucketUpperBound(int bucket) {
+    if (bucket < 4) return static_cast<uint64_t>(bucket);
+
+    int shift = (bucket - 4) / 4;
+    uint64_t sub = static_cast<uint64_t>((bucket - 4) % 4);
+    return ((5 + sub) << shift) - 1;
+}
+
+bool ClientStats::onPacket(size_t bytes, int64_t nowUs) {
+    packetsReceived_.fetch_add(1, std::memory_order_relaxed);
+    bytesReceived_.fetch_add(bytes, std::memory_order_relaxed);
+    windowBytes_.fetch_add(bytes, std::memory_order_relaxed);
+
+    int64_t start = windowStartUs_.load(std::memory_order_relaxed);
+    if (start == 0) {
+        windowStartUs_.compare_exchange_strong(start, nowUs, std::memory_order_relaxed);
+        return false;
+    }
+
+    int64_t elapsed = nowUs - start;
+    if (elapsed < kRateWindowUs) return false;
+
+    // Окно закрывает один из конкурирующих потоков
+    if (!windowStartUs_.compare_exchange_strong(start, nowUs, std::memory_order_relaxed)) {
+        return false;
+    }
+
+    uint64_t windowBytes = windowBytes_.exchange(0, std::memory_order_relaxed);
+    uint64_t windowFrames = windowFrames_.exchange(0, std::memory_order_relaxed);
+    bitrateBps_.store(windowBytes * 8 * 1000000 / static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+    fpsMilli_.store(windowFrames * 1000000000 / static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+    rateUpdatedUs_.store(nowUs, std::memory_order_relaxed);
+    return true;
+}
+
+void ClientStats::onFrame(bool video) {
+    framesAssembled_.fetch_add(1, std::memory_order_relaxed);
+    if (video) {
+        windowFrames_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ClientStats::recordCallbackLatency(int64_t durationUs) {
+    uint64_t duration = durationUs > 0 ? static_cast<uint64_t>(durationUs) : 0;
+    latencyCounts_[latencyBucket(duration)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = latencyMaxUs_.load(std::memory_order_relaxed);
+    while (duration > max &&
+           !latencyMaxUs_.compare_exchange_weak(max, duration, std::memory_order_relaxed)) {
+    }
+}
+
+void ClientStats::onReconnect() {
+    reconnects_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ClientStats::publishStreamState(uint64_t packetsLost, int64_t jitterUs) {
+    packetsLost_.store(packetsLost, std::memory_order_relaxed);
+    jitterUs_.store(jitterUs, std::memory_order_relaxed);
+}
+
+uint64_t ClientStats::latencyPercentile(const uint64_t* counts, uint64_t total, double percentile) const {
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(total)));
+    if (rank == 0) rank = 1;
+
+    uint64_t max = latencyMaxUs_.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < kLatencyBuckets; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            uint64_t bound = latencyBucketUpperBound(bucket);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+void ClientStats::snapshot(RTSPClientStats& stats, int64_t nowUs) const {
+    stats.packetsReceived = packetsReceived_.load(std::memory_order_relaxed);
+    stats.bytesReceived = bytesReceived_.load(std::memory_order_relaxed);
+    stats.framesAssembled = framesAssembled_.load(std::memory_order_relaxed);
+    stats.packetsLost = packetsLost_.load(std::memory_order_relaxed);
+    uint64_t expected = stats.packetsReceived + stats.packetsLost;
+    stats.lossPercent = expected > 0 ? 100.0 * static_cast<double>(stats.packetsLost) / static_cast<double>(expected) : 0.0;
+    stats.jitterMs = static_cast<double>(jitterUs_.load(std::memory_order_relaxed)) / 1000.0;
+    stats.reconnects = reconnects_.load(std::memory_order_relaxed);
+
+    if (nowUs - rateUpdatedUs_.load(std::memory_order_relaxed) <= kRateStaleUs) {
+        stats.bitrateKbps = static_cast<double>(bitrateBps_.load(std::memory_order_relaxed)) / 1000.0;
+        stats.fps = static_cast<double>(fpsMilli_.load(std::memory_order_relaxed)) / 1000.0;
+    } else {
+        stats.bitrateKbps = 0.0;
+        stats.fps = 0.0;
+    }
+
+    // Корзины читаются без согласования между собой: снимок приблизительный
+    uint64_t counts[kLatencyBuckets];
+    uint64_t total = 0;
+    for (int bucket = 0; bucket < kLatencyBuckets; bucket++) {
+        counts[bucket] = latencyCounts_[bucket].load(std::memory_order_relaxed);
+        total += counts[bucket];
+    }
+
+    stats.callbacks = total;
+    if (total == 0) {
+        stats.callbackP50Us = stats.callbackP95Us = stats.callbackP99Us = stats.callbackMaxUs = 0;
+        return;
+    }
+    stats.callbackP50Us = static_cast<int64_t>(latencyPercentile(counts, total, 0.50));
+    stats.callbackP95Us = static_cast<int64_t>(latencyPercentile(counts, total, 0.95));
+    stats.callbackP99Us = static_cast<int64_t>(latencyPercentile(counts, total, 0.99));
+    stats.callbackMaxUs = static_cast<int64_t>(latencyMaxUs_.load(std::memory_order_relaxed));
+}
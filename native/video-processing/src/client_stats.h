@@ -0,0 +1,70 @@
+#ifndef CLIENT_STATS_H
+#define CLIENT_STATS_H
+
+#include "rtsp_client.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Живая статистика RTSP клиента. Счетчики - атомики с relaxed порядком:
+// поток приема и поток доставки обновляют их без блокировок, а снимок
+// для мониторинга читается из любого потока и никого не ждет.
+// Скорости (битрейт, fps) считаются по окнам kRateWindowUs: первый пакет
+// после окончания окна публикует его итоги. Потери и jitter публикует
+// владелец потоков по сигналу onPacket() о смене окна.
+class ClientStats {
+public:
+    static const int64_t kRateWindowUs = 1000000;
+
+    // Гистограмма времени callback: 4 точных корзины (0-3 мкс), далее по 4
+    // корзины на степень двойки (погрешность не более 25%) до ~67 с
+    static const int kLatencyBuckets = 4 + 4 * 24;
+
+    ClientStats();
+
+    ClientStats(const ClientStats&) = delete;
+    ClientStats& operator=(const ClientStats&) = delete;
+
+    // Принятый RTP пакет. true - закрыто окно скорости: вызывающему
+    // следует обновить потери и jitter (publishStreamState)
+    bool onPacket(size_t bytes, int64_t nowUs);
+
+    // Собранный кадр (видео учитывается в fps)
+    void onFrame(bool video);
+
+    // Время выполнения callback подписчика
+    void recordCallbackLatency(int64_t durationUs);
+
+    void onReconnect();
+
+    // Потери RTP всех потоков и jitter видео (мкс) на момент закрытия окна
+    void publishStreamState(uint64_t packetsLost, int64_t jitterUs);
+
+    void snapshot(RTSPClientStats& stats, int64_t nowUs) const;
+
+    static int latencyBucket(uint64_t durationUs);
+    static uint64_t latencyBucketUpperBound(int bucket);
+
+private:
+    uint64_t latencyPercentile(const uint64_t* counts, uint64_t total, double percentile) const;
+
+    std::atomic<uint64_t> packetsReceived_;
+    std::atomic<uint64_t> bytesReceived_;
+    std::atomic<uint64_t> framesAssembled_;
+    std::atomic<uint64_t> packetsLost_;
+    std::atomic<int64_t> jitterUs_;
+    std::atomic<uint32_t> reconnects_;
+
+    // Окно скорости
+    std::atomic<int64_t> windowStartUs_;
+    std::atomic<uint64_t> windowBytes_;
+    std::atomic<uint64_t> windowFrames_;
+    std::atomic<uint64_t> bitrateBps_;
+    std::atomic<uint64_t> fpsMilli_;         // Кадры видео в секунду * 1000
+    std::atomic<int64_t> rateUpdatedUs_;     // Конец последнего закрытого окна
+
+    std::atomic<uint64_t> latencyCounts_[kLatencyBuckets];
+    std::atomic<uint64_t> latencyMaxUs_;
+};
+
+#endif // CLIENT_STATS_H
@@ -0,0 +1,219 @@
+#include "dns_resolver.h"
+#include <cstring>
+#include <memory>
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+#endif
+
+namespace {
+
+// Ожидание результата синхронным вызовом resolve()
+struct SyncResolve {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done;
+    bool success;
+    struct sockaddr_in addr;
+
+    SyncResolve() : done(false), success(false) {
+        memset(&addr, 0, sizeof(addr));
+    }
+};
+
+void on_sync_resolved(bool success, const struct sockaddr_in& addr, void* context) {
+    // Владение контекстом передается обработчику: ожидающий мог уйти по таймауту
+    std::shared_ptr<SyncResolve>* holder = static_cast<std::shared_ptr<SyncResolve>*>(context);
+    std::shared_ptr<SyncResolve> wait = *holder;
+    delete holder;
+
+    {
+        std::lock_guard<std::mutex> lock(wait->mutex);
+        wait->done = true;
+        wait->success = success;
+        wait->addr = addr;
+    }
+    wait->condition.notify_all();
+}
+
+} // namespace
+
+const int DNSResolver::kDefaultTtlMs;
+const int DNSResolver::kNegativeTtlMs;
+const int DNSResolver::kWorkerCount;
+
+DNSResolver& DNSResolver::instance() {
+    static DNSResolver resolver;
+    return resolver;
+}
+
+DNSResolver::DNSResolver()
+    : stopping_(false), ttlMs_(kDefaultTtlMs), hits_(0), misses_(0), failures_(0) {}
+
+DNSResolver::~DNSResolver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queueCondition_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void DNSResolver::setTtl(int ttlMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttlMs_ = ttlMs > 0 ? ttlMs : 0;
+}
+
+void DNSResolver::startWorkers() {
+    // Вызывается под mutex_
+    if (!workers_.empty()) return;
+    for (int i = 0; i < kWorkerCount; i++) {
+        workers_.emplace_back(&DNSResolver::run, this);
+    }
+}
+
+void DNSResolver::resolveAsync(const std::string& host, DNSResolveHandler handler, void* context) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+
+    // IP адрес не требует DNS запроса
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) == 1) {
+        handler(true, addr, context);
+        return;
+    }
+
+    bool callNow = false;
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            callNow = true;
+        } else {
+            auto now = std::chrono::steady_clock::now();
+            Entry& entry = cache_[host];
+            bool fresh = now < entry.expires;
+
+            if (fresh || (entry.valid && ttlMs_ > 0)) {
+                // Попадание в кэш; устаревший адрес выдается и обновляется в фоне
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                callNow = true;
+                success = entry.valid;
+                addr = entry.addr;
+                if (!fresh && !entry.resolving) {
+                    entry.resolving = true;
+                    startWorkers();
+                    queue_.push_back(host);
+                    queueCondition_.notify_one();
+                }
+            } else {
+                misses_.fetch_add(1, std::memory_order_relaxed);
+                entry.waiters.push_back(std::make_pair(handler, context));
+                if (!entry.resolving) {
+                    entry.resolving = true;
+                    startWorkers();
+                    queue_.push_back(host);
+                    queueCondition_.notify_one();
+                }
+            }
+        }
+    }
+
+    if (callNow) {
+        handler(success, addr, context);
+    }
+}
+
+bool DNSResolver::resolve(const std::string& host, struct sockaddr_in& addr, int timeoutMs) {
+    std::shared_ptr<SyncResolve> wait = std::make_shared<SyncResolve>();
+    resolveAsync(host, on_sync_resolved, new std::shared_ptr<SyncResolve>(wait));
+
+    std::unique_lock<std::mutex> lock(wait->mutex);
+    if (!wait->condition.wait_for(lock, std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 5000),
+                                  [&wait] { return wait->done; })) {
+        return false;
+    }
+    if (wait->success) {
+        addr = wait->addr;
+    }
+    return wait->success;
+}
+
+void DNSResolver::getStats(Stats& stats) const {
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.failures = failures_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.cachedHosts = static_cast<int>(cache_.size());
+}
+
+void DNSResolver::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Записи с ожидающими запросами сохраняются до получения результата
+    for (auto it = cache_.begin(); it != cache_.end();) {
+        if (it->second.resolving) {
+            ++it;
+        } else {
+            it = cache_.erase(it);
+        }
+    }
+}
+
+void DNSResolver::run() {
+    while (true) {
+        std::string host;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queueCondition_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            host = queue_.front();
+            queue_.pop_front();
+        }
+
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        struct addrinfo* result = nullptr;
+        bool success = getaddrinfo(host.c_str(), nullptr, &hints, &result) == 0 && result;
+        if (success) {
+            memcpy(&addr, result->ai_addr, sizeof(addr));
+            addr.sin_port = 0;
+        }
+        if (result) {
+            freeaddrinfo(result);
+        }
+
+        std::vector<std::pair<DNSResolveHandler, void*>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Entry& entry = cache_[host];
+            auto now = std::chrono::steady_clock::now();
+            entry.resolving = false;
+            if (success) {
+                entry.valid = true;
+                entry.addr = addr;
+                entry.expires = now + std::chrono::milliseconds(ttlMs_);
+            } else {
+                // Неудача кэшируется ненадолго; прежний адрес остается в ходу
+                failures_.fetch_add(1, std::memory_order_relaxed);
+                entry.expires = now + std::chrono::milliseconds(kNegativeTtlMs);
+            }
+            waiters.swap(entry.waiters);
+        }
+
+        for (auto& waiter : waiters) {
+            waiter.first(success, addr, waiter.second);
+        }
+    }
+}
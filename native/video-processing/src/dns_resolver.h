@@ -0,0 +1,91 @@
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <netinet/in.h>
+#endif
+
+// Результат разрешения имени (вызывается в потоке резолвера или сразу,
+// если адрес есть в кэше). addr действителен только на время вызова.
+typedef void (*DNSResolveHandler)(bool success, const struct sockaddr_in& addr, void* context);
+
+// Общий для процесса резолвер имен камер.
+// getaddrinfo выполняется небольшим пулом потоков, результаты кэшируются
+// на ttl; одновременные запросы одного имени объединяются в один запрос.
+// Устаревшая запись выдается сразу и обновляется в фоне, поэтому
+// массовое переподключение камер не ждет DNS.
+class DNSResolver {
+public:
+    static const int kDefaultTtlMs = 60000;
+    static const int kNegativeTtlMs = 5000;     // Кэширование неудачных запросов
+    static const int kWorkerCount = 4;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t failures;
+        int cachedHosts;
+    };
+
+    static DNSResolver& instance();
+
+    void setTtl(int ttlMs);
+
+    // Асинхронное разрешение. IP адрес в виде строки разрешается сразу без кэша.
+    void resolveAsync(const std::string& host, DNSResolveHandler handler, void* context);
+
+    // Синхронное разрешение с ожиданием не дольше timeoutMs
+    bool resolve(const std::string& host, struct sockaddr_in& addr, int timeoutMs);
+
+    void getStats(Stats& stats) const;
+
+    // Очистка кэша (например, после смены DNS сервера)
+    void clear();
+
+    ~DNSResolver();
+
+private:
+    DNSResolver();
+    DNSResolver(const DNSResolver&) = delete;
+    DNSResolver& operator=(const DNSResolver&) = delete;
+
+    struct Entry {
+        bool valid;                 // Есть разрешенный адрес
+        struct sockaddr_in addr;
+        std::chrono::steady_clock::time_point expires;
+        bool resolving;
+        std::vector<std::pair<DNSResolveHandler, void*>> waiters;
+    };
+
+    void run();
+    void startWorkers();
+
+    mutable std::mutex mutex_;
+    std::condition_variable queueCondition_;
+    std::map<std::string, Entry> cache_;
+    std::deque<std::string> queue_;
+    std::vector<std::thread> workers_;
+    bool stopping_;
+    int ttlMs_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> failures_;
+};
+
+#endif // DNS_RESOLVER_H
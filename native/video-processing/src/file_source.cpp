@@ -0,0 +1,189 @@
+#include "file_source.h"
+#include "frame_pool.h"
+#include <chrono>
+
+const int64_t FileSource::kMaxLagUs;
+
+namespace {
+
+const char kFileScheme[] = "file://";
+
+int64_t steady_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wall_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+FileSource::FileSource(RTSPFrameCallback frameCallback, StreamStatusCallback statusCallback, void* userData)
+    : frameCallback_(frameCallback), statusCallback_(statusCallback), userData_(userData),
+      framePool_(FramePool::create()), mode_(STREAM_PLAYBACK_REALTIME), speed_(1.0), loop_(false),
+      position_(0), loopOffsetUs_(0), startUnixUs_(0), running_(false), stopRequested_(false) {}
+
+FileSource::~FileSource() {
+    halt();
+    file_.close();
+    framePool_->detach();
+}
+
+bool FileSource::open(const StreamConfig& config, std::string& error) {
+    close();
+
+    std::string path = config.url;
+    if (path.compare(0, sizeof(kFileScheme) - 1, kFileScheme) == 0) {
+        path.erase(0, sizeof(kFileScheme) - 1);
+    }
+    if (!file_.open(path, config.fileFps, error)) {
+        return false;
+    }
+
+    mode_ = config.playbackMode;
+    speed_ = mode_ == STREAM_PLAYBACK_SCALED && config.playbackSpeed > 0 ? config.playbackSpeed : 1.0;
+    loop_ = config.playbackLoop;
+    position_ = 0;
+    loopOffsetUs_ = 0;
+    return true;
+}
+
+void FileSource::close() {
+    halt();
+    if (thread_.joinable() && thread_.get_id() == std::this_thread::get_id()) {
+        // Закрытие из callback: отображение файла нужно потоку до его выхода
+        return;
+    }
+    file_.close();
+    position_ = 0;
+    loopOffsetUs_ = 0;
+}
+
+bool FileSource::play() {
+    if (!file_.isOpen()) return false;
+
+    bool self = thread_.joinable() && thread_.get_id() == std::this_thread::get_id();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_ && (!stopRequested_ || self)) {
+            // Уже воспроизводится (или остановка из callback отменяется)
+            stopRequested_ = false;
+            return true;
+        }
+    }
+    if (self) return false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (position_ >= file_.sampleCount()) {
+        position_ = 0;
+        loopOffsetUs_ = 0;
+    }
+    if (position_ == 0 && loopOffsetUs_ == 0) {
+        startUnixUs_ = wall_now_us() - file_.sample(0).presentationTimeUs;
+    }
+
+    stopRequested_ = false;
+    running_ = true;
+    thread_ = std::thread(&FileSource::run, this);
+    return true;
+}
+
+void FileSource::halt() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    condition_.notify_all();
+
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+        thread_.join();
+    }
+}
+
+void FileSource::pause() {
+    halt();
+}
+
+void FileSource::stop() {
+    halt();
+    std::lock_guard<std::mutex> lock(mutex_);
+    position_ = 0;
+    loopOffsetUs_ = 0;
+}
+
+void FileSource::getStats(RTSPClientStats* stats) const {
+    stats_.snapshot(*stats, steady_now_us());
+}
+
+void FileSource::run() {
+    const size_t count = file_.sampleCount();
+    const bool paced = mode_ != STREAM_PLAYBACK_AS_FAST_AS_POSSIBLE;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Расписание: кадр с временем декодирования anchorMediaUs выдается в anchorUs
+    int64_t anchorUs = steady_now_us();
+    int64_t anchorMediaUs = (position_ < count ? file_.sample(position_).decodeTimeUs : 0) + loopOffsetUs_;
+
+    while (!stopRequested_) {
+        if (position_ >= count) {
+            if (!loop_) break;
+            position_ = 0;
+            loopOffsetUs_ += file_.durationUs();
+        }
+
+        const MediaSample& sample = file_.sample(position_);
+        int64_t mediaUs = sample.decodeTimeUs + loopOffsetUs_;
+        if (paced) {
+            int64_t dueUs = anchorUs + static_cast<int64_t>((mediaUs - anchorMediaUs) / speed_);
+            int64_t nowUs = steady_now_us();
+            if (nowUs - dueUs > kMaxLagUs) {
+                anchorUs = nowUs;
+                anchorMediaUs = mediaUs;
+            } else if (dueUs > nowUs &&
+                       condition_.wait_for(lock, std::chrono::microseconds(dueUs - nowUs),
+                                           [this] { return stopRequested_; })) {
+                break;
+            }
+        }
+
+        // Позиция сдвигается до выдачи: остановка из callback не повторит кадр
+        position_++;
+        int64_t timeOffsetUs = loopOffsetUs_;
+        lock.unlock();
+        emit(sample, timeOffsetUs);
+        lock.lock();
+    }
+
+    bool finished = !stopRequested_;
+    running_ = false;
+    lock.unlock();
+
+    if (finished && statusCallback_) {
+        statusCallback_(STREAM_STATUS_CONNECTED, "End of file", userData_);
+    }
+}
+
+void FileSource::emit(const MediaSample& sample, int64_t timeOffsetUs) {
+    size_t size = file_.frameSize(sample);
+    RTSPFrame* frame = framePool_->acquire(size);
+    frame->size = static_cast<int>(file_.writeFrame(sample, frame->data));
+    frame->timestamp = startUnixUs_ + sample.presentationTimeUs + timeOffsetUs;
+    frame->timestampSynchronized = false;
+    frame->type = RTSP_STREAM_VIDEO;
+    frame->width = file_.width();
+    frame->height = file_.height();
+    frame->keyframe = sample.keyframe;
+
+    int64_t nowUs = steady_now_us();
+    if (stats_.onPacket(size, nowUs)) {
+        stats_.publishStreamState(0, 0);
+    }
+    stats_.onFrame(true);
+
+    frameCallback_(frame, userData_);
+    stats_.recordCallbackLatency(steady_now_us() - nowUs);
+}
@@ -0,0 +1,84 @@
+#ifndef FILE_SOURCE_H
+#define FILE_SOURCE_H
+
+#include "stream_manager.h"
+#include "media_file.h"
+#include "client_stats.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class FramePool;
+
+// Источник STREAM_TYPE_FILE: кадры MediaFile выдаются в callback так же, как
+// кадры камеры (Annex-B из пула с подсчетом ссылок), в отдельном потоке
+// воспроизведения. Темп - по времени кадров в файле: реальное время, с
+// множителем или без пауз (нагрузочные тесты, прогон записи через аналитику).
+// timestamp кадра - время начала воспроизведения плюс время показа кадра в
+// файле; при повторе файла время продолжает расти.
+// Управление (open/play/pause/stop/close) вызывается из одного потока за раз;
+// из callback кадра можно останавливать воспроизведение, но не уничтожать источник.
+class FileSource {
+public:
+    // Отставание от расписания, после которого темп отсчитывается заново
+    // (медленный потребитель не получает потом кадры пачкой)
+    static const int64_t kMaxLagUs = 1000000;
+
+    FileSource(RTSPFrameCallback frameCallback, StreamStatusCallback statusCallback, void* userData);
+    ~FileSource();
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    // Открытие файла (url: путь или file://путь) с параметрами воспроизведения конфигурации
+    bool open(const StreamConfig& config, std::string& error);
+    void close();
+
+    // Запуск или продолжение воспроизведения. После конца файла - с начала.
+    bool play();
+
+    // Остановка с сохранением позиции
+    void pause();
+
+    // Остановка с возвратом к началу файла
+    void stop();
+
+    bool isOpen() const { return file_.isOpen(); }
+    const MediaFile& file() const { return file_; }
+
+    // Статистика в формате клиента: пакеты - прочитанные кадры, байты - их размер
+    void getStats(RTSPClientStats* stats) const;
+
+private:
+    void run();
+    void halt();
+    void emit(const MediaSample& sample, int64_t timeOffsetUs);
+
+    const RTSPFrameCallback frameCallback_;
+    const StreamStatusCallback statusCallback_;
+    void* const userData_;
+
+    MediaFile file_;
+    FramePool* framePool_;
+    ClientStats stats_;
+
+    StreamPlaybackMode mode_;
+    double speed_;
+    bool loop_;
+
+    // Состояние воспроизведения (меняется потоком воспроизведения, пока он идет)
+    size_t position_;
+    int64_t loopOffsetUs_;      // Сдвиг времени повторов файла
+    int64_t startUnixUs_;       // Время начала воспроизведения для timestamp кадров
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool running_;              // Поток воспроизведения еще не вышел
+    bool stopRequested_;
+};
+
+#endif // FILE_SOURCE_H
@@ -0,0 +1,200 @@
+#include "frame_pool.h"
+
+// Кадр пула. RTSPFrame должен быть первым полем: указатель на RTSPFrame,
+// отданный наружу, приводится обратно к PooledFrame при release/retain.
+struct PooledFrame {
+    RTSPFrame frame;
+    std::atomic<int> refCount;
+    FramePool* pool;
+    int sizeClass;          // -1 для разово выделенных кадров
+    size_t capacity;
+    uint8_t* buffer;
+    PooledFrame* next;
+
+    PooledFrame() : refCount(0), pool(nullptr), sizeClass(-1), capacity(0),
+                    buffer(nullptr), next(nullptr) {
+        frame.data = nullptr;
+        frame.size = 0;
+        frame.timestamp = 0;
+        frame.type = RTSP_STREAM_VIDEO;
+        frame.width = 0;
+        frame.height = 0;
+    }
+};
+
+namespace {
+
+struct SizeClassConfig {
+    size_t bufferSize;
+    int buffersPerSlab;
+};
+
+// Классы размеров: от P-кадров sub-потока до I-кадров 4K
+const SizeClassConfig kSizeClasses[FramePool::kSizeClassCount] = {
+    {32 * 1024, 8},
+    {128 * 1024, 8},
+    {512 * 1024, 4},
+    {2 * 1024 * 1024, 2},
+    {8 * 1024 * 1024, 1}
+};
+
+} // namespace
+
+FramePool* FramePool::create(size_t memoryLimit) {
+    return new FramePool(memoryLimit);
+}
+
+FramePool::FramePool(size_t memoryLimit)
+    : memoryLimit_(memoryLimit), refs_(1), hits_(0), misses_(0), inUse_(0),
+      highWaterMark_(0), allocatedBytes_(0) {
+    for (int i = 0; i < kSizeClassCount; i++) {
+        classes_[i].bufferSize = kSizeClasses[i].bufferSize;
+        classes_[i].buffersPerSlab = kSizeClasses[i].buffersPerSlab;
+        classes_[i].freeList.store(nullptr);
+        classes_[i].localList = nullptr;
+    }
+}
+
+FramePool::~FramePool() {
+    // Память slab'ов освобождается вместе с вектором
+}
+
+void FramePool::detach() {
+    unref();
+}
+
+void FramePool::unref() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+PooledFrame* FramePool::popFree(int sizeClass) {
+    SizeClass& cls = classes_[sizeClass];
+    if (!cls.localList) {
+        // Забираем весь список возвращенных кадров целиком: exchange не подвержен ABA
+        cls.localList = cls.freeList.exchange(nullptr, std::memory_order_acquire);
+    }
+    PooledFrame* frame = cls.localList;
+    if (frame) {
+        cls.localList = frame->next;
+        frame->next = nullptr;
+    }
+    return frame;
+}
+
+bool FramePool::growSizeClass(int sizeClass) {
+    SizeClass& cls = classes_[sizeClass];
+    size_t slabBytes = cls.bufferSize * cls.buffersPerSlab;
+
+    std::lock_guard<std::mutex> lock(slabMutex_);
+    if (allocatedBytes_.load(std::memory_order_relaxed) + slabBytes > memoryLimit_) {
+        return false;
+    }
+
+    Slab slab;
+    slab.frames.reset(new PooledFrame[cls.buffersPerSlab]);
+    slab.data.reset(new uint8_t[slabBytes]);
+
+    for (int i = 0; i < cls.buffersPerSlab; i++) {
+        PooledFrame* frame = &slab.frames[i];
+        frame->pool = this;
+        frame->sizeClass = sizeClass;
+        frame->capacity = cls.bufferSize;
+        frame->buffer = slab.data.get() + i * cls.bufferSize;
+        frame->next = cls.localList;
+        cls.localList = frame;
+    }
+
+    slabs_.push_back(std::move(slab));
+    allocatedBytes_.fetch_add(slabBytes, std::memory_order_relaxed);
+    return true;
+}
+
+RTSPFrame* FramePool::acquire(size_t size) {
+    int sizeClass = -1;
+    for (int i = 0; i < kSizeClassCount; i++) {
+        if (size <= classes_[i].bufferSize) {
+            sizeClass = i;
+            break;
+        }
+    }
+
+    PooledFrame* frame = nullptr;
+    if (sizeClass >= 0) {
+        frame = popFree(sizeClass);
+        if (frame) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+        } else if (growSizeClass(sizeClass)) {
+            frame = popFree(sizeClass);
+            misses_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!frame) {
+        // Слишком большой кадр или исчерпан лимит памяти: разовое выделение
+        frame = new PooledFrame();
+        frame->pool = this;
+        frame->capacity = size;
+        frame->buffer = new uint8_t[size > 0 ? size : 1];
+        misses_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    frame->refCount.store(1, std::memory_order_relaxed);
+    frame->frame.data = frame->buffer;
+    frame->frame.size = static_cast<int>(size);
+    frame->frame.timestamp = 0;
+    frame->frame.type = RTSP_STREAM_VIDEO;
+    frame->frame.width = 0;
+    frame->frame.height = 0;
+
+    refs_.fetch_add(1, std::memory_order_relaxed);
+    int inUse = inUse_.fetch_add(1, std::memory_order_relaxed) + 1;
+    int highWater = highWaterMark_.load(std::memory_order_relaxed);
+    while (inUse > highWater &&
+           !highWaterMark_.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed)) {
+    }
+
+    return &frame->frame;
+}
+
+RTSPFrame* FramePool::retain(RTSPFrame* frame) {
+    if (!frame) return nullptr;
+    PooledFrame* pooled = reinterpret_cast<PooledFrame*>(frame);
+    pooled->refCount.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+void FramePool::release(RTSPFrame* frame) {
+    if (!frame) return;
+    PooledFrame* pooled = reinterpret_cast<PooledFrame*>(frame);
+    if (pooled->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        pooled->pool->recycle(pooled);
+    }
+}
+
+void FramePool::recycle(PooledFrame* frame) {
+    if (frame->sizeClass < 0) {
+        delete[] frame->buffer;
+        delete frame;
+    } else {
+        std::atomic<PooledFrame*>& freeList = classes_[frame->sizeClass].freeList;
+        PooledFrame* head = freeList.load(std::memory_order_relaxed);
+        do {
+            frame->next = head;
+        } while (!freeList.compare_exchange_weak(head, frame, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    }
+
+    inUse_.fetch_sub(1, std::memory_order_relaxed);
+    unref();
+}
+
+void FramePool::getStats(RTSPFramePoolStats* stats) const {
+    if (!stats) return;
+    stats->hits = hits_.load(std::memory_order_relaxed);
+    stats->misses = misses_.load(std::memory_order_relaxed);
+    stats->inUse = inUse_.load(std::memory_order_relaxed);
+    stats->highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+    stats->allocatedBytes = allocatedBytes_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,78 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include "rtsp_client.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct PooledFrame;
+
+// Пул буферов кадров с подсчетом ссылок.
+// Буферы разбиты на классы размеров и выделяются slab'ами, после первого
+// использования кадры возвращаются в пул без обращения к аллокатору.
+// acquire() вызывается только из одного потока (поток приема клиента),
+// release() - из любого потока.
+// Пул живет, пока жив владелец или хотя бы один выданный кадр.
+class FramePool {
+public:
+    // Количество классов размеров буферов
+    static const int kSizeClassCount = 5;
+
+    // Лимит памяти под slab'ы по умолчанию, сверх него кадры выделяются разово
+    static const size_t kDefaultMemoryLimit = 64 * 1024 * 1024;
+
+    static FramePool* create(size_t memoryLimit = kDefaultMemoryLimit);
+
+    // Отказ владельца от пула (пул удаляется после возврата всех кадров)
+    void detach();
+
+    // Получение кадра с буфером не меньше size байт (refCount = 1)
+    RTSPFrame* acquire(size_t size);
+
+    // Увеличение счетчика ссылок кадра
+    static RTSPFrame* retain(RTSPFrame* frame);
+
+    // Уменьшение счетчика ссылок, при нуле кадр возвращается в пул
+    static void release(RTSPFrame* frame);
+
+    void getStats(RTSPFramePoolStats* stats) const;
+
+private:
+    explicit FramePool(size_t memoryLimit);
+    ~FramePool();
+
+    void recycle(PooledFrame* frame);
+    PooledFrame* popFree(int sizeClass);
+    bool growSizeClass(int sizeClass);
+    void unref();
+
+    struct SizeClass {
+        size_t bufferSize;
+        int buffersPerSlab;
+        std::atomic<PooledFrame*> freeList;     // Возвращенные кадры (push из любого потока)
+        PooledFrame* localList;                 // Кэш потока acquire()
+    };
+
+    struct Slab {
+        std::unique_ptr<PooledFrame[]> frames;
+        std::unique_ptr<uint8_t[]> data;
+    };
+
+    SizeClass classes_[kSizeClassCount];
+    std::vector<Slab> slabs_;
+    std::mutex slabMutex_;
+    size_t memoryLimit_;
+
+    std::atomic<int> refs_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<int> inUse_;
+    std::atomic<int> highWaterMark_;
+    std::atomic<uint64_t> allocatedBytes_;
+};
+
+#endif // FRAME_POOL_H
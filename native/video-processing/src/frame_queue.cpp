@@ -0,0 +1,191 @@
+#include "frame_queue.h"
+#include "frame_pool.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+uint64_t round_up_capacity(int capacity) {
+    uint64_t rounded = 2;
+    while (rounded < static_cast<uint64_t>(std::max(capacity, 2))) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+} // namespace
+
+const int FrameQueue::kDefaultCapacity;
+
+FrameQueue::FrameQueue(int capacity, RTSPFrameQueuePolicy policy)
+    : capacity_(round_up_capacity(capacity > 0 ? capacity : kDefaultCapacity)),
+      mask_(capacity_ - 1), policy_(policy),
+      slots_(new std::atomic<RTSPFrame*>[capacity_]),
+      head_(0), tail_(0), waitingForKeyframe_(false), closed_(true),
+      consumerWaiting_(false), producerWaiting_(false),
+      enqueued_(0), dropped_(0), blocked_(0), highWaterMark_(0) {
+    for (uint64_t i = 0; i < capacity_; i++) {
+        slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+FrameQueue::~FrameQueue() {
+    while (RTSPFrame* frame = pop()) {
+        FramePool::release(frame);
+    }
+}
+
+void FrameQueue::discard(RTSPFrame* frame) {
+    FramePool::release(frame);
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool FrameQueue::dropOldest(uint64_t tail) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) return false;
+
+    // Слот head прочитан до CAS: если потребитель успел его забрать, CAS не пройдет
+    RTSPFrame* oldest = slots_[head & mask_].load(std::memory_order_relaxed);
+    if (!head_.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+        return false;
+    }
+    discard(oldest);
+    return true;
+}
+
+bool FrameQueue::push(RTSPFrame* frame) {
+    if (closed_.load(std::memory_order_acquire)) {
+        discard(frame);
+        return false;
+    }
+
+    // После отброшенного кадра зависимые от него кадры бесполезны для декодера
+    if (policy_ == RTSP_FRAME_QUEUE_DROP_NON_KEYFRAME && waitingForKeyframe_) {
+        if (!frame->keyframe) {
+            discard(frame);
+            return false;
+        }
+        waitingForKeyframe_ = false;
+    }
+
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    bool countedBlock = false;
+    while (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+        if (policy_ == RTSP_FRAME_QUEUE_BLOCK) {
+            if (!countedBlock) {
+                blocked_.fetch_add(1, std::memory_order_relaxed);
+                countedBlock = true;
+            }
+            std::unique_lock<std::mutex> lock(waitMutex_);
+            producerWaiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            producerCondition_.wait_for(lock, std::chrono::milliseconds(100), [&] {
+                return tail - head_.load(std::memory_order_acquire) < capacity_ ||
+                       closed_.load(std::memory_order_acquire);
+            });
+            producerWaiting_.store(false, std::memory_order_relaxed);
+            if (closed_.load(std::memory_order_acquire)) {
+                lock.unlock();
+                discard(frame);
+                return false;
+            }
+        } else if (policy_ == RTSP_FRAME_QUEUE_DROP_NON_KEYFRAME && !frame->keyframe) {
+            waitingForKeyframe_ = true;
+            discard(frame);
+            return false;
+        } else {
+            // DROP_OLDEST, или ключевой кадр вытесняет кадры, которые он заменяет
+            dropOldest(tail);
+        }
+    }
+
+    slots_[tail & mask_].store(frame, std::memory_order_relaxed);
+    tail_.store(tail + 1, std::memory_order_release);
+    enqueued_.fetch_add(1, std::memory_order_relaxed);
+
+    int depth = static_cast<int>(tail + 1 - head_.load(std::memory_order_relaxed));
+    int highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+    while (depth > highWaterMark &&
+           !highWaterMark_.compare_exchange_weak(highWaterMark, depth, std::memory_order_relaxed)) {
+    }
+
+    wakeConsumer();
+    return true;
+}
+
+RTSPFrame* FrameQueue::pop() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (head != tail_.load(std::memory_order_acquire)) {
+        RTSPFrame* frame = slots_[head & mask_].load(std::memory_order_relaxed);
+        if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+            wakeProducer();
+            return frame;
+        }
+        // Производитель вытеснил кадр: повтор с новым head
+    }
+    return nullptr;
+}
+
+// Пробуждение ждущей стороны. Забор между изменением индекса и чтением флага
+// в паре с забором ожидающего исключает потерю пробуждения.
+void FrameQueue::wakeConsumer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerWaiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        consumerCondition_.notify_one();
+    }
+}
+
+void FrameQueue::wakeProducer() {
+    if (policy_ != RTSP_FRAME_QUEUE_BLOCK) return;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producerWaiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        producerCondition_.notify_one();
+    }
+}
+
+bool FrameQueue::waitForFrames(int timeoutMs) {
+    if (size() > 0) return true;
+    if (timeoutMs <= 0) return false;
+
+    std::unique_lock<std::mutex> lock(waitMutex_);
+    consumerWaiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ready = consumerCondition_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+        return size() > 0 || closed_.load(std::memory_order_acquire);
+    });
+    consumerWaiting_.store(false, std::memory_order_relaxed);
+    return ready && size() > 0;
+}
+
+void FrameQueue::close() {
+    closed_.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(waitMutex_);
+    consumerCondition_.notify_all();
+    producerCondition_.notify_all();
+}
+
+void FrameQueue::open() {
+    while (RTSPFrame* frame = pop()) {
+        FramePool::release(frame);
+    }
+    waitingForKeyframe_ = false;
+    closed_.store(false, std::memory_order_release);
+}
+
+int FrameQueue::size() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? static_cast<int>(tail - head) : 0;
+}
+
+void FrameQueue::getStats(RTSPFrameQueueStats* stats) const {
+    stats->depth = size();
+    stats->capacity = capacity();
+    stats->highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+    stats->enqueued = enqueued_.load(std::memory_order_relaxed);
+    stats->dropped = dropped_.load(std::memory_order_relaxed);
+    stats->blocked = blocked_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,78 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include "rtsp_client.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Ограниченная очередь кадров между потоком приема (производитель) и потоком
+// доставки в callback (потребитель). Кольцевой буфер без блокировок: один
+// производитель, один потребитель; при переполнении производитель может
+// вытеснить самый старый кадр (head продвигается через CAS обеими сторонами).
+// Мьютекс используется только для ожидания, когда очередь пуста или полна.
+// Очередь владеет кадрами: отброшенные и оставшиеся кадры освобождаются.
+class FrameQueue {
+public:
+    static const int kDefaultCapacity = 16;
+
+    FrameQueue(int capacity, RTSPFrameQueuePolicy policy);
+    ~FrameQueue();
+
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    // Производитель: постановка кадра. false - кадр отброшен (и освобожден)
+    bool push(RTSPFrame* frame);
+
+    // Потребитель: извлечение кадра, nullptr - очередь пуста
+    RTSPFrame* pop();
+
+    // Потребитель: ожидание кадров. false - кадров нет (таймаут или закрытие)
+    bool waitForFrames(int timeoutMs);
+
+    // Закрытие: ожидающие стороны просыпаются, новые кадры отбрасываются
+    void close();
+
+    // Открытие для новой сессии; оставшиеся кадры освобождаются (вызывает потребитель)
+    void open();
+
+    bool isClosed() const { return closed_.load(std::memory_order_acquire); }
+    int capacity() const { return static_cast<int>(capacity_); }
+    int size() const;
+
+    void getStats(RTSPFrameQueueStats* stats) const;
+
+private:
+    bool dropOldest(uint64_t tail);
+    void discard(RTSPFrame* frame);
+    void wakeConsumer();
+    void wakeProducer();
+
+    const uint64_t capacity_;
+    const uint64_t mask_;
+    const RTSPFrameQueuePolicy policy_;
+    std::unique_ptr<std::atomic<RTSPFrame*>[]> slots_;
+
+    // Индексы растут монотонно, номер слота - индекс & mask_
+    alignas(64) std::atomic<uint64_t> head_;
+    alignas(64) std::atomic<uint64_t> tail_;
+    bool waitingForKeyframe_;       // Состояние производителя (DROP_NON_KEYFRAME)
+
+    std::atomic<bool> closed_;
+    std::mutex waitMutex_;
+    std::condition_variable consumerCondition_;
+    std::condition_variable producerCondition_;
+    std::atomic<bool> consumerWaiting_;
+    std::atomic<bool> producerWaiting_;
+
+    std::atomic<uint64_t> enqueued_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> blocked_;
+    std::atomic<int> highWaterMark_;
+};
+
+#endif // FRAME_QUEUE_H
@@ -0,0 +1,72 @@
+#include "gop_cache.h"
+#include "frame_pool.h"
+
+const int GopCache::kDefaultMaxFrames;
+const size_t GopCache::kDefaultMaxBytes;
+
+GopCache::GopCache() : enabled_(false), maxFrames_(0), maxBytes_(0), bytes_(0) {}
+
+GopCache::~GopCache() {
+    releaseFrames();
+}
+
+void GopCache::releaseFrames() {
+    for (RTSPFrame* frame : frames_) {
+        FramePool::release(frame);
+    }
+    // clear() сохраняет емкость: следующий GOP не перевыделяет память
+    frames_.clear();
+    bytes_ = 0;
+}
+
+void GopCache::setLimits(int maxFrames, size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxFrames_ = maxFrames > 0 ? maxFrames : 0;
+    maxBytes_ = maxBytes > 0 ? maxBytes : kDefaultMaxBytes;
+    enabled_.store(maxFrames_ > 0, std::memory_order_release);
+
+    if (maxFrames_ == 0 || static_cast<int>(frames_.size()) > maxFrames_ || bytes_ > maxBytes_) {
+        releaseFrames();
+    }
+}
+
+void GopCache::push(RTSPFrame* frame) {
+    if (!enabled()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame->keyframe) {
+        releaseFrames();
+    } else if (frames_.empty()) {
+        // Начало GOP не попало в кэш
+        return;
+    }
+
+    size_t size = static_cast<size_t>(frame->size);
+    if (static_cast<int>(frames_.size()) >= maxFrames_ || bytes_ + size > maxBytes_) {
+        // GOP длиннее лимитов: неполный GOP бесполезен, ждем следующий ключевой кадр
+        releaseFrames();
+        return;
+    }
+
+    frames_.push_back(FramePool::retain(frame));
+    bytes_ += size;
+}
+
+void GopCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    releaseFrames();
+}
+
+size_t GopCache::snapshot(std::vector<RTSPFrame*>& frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (RTSPFrame* frame : frames_) {
+        frames.push_back(FramePool::retain(frame));
+    }
+    return frames_.size();
+}
+
+void GopCache::getStats(int& frames, size_t& bytes) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames = static_cast<int>(frames_.size());
+    bytes = bytes_;
+}
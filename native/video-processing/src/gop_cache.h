@@ -0,0 +1,57 @@
+#ifndef GOP_CACHE_H
+#define GOP_CACHE_H
+
+#include "rtsp_client.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Последняя группа кадров (GOP) видеопотока: от последнего ключевого кадра
+// до текущего. Кадры хранятся по ссылке (rtsp_frame_retain), без копирования.
+// Новому подписчику GOP выдается целиком, и он декодирует картинку сразу,
+// не дожидаясь следующего IDR от камеры.
+// push() вызывает поток приема, snapshot() - любой поток.
+class GopCache {
+public:
+    static const int kDefaultMaxFrames = 300;
+    static const size_t kDefaultMaxBytes = 16 * 1024 * 1024;
+
+    GopCache();
+    ~GopCache();
+
+    GopCache(const GopCache&) = delete;
+    GopCache& operator=(const GopCache&) = delete;
+
+    // Лимиты кэша. GOP, не уложившийся в лимиты, не кэшируется до следующего
+    // ключевого кадра. maxFrames = 0 - кэш выключен (кадры освобождаются).
+    void setLimits(int maxFrames, size_t maxBytes);
+
+    bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+    // Учет доставленного кадра: ключевой начинает новый GOP
+    void push(RTSPFrame* frame);
+
+    // Сброс GOP: разрыв потока (кадры до следующего ключевого не декодируются)
+    // или новая сессия
+    void clear();
+
+    // Копия GOP: в frames добавляются кадры с захваченными ссылками,
+    // вызывающий освобождает каждый. Возвращает число кадров.
+    size_t snapshot(std::vector<RTSPFrame*>& frames);
+
+    void getStats(int& frames, size_t& bytes) const;
+
+private:
+    void releaseFrames();
+
+    mutable std::mutex mutex_;
+    std::atomic<bool> enabled_;
+    int maxFrames_;
+    size_t maxBytes_;
+    std::vector<RTSPFrame*> frames_;    // Начинается с ключевого кадра (или пуст)
+    size_t bytes_;
+};
+
+#endif // GOP_CACHE_H
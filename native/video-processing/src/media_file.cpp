@@ -0,0 +1,818 @@
+#include "media_file.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const int MediaFile::kDefaultFps;
+
+namespace {
+
+const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+
+// Типы NAL H.264
+const int kH264NalIdr = 5;
+const int kH264NalSps = 7;
+
+// Типы NAL H.265
+const int kH265NalIrapFirst = 16;
+const int kH265NalIrapLast = 21;
+const int kH265NalVps = 32;
+const int kH265NalSps = 33;
+
+// Элементы Matroska (EBML ID с маркером длины)
+const uint32_t kEbmlHeader = 0x1A45DFA3;
+const uint32_t kMkvSegment = 0x18538067;
+const uint32_t kMkvSeekHead = 0x114D9B74;
+const uint32_t kMkvInfo = 0x1549A966;
+const uint32_t kMkvTimestampScale = 0x2AD7B1;
+const uint32_t kMkvTracks = 0x1654AE6B;
+const uint32_t kMkvTrackEntry = 0xAE;
+const uint32_t kMkvTrackNumber = 0xD7;
+const uint32_t kMkvTrackType = 0x83;
+const uint32_t kMkvCodecId = 0x86;
+const uint32_t kMkvCodecPrivate = 0x63A2;
+const uint32_t kMkvVideo = 0xE0;
+const uint32_t kMkvPixelWidth = 0xB0;
+const uint32_t kMkvPixelHeight = 0xBA;
+const uint32_t kMkvCluster = 0x1F43B675;
+const uint32_t kMkvClusterTimestamp = 0xE7;
+const uint32_t kMkvSimpleBlock = 0xA3;
+const uint32_t kMkvBlockGroup = 0xA0;
+const uint32_t kMkvBlock = 0xA1;
+const uint32_t kMkvReferenceBlock = 0xFB;
+const uint32_t kMkvCues = 0x1C53BB6B;
+const uint32_t kMkvChapters = 0x1043A770;
+const uint32_t kMkvTags = 0x1254C367;
+const uint32_t kMkvAttachments = 0x1941A469;
+
+const uint64_t kMkvDefaultTimestampScale = 1000000;    // Наносекунд в единице времени
+const int kMkvTrackTypeVideo = 1;
+
+uint16_t read_u16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t read_u32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+uint64_t read_u64(const uint8_t* p) {
+    return (static_cast<uint64_t>(read_u32(p)) << 32) | read_u32(p + 4);
+}
+
+uint32_t read_length(const uint8_t* p, int lengthSize) {
+    uint32_t value = 0;
+    for (int i = 0; i < lengthSize; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+constexpr uint32_t fourcc(const char (&name)[5]) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+}
+
+// Перевод времени из единиц timescale в микросекунды без переполнения
+int64_t to_us(int64_t value, uint64_t timescale) {
+    int64_t scale = static_cast<int64_t>(timescale);
+    return value / scale * 1000000 + value % scale * 1000000 / scale;
+}
+
+std::string lower_extension(const std::string& path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos) return "";
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+void append_annexb_nal(std::vector<uint8_t>& output, const uint8_t* nal, size_t size) {
+    output.insert(output.end(), kStartCode, kStartCode + sizeof(kStartCode));
+    output.insert(output.end(), nal, nal + size);
+}
+
+// Обход NAL-единиц кадра с префиксами длины (MP4/MKV). Поврежденный хвост пропускается.
+template <typename Visitor>
+void for_each_prefixed_nal(const uint8_t* data, size_t size, int lengthSize, Visitor visit) {
+    const uint8_t* end = data + size;
+    while (end - data > lengthSize) {
+        uint32_t length = read_length(data, lengthSize);
+        data += lengthSize;
+        if (length == 0) continue;
+        if (length > static_cast<size_t>(end - data)) break;
+        visit(data, length);
+        data += length;
+    }
+}
+
+// Кодек элементарного потока по первой NAL-единице: VPS/SPS/PPS/AUD/SEI H.265
+// не совпадают с допустимыми заголовками H.264 (nal_unit_type 0, 25-31 или
+// forbidden_zero_bit), обратное неверно, поэтому проверяется H.265
+RTPPayloadCodec detect_annexb_codec(const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    const uint8_t* nal = nullptr;
+    size_t nalSize = 0;
+    if (!annexb_next_nal(data, size, offset, nal, nalSize) || nalSize < 2) {
+        return RTPPayloadCodec::H264;
+    }
+    int type = (nal[0] >> 1) & 0x3F;
+    bool h265Header = (nal[0] & 0x80) == 0 && (nal[1] & 0x07) != 0;
+    if (h265Header && (type == kH265NalVps || type == kH265NalSps || type == 34 ||
+                       type == 35 || type == 39)) {
+        return RTPPayloadCodec::H265;
+    }
+    return RTPPayloadCodec::H264;
+}
+
+bool is_vcl(RTPPayloadCodec codec, int type) {
+    return codec == RTPPayloadCodec::H264 ? (type >= 1 && type <= 5) : (type < 32);
+}
+
+// NAL-единица открывает новый кадр (как в симуляторе камер)
+bool starts_access_unit(RTPPayloadCodec codec, int type, const uint8_t* nal, size_t size) {
+    if (codec == RTPPayloadCodec::H264) {
+        // first_mb_in_slice == 0: ue(v) со значением 0 - единичный старший бит
+        if (is_vcl(codec, type)) return size > 1 && (nal[1] & 0x80) != 0;
+        return (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+    }
+    // first_slice_segment_in_pic_flag
+    if (is_vcl(codec, type)) return size > 2 && (nal[2] & 0x80) != 0;
+    return (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44) ||
+           (type >= 48 && type <= 55);
+}
+
+// ISO BMFF box: тип и полезная нагрузка без заголовка
+struct Box {
+    uint32_t type;
+    const uint8_t* data;
+    size_t size;
+};
+
+// Следующий box в [cursor, end). false - данные кончились или заголовок поврежден
+bool next_box(const uint8_t*& cursor, const uint8_t* end, Box& box) {
+    size_t available = static_cast<size_t>(end - cursor);
+    if (available < 8) return false;
+
+    uint64_t size = read_u32(cursor);
+    size_t header = 8;
+    box.type = read_u32(cursor + 4);
+    if (size == 1) {
+        if (available < 16) return false;
+        size = read_u64(cursor + 8);
+        header = 16;
+    } else if (size == 0) {
+        size = available;   // До конца файла
+    }
+    if (size < header || size > available) return false;
+
+    box.data = cursor + header;
+    box.size = static_cast<size_t>(size) - header;
+    cursor += size;
+    return true;
+}
+
+bool find_box(const uint8_t* data, size_t size, uint32_t type, Box& box) {
+    const uint8_t* cursor = data;
+    while (next_box(cursor, data + size, box)) {
+        if (box.type == type) return true;
+    }
+    return false;
+}
+
+// Таблица full box (stts, stsz, stco...): число записей после версии и флагов.
+// false - записи не помещаются в box.
+bool table_entries(const Box& box, size_t headerSize, size_t entrySize, uint32_t& count) {
+    if (box.size < headerSize) return false;
+    count = read_u32(box.data + headerSize - 4);
+    return count <= (box.size - headerSize) / entrySize;
+}
+
+// Элемент EBML
+struct Element {
+    uint32_t id;
+    const uint8_t* data;
+    size_t size;
+    bool unknownSize;       // Размер не указан (запись потоком): до конца родителя
+};
+
+bool read_ebml_id(const uint8_t*& p, const uint8_t* end, uint32_t& id) {
+    if (p >= end || p[0] == 0) return false;
+    int length = 1;
+    for (uint8_t mask = 0x80; !(p[0] & mask); mask >>= 1) length++;
+    if (length > 4 || end - p < length) return false;
+
+    id = 0;
+    for (int i = 0; i < length; i++) {
+        id = (id << 8) | p[i];
+    }
+    p += length;
+    return true;
+}
+
+// Целое переменной длины EBML (размер элемента, номер дорожки блока)
+bool read_ebml_vint(const uint8_t*& p, const uint8_t* end, uint64_t& value, bool& unknown) {
+    if (p >= end || p[0] == 0) return false;
+    int length = 1;
+    uint8_t mask = 0x80;
+    while (!(p[0] & mask)) {
+        mask >>= 1;
+        length++;
+    }
+    if (end - p < length) return false;
+
+    value = p[0] & (mask - 1);
+    unknown = value == static_cast<uint64_t>(mask - 1);
+    for (int i = 1; i < length; i++) {
+        value = (value << 8) | p[i];
+        unknown = unknown && p[i] == 0xFF;
+    }
+    p += length;
+    return true;
+}
+
+bool next_element(const uint8_t*& cursor, const uint8_t* end, Element& element) {
+    const uint8_t* p = cursor;
+    uint64_t size = 0;
+    if (!read_ebml_id(p, end, element.id) || !read_ebml_vint(p, end, size, element.unknownSize)) {
+        return false;
+    }
+
+    // Неизвестный размер и обрезанный конец файла - до конца родителя
+    size_t available = static_cast<size_t>(end - p);
+    element.data = p;
+    element.size = element.unknownSize || size > available ? available : static_cast<size_t>(size);
+    cursor = p + element.size;
+    return true;
+}
+
+uint64_t ebml_uint(const Element& element) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < element.size && i < 8; i++) {
+        value = (value << 8) | element.data[i];
+    }
+    return value;
+}
+
+// Элементы верхнего уровня сегмента: ими заканчивается кластер неизвестного размера
+bool is_segment_child(uint32_t id) {
+    return id == kMkvCluster || id == kMkvCues || id == kMkvTags || id == kMkvChapters ||
+           id == kMkvAttachments || id == kMkvSeekHead || id == kMkvInfo || id == kMkvTracks;
+}
+
+} // namespace
+
+MediaFile::MediaFile()
+    : data_(nullptr), size_(0), container_(Container::None), codec_(RTPPayloadCodec::Unknown),
+      width_(0), height_(0), nalLengthSize_(0), durationUs_(0) {}
+
+MediaFile::~MediaFile() {
+    close();
+}
+
+bool MediaFile::open(const std::string& path, int fps, std::string& error) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Failed to open " + path;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    // Отображение удерживает файл, дескрипторы больше не нужны
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (!view) {
+        error = "Failed to map " + path;
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(view);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "Failed to open " + path;
+        return false;
+    }
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // Отображение удерживает файл, дескриптор больше не нужен
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        error = "Failed to map " + path;
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(view);
+    size_ = static_cast<size_t>(info.st_size);
+    // Кадры читаются подряд: ядро читает файл с опережением
+    madvise(view, size_, MADV_SEQUENTIAL);
+#endif
+
+    bool parsed;
+    if (size_ >= 8 && (read_u32(data_ + 4) == fourcc("ftyp") || read_u32(data_ + 4) == fourcc("moov"))) {
+        container_ = Container::Mp4;
+        parsed = parseMp4(error);
+    } else if (size_ >= 4 && read_u32(data_) == kEbmlHeader) {
+        container_ = Container::Matroska;
+        parsed = parseMatroska(error);
+    } else {
+        container_ = Container::AnnexB;
+        parseAnnexB(path, fps);
+        parsed = true;
+    }
+
+    if (parsed && samples_.empty()) {
+        error = "No video frames in " + path;
+        parsed = false;
+    }
+    if (!parsed) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MediaFile::close() {
+    if (data_) {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        munmap(data_, size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+    container_ = Container::None;
+    codec_ = RTPPayloadCodec::Unknown;
+    width_ = 0;
+    height_ = 0;
+    nalLengthSize_ = 0;
+    parameterSets_.clear();
+    samples_.clear();
+    durationUs_ = 0;
+}
+
+int MediaFile::nalType(const uint8_t* nal) const {
+    return codec_ == RTPPayloadCodec::H264 ? (nal[0] & 0x1F) : ((nal[0] >> 1) & 0x3F);
+}
+
+bool MediaFile::isKeyframeNal(int type) const {
+    return codec_ == RTPPayloadCodec::H264 ? type == kH264NalIdr
+                                           : (type >= kH265NalIrapFirst && type <= kH265NalIrapLast);
+}
+
+void MediaFile::parseAnnexB(const std::string& path, int fps) {
+    std::string extension = lower_extension(path);
+    if (extension == "h265" || extension == "265" || extension == "hevc") {
+        codec_ = RTPPayloadCodec::H265;
+    } else if (extension == "h264" || extension == "264" || extension == "avc") {
+        codec_ = RTPPayloadCodec::H264;
+    } else {
+        codec_ = detect_annexb_codec(data_, size_);
+    }
+
+    // Времени в элементарном потоке нет: кадры идут с постоянной частотой.
+    // Границы кадров находятся одним проходом по файлу при открытии.
+    int64_t frameDurationUs = 1000000 / (fps > 0 ? fps : kDefaultFps);
+    size_t minNalSize = codec_ == RTPPayloadCodec::H264 ? 1 : 3;
+
+    size_t offset = 0;
+    const uint8_t* nal = nullptr;
+    size_t nalSize = 0;
+    size_t unitStart = SIZE_MAX;
+    bool haveVcl = false;
+    bool keyframe = false;
+    auto addSample = [&](size_t end) {
+        int64_t timeUs = static_cast<int64_t>(samples_.size()) * frameDurationUs;
+        samples_.push_back({unitStart, static_cast<uint32_t>(end - unitStart), timeUs, timeUs, keyframe});
+    };
+
+    while (annexb_next_nal(data_, size_, offset, nal, nalSize)) {
+        if (nalSize < minNalSize) continue;
+
+        // Начало стартового кода NAL-единицы (3 или 4 байта)
+        size_t nalStart = static_cast<size_t>(nal - data_) - 3;
+        if (nalStart > 0 && data_[nalStart - 1] == 0) nalStart--;
+
+        int type = nalType(nal);
+        if (haveVcl && starts_access_unit(codec_, type, nal, nalSize)) {
+            addSample(nalStart);
+            unitStart = nalStart;
+            haveVcl = false;
+            keyframe = false;
+        } else if (unitStart == SIZE_MAX) {
+            unitStart = nalStart;
+        }
+        haveVcl = haveVcl || is_vcl(codec_, type);
+        keyframe = keyframe || isKeyframeNal(type);
+    }
+    if (haveVcl) {
+        addSample(size_);
+    }
+
+    durationUs_ = static_cast<int64_t>(samples_.size()) * frameDurationUs;
+}
+
+bool MediaFile::parseDecoderConfiguration(const uint8_t* data, size_t size) {
+    const uint8_t* end = data + size;
+    const uint8_t* p;
+    auto copyNals = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            if (end - p < 2) return false;
+            size_t length = read_u16(p);
+            p += 2;
+            if (length > static_cast<size_t>(end - p)) return false;
+            append_annexb_nal(parameterSets_, p, length);
+            p += length;
+        }
+        return true;
+    };
+
+    if (codec_ == RTPPayloadCodec::H264) {
+        // avcC (ISO/IEC 14496-15, 5.3.3.1)
+        if (size < 7) return false;
+        nalLengthSize_ = (data[4] & 0x03) + 1;
+        p = data + 6;
+        if (!copyNals(data[5] & 0x1F) || p >= end) return false;
+        int ppsCount = *p++;
+        return copyNals(ppsCount);
+    }
+
+    // hvcC (ISO/IEC 14496-15, 8.3.3.1): массивы VPS, SPS, PPS, SEI
+    if (size < 23) return false;
+    nalLengthSize_ = (data[21] & 0x03) + 1;
+    p = data + 23;
+    for (int i = 0; i < data[22]; i++) {
+        if (end - p < 3) return false;
+        int count = read_u16(p + 1);
+        p += 3;
+        if (!copyNals(count)) return false;
+    }
+    return true;
+}
+
+bool MediaFile::parseMp4(std::string& error) {
+    Box moov;
+    if (!find_box(data_, size_, fourcc("moov"), moov)) {
+        error = "MP4 without moov box (fragmented or incomplete file)";
+        return false;
+    }
+
+    // Первая видеодорожка H.264/H.265
+    Box stbl = {};
+    uint64_t timescale = 0;
+    const uint8_t* trakCursor = moov.data;
+    Box trak;
+    while (codec_ == RTPPayloadCodec::Unknown && next_box(trakCursor, moov.data + moov.size, trak)) {
+        Box mdia, hdlr, mdhd, minf, stsd;
+        if (trak.type != fourcc("trak") || !find_box(trak.data, trak.size, fourcc("mdia"), mdia) ||
+            !find_box(mdia.data, mdia.size, fourcc("hdlr"), hdlr) || hdlr.size < 12 ||
+            read_u32(hdlr.data + 8) != fourcc("vide") ||
+            !find_box(mdia.data, mdia.size, fourcc("mdhd"), mdhd) || mdhd.size < 24 ||
+            !find_box(mdia.data, mdia.size, fourcc("minf"), minf) ||
+            !find_box(minf.data, minf.size, fourcc("stbl"), stbl) ||
+            !find_box(stbl.data, stbl.size, fourcc("stsd"), stsd) || stsd.size < 8) {
+            continue;
+        }
+        timescale = mdhd.data[0] == 1 ? read_u32(mdhd.data + 20) : read_u32(mdhd.data + 12);
+
+        // Описание кодека: VisualSampleEntry (78 байт) и вложенный avcC/hvcC
+        const uint8_t* entryCursor = stsd.data + 8;
+        Box entry, config;
+        if (!next_box(entryCursor, stsd.data + stsd.size, entry) || entry.size < 78) continue;
+        uint32_t configType;
+        if (entry.type == fourcc("avc1") || entry.type == fourcc("avc3")) {
+            codec_ = RTPPayloadCodec::H264;
+            configType = fourcc("avcC");
+        } else if (entry.type == fourcc("hvc1") || entry.type == fourcc("hev1")) {
+            codec_ = RTPPayloadCodec::H265;
+            configType = fourcc("hvcC");
+        } else {
+            continue;
+        }
+        width_ = read_u16(entry.data + 24);
+        height_ = read_u16(entry.data + 26);
+        if (!find_box(entry.data + 78, entry.size - 78, configType, config) ||
+            !parseDecoderConfiguration(config.data, config.size)) {
+            error = "Invalid decoder configuration in MP4 video track";
+            return false;
+        }
+    }
+    if (codec_ == RTPPayloadCodec::Unknown || timescale == 0) {
+        error = "No H.264/H.265 video track in MP4";
+        return false;
+    }
+
+    Box stsz, stsc, stts, chunkBox;
+    bool largeOffsets = false;
+    uint32_t sampleCount = 0, stscCount = 0, sttsCount = 0, chunkCount = 0;
+    if (!find_box(stbl.data, stbl.size, fourcc("stco"), chunkBox)) {
+        largeOffsets = find_box(stbl.data, stbl.size, fourcc("co64"), chunkBox);
+        if (!largeOffsets) chunkBox.size = 0;
+    }
+    if (!find_box(stbl.data, stbl.size, fourcc("stsz"), stsz) || stsz.size < 12 ||
+        !find_box(stbl.data, stbl.size, fourcc("stsc"), stsc) || !table_entries(stsc, 8, 12, stscCount) ||
+        !find_box(stbl.data, stbl.size, fourcc("stts"), stts) || !table_entries(stts, 8, 8, sttsCount) ||
+        !table_entries(chunkBox, 8, largeOffsets ? 8 : 4, chunkCount)) {
+        error = "Incomplete MP4 sample table";
+        return false;
+    }
+
+    uint32_t fixedSize = read_u32(stsz.data + 4);
+    sampleCount = read_u32(stsz.data + 8);
+    if (fixedSize == 0 && sampleCount > (stsz.size - 12) / 4) {
+        error = "Incomplete MP4 sample table";
+        return false;
+    }
+    samples_.resize(sampleCount);
+
+    // Размеры и смещения: кадры лежат в чанках подряд, stsc задает число кадров в чанке
+    size_t index = 0;
+    for (uint32_t e = 0; e < stscCount && index < sampleCount; e++) {
+        const uint8_t* record = stsc.data + 8 + e * 12;
+        uint64_t firstChunk = read_u32(record);
+        uint32_t perChunk = read_u32(record + 4);
+        uint64_t nextFirst = e + 1 < stscCount ? read_u32(record + 12) : uint64_t(chunkCount) + 1;
+        for (uint64_t chunk = std::max<uint64_t>(firstChunk, 1); chunk < nextFirst && chunk <= chunkCount; chunk++) {
+            uint64_t offset = largeOffsets ? read_u64(chunkBox.data + 8 + (chunk - 1) * 8)
+                                           : read_u32(chunkBox.data + 8 + (chunk - 1) * 4);
+            for (uint32_t i = 0; i < perChunk && index < sampleCount; i++, index++) {
+                uint32_t size = fixedSize ? fixedSize : read_u32(stsz.data + 12 + index * 4);
+                samples_[index].offset = offset;
+                samples_[index].size = size;
+                samples_[index].keyframe = true;
+                offset += size;
+            }
+        }
+    }
+    samples_.resize(index);
+
+    // Время декодирования (stts) и сдвиг показа (ctts, версия 1 - со знаком)
+    int64_t decodeTime = 0;
+    int64_t lastDelta = 0;
+    index = 0;
+    for (uint32_t e = 0; e < sttsCount; e++) {
+        uint32_t count = read_u32(stts.data + 8 + e * 8);
+        lastDelta = read_u32(stts.data + 12 + e * 8);
+        for (uint32_t i = 0; i < count && index < samples_.size(); i++, index++) {
+            samples_[index].decodeTimeUs = to_us(decodeTime, timescale);
+            samples_[index].presentationTimeUs = samples_[index].decodeTimeUs;
+            decodeTime += lastDelta;
+        }
+    }
+    samples_.resize(index);
+    durationUs_ = to_us(decodeTime, timescale);
+
+    Box ctts;
+    uint32_t cttsCount = 0;
+    if (find_box(stbl.data, stbl.size, fourcc("ctts"), ctts) && table_entries(ctts, 8, 8, cttsCount)) {
+        index = 0;
+        for (uint32_t e = 0; e < cttsCount && index < samples_.size(); e++) {
+            uint32_t count = read_u32(ctts.data + 8 + e * 8);
+            int32_t shift = static_cast<int32_t>(read_u32(ctts.data + 12 + e * 8));
+            for (uint32_t i = 0; i < count && index < samples_.size(); i++, index++) {
+                samples_[index].presentationTimeUs = samples_[index].decodeTimeUs + to_us(shift, timescale);
+            }
+        }
+    }
+
+    // Ключевые кадры (stss); без таблицы ключевые все кадры
+    Box stss;
+    uint32_t stssCount = 0;
+    if (find_box(stbl.data, stbl.size, fourcc("stss"), stss) && table_entries(stss, 8, 4, stssCount)) {
+        for (MediaSample& sample : samples_) {
+            sample.keyframe = false;
+        }
+        for (uint32_t e = 0; e < stssCount; e++) {
+            uint32_t number = read_u32(stss.data + 8 + e * 4);
+            if (number >= 1 && number <= samples_.size()) {
+                samples_[number - 1].keyframe = true;
+            }
+        }
+    }
+
+    // Обрезанный файл (запись прервана): индекс до первого кадра за концом данных
+    for (size_t i = 0; i < samples_.size(); i++) {
+        if (samples_[i].offset > size_ || samples_[i].size > size_ - samples_[i].offset) {
+            samples_.resize(i);
+            durationUs_ = i > 0 ? samples_[i - 1].decodeTimeUs + to_us(lastDelta, timescale) : 0;
+            break;
+        }
+    }
+    return true;
+}
+
+bool MediaFile::parseMatroska(std::string& error) {
+    const uint8_t* end = data_ + size_;
+    const uint8_t* cursor = data_;
+    Element element;
+    if (!next_element(cursor, end, element) || element.id != kEbmlHeader ||
+        !next_element(cursor, end, element) || element.id != kMkvSegment) {
+        error = "Invalid Matroska header";
+        return false;
+    }
+
+    uint64_t timestampScale = kMkvDefaultTimestampScale;
+    uint64_t videoTrack = 0;
+    std::vector<int64_t> presentationTimes;
+
+    // Блок кадра: [номер дорожки vint][время int16 от кластера][флаги][данные]
+    auto addBlock = [&](const Element& block, int64_t clusterTime, bool simple, bool hasReference) {
+        const uint8_t* p = block.data;
+        const uint8_t* blockEnd = block.data + block.size;
+        uint64_t track = 0;
+        bool unknown = false;
+        if (!read_ebml_vint(p, blockEnd, track, unknown) || track != videoTrack || blockEnd - p < 3) {
+            return;
+        }
+        int16_t relativeTime = static_cast<int16_t>(read_u16(p));
+        uint8_t flags = p[2];
+        p += 3;
+        // Лейсинг (несколько кадров в блоке) для видео не используется
+        if ((flags & 0x06) != 0 || p == blockEnd) return;
+
+        MediaSample sample;
+        sample.offset = static_cast<uint64_t>(p - data_);
+        sample.size = static_cast<uint32_t>(blockEnd - p);
+        sample.keyframe = simple ? (flags & 0x80) != 0 : !hasReference;
+        sample.decodeTimeUs = 0;
+        int64_t time = clusterTime + relativeTime;
+        sample.presentationTimeUs = time * static_cast<int64_t>(timestampScale) / 1000;
+        samples_.push_back(sample);
+        presentationTimes.push_back(sample.presentationTimeUs);
+    };
+
+    const uint8_t* segmentEnd = element.data + element.size;
+    cursor = element.data;
+    while (next_element(cursor, segmentEnd, element)) {
+        if (element.id == kMkvInfo) {
+            const uint8_t* p = element.data;
+            Element child;
+            while (next_element(p, element.data + element.size, child)) {
+                if (child.id == kMkvTimestampScale && ebml_uint(child) > 0) {
+                    timestampScale = ebml_uint(child);
+                }
+            }
+        } else if (element.id == kMkvTracks && videoTrack == 0) {
+            const uint8_t* p = element.data;
+            Element entry;
+            while (videoTrack == 0 && next_element(p, element.data + element.size, entry)) {
+                if (entry.id != kMkvTrackEntry) continue;
+
+                uint64_t number = 0, type = 0;
+                std::string codecId;
+                Element codecPrivate = {};
+                int width = 0, height = 0;
+                const uint8_t* q = entry.data;
+                Element field;
+                while (next_element(q, entry.data + entry.size, field)) {
+                    if (field.id == kMkvTrackNumber) number = ebml_uint(field);
+                    if (field.id == kMkvTrackType) type = ebml_uint(field);
+                    if (field.id == kMkvCodecId) codecId.assign(reinterpret_cast<const char*>(field.data), field.size);
+                    if (field.id == kMkvCodecPrivate) codecPrivate = field;
+                    if (field.id == kMkvVideo) {
+                        const uint8_t* v = field.data;
+                        Element dimension;
+                        while (next_element(v, field.data + field.size, dimension)) {
+                            if (dimension.id == kMkvPixelWidth) width = static_cast<int>(ebml_uint(dimension));
+                            if (dimension.id == kMkvPixelHeight) height = static_cast<int>(ebml_uint(dimension));
+                        }
+                    }
+                }
+                codecId = codecId.c_str();     // Строки EBML дополняются нулями
+
+                if (type != kMkvTrackTypeVideo || number == 0) continue;
+                if (codecId == "V_MPEG4/ISO/AVC") {
+                    codec_ = RTPPayloadCodec::H264;
+                } else if (codecId == "V_MPEGH/ISO/HEVC") {
+                    codec_ = RTPPayloadCodec::H265;
+                } else {
+                    continue;
+                }
+                if (!codecPrivate.data || !parseDecoderConfiguration(codecPrivate.data, codecPrivate.size)) {
+                    error = "Invalid CodecPrivate in Matroska video track";
+                    return false;
+                }
+                videoTrack = number;
+                width_ = width;
+                height_ = height;
+            }
+        } else if (element.id == kMkvCluster) {
+            // Кластер неизвестного размера заканчивается следующим элементом сегмента
+            const uint8_t* p = element.data;
+            const uint8_t* clusterEnd = element.data + element.size;
+            int64_t clusterTime = 0;
+            Element child;
+            const uint8_t* childStart = p;
+            while (next_element(p, clusterEnd, child)) {
+                if (element.unknownSize && is_segment_child(child.id)) {
+                    p = childStart;
+                    break;
+                }
+                if (child.id == kMkvClusterTimestamp) {
+                    clusterTime = static_cast<int64_t>(ebml_uint(child));
+                } else if (child.id == kMkvSimpleBlock && videoTrack != 0) {
+                    addBlock(child, clusterTime, true, false);
+                } else if (child.id == kMkvBlockGroup && videoTrack != 0) {
+                    Element block = {}, groupChild;
+                    bool hasReference = false;
+                    const uint8_t* g = child.data;
+                    while (next_element(g, child.data + child.size, groupChild)) {
+                        if (groupChild.id == kMkvBlock) block = groupChild;
+                        if (groupChild.id == kMkvReferenceBlock) hasReference = true;
+                    }
+                    if (block.data) addBlock(block, clusterTime, false, hasReference);
+                }
+                childStart = p;
+            }
+            if (element.unknownSize) cursor = p;
+        } else if (element.unknownSize) {
+            // Иной элемент без размера пропустить нельзя
+            break;
+        }
+    }
+
+    if (videoTrack == 0) {
+        error = "No H.264/H.265 video track in Matroska";
+        return false;
+    }
+    if (samples_.empty()) return true;
+
+    // В Matroska хранится только время показа. Время декодирования - те же
+    // значения по возрастанию: кадры идут в порядке декодирования, а при
+    // B-кадрах i-й кадр декодируется не позже i-го по порядку показа.
+    std::sort(presentationTimes.begin(), presentationTimes.end());
+    int64_t start = presentationTimes.front();
+    for (size_t i = 0; i < samples_.size(); i++) {
+        samples_[i].decodeTimeUs = presentationTimes[i] - start;
+        samples_[i].presentationTimeUs -= start;
+    }
+    int64_t span = presentationTimes.back() - start;
+    int64_t frameDurationUs = samples_.size() > 1 ? span / static_cast<int64_t>(samples_.size() - 1)
+                                                  : 1000000 / kDefaultFps;
+    durationUs_ = span + frameDurationUs;
+    return true;
+}
+
+bool MediaFile::needsParameterSets(const MediaSample& sample) const {
+    if (!sample.keyframe || nalLengthSize_ == 0 || parameterSets_.empty()) return false;
+
+    bool inBand = false;
+    int spsType = codec_ == RTPPayloadCodec::H264 ? kH264NalSps : kH265NalSps;
+    for_each_prefixed_nal(data_ + sample.offset, sample.size, nalLengthSize_,
+                          [&](const uint8_t* nal, size_t) { inBand = inBand || nalType(nal) == spsType; });
+    return !inBand;
+}
+
+size_t MediaFile::frameSize(const MediaSample& sample) const {
+    if (nalLengthSize_ == 0) return sample.size;
+
+    size_t size = needsParameterSets(sample) ? parameterSets_.size() : 0;
+    for_each_prefixed_nal(data_ + sample.offset, sample.size, nalLengthSize_,
+                          [&](const uint8_t*, size_t length) { size += sizeof(kStartCode) + length; });
+    return size;
+}
+
+size_t MediaFile::writeFrame(const MediaSample& sample, uint8_t* output) const {
+    if (nalLengthSize_ == 0) {
+        memcpy(output, data_ + sample.offset, sample.size);
+        return sample.size;
+    }
+
+    uint8_t* p = output;
+    if (needsParameterSets(sample)) {
+        memcpy(p, parameterSets_.data(), parameterSets_.size());
+        p += parameterSets_.size();
+    }
+    for_each_prefixed_nal(data_ + sample.offset, sample.size, nalLengthSize_,
+                          [&](const uint8_t* nal, size_t length) {
+        memcpy(p, kStartCode, sizeof(kStartCode));
+        memcpy(p + sizeof(kStartCode), nal, length);
+        p += sizeof(kStartCode) + length;
+    });
+    return static_cast<size_t>(p - output);
+}
@@ -0,0 +1,94 @@
+#ifndef MEDIA_FILE_H
+#define MEDIA_FILE_H
+
+#include "rtp_depacketizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Кадр файла: положение данных в отображении файла и время кадра
+struct MediaSample {
+    uint64_t offset;
+    uint32_t size;
+    int64_t decodeTimeUs;       // Время от начала файла в порядке декодирования (темп выдачи)
+    int64_t presentationTimeUs; // Время показа (отличается от decodeTimeUs при B-кадрах)
+    bool keyframe;
+};
+
+// Видеофайл, отображенный в память (mmap): элементарный поток H.264/H.265
+// (Annex-B), MP4/MOV (ISO BMFF без фрагментов) и Matroska/WebM.
+// При открытии строится только индекс кадров, данные не копируются: кадр
+// читается из отображения в момент выдачи сразу в буфер получателя
+// (writeFrame), страницы подгружает ядро по мере чтения.
+// Кадры выдаются в Annex-B, как от камеры: длины NAL-единиц MP4/MKV
+// заменяются стартовыми кодами, перед ключевым кадром вставляются наборы
+// параметров из avcC/hvcC, если их нет в самом кадре.
+// После открытия объект только читается и доступен из любого потока.
+class MediaFile {
+public:
+    enum class Container {
+        None,
+        AnnexB,
+        Mp4,
+        Matroska
+    };
+
+    static const int kDefaultFps = 25;
+
+    MediaFile();
+    ~MediaFile();
+
+    MediaFile(const MediaFile&) = delete;
+    MediaFile& operator=(const MediaFile&) = delete;
+
+    // Открытие файла. Формат определяется по содержимому, кодек элементарного
+    // потока - по расширению (.h265/.265/.hevc) или по первой NAL-единице.
+    // fps - частота кадров элементарного потока (времени в нем нет), 0 - 25.
+    bool open(const std::string& path, int fps, std::string& error);
+    void close();
+
+    bool isOpen() const { return data_ != nullptr; }
+    Container container() const { return container_; }
+    RTPPayloadCodec codec() const { return codec_; }
+    int width() const { return width_; }        // 0 - неизвестно (элементарный поток)
+    int height() const { return height_; }
+
+    size_t sampleCount() const { return samples_.size(); }
+    const MediaSample& sample(size_t index) const { return samples_[index]; }
+
+    // Длительность: время последнего кадра плюс длительность кадра
+    int64_t durationUs() const { return durationUs_; }
+
+    // Наборы параметров из заголовка контейнера в Annex-B (пусто для элементарного потока)
+    const std::vector<uint8_t>& parameterSets() const { return parameterSets_; }
+
+    // Размер кадра в Annex-B
+    size_t frameSize(const MediaSample& sample) const;
+
+    // Запись кадра в Annex-B в output (не меньше frameSize байт). Возвращает размер.
+    size_t writeFrame(const MediaSample& sample, uint8_t* output) const;
+
+private:
+    void parseAnnexB(const std::string& path, int fps);
+    bool parseMp4(std::string& error);
+    bool parseMatroska(std::string& error);
+    bool parseDecoderConfiguration(const uint8_t* data, size_t size);
+    bool needsParameterSets(const MediaSample& sample) const;
+    bool isKeyframeNal(int type) const;
+    int nalType(const uint8_t* nal) const;
+
+    uint8_t* data_;
+    size_t size_;
+
+    Container container_;
+    RTPPayloadCodec codec_;
+    int width_;
+    int height_;
+    int nalLengthSize_;                     // Размер длины NAL-единицы MP4/MKV, 0 - Annex-B
+    std::vector<uint8_t> parameterSets_;
+    std::vector<MediaSample> samples_;
+    int64_t durationUs_;
+};
+
+#endif // MEDIA_FILE_H
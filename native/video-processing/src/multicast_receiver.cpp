@@ -0,0 +1,351 @@
+#include "multicast_receiver.h"
+#include "rtp_reactor.h"
+#include <cstring>
+
+#ifdef _WIN32
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+// Максимальное число датаграмм, читаемых из сокета группы за одно событие
+const int kMaxDatagramsPerWakeup = 64;
+
+const UDPSocket kInvalidSocket = static_cast<UDPSocket>(-1);
+
+void close_socket(UDPSocket sock) {
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+bool parse_ipv4(const std::string& address, struct in_addr& out) {
+    return !address.empty() && inet_pton(AF_INET, address.c_str(), &out) == 1;
+}
+
+// Членство в группе на интерфейсе (INADDR_ANY - интерфейс по маршруту)
+bool build_membership(const std::string& group, const std::string& interfaceAddress, struct ip_mreq& mreq) {
+    memset(&mreq, 0, sizeof(mreq));
+    if (!parse_ipv4(group, mreq.imr_multiaddr)) return false;
+    if (interfaceAddress.empty()) {
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        return true;
+    }
+    return parse_ipv4(interfaceAddress, mreq.imr_interface);
+}
+
+} // namespace
+
+bool multicast_is_group_address(const std::string& address) {
+    struct in_addr addr;
+    if (!parse_ipv4(address, addr)) return false;
+    return (ntohl(addr.s_addr) & 0xF0000000u) == 0xE0000000u;
+}
+
+UDPSocket multicast_open_socket(const std::string& group, int port, const std::string& interfaceAddress) {
+    struct ip_mreq mreq;
+    if (port <= 0 || port > 65535 || !multicast_is_group_address(group) ||
+        !build_membership(group, interfaceAddress, mreq)) {
+        return kInvalidSocket;
+    }
+
+    UDPSocket sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == kInvalidSocket) {
+        return kInvalidSocket;
+    }
+
+    // Порт группы могут слушать и другие процессы узла
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+#ifdef _WIN32
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+#else
+    // Привязка к адресу группы: датаграммы других групп на том же порту не принимаются
+    addr.sin_addr = mreq.imr_multiaddr;
+#endif
+
+    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                   reinterpret_cast<const char*>(&mreq), sizeof(mreq)) != 0) {
+        close_socket(sock);
+        return kInvalidSocket;
+    }
+
+    // RTCP отчеты в группу уходят через тот же интерфейс
+    if (!interfaceAddress.empty()) {
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF,
+                   reinterpret_cast<const char*>(&mreq.imr_interface), sizeof(mreq.imr_interface));
+    }
+
+    return sock;
+}
+
+void multicast_close_socket(UDPSocket sock, const std::string& group, const std::string& interfaceAddress) {
+    if (sock == kInvalidSocket) return;
+
+    struct ip_mreq mreq;
+    if (build_membership(group, interfaceAddress, mreq)) {
+        setsockopt(sock, IPPROTO_IP, IP_DROP_MEMBERSHIP, reinterpret_cast<const char*>(&mreq), sizeof(mreq));
+    }
+    close_socket(sock);
+}
+
+MulticastReceiver& MulticastReceiver::instance() {
+    static MulticastReceiver receiver;
+    return receiver;
+}
+
+bool MulticastReceiver::isSupported() {
+    return RTPReactor::isSupported();
+}
+
+MulticastReceiver::MulticastReceiver() : nextSubscription_(1), datagrams_(0), deliveries_(0) {}
+
+uint64_t MulticastReceiver::subscribe(const std::string& group, int port, const std::string& interfaceAddress,
+                                      uint64_t reactorKey, PacketHandler handler, void* context) {
+    if (!handler || !isSupported()) return 0;
+
+    RTPReactor& reactor = RTPReactor::instance();
+    if (!reactor.isRunning() && !reactor.start(0)) return 0;
+
+    std::string groupKey = group + ":" + std::to_string(port) + "@" + interfaceAddress;
+    std::shared_ptr<Group> entry;
+    bool created = false;
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = groups_.find(groupKey);
+        if (it != groups_.end()) {
+            entry = it->second;
+        } else {
+            UDPSocket sock = multicast_open_socket(group, port, interfaceAddress);
+            if (sock == kInvalidSocket) return 0;
+
+            entry = std::make_shared<Group>();
+            entry->key = groupKey;
+            entry->address = group;
+            entry->interfaceAddress = interfaceAddress;
+            entry->sock = sock;
+            entry->pendingSubscribers = 0;
+            entry->requestedBuffer = 0;
+            entry->receiveBufferBytes = 0;
+            entry->kernelDrops.store(0);
+            entry->prunePending = false;
+            UDPBatchReceiver::enableDropCounter(sock);
+            groups_[groupKey] = entry;
+            created = true;
+        }
+
+        id = nextSubscription_++;
+        subscriptions_[id] = entry;
+        // Группа не закрывается, пока подписчик не добавлен
+        entry->pendingSubscribers++;
+    }
+
+    Subscriber subscriber = {id, handler, context, true};
+    if (entry->dispatchThread.load() == std::this_thread::get_id()) {
+        // Подписка из обработчика этой группы: мьютекс группы уже захвачен
+        entry->subscribers.push_back(subscriber);
+    } else {
+        std::lock_guard<std::mutex> groupLock(entry->mutex);
+        entry->subscribers.push_back(subscriber);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entry->pendingSubscribers--;
+    }
+
+    if (created && !reactor.registerSocket(static_cast<int>(entry->sock), reactorKey, onGroupReady, entry.get())) {
+        unsubscribe(id);
+        return 0;
+    }
+    return id;
+}
+
+bool MulticastReceiver::releaseIfEmptyLocked(Group& group) {
+    if (!group.subscribers.empty()) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (group.pendingSubscribers > 0) return false;
+
+    auto it = groups_.find(group.key);
+    if (it != groups_.end() && it->second.get() == &group) {
+        groups_.erase(it);
+    }
+    return true;
+}
+
+void MulticastReceiver::unsubscribe(uint64_t subscription) {
+    std::shared_ptr<Group> group;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = subscriptions_.find(subscription);
+        if (it == subscriptions_.end()) return;
+        group = it->second;
+        subscriptions_.erase(it);
+
+        if (group->dispatchThread.load() == std::this_thread::get_id()) {
+            // Вызов из обработчика группы: подписчик удаляется после выдачи пачки
+            for (auto& subscriber : group->subscribers) {
+                if (subscriber.id == subscription) subscriber.active = false;
+            }
+            group->prunePending = true;
+            return;
+        }
+    }
+
+    bool empty;
+    {
+        // Ожидание завершения выдачи пачки, в которой подписчик мог участвовать
+        std::lock_guard<std::mutex> groupLock(group->mutex);
+        for (auto it = group->subscribers.begin(); it != group->subscribers.end(); ++it) {
+            if (it->id == subscription) {
+                group->subscribers.erase(it);
+                break;
+            }
+        }
+        empty = releaseIfEmptyLocked(*group);
+    }
+
+    if (empty) {
+        closeGroup(group);
+    }
+}
+
+void MulticastReceiver::closeGroup(const std::shared_ptr<Group>& group) {
+    RTPReactor::instance().unregisterSocket(static_cast<int>(group->sock));
+    multicast_close_socket(group->sock, group->address, group->interfaceAddress);
+    group->sock = kInvalidSocket;
+}
+
+void MulticastReceiver::onGroupReady(int fd, void* context) {
+    (void)fd;
+    // Ссылка удерживает группу, если последний подписчик уйдет из обработчика
+    std::shared_ptr<Group> group = static_cast<Group*>(context)->shared_from_this();
+    MulticastReceiver& receiver = instance();
+    receiver.dispatch(*group);
+    if (group->prunePending) {
+        receiver.prune(group);
+    }
+}
+
+void MulticastReceiver::dispatch(Group& group) {
+    UDPBatchReceiver& batch = UDPBatchReceiver::forCurrentThread();
+
+    std::lock_guard<std::mutex> groupLock(group.mutex);
+    group.dispatchThread.store(std::this_thread::get_id());
+
+    uint64_t delivered = 0;
+    int total = 0;
+    while (total < kMaxDatagramsPerWakeup) {
+        int count = batch.receive(group.sock);
+        if (count <= 0) break;
+
+        for (int i = 0; i < count; i++) {
+            const UDPDatagram& datagram = batch.datagram(i);
+            if (datagram.truncated) continue;
+
+            // Обработчик может добавить подписчика: индекс вместо итератора
+            for (size_t s = 0; s < group.subscribers.size(); s++) {
+                if (!group.subscribers[s].active) continue;
+                PacketHandler handler = group.subscribers[s].handler;
+                void* context = group.subscribers[s].context;
+                handler(datagram.data, datagram.size, context);
+                delivered++;
+            }
+        }
+
+        uint32_t drops;
+        if (batch.dropCounter(drops)) {
+            group.kernelDrops.store(drops, std::memory_order_relaxed);
+        }
+        datagrams_.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+        total += count;
+        if (count < UDPBatchReceiver::kMaxBatch) break;
+    }
+
+    deliveries_.fetch_add(delivered, std::memory_order_relaxed);
+    group.dispatchThread.store(std::thread::id());
+}
+
+void MulticastReceiver::prune(const std::shared_ptr<Group>& group) {
+    bool empty;
+    {
+        std::lock_guard<std::mutex> groupLock(group->mutex);
+        group->prunePending = false;
+        auto& subscribers = group->subscribers;
+        for (size_t i = 0; i < subscribers.size();) {
+            if (!subscribers[i].active) {
+                subscribers.erase(subscribers.begin() + static_cast<std::ptrdiff_t>(i));
+            } else {
+                i++;
+            }
+        }
+        empty = releaseIfEmptyLocked(*group);
+    }
+
+    // Из потока реактора снятие сокета не ждет окончания итерации
+    if (empty) {
+        closeGroup(group);
+    }
+}
+
+bool MulticastReceiver::send(uint64_t subscription, int port, int ttl, const uint8_t* data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscriptions_.find(subscription);
+    if (it == subscriptions_.end() || port <= 0 || port > 65535) return false;
+
+    const Group& group = *it->second;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (!parse_ipv4(group.address, addr.sin_addr)) return false;
+
+    if (ttl > 0) {
+        int value = ttl;
+        setsockopt(group.sock, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    return sendto(group.sock, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+                  reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == static_cast<int>(size);
+}
+
+int MulticastReceiver::setReceiveBufferSize(uint64_t subscription, int bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscriptions_.find(subscription);
+    if (it == subscriptions_.end()) return 0;
+
+    Group& group = *it->second;
+    if (bytes > group.requestedBuffer) {
+        group.requestedBuffer = bytes;
+        group.receiveBufferBytes = UDPBatchReceiver::setReceiveBufferSize(group.sock, bytes);
+    }
+    return group.receiveBufferBytes;
+}
+
+uint64_t MulticastReceiver::kernelDrops(uint64_t subscription) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscriptions_.find(subscription);
+    if (it == subscriptions_.end()) return 0;
+    return it->second->kernelDrops.load(std::memory_order_relaxed);
+}
+
+void MulticastReceiver::getStats(Stats& stats) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.groups = static_cast<int>(groups_.size());
+    stats.subscribers = static_cast<int>(subscriptions_.size());
+    stats.datagrams = datagrams_.load(std::memory_order_relaxed);
+    stats.deliveries = deliveries_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,117 @@
+#ifndef MULTICAST_RECEIVER_H
+#define MULTICAST_RECEIVER_H
+
+#include "udp_batch_receiver.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Сокет, привязанный к порту группы и присоединенный к ней (IP_ADD_MEMBERSHIP).
+// interfaceAddress - адрес локального интерфейса ("" - выбор по маршруту).
+// Возвращает сокет или -1 (INVALID_SOCKET) при ошибке.
+UDPSocket multicast_open_socket(const std::string& group, int port, const std::string& interfaceAddress);
+
+// Выход из группы и закрытие сокета
+void multicast_close_socket(UDPSocket sock, const std::string& group, const std::string& interfaceAddress);
+
+// Проверка, что адрес - IPv4 multicast (224.0.0.0/4)
+bool multicast_is_group_address(const std::string& address);
+
+// Общий для процесса прием multicast RTP/RTCP.
+// На каждую пару (группа, порт, интерфейс) открывается один сокет, который
+// обслуживается общим реактором (RTPReactor). Датаграммы читаются в буферы
+// потока реактора один раз и передаются всем локальным подписчикам, поэтому
+// сколько бы клиентов ни смотрели одну камеру, ядро копирует пакет один раз.
+// Доступен там же, где реактор; на других платформах клиент открывает
+// собственный сокет группы (multicast_open_socket).
+class MulticastReceiver {
+public:
+    // Обработчик датаграммы (поток реактора). Данные действительны до возврата.
+    typedef void (*PacketHandler)(const uint8_t* data, int size, void* context);
+
+    struct Stats {
+        int groups;             // Открытые сокеты групп
+        int subscribers;
+        uint64_t datagrams;     // Принято из сети
+        uint64_t deliveries;    // Передано подписчикам
+    };
+
+    static MulticastReceiver& instance();
+
+    static bool isSupported();
+
+    // Подписка на датаграммы группы. reactorKey закрепляет сокет новой группы
+    // за потоком реактора: подписчики, передающие один ключ (например, адрес
+    // камеры), получают все свои группы в одном потоке.
+    // Возвращает идентификатор подписки (0 - ошибка).
+    uint64_t subscribe(const std::string& group, int port, const std::string& interfaceAddress,
+                       uint64_t reactorKey, PacketHandler handler, void* context);
+
+    // Отмена подписки. После возврата обработчик подписки не выполняется и не
+    // будет вызван; из обработчика той же группы отмена вступает в силу после
+    // его возврата. Последний подписчик закрывает сокет группы.
+    void unsubscribe(uint64_t subscription);
+
+    // Отправка датаграммы в группу подписки на указанный порт (RTCP отчеты)
+    bool send(uint64_t subscription, int port, int ttl, const uint8_t* data, size_t size);
+
+    // Приемный буфер сокета группы общий: он увеличивается до наибольшего
+    // запрошенного подписчиками размера. Возвращает фактический размер.
+    int setReceiveBufferSize(uint64_t subscription, int bytes);
+
+    // Датаграммы группы, отброшенные ядром при переполнении буфера сокета
+    uint64_t kernelDrops(uint64_t subscription) const;
+
+    void getStats(Stats& stats) const;
+
+private:
+    MulticastReceiver();
+    MulticastReceiver(const MulticastReceiver&) = delete;
+    MulticastReceiver& operator=(const MulticastReceiver&) = delete;
+
+    struct Subscriber {
+        uint64_t id;
+        PacketHandler handler;
+        void* context;
+        bool active;
+    };
+
+    struct Group : std::enable_shared_from_this<Group> {
+        std::string key;
+        std::string address;
+        std::string interfaceAddress;
+        UDPSocket sock;
+        std::mutex mutex;               // Подписчики; удерживается на время выдачи пачки
+        std::vector<Subscriber> subscribers;
+        std::atomic<std::thread::id> dispatchThread;
+        int pendingSubscribers;         // Подписки, еще не добавленные в список (под mutex_)
+        int requestedBuffer;            // Наибольший запрошенный SO_RCVBUF (под mutex_)
+        int receiveBufferBytes;
+        std::atomic<uint32_t> kernelDrops;  // SO_RXQ_OVFL последней пачки
+        bool prunePending;              // Отмена подписки из обработчика группы
+    };
+
+    static void onGroupReady(int fd, void* context);
+    void dispatch(Group& group);
+    void prune(const std::shared_ptr<Group>& group);
+    // Удаление пустой группы из реестра (под Group::mutex). true - сокет нужно закрыть.
+    bool releaseIfEmptyLocked(Group& group);
+    void closeGroup(const std::shared_ptr<Group>& group);
+
+    // Порядок: Group::mutex -> mutex_ (обработчики вызываются под мьютексом
+    // группы и могут подписываться); под mutex_ мьютекс группы не захватывается
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<Group>> groups_;
+    std::map<uint64_t, std::shared_ptr<Group>> subscriptions_;
+    uint64_t nextSubscription_;
+    std::atomic<uint64_t> datagrams_;
+    std::atomic<uint64_t> deliveries_;
+};
+
+#endif // MULTICAST_RECEIVER_H
@@ -0,0 +1,445 @@
+#include "pipeline_shards.h"
+#include "frame_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Кадров одной очереди за проход: очереди шарда обслуживаются по очереди
+const int kMaxFramesPerLane = 8;
+
+// Период проверки очередей без пробуждения
+const std::chrono::milliseconds kIdleWait(100);
+
+// Допустимая разница нагрузки шардов (доля нагрузки наиболее загруженного):
+// меньшие колебания не стоят переноса очередей
+const uint64_t kImbalanceTolerance = 8;
+
+// Шард и очередь, обрабатываемые текущим потоком (nullptr - не поток шарда)
+thread_local const void* currentShard = nullptr;
+thread_local const PipelineLane* currentLane = nullptr;
+
+uint64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+// Список ядер в формате sysfs: "0-3,8-11"
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    const char* p = text.c_str();
+    while (*p) {
+        char* end;
+        long first = std::strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        while (*p == ',' || *p == '\n' || *p == ' ') p++;
+    }
+    return cpus;
+}
+
+// Узлы NUMA ядер (из /sys/devices/system/node)
+std::map<int, int> read_cpu_nodes() {
+    std::map<int, int> nodes;
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (!dir) return nodes;
+
+    while (struct dirent* entry = readdir(dir)) {
+        int node;
+        if (std::sscanf(entry->d_name, "node%d", &node) != 1) continue;
+
+        std::string path = std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist";
+        FILE* file = std::fopen(path.c_str(), "r");
+        if (!file) continue;
+        char buffer[4096];
+        size_t length = std::fread(buffer, 1, sizeof(buffer) - 1, file);
+        std::fclose(file);
+        buffer[length] = '\0';
+
+        for (int cpu : parse_cpu_list(buffer)) {
+            nodes[cpu] = node;
+        }
+    }
+    closedir(dir);
+    return nodes;
+}
+#endif
+
+} // namespace
+
+PipelineLane::PipelineLane(int capacity, RTSPFrameQueuePolicy policy, Handler handler, void* context)
+    : queue_(capacity, policy), handler_(handler), context_(context), owner_(nullptr), shardIndex_(-1),
+      detached_(false), frames_(0), busyNs_(0), balancedBusyNs_(0) {
+    queue_.open();
+}
+
+bool PipelineLane::push(RTSPFrame* frame) {
+    if (!queue_.push(frame)) {
+        return false;
+    }
+    PipelineShards* owner = owner_.load();
+    int shard = shardIndex_.load();
+    if (owner && shard >= 0) {
+        owner->wake(shard);
+    }
+    return true;
+}
+
+int PipelineLane::shard() const {
+    return shardIndex_.load();
+}
+
+std::vector<int> PipelineShards::shardCpus(bool numaAware, std::vector<int>* nodes) {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        int count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+        for (int cpu = 0; cpu < count; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    std::vector<int> cpuNodes(cpus.size(), -1);
+#ifdef __linux__
+    std::map<int, int> topology = read_cpu_nodes();
+    for (size_t i = 0; i < cpus.size(); i++) {
+        auto it = topology.find(cpus[i]);
+        if (it != topology.end()) cpuNodes[i] = it->second;
+    }
+
+    if (numaAware && !topology.empty()) {
+        // Ядра узлов поочередно: первые шарды занимают все узлы
+        std::map<int, std::vector<int>> byNode;
+        for (size_t i = 0; i < cpus.size(); i++) {
+            byNode[cpuNodes[i]].push_back(cpus[i]);
+        }
+        std::vector<int> ordered;
+        std::vector<int> orderedNodes;
+        for (size_t round = 0; ordered.size() < cpus.size(); round++) {
+            for (const auto& node : byNode) {
+                if (round < node.second.size()) {
+                    ordered.push_back(node.second[round]);
+                    orderedNodes.push_back(node.first);
+                }
+            }
+        }
+        cpus.swap(ordered);
+        cpuNodes.swap(orderedNodes);
+    }
+#else
+    (void)numaAware;
+#endif
+
+    if (nodes) {
+        nodes->swap(cpuNodes);
+    }
+    return cpus;
+}
+
+PipelineShards::PipelineShards(const Params& params) {
+    std::vector<int> nodes;
+    std::vector<int> cpus = shardCpus(params.numaAware, &nodes);
+    int count = params.shardCount > 0 ? params.shardCount : static_cast<int>(cpus.size());
+
+    for (int i = 0; i < count; i++) {
+        std::unique_ptr<Shard> shard(new Shard());
+        size_t slot = static_cast<size_t>(i) % cpus.size();
+        shard->index = i;
+        shard->cpu = params.pinThreads ? cpus[slot] : -1;
+        shard->numaNode = nodes[slot];
+        shard->pinned = false;
+        shard->lanes = std::make_shared<const LaneList>();
+        shard->stopping = false;
+        shard->pending = false;
+        shard->frames = 0;
+        shard->busyNs = 0;
+        shards_.push_back(std::move(shard));
+    }
+
+    for (auto& shard : shards_) {
+        shard->thread = std::thread(&PipelineShards::run, this, shard.get());
+    }
+}
+
+PipelineShards::~PipelineShards() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->stopping = true;
+        shard->condition.notify_all();
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+void PipelineShards::run(Shard* shard) {
+#ifdef __linux__
+    if (shard->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard->cpu, &set);
+        shard->pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+#endif
+    currentShard = shard;
+
+    for (;;) {
+        shard->pending = false;
+        std::shared_ptr<const LaneList> lanes;
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            if (shard->stopping) break;
+            lanes = shard->lanes;
+        }
+        if (drain(shard, *lanes)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        shard->condition.wait_for(lock, kIdleWait, [shard] {
+            return shard->pending.load() || shard->stopping;
+        });
+    }
+    currentShard = nullptr;
+}
+
+// Проход по очередям шарда: не больше kMaxFramesPerLane кадров каждой.
+// false - кадров не было.
+bool PipelineShards::drain(Shard* shard, const LaneList& lanes) {
+    bool worked = false;
+    for (const auto& lane : lanes) {
+        std::lock_guard<std::mutex> lock(lane->mutex_);
+        // Очередь отключена или перенесена после снимка списка
+        if (lane->detached_ || lane->shardIndex_ != shard->index) continue;
+
+        RTSPFrame* frame = lane->queue_.pop();
+        if (!frame) continue;
+
+        currentLane = lane.get();
+        uint64_t startNs = steady_now_ns();
+        int count = 0;
+        do {
+            lane->handler_(frame, lane->context_);
+            count++;
+            // Обработчик мог отключить свою очередь
+            if (lane->detached_ || count == kMaxFramesPerLane) break;
+        } while ((frame = lane->queue_.pop()) != nullptr);
+        uint64_t busyNs = steady_now_ns() - startNs;
+        currentLane = nullptr;
+
+        lane->frames_.fetch_add(count, std::memory_order_relaxed);
+        lane->busyNs_.fetch_add(busyNs, std::memory_order_relaxed);
+        shard->frames.fetch_add(count, std::memory_order_relaxed);
+        shard->busyNs.fetch_add(busyNs, std::memory_order_relaxed);
+        worked = true;
+    }
+    return worked;
+}
+
+void PipelineShards::wake(int index) {
+    Shard* shard = shards_[index].get();
+    // Шард уже разбужен и еще не просматривал очереди
+    if (shard->pending.exchange(true)) return;
+
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->condition.notify_one();
+}
+
+void PipelineShards::addLane(Shard* shard, const std::shared_ptr<PipelineLane>& lane) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto lanes = std::make_shared<LaneList>(*shard->lanes);
+    lanes->push_back(lane);
+    shard->lanes = lanes;
+}
+
+void PipelineShards::removeLane(Shard* shard, const PipelineLane* lane) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    auto lanes = std::make_shared<LaneList>();
+    for (const auto& current : *shard->lanes) {
+        if (current.get() != lane) lanes->push_back(current);
+    }
+    shard->lanes = lanes;
+}
+
+void PipelineShards::attach(const std::shared_ptr<PipelineLane>& lane) {
+    std::lock_guard<std::mutex> laneLock(lane->mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lane->detached_ || lane->shardIndex_ >= 0) return;
+
+    Shard* target = nullptr;
+    size_t fewest = 0;
+    for (auto& shard : shards_) {
+        size_t count;
+        {
+            std::lock_guard<std::mutex> shardLock(shard->mutex);
+            count = shard->lanes->size();
+        }
+        if (!target || count < fewest) {
+            target = shard.get();
+            fewest = count;
+        }
+    }
+
+    lane->balancedBusyNs_ = lane->busyNs();
+    lane->shardIndex_ = target->index;
+    lane->owner_ = this;
+    addLane(target, lane);
+    wake(target->index);
+}
+
+void PipelineShards::detach(const std::shared_ptr<PipelineLane>& lane) {
+    // Из обработчика очереди ее мьютекс уже удерживает поток шарда
+    std::unique_lock<std::mutex> laneLock(lane->mutex_, std::defer_lock);
+    if (currentLane != lane.get()) {
+        laneLock.lock();
+    }
+    if (lane->detached_) return;
+    lane->detached_ = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int index = lane->shardIndex_;
+        if (index >= 0) {
+            removeLane(shards_[index].get(), lane.get());
+        }
+        lane->shardIndex_ = -1;
+        lane->owner_ = nullptr;
+    }
+
+    // Шард очередь больше не читает: оставшиеся кадры освобождаются здесь
+    lane->queue_.close();
+    while (RTSPFrame* frame = lane->queue_.pop()) {
+        FramePool::release(frame);
+    }
+}
+
+int PipelineShards::rebalance() {
+    if (currentShard) return 0;
+
+    // План переносов по нагрузке с прошлой балансировки
+    struct Move {
+        std::shared_ptr<PipelineLane> lane;
+        int from;
+        int to;
+    };
+    std::vector<Move> moves;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const int count = shardCount();
+        std::vector<std::shared_ptr<const LaneList>> lists(count);
+        for (int i = 0; i < count; i++) {
+            std::lock_guard<std::mutex> shardLock(shards_[i]->mutex);
+            lists[i] = shards_[i]->lanes;
+        }
+
+        std::vector<std::vector<std::pair<std::shared_ptr<PipelineLane>, uint64_t>>> lanes(count);
+        uint64_t total = 0;
+        for (int i = 0; i < count; i++) {
+            for (const auto& lane : *lists[i]) {
+                uint64_t busyNs = lane->busyNs();
+                uint64_t load = busyNs - lane->balancedBusyNs_;
+                lane->balancedBusyNs_ = busyNs;
+                lanes[i].push_back(std::make_pair(lane, load));
+                total += load;
+            }
+        }
+        // Без нагрузки выравнивается число очередей
+        if (total == 0) {
+            for (auto& shardLanes : lanes) {
+                for (auto& entry : shardLanes) entry.second = 1;
+            }
+        }
+
+        std::vector<uint64_t> loads(count, 0);
+        for (int i = 0; i < count; i++) {
+            for (const auto& entry : lanes[i]) loads[i] += entry.second;
+        }
+
+        for (;;) {
+            int busiest = static_cast<int>(std::max_element(loads.begin(), loads.end()) - loads.begin());
+            int idlest = static_cast<int>(std::min_element(loads.begin(), loads.end()) - loads.begin());
+            uint64_t gap = loads[busiest] - loads[idlest];
+            if (gap == 0 || gap <= loads[busiest] / kImbalanceTolerance) break;
+
+            // Перенос очереди с нагрузкой меньше разницы ее уменьшает;
+            // лучшая - ближайшая к половине разницы
+            auto& candidates = lanes[busiest];
+            auto best = candidates.end();
+            for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+                if (it->second == 0 || it->second >= gap) continue;
+                if (best == candidates.end() ||
+                    std::llabs(static_cast<long long>(it->second * 2) - static_cast<long long>(gap)) <
+                    std::llabs(static_cast<long long>(best->second * 2) - static_cast<long long>(gap))) {
+                    best = it;
+                }
+            }
+            if (best == candidates.end()) break;
+
+            moves.push_back(Move{best->first, busiest, idlest});
+            loads[busiest] -= best->second;
+            loads[idlest] += best->second;
+            lanes[idlest].push_back(*best);
+            candidates.erase(best);
+        }
+    }
+
+    // Перенос: обработчик очереди на прежнем шарде завершается до переноса
+    int moved = 0;
+    for (const Move& move : moves) {
+        PipelineLane* lane = move.lane.get();
+        std::lock_guard<std::mutex> laneLock(lane->mutex_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (lane->detached_ || lane->shardIndex_ != move.from) continue;
+
+        removeLane(shards_[move.from].get(), lane);
+        lane->shardIndex_ = move.to;
+        addLane(shards_[move.to].get(), move.lane);
+        wake(move.to);
+        moved++;
+    }
+    return moved;
+}
+
+bool PipelineShards::getStats(int index, PipelineShardStats* stats) const {
+    if (!stats || index < 0 || index >= shardCount()) return false;
+
+    Shard* shard = shards_[index].get();
+    stats->cpu = shard->pinned ? shard->cpu : -1;
+    stats->numaNode = shard->numaNode;
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats->lanes = static_cast<int>(shard->lanes->size());
+    }
+    stats->frames = shard->frames.load(std::memory_order_relaxed);
+    stats->busyUs = shard->busyNs.load(std::memory_order_relaxed) / 1000;
+    return true;
+}
@@ -0,0 +1,142 @@
+#ifndef PIPELINE_SHARDS_H
+#define PIPELINE_SHARDS_H
+
+#include "frame_queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PipelineShards;
+
+// Очередь кадров одного потока к его шарду. Кадры ставит поток приема
+// (производитель), извлекает и передает обработчику поток шарда, за которым
+// закреплена очередь. Обработчик получает кадр во владение.
+class PipelineLane {
+public:
+    typedef void (*Handler)(RTSPFrame* frame, void* context);
+
+    PipelineLane(int capacity, RTSPFrameQueuePolicy policy, Handler handler, void* context);
+
+    PipelineLane(const PipelineLane&) = delete;
+    PipelineLane& operator=(const PipelineLane&) = delete;
+
+    // Производитель: постановка кадра и пробуждение шарда.
+    // false - кадр отброшен (очередь отключена или переполнена).
+    bool push(RTSPFrame* frame);
+
+    // Шард очереди (-1 - очередь не подключена)
+    int shard() const;
+
+    uint64_t frames() const { return frames_.load(std::memory_order_relaxed); }
+    uint64_t busyNs() const { return busyNs_.load(std::memory_order_relaxed); }
+
+    void getStats(RTSPFrameQueueStats* stats) const { queue_.getStats(stats); }
+
+private:
+    friend class PipelineShards;
+
+    FrameQueue queue_;
+    const Handler handler_;
+    void* const context_;
+
+    // Удерживается шардом на время обработки кадров очереди: перенос и
+    // отключение дожидаются завершения обработчика
+    std::mutex mutex_;
+    std::atomic<PipelineShards*> owner_;
+    std::atomic<int> shardIndex_;       // Меняется под mutex_
+    bool detached_;                     // Под mutex_
+
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> busyNs_;      // Время в обработчике
+    uint64_t balancedBusyNs_;           // busyNs_ на момент прошлой балансировки (под мьютексом шардов)
+};
+
+// Статистика шарда
+struct PipelineShardStats {
+    int cpu;                // Ядро, к которому привязан поток (-1 - без привязки)
+    int numaNode;           // Узел NUMA ядра (-1 - неизвестен)
+    int lanes;              // Закрепленных очередей
+    uint64_t frames;        // Обработанных кадров
+    uint64_t busyUs;        // Время в обработчиках
+};
+
+// Пул потоков-шардов (thread-per-core): каждая очередь закреплена за одним
+// шардом, и все кадры потока обрабатываются одним потоком на одном ядре -
+// данные потока (кадры, состояние обработчика) остаются в кэше этого ядра,
+// а потоки разных шардов не конкурируют за общие структуры.
+// Поток шарда привязывается к ядру (Linux); с учетом NUMA шарды чередуются
+// по узлам, чтобы занять ядра всех узлов равномерно.
+// Новые очереди закрепляются за шардом с наименьшим числом очередей;
+// rebalance() переносит очереди с наиболее загруженных шардов.
+class PipelineShards {
+public:
+    struct Params {
+        int shardCount;     // 0 - по числу доступных ядер
+        bool pinThreads;    // Привязать потоки к ядрам
+        bool numaAware;     // Чередовать ядра по узлам NUMA
+    };
+
+    explicit PipelineShards(const Params& params);
+    ~PipelineShards();
+
+    PipelineShards(const PipelineShards&) = delete;
+    PipelineShards& operator=(const PipelineShards&) = delete;
+
+    int shardCount() const { return static_cast<int>(shards_.size()); }
+
+    // Закрепление очереди за наименее занятым шардом
+    void attach(const std::shared_ptr<PipelineLane>& lane);
+
+    // Отключение очереди: оставшиеся кадры освобождаются. После возврата
+    // обработчик очереди не вызывается (из самого обработчика - после его завершения).
+    void detach(const std::shared_ptr<PipelineLane>& lane);
+
+    // Перенос очередей с наиболее загруженных шардов (по времени в обработчиках
+    // с прошлой балансировки, без нагрузки - по числу очередей) на наименее
+    // загруженные, пока разница больше 1/8 нагрузки шарда. Кадры очереди
+    // обрабатываются по порядку: перенос дожидается завершения текущего обработчика.
+    // Из обработчиков не выполняется. Возвращает число перенесенных очередей.
+    int rebalance();
+
+    bool getStats(int shard, PipelineShardStats* stats) const;
+
+    // Ядра для шардов: доступные процессу, с учетом NUMA - поочередно из узлов
+    static std::vector<int> shardCpus(bool numaAware, std::vector<int>* nodes);
+
+private:
+    typedef std::vector<std::shared_ptr<PipelineLane>> LaneList;
+
+    struct Shard {
+        int index;
+        int cpu;                                // Ядро для привязки (-1 - без привязки)
+        int numaNode;
+        std::atomic<bool> pinned;               // Поток привязан к cpu
+        std::thread thread;
+
+        std::mutex mutex;                       // lanes, stopping, ожидание
+        std::condition_variable condition;
+        std::shared_ptr<const LaneList> lanes;  // Заменяется целиком (копирование при записи)
+        bool stopping;
+        std::atomic<bool> pending;              // Есть непросмотренные кадры
+
+        std::atomic<uint64_t> frames;
+        std::atomic<uint64_t> busyNs;
+    };
+
+    void run(Shard* shard);
+    bool drain(Shard* shard, const LaneList& lanes);
+    void wake(int shard);
+    void addLane(Shard* shard, const std::shared_ptr<PipelineLane>& lane);
+    void removeLane(Shard* shard, const PipelineLane* lane);
+
+    friend class PipelineLane;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    mutable std::mutex mutex_;                  // Закрепление очередей (attach/detach/rebalance)
+};
+
+#endif // PIPELINE_SHARDS_H
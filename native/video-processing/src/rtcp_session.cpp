@@ -0,0 +1,362 @@
+#include "rtcp_session.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace {
+
+const uint8_t kRtcpSenderReport = 200;
+const uint8_t kRtcpReceiverReport = 201;
+const uint8_t kRtcpSourceDescription = 202;
+const uint8_t kRtcpPayloadFeedback = 206;
+const uint8_t kFeedbackPli = 1;
+const uint8_t kFeedbackFir = 4;
+const uint8_t kSdesCname = 1;
+const char kCname[] = "IP-CSS";
+
+// Допуски номеров последовательности (RFC 3550 A.1)
+const uint16_t kMaxDropout = 3000;
+const uint16_t kMaxMisorder = 100;
+
+// Секунды между эпохами NTP (1900) и Unix (1970)
+const int64_t kNtpUnixOffsetSec = 2208988800LL;
+
+uint32_t read32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void write16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+void write32(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+int64_t ntp_to_unix_us(uint64_t ntp) {
+    int64_t seconds = static_cast<int64_t>(ntp >> 32) - kNtpUnixOffsetSec;
+    int64_t fraction = static_cast<int64_t>(((ntp & 0xFFFFFFFFull) * 1000000ull) >> 32);
+    return seconds * 1000000 + fraction;
+}
+
+uint32_t random_ssrc() {
+    static std::mt19937 generator(static_cast<uint32_t>(
+        std::chrono::high_resolution_clock::now().time_since_epoch().count()));
+    static std::mutex generatorMutex;
+    std::lock_guard<std::mutex> lock(generatorMutex);
+    return generator();
+}
+
+} // namespace
+
+const int64_t RTCPSession::kKeyframeRequestIntervalUs;
+
+RTCPSession::RTCPSession() : localSsrc_(random_ssrc()), clockRate_(90000) {
+    reset();
+}
+
+void RTCPSession::setClockRate(int clockRate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clockRate_ = clockRate > 0 ? clockRate : 90000;
+}
+
+void RTCPSession::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    haveSource_ = false;
+    sourceSsrc_ = 0;
+    initSequence(0);
+    haveTransit_ = false;
+    transit_ = 0;
+    jitterQ4_ = 0;
+    haveTimestamp_ = false;
+    lastExtendedTimestamp_ = 0;
+    haveSenderReport_ = false;
+    senderReportNtp_ = 0;
+    senderReportRtp_ = 0;
+    senderReportWallUs_ = 0;
+    senderReportArrivalUs_ = 0;
+    haveAnchor_ = false;
+    anchorRtp_ = 0;
+    anchorWallUs_ = 0;
+    lossPending_ = false;
+    lossStartUs_ = 0;
+    requestsForLoss_ = 0;
+    haveLastRequest_ = false;
+    lastRequestUs_ = 0;
+    firSequence_ = 0;
+    keyframeStats_ = KeyframeRequestStats();
+}
+
+void RTCPSession::initSequence(uint16_t sequence) {
+    baseSequence_ = sequence;
+    maxSequence_ = sequence;
+    badSequence_ = 0x10001;     // Недостижимое значение
+    cycles_ = 0;
+    received_ = 0;
+    expectedPrior_ = 0;
+    receivedPrior_ = 0;
+}
+
+int64_t RTCPSession::extendTimestamp(uint32_t rtpTimestamp) {
+    if (!haveTimestamp_) {
+        haveTimestamp_ = true;
+        lastExtendedTimestamp_ = rtpTimestamp;
+        return lastExtendedTimestamp_;
+    }
+
+    // Разница по модулю 2^32: кадры могут идти не по порядку времени (B-кадры)
+    int32_t delta = static_cast<int32_t>(rtpTimestamp - static_cast<uint32_t>(lastExtendedTimestamp_));
+    lastExtendedTimestamp_ += delta;
+    return lastExtendedTimestamp_;
+}
+
+int64_t RTCPSession::rtpToUs(int64_t rtpTicks) const {
+    return rtpTicks * 1000000 / clockRate_;
+}
+
+void RTCPSession::onRtpPacket(uint32_t ssrc, uint16_t sequence, uint32_t rtpTimestamp, int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!haveSource_ || ssrc != sourceSsrc_) {
+        if (haveSource_) {
+            // Новый источник: прежние SR и развертка к нему не относятся
+            haveTransit_ = false;
+            jitterQ4_ = 0;
+            haveTimestamp_ = false;
+            haveSenderReport_ = false;
+            haveAnchor_ = false;
+        }
+        haveSource_ = true;
+        sourceSsrc_ = ssrc;
+        initSequence(sequence);
+    } else {
+        uint16_t delta = static_cast<uint16_t>(sequence - maxSequence_);
+        if (delta < kMaxDropout) {
+            // По порядку или с допустимым пропуском
+            if (sequence < maxSequence_) {
+                cycles_ += 0x10000;
+            }
+            maxSequence_ = sequence;
+        } else if (delta <= 0x10000 - kMaxMisorder) {
+            // Большой скачок: источник перезапущен, если следующий пакет его подтвердит
+            if (sequence == badSequence_) {
+                initSequence(sequence);
+            } else {
+                badSequence_ = static_cast<uint16_t>(sequence + 1);
+                return;
+            }
+        }
+        // Иначе дубликат или пакет не по порядку
+    }
+    received_++;
+
+    int64_t extended = extendTimestamp(rtpTimestamp);
+    if (!haveAnchor_) {
+        haveAnchor_ = true;
+        anchorRtp_ = extended;
+        anchorWallUs_ = nowUs;
+    }
+
+    // Jitter (A.8): J += (|D| - J) / 16, хранится в 1/16 единицы.
+    // Время прихода в RTP единицах отсчитывается от опоры, чтобы не переполнить int64
+    int64_t arrival = (nowUs - anchorWallUs_) * clockRate_ / 1000000;
+    int64_t transit = arrival - (extended - anchorRtp_);
+    if (haveTransit_) {
+        int64_t difference = transit - transit_;
+        if (difference < 0) difference = -difference;
+        difference = std::min<int64_t>(difference, clockRate_ * 10LL);
+        int64_t jitter = static_cast<int64_t>(jitterQ4_) + difference - ((jitterQ4_ + 8) >> 4);
+        jitterQ4_ = static_cast<uint32_t>(std::max<int64_t>(jitter, 0));
+    }
+    haveTransit_ = true;
+    transit_ = transit;
+}
+
+bool RTCPSession::onRtcpPacket(const uint8_t* data, size_t size, int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    bool found = false;
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+        const uint8_t* packet = data + offset;
+        if ((packet[0] >> 6) != 2) break;
+
+        size_t length = (((static_cast<size_t>(packet[2]) << 8) | packet[3]) + 1) * 4;
+        if (offset + length > size) break;
+
+        if (packet[1] == kRtcpSenderReport && length >= 28) {
+            uint32_t ssrc = read32(packet + 4);
+            if (!haveSource_ || ssrc == sourceSsrc_) {
+                senderReportNtp_ = (static_cast<uint64_t>(read32(packet + 8)) << 32) | read32(packet + 12);
+                senderReportRtp_ = extendTimestamp(read32(packet + 16));
+                senderReportWallUs_ = ntp_to_unix_us(senderReportNtp_);
+                senderReportArrivalUs_ = nowUs;
+                haveSenderReport_ = true;
+                found = true;
+            }
+        }
+        offset += length;
+    }
+    return found;
+}
+
+int64_t RTCPSession::frameTime(uint32_t rtpTimestamp, bool& synchronized) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int64_t extended = extendTimestamp(rtpTimestamp);
+    if (haveSenderReport_) {
+        synchronized = true;
+        return senderReportWallUs_ + rtpToUs(extended - senderReportRtp_);
+    }
+
+    synchronized = false;
+    if (!haveAnchor_) {
+        haveAnchor_ = true;
+        anchorRtp_ = extended;
+        anchorWallUs_ = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    return anchorWallUs_ + rtpToUs(extended - anchorRtp_);
+}
+
+size_t RTCPSession::buildReceiverReport(uint8_t* out, size_t capacity, int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buildReceiverReportLocked(out, capacity, nowUs);
+}
+
+size_t RTCPSession::buildReceiverReportLocked(uint8_t* out, size_t capacity, int64_t nowUs) {
+    const size_t cnameLength = sizeof(kCname) - 1;
+    size_t reportSize = haveSource_ ? 32 : 8;
+    size_t chunkSize = (4 + 2 + cnameLength + 1 + 3) & ~static_cast<size_t>(3);
+    size_t sdesSize = 4 + chunkSize;
+    if (capacity < reportSize + sdesSize) return 0;
+
+    memset(out, 0, reportSize + sdesSize);
+
+    // RR
+    out[0] = static_cast<uint8_t>(0x80 | (haveSource_ ? 1 : 0));
+    out[1] = kRtcpReceiverReport;
+    write16(out + 2, static_cast<uint16_t>(reportSize / 4 - 1));
+    write32(out + 4, localSsrc_);
+
+    if (haveSource_) {
+        uint8_t* block = out + 8;
+        uint32_t extendedMax = cycles_ + maxSequence_;
+        int64_t expected = static_cast<int64_t>(extendedMax) - baseSequence_ + 1;
+        int64_t lost = expected - static_cast<int64_t>(received_);
+        lost = std::max<int64_t>(std::min<int64_t>(lost, 0x7FFFFF), -0x800000);
+
+        int64_t expectedInterval = expected - static_cast<int64_t>(expectedPrior_);
+        int64_t receivedInterval = static_cast<int64_t>(received_ - receivedPrior_);
+        int64_t lostInterval = expectedInterval - receivedInterval;
+        expectedPrior_ = static_cast<uint64_t>(std::max<int64_t>(expected, 0));
+        receivedPrior_ = received_;
+        uint32_t fraction = (expectedInterval <= 0 || lostInterval <= 0)
+                                ? 0 : static_cast<uint32_t>((lostInterval << 8) / expectedInterval);
+
+        write32(block, sourceSsrc_);
+        write32(block + 4, (std::min<uint32_t>(fraction, 255) << 24) |
+                           (static_cast<uint32_t>(lost) & 0xFFFFFF));
+        write32(block + 8, extendedMax);
+        write32(block + 12, jitterQ4_ >> 4);
+        if (haveSenderReport_) {
+            // LSR - средние 32 бита NTP времени SR, DLSR - в 1/65536 секунды
+            write32(block + 16, static_cast<uint32_t>(senderReportNtp_ >> 16));
+            int64_t delayUs = std::max<int64_t>(nowUs - senderReportArrivalUs_, 0);
+            write32(block + 20, static_cast<uint32_t>(delayUs * 65536 / 1000000));
+        }
+    }
+
+    // SDES с CNAME (обязателен в составном пакете)
+    uint8_t* sdes = out + reportSize;
+    sdes[0] = 0x81;
+    sdes[1] = kRtcpSourceDescription;
+    write16(sdes + 2, static_cast<uint16_t>(sdesSize / 4 - 1));
+    write32(sdes + 4, localSsrc_);
+    sdes[8] = kSdesCname;
+    sdes[9] = static_cast<uint8_t>(cnameLength);
+    memcpy(sdes + 10, kCname, cnameLength);
+    // Завершающий нулевой элемент и выравнивание уже обнулены
+
+    return reportSize + sdesSize;
+}
+
+void RTCPSession::onFrameLoss(int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!lossPending_) {
+        lossPending_ = true;
+        lossStartUs_ = nowUs;
+        requestsForLoss_ = 0;
+    }
+}
+
+void RTCPSession::onFrame(bool keyframe, int64_t nowUs) {
+    if (!keyframe) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!lossPending_) return;
+
+    int64_t recoveryUs = std::max<int64_t>(nowUs - lossStartUs_, 0);
+    keyframeStats_.recoveries++;
+    keyframeStats_.lastRecoveryUs = recoveryUs;
+    keyframeStats_.maxRecoveryUs = std::max(keyframeStats_.maxRecoveryUs, recoveryUs);
+    lossPending_ = false;
+}
+
+bool RTCPSession::keyframeRequestDueLocked(int64_t nowUs) const {
+    return lossPending_ && haveSource_ &&
+           (!haveLastRequest_ || nowUs - lastRequestUs_ >= kKeyframeRequestIntervalUs);
+}
+
+bool RTCPSession::keyframeRequestDue(int64_t nowUs) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return keyframeRequestDueLocked(nowUs);
+}
+
+size_t RTCPSession::buildKeyframeRequest(uint8_t* out, size_t capacity, int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!keyframeRequestDueLocked(nowUs)) return 0;
+
+    // Обратная связь передается в составном пакете после RR и SDES (RFC 4585, 3.1)
+    bool fir = requestsForLoss_ > 0;
+    size_t feedbackSize = fir ? 20 : 12;
+    size_t reportSize = buildReceiverReportLocked(out, capacity, nowUs);
+    if (reportSize == 0 || capacity < reportSize + feedbackSize) return 0;
+
+    uint8_t* feedback = out + reportSize;
+    memset(feedback, 0, feedbackSize);
+    feedback[0] = static_cast<uint8_t>(0x80 | (fir ? kFeedbackFir : kFeedbackPli));
+    feedback[1] = kRtcpPayloadFeedback;
+    write16(feedback + 2, static_cast<uint16_t>(feedbackSize / 4 - 1));
+    write32(feedback + 4, localSsrc_);
+    if (fir) {
+        // SSRC источника в заголовке не используется, адресат - в FCI
+        write32(feedback + 12, sourceSsrc_);
+        feedback[16] = firSequence_++;
+        keyframeStats_.firSent++;
+    } else {
+        write32(feedback + 8, sourceSsrc_);
+        keyframeStats_.pliSent++;
+    }
+
+    requestsForLoss_++;
+    haveLastRequest_ = true;
+    lastRequestUs_ = nowUs;
+    return reportSize + feedbackSize;
+}
+
+void RTCPSession::getKeyframeRequestStats(KeyframeRequestStats& stats) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats = keyframeStats_;
+}
+
+uint32_t RTCPSession::jitter() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jitterQ4_ >> 4;
+}
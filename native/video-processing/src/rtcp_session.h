@@ -0,0 +1,124 @@
+#ifndef RTCP_SESSION_H
+#define RTCP_SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Состояние RTCP для одного принимаемого RTP потока (RFC 3550):
+// статистика приема для receiver report (A.1, A.3, A.8), сопоставление RTP
+// времени с NTP временем отправителя по sender report, развертка 32-битного
+// RTP timestamp в 64-битное время кадра и запросы ключевого кадра после
+// потерь (PLI, RFC 4585; FIR, RFC 5104).
+// Все времена - Unix время в микросекундах (system_clock).
+// Методы потокобезопасны: пакеты обрабатывает поток приема, отчеты
+// формирует поток таймеров.
+class RTCPSession {
+public:
+    // Минимальный интервал между запросами ключевого кадра
+    static const int64_t kKeyframeRequestIntervalUs = 500000;
+
+    struct KeyframeRequestStats {
+        uint64_t pliSent;
+        uint64_t firSent;
+        uint64_t recoveries;        // Ключевые кадры, завершившие восстановление после потери
+        int64_t lastRecoveryUs;     // От обнаружения потери до ключевого кадра
+        int64_t maxRecoveryUs;
+    };
+
+    RTCPSession();
+
+    void setClockRate(int clockRate);
+
+    // Сброс состояния (новая сессия)
+    void reset();
+
+    // Учет принятого RTP пакета. Смена SSRC начинает статистику заново.
+    void onRtpPacket(uint32_t ssrc, uint16_t sequence, uint32_t rtpTimestamp, int64_t nowUs);
+
+    // Разбор составного RTCP пакета. true - найден sender report источника.
+    bool onRtcpPacket(const uint8_t* data, size_t size, int64_t nowUs);
+
+    // Время кадра в микросекундах Unix времени. synchronized = true, если
+    // время получено из sender report (сопоставимо между камерами); до первого
+    // SR отсчитывается от момента приема первого пакета.
+    int64_t frameTime(uint32_t rtpTimestamp, bool& synchronized);
+
+    // Составной RTCP пакет RR + SDES (CNAME) для отправителя.
+    // Возвращает размер пакета (0 - не хватает места).
+    size_t buildReceiverReport(uint8_t* out, size_t capacity, int64_t nowUs);
+
+    // Потеря пакетов испортила кадр: нужен ключевой кадр
+    void onFrameLoss(int64_t nowUs);
+
+    // Доставлен кадр; ключевой завершает восстановление после потери
+    void onFrame(bool keyframe, int64_t nowUs);
+
+    // Ключевой кадр ожидается и интервал между запросами истек
+    bool keyframeRequestDue(int64_t nowUs) const;
+
+    // Составной пакет RR + SDES + PLI (первый запрос после потери) или FIR
+    // (камера не ответила на PLI). 0 - запрос не нужен или не хватает места.
+    size_t buildKeyframeRequest(uint8_t* out, size_t capacity, int64_t nowUs);
+
+    void getKeyframeRequestStats(KeyframeRequestStats& stats) const;
+
+    // Межпакетный jitter в единицах RTP времени
+    uint32_t jitter() const;
+
+    uint32_t localSsrc() const { return localSsrc_; }
+
+private:
+    void initSequence(uint16_t sequence);
+    int64_t extendTimestamp(uint32_t rtpTimestamp);
+    int64_t rtpToUs(int64_t rtpTicks) const;
+    size_t buildReceiverReportLocked(uint8_t* out, size_t capacity, int64_t nowUs);
+    bool keyframeRequestDueLocked(int64_t nowUs) const;
+
+    mutable std::mutex mutex_;
+    uint32_t localSsrc_;
+    int clockRate_;
+
+    // Источник и статистика номеров последовательности (RFC 3550 A.1)
+    bool haveSource_;
+    uint32_t sourceSsrc_;
+    uint16_t maxSequence_;
+    uint32_t cycles_;
+    uint32_t baseSequence_;
+    uint32_t badSequence_;
+    uint64_t received_;
+    uint64_t expectedPrior_;
+    uint64_t receivedPrior_;
+
+    // Jitter (A.8): transit и оценка в 1/16 единицы RTP времени
+    bool haveTransit_;
+    int64_t transit_;
+    uint32_t jitterQ4_;
+
+    // Развертка RTP timestamp
+    bool haveTimestamp_;
+    int64_t lastExtendedTimestamp_;
+
+    // Последний sender report
+    bool haveSenderReport_;
+    uint64_t senderReportNtp_;
+    int64_t senderReportRtp_;       // Развернутый RTP timestamp из SR
+    int64_t senderReportWallUs_;    // NTP время SR в Unix микросекундах
+    int64_t senderReportArrivalUs_;
+
+    // Опора времени кадров до первого SR
+    bool haveAnchor_;
+    int64_t anchorRtp_;
+    int64_t anchorWallUs_;
+
+    // Запросы ключевого кадра
+    bool lossPending_;              // После потери ключевой кадр еще не пришел
+    int64_t lossStartUs_;
+    int requestsForLoss_;           // Запросы, отправленные с момента потери
+    bool haveLastRequest_;
+    int64_t lastRequestUs_;
+    uint8_t firSequence_;           // Номер команды FIR (RFC 5104, 4.3.1)
+    KeyframeRequestStats keyframeStats_;
+};
+
+#endif // RTCP_SESSION_H
@@ -0,0 +1,297 @@
+#include "rtp_depacketizer.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+
+// Типы NAL/пакетов H.264 (RFC 6184)
+const int kH264NalIdr = 5;
+const int kH264StapA = 24;
+const int kH264FuA = 28;
+
+// Типы NAL/пакетов H.265 (RFC 7798)
+const int kH265NalIrapFirst = 16;
+const int kH265NalIrapLast = 21;
+const int kH265Ap = 48;
+const int kH265Fu = 49;
+
+// Начало стартового кода (00 00 01) в data[from, size), size - не найден
+size_t find_start_code(const uint8_t* data, size_t size, size_t from) {
+    for (size_t i = from; i + 2 < size; i++) {
+        if (data[i + 2] > 1) {
+            i += 2;
+        } else if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            return i;
+        }
+    }
+    return size;
+}
+
+} // namespace
+
+bool annexb_next_nal(const uint8_t* data, size_t size, size_t& offset,
+                     const uint8_t*& nal, size_t& nalSize) {
+    size_t start;
+    size_t end;
+    do {
+        start = find_start_code(data, size, offset);
+        if (start == size) {
+            offset = size;
+            return false;
+        }
+        start += 3;
+
+        end = find_start_code(data, size, start);
+        offset = end;
+        // Нули перед следующим стартовым кодом (4-байтовый код, trailing_zero_8bits)
+        while (end > start && data[end - 1] == 0) end--;
+        // Пустые NAL-единицы пропускаются циклом: в файле их может быть сколько угодно подряд
+    } while (end == start);
+
+    nal = data + start;
+    nalSize = end - start;
+    return true;
+}
+
+RTPPayloadCodec rtp_payload_codec_from_name(const std::string& name) {
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+    if (upper == "H264") return RTPPayloadCodec::H264;
+    if (upper == "H265" || upper == "HEVC") return RTPPayloadCodec::H265;
+    return RTPPayloadCodec::Unknown;
+}
+
+RTPDepacketizer::RTPDepacketizer(RTPPayloadCodec codec)
+    : codec_(codec), timestamp_(0), keyframe_(false), fragmentInProgress_(false),
+      fragmentStart_(0), discarding_(false), discardTimestamp_(0) {}
+
+void RTPDepacketizer::setCodec(RTPPayloadCodec codec) {
+    codec_ = codec;
+    reset();
+}
+
+void RTPDepacketizer::reset() {
+    clearFrame();
+    discarding_ = false;
+}
+
+void RTPDepacketizer::clearFrame() {
+    // clear() сохраняет емкость, поэтому буфер не перевыделяется на каждый кадр
+    buffer_.clear();
+    keyframe_ = false;
+    fragmentInProgress_ = false;
+    fragmentStart_ = 0;
+}
+
+int RTPDepacketizer::onPacketLoss(const uint8_t* payload, size_t size, uint32_t timestamp) {
+    int dropped = 0;
+    if (!buffer_.empty()) {
+        // Потеряна середина или конец незавершенного кадра
+        dropped++;
+        clearFrame();
+        if (timestamp == timestamp_) {
+            discarding_ = true;
+            discardTimestamp_ = timestamp;
+            return dropped;
+        }
+    } else if (discarding_ && timestamp == discardTimestamp_) {
+        // Кадр уже отбрасывается и учтен
+        return dropped;
+    }
+
+    // Новый кадр начат чисто, если пакет начинает NAL-единицу
+    // (потерянным был, например, пакет с marker битом предыдущего кадра)
+    discarding_ = !startsNal(payload, size);
+    if (discarding_) {
+        discardTimestamp_ = timestamp;
+        dropped++;
+    }
+    return dropped;
+}
+
+bool RTPDepacketizer::startsNal(const uint8_t* payload, size_t size) const {
+    if (!payload || size == 0) return false;
+
+    if (codec_ == RTPPayloadCodec::H264) {
+        int type = payload[0] & 0x1F;
+        if (type == kH264FuA) return size >= 2 && (payload[1] & 0x80) != 0;
+    } else if (codec_ == RTPPayloadCodec::H265) {
+        int type = size >= 2 ? (payload[0] >> 1) & 0x3F : 0;
+        if (type == kH265Fu) return size >= 3 && (payload[2] & 0x80) != 0;
+    }
+    return true;
+}
+
+void RTPDepacketizer::push(const uint8_t* payload, size_t size, uint32_t timestamp, bool marker,
+                           AccessUnitHandler handler, void* context) {
+    if (!payload || size == 0) return;
+
+    // Кадр, начало или середина которого потеряны
+    if (discarding_) {
+        if (timestamp == discardTimestamp_) return;
+        discarding_ = false;
+    }
+
+    if (codec_ == RTPPayloadCodec::Unknown) {
+        // Неизвестный кодек: каждый пакет передается отдельным кадром
+        AccessUnit au = {payload, size, timestamp, false};
+        if (handler) handler(au, context);
+        return;
+    }
+
+    // Смена timestamp без marker бита: предыдущий кадр считается завершенным
+    if (!buffer_.empty() && timestamp != timestamp_) {
+        flush(handler, context);
+    }
+    timestamp_ = timestamp;
+
+    if (codec_ == RTPPayloadCodec::H264) {
+        pushH264(payload, size);
+    } else {
+        pushH265(payload, size);
+    }
+
+    if (buffer_.size() > kMaxAccessUnitSize) {
+        clearFrame();
+        return;
+    }
+
+    if (marker) {
+        flush(handler, context);
+    }
+}
+
+void RTPDepacketizer::pushH264(const uint8_t* payload, size_t size) {
+    int type = payload[0] & 0x1F;
+
+    if (type >= 1 && type <= 23) {
+        // Single NAL unit
+        abandonFragment();
+        markNalType(type);
+        appendNal(payload, size);
+    } else if (type == kH264StapA) {
+        // STAP-A: [индикатор][размер(2) NAL]...
+        abandonFragment();
+        size_t offset = 1;
+        while (offset + 2 <= size) {
+            size_t nalSize = (static_cast<size_t>(payload[offset]) << 8) | payload[offset + 1];
+            offset += 2;
+            if (nalSize == 0 || offset + nalSize > size) break;
+            markNalType(payload[offset] & 0x1F);
+            appendNal(payload + offset, nalSize);
+            offset += nalSize;
+        }
+    } else if (type == kH264FuA) {
+        // FU-A: [индикатор][заголовок FU][фрагмент]
+        if (size < 2) return;
+        bool start = (payload[1] & 0x80) != 0;
+        bool end = (payload[1] & 0x40) != 0;
+        int nalType = payload[1] & 0x1F;
+
+        if (start) {
+            abandonFragment();
+            uint8_t header = static_cast<uint8_t>((payload[0] & 0xE0) | nalType);
+            markNalType(nalType);
+            fragmentStart_ = buffer_.size();
+            appendNal(&header, 1);
+            fragmentInProgress_ = true;
+        } else if (!fragmentInProgress_) {
+            // Начало фрагментированного NAL потеряно, продолжение бесполезно
+            return;
+        }
+
+        appendFragment(payload + 2, size - 2);
+        if (end) {
+            fragmentInProgress_ = false;
+        }
+    }
+    // STAP-B, MTAP и FU-B в IP камерах не используются (interleaved режим)
+}
+
+void RTPDepacketizer::pushH265(const uint8_t* payload, size_t size) {
+    if (size < 2) return;
+    int type = (payload[0] >> 1) & 0x3F;
+
+    if (type < kH265Ap) {
+        // Single NAL unit
+        abandonFragment();
+        markNalType(type);
+        appendNal(payload, size);
+    } else if (type == kH265Ap) {
+        // AP: [заголовок(2)][размер(2) NAL]... (без DONL, sprop-max-don-diff=0)
+        abandonFragment();
+        size_t offset = 2;
+        while (offset + 2 <= size) {
+            size_t nalSize = (static_cast<size_t>(payload[offset]) << 8) | payload[offset + 1];
+            offset += 2;
+            if (nalSize < 2 || offset + nalSize > size) break;
+            markNalType((payload[offset] >> 1) & 0x3F);
+            appendNal(payload + offset, nalSize);
+            offset += nalSize;
+        }
+    } else if (type == kH265Fu) {
+        // FU: [заголовок(2)][заголовок FU][фрагмент]
+        if (size < 3) return;
+        bool start = (payload[2] & 0x80) != 0;
+        bool end = (payload[2] & 0x40) != 0;
+        int nalType = payload[2] & 0x3F;
+
+        if (start) {
+            abandonFragment();
+            uint8_t header[2] = {
+                static_cast<uint8_t>((payload[0] & 0x81) | (nalType << 1)),
+                payload[1]
+            };
+            markNalType(nalType);
+            fragmentStart_ = buffer_.size();
+            appendNal(header, 2);
+            fragmentInProgress_ = true;
+        } else if (!fragmentInProgress_) {
+            return;
+        }
+
+        appendFragment(payload + 3, size - 3);
+        if (end) {
+            fragmentInProgress_ = false;
+        }
+    }
+    // PACI (50) не поддерживается
+}
+
+void RTPDepacketizer::appendNal(const uint8_t* nal, size_t size) {
+    buffer_.insert(buffer_.end(), kStartCode, kStartCode + sizeof(kStartCode));
+    buffer_.insert(buffer_.end(), nal, nal + size);
+}
+
+void RTPDepacketizer::appendFragment(const uint8_t* data, size_t size) {
+    buffer_.insert(buffer_.end(), data, data + size);
+}
+
+void RTPDepacketizer::markNalType(int nalType) {
+    if (codec_ == RTPPayloadCodec::H264) {
+        if (nalType == kH264NalIdr) keyframe_ = true;
+    } else if (codec_ == RTPPayloadCodec::H265) {
+        if (nalType >= kH265NalIrapFirst && nalType <= kH265NalIrapLast) keyframe_ = true;
+    }
+}
+
+void RTPDepacketizer::abandonFragment() {
+    if (fragmentInProgress_) {
+        // Конец фрагментированного NAL потерян, отбрасываем только этот NAL
+        buffer_.resize(fragmentStart_);
+        fragmentInProgress_ = false;
+    }
+}
+
+void RTPDepacketizer::flush(AccessUnitHandler handler, void* context) {
+    abandonFragment();
+    if (!buffer_.empty() && handler) {
+        AccessUnit au = {buffer_.data(), buffer_.size(), timestamp_, keyframe_};
+        handler(au, context);
+    }
+    clearFrame();
+}
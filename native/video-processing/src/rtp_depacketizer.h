@@ -0,0 +1,85 @@
+#ifndef RTP_DEPACKETIZER_H
+#define RTP_DEPACKETIZER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Кодек полезной нагрузки RTP, для которого выполняется сборка кадров
+enum class RTPPayloadCodec {
+    Unknown,    // Полезная нагрузка передается как есть (по пакету на кадр)
+    H264,       // RFC 6184
+    H265        // RFC 7798
+};
+
+// Определение кодека по имени из a=rtpmap (H264, H265, HEVC)
+RTPPayloadCodec rtp_payload_codec_from_name(const std::string& name);
+
+// Следующая NAL-единица Annex-B потока начиная с offset (стартовые коды
+// 00 00 01 и 00 00 00 01). false - NAL-единиц больше нет.
+bool annexb_next_nal(const uint8_t* data, size_t size, size_t& offset,
+                     const uint8_t*& nal, size_t& nalSize);
+
+// Собранный кадр (access unit) в формате Annex-B
+struct AccessUnit {
+    const uint8_t* data;
+    size_t size;
+    uint32_t rtpTimestamp;
+    bool keyframe;          // Содержит IDR (H.264) или IRAP (H.265)
+};
+
+// Обработчик готового кадра. Данные действительны только на время вызова.
+typedef void (*AccessUnitHandler)(const AccessUnit& au, void* context);
+
+// Сборщик NAL-единиц из RTP пакетов в полные кадры.
+// Поддерживает Single NAL, STAP-A, FU-A (H.264) и Single NAL, AP, FU (H.265).
+// Кадр завершается по marker биту или при смене RTP timestamp.
+class RTPDepacketizer {
+public:
+    explicit RTPDepacketizer(RTPPayloadCodec codec = RTPPayloadCodec::Unknown);
+
+    void setCodec(RTPPayloadCodec codec);
+    RTPPayloadCodec codec() const { return codec_; }
+
+    // Обработка полезной нагрузки одного RTP пакета
+    void push(const uint8_t* payload, size_t size, uint32_t timestamp, bool marker,
+              AccessUnitHandler handler, void* context);
+
+    // Потеря пакетов перед пакетом с полезной нагрузкой payload (вызывается до
+    // его push). Незавершенный кадр отбрасывается; кадр этого пакета - тоже,
+    // если это тот же кадр или пакет продолжает NAL-единицу (ее начало потеряно).
+    // Возвращает число отброшенных кадров, каждый кадр учитывается один раз.
+    int onPacketLoss(const uint8_t* payload, size_t size, uint32_t timestamp);
+
+    // Сброс незавершенного кадра и отбрасывания после потери (смена источника)
+    void reset();
+
+    // Есть ли незавершенный кадр
+    bool hasPendingData() const { return !buffer_.empty(); }
+
+    // Максимальный размер собираемого кадра, при превышении кадр отбрасывается
+    static const size_t kMaxAccessUnitSize = 8 * 1024 * 1024;
+
+private:
+    void pushH264(const uint8_t* payload, size_t size);
+    void pushH265(const uint8_t* payload, size_t size);
+    void appendNal(const uint8_t* nal, size_t size);
+    void appendFragment(const uint8_t* data, size_t size);
+    void markNalType(int nalType);
+    void abandonFragment();
+    void clearFrame();
+    void flush(AccessUnitHandler handler, void* context);
+    bool startsNal(const uint8_t* payload, size_t size) const;
+
+    RTPPayloadCodec codec_;
+    std::vector<uint8_t> buffer_;
+    uint32_t timestamp_;
+    bool keyframe_;
+    bool fragmentInProgress_;
+    size_t fragmentStart_;  // Смещение начала фрагментированного NAL в буфере
+    bool discarding_;       // Пакеты кадра discardTimestamp_ отбрасываются после потери
+    uint32_t discardTimestamp_;
+};
+
+#endif // RTP_DEPACKETIZER_H
@@ -0,0 +1,159 @@
+#include "rtp_jitter_buffer.h"
+
+namespace {
+
+const int kSlotMask = RTPJitterBuffer::kCapacity - 1;
+
+// Разница номеров последовательности с учетом переполнения 16 бит
+inline int sequence_diff(uint16_t a, uint16_t b) {
+    return static_cast<int16_t>(static_cast<uint16_t>(a - b));
+}
+
+} // namespace
+
+RTPJitterBuffer::RTPJitterBuffer()
+    : slots_(kCapacity), depthMs_(kDefaultDepthMs), started_(false), nextSequence_(0),
+      highestSequence_(0), buffered_(0), gapSinceUs_(-1), pendingDiscontinuity_(false) {
+    for (auto& slot : slots_) {
+        slot.used = false;
+        slot.sequence = 0;
+        slot.timestamp = 0;
+        slot.marker = false;
+    }
+}
+
+void RTPJitterBuffer::setDepth(int depthMs) {
+    depthMs_ = depthMs > 0 ? depthMs : 0;
+}
+
+void RTPJitterBuffer::reset() {
+    for (auto& slot : slots_) {
+        slot.used = false;
+    }
+    started_ = false;
+    buffered_ = 0;
+    gapSinceUs_ = -1;
+    pendingDiscontinuity_ = false;
+}
+
+void RTPJitterBuffer::insert(const uint8_t* payload, size_t size, uint16_t sequence,
+                             uint32_t timestamp, bool marker, int64_t nowUs,
+                             RTPOrderedPacketHandler handler, void* context) {
+    counters_.packetsReceived.fetch_add(1, std::memory_order_relaxed);
+
+    if (!started_) {
+        started_ = true;
+        nextSequence_ = sequence;
+        highestSequence_ = sequence;
+    }
+
+    int diff = sequence_diff(sequence, nextSequence_);
+    if (diff < 0) {
+        if (diff > -kCapacity) {
+            // Номер уже выдан или пропущен как потерянный
+            counters_.packetsLate.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // Источник перезапустил нумерацию
+        flushAll(handler, context);
+        nextSequence_ = sequence;
+        highestSequence_ = sequence;
+        diff = 0;
+    } else if (diff >= kCapacity) {
+        // Скачок вперед больше окна: выдаем накопленное и начинаем заново
+        flushAll(handler, context);
+        nextSequence_ = sequence;
+        highestSequence_ = sequence;
+        pendingDiscontinuity_ = true;
+        diff = 0;
+    }
+
+    if (sequence_diff(sequence, highestSequence_) < 0) {
+        counters_.packetsReordered.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        highestSequence_ = sequence;
+    }
+
+    if (diff == 0 && buffered_ == 0) {
+        // Быстрый путь: пакет по порядку, буфер пуст - без копирования
+        RTPOrderedPacket packet = {payload, size, sequence, timestamp, marker};
+        bool discontinuity = pendingDiscontinuity_;
+        pendingDiscontinuity_ = false;
+        nextSequence_++;
+        gapSinceUs_ = -1;
+        if (handler) handler(packet, discontinuity, context);
+        return;
+    }
+
+    Slot& slot = slots_[sequence & kSlotMask];
+    if (slot.used) {
+        counters_.packetsDuplicate.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    slot.used = true;
+    slot.sequence = sequence;
+    slot.timestamp = timestamp;
+    slot.marker = marker;
+    slot.payload.assign(payload, payload + size);
+    buffered_++;
+
+    drain(nowUs, handler, context);
+}
+
+void RTPJitterBuffer::drain(int64_t nowUs, RTPOrderedPacketHandler handler, void* context) {
+    while (buffered_ > 0) {
+        Slot& slot = slots_[nextSequence_ & kSlotMask];
+        if (slot.used && slot.sequence == nextSequence_) {
+            emit(slot, handler, context);
+            nextSequence_++;
+            gapSinceUs_ = -1;
+            continue;
+        }
+
+        // Пропуск номера: ждем не дольше глубины буфера
+        if (gapSinceUs_ < 0) {
+            gapSinceUs_ = nowUs;
+        }
+        bool expired = nowUs - gapSinceUs_ >= static_cast<int64_t>(depthMs_) * 1000;
+        bool overflow = buffered_ >= kCapacity / 2;
+        if (!expired && !overflow) {
+            break;
+        }
+
+        // Пропущенные номера признаются потерянными
+        uint16_t sequence = nextSequence_;
+        uint64_t skipped = 0;
+        while (!(slots_[sequence & kSlotMask].used && slots_[sequence & kSlotMask].sequence == sequence)) {
+            sequence++;
+            skipped++;
+        }
+        counters_.packetsLost.fetch_add(skipped, std::memory_order_relaxed);
+        nextSequence_ = sequence;
+        pendingDiscontinuity_ = true;
+        gapSinceUs_ = -1;
+    }
+}
+
+void RTPJitterBuffer::emit(Slot& slot, RTPOrderedPacketHandler handler, void* context) {
+    RTPOrderedPacket packet = {slot.payload.data(), slot.payload.size(), slot.sequence,
+                               slot.timestamp, slot.marker};
+    bool discontinuity = pendingDiscontinuity_;
+    pendingDiscontinuity_ = false;
+    slot.used = false;
+    buffered_--;
+    if (handler) handler(packet, discontinuity, context);
+}
+
+void RTPJitterBuffer::flushAll(RTPOrderedPacketHandler handler, void* context) {
+    for (int i = 0; i < kCapacity && buffered_ > 0; i++) {
+        Slot& slot = slots_[nextSequence_ & kSlotMask];
+        if (slot.used && slot.sequence == nextSequence_) {
+            emit(slot, handler, context);
+        } else {
+            pendingDiscontinuity_ = true;
+        }
+        nextSequence_++;
+    }
+    gapSinceUs_ = -1;
+}
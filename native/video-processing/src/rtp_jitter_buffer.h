@@ -0,0 +1,86 @@
+#ifndef RTP_JITTER_BUFFER_H
+#define RTP_JITTER_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Счетчики RTP потока. Обновляются потоком приема, читаются из любого потока.
+struct RTPStreamCounters {
+    std::atomic<uint64_t> packetsReceived;
+    std::atomic<uint64_t> packetsLost;          // Пропуски номеров, признанные потерей
+    std::atomic<uint64_t> packetsReordered;     // Пришли не по порядку, но вовремя
+    std::atomic<uint64_t> packetsLate;          // Пришли после того, как их номер пропущен
+    std::atomic<uint64_t> packetsDuplicate;
+    std::atomic<uint64_t> framesDropped;        // Отброшенные неполные кадры
+    std::atomic<uint64_t> kernelDrops;          // Отброшены ядром до приема (SO_RXQ_OVFL)
+
+    RTPStreamCounters() : packetsReceived(0), packetsLost(0), packetsReordered(0),
+                          packetsLate(0), packetsDuplicate(0), framesDropped(0), kernelDrops(0) {}
+};
+
+// Пакет на выходе буфера (только полезная нагрузка и поля заголовка)
+struct RTPOrderedPacket {
+    const uint8_t* payload;
+    size_t size;
+    uint16_t sequence;
+    uint32_t timestamp;
+    bool marker;
+};
+
+// Обработчик упорядоченных пакетов. discontinuity = true, если перед пакетом
+// были потеряны пакеты (неполный кадр нужно отбросить).
+typedef void (*RTPOrderedPacketHandler)(const RTPOrderedPacket& packet, bool discontinuity,
+                                        void* context);
+
+// Буфер переупорядочивания RTP пакетов по 16-битному номеру последовательности.
+// Пакеты по порядку выдаются сразу; при пропуске номера буфер ждет недостающий
+// пакет не дольше заданной глубины, после чего пропуск считается потерей.
+class RTPJitterBuffer {
+public:
+    // Емкость окна в пакетах (степень двойки)
+    static const int kCapacity = 1024;
+    static const int kDefaultDepthMs = 50;
+
+    RTPJitterBuffer();
+
+    // Глубина ожидания пропущенных пакетов (0 - без ожидания)
+    void setDepth(int depthMs);
+    int depth() const { return depthMs_; }
+
+    // Добавление пакета и выдача всех пакетов, готовых по порядку
+    void insert(const uint8_t* payload, size_t size, uint16_t sequence, uint32_t timestamp,
+                bool marker, int64_t nowUs, RTPOrderedPacketHandler handler, void* context);
+
+    // Сброс состояния (смена SSRC, переподключение)
+    void reset();
+
+    RTPStreamCounters& counters() { return counters_; }
+    const RTPStreamCounters& counters() const { return counters_; }
+
+private:
+    struct Slot {
+        bool used;
+        uint16_t sequence;
+        uint32_t timestamp;
+        bool marker;
+        std::vector<uint8_t> payload;   // Емкость сохраняется между пакетами
+    };
+
+    void drain(int64_t nowUs, RTPOrderedPacketHandler handler, void* context);
+    void emit(Slot& slot, RTPOrderedPacketHandler handler, void* context);
+    void flushAll(RTPOrderedPacketHandler handler, void* context);
+
+    std::vector<Slot> slots_;
+    int depthMs_;
+    bool started_;
+    uint16_t nextSequence_;
+    uint16_t highestSequence_;
+    int buffered_;
+    int64_t gapSinceUs_;            // Момент обнаружения пропуска (0 - пропуска нет)
+    bool pendingDiscontinuity_;
+    RTPStreamCounters counters_;
+};
+
+#endif // RTP_JITTER_BUFFER_H
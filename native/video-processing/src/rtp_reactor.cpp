@@ -0,0 +1,281 @@
+#include "rtp_reactor.h"
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Число виртуальных узлов на поток в кольце consistent hashing
+const int kVirtualNodesPerThread = 64;
+const int kMaxEventsPerWait = 64;
+const int kWaitTimeoutMs = 1000;
+
+// splitmix64: равномерное перемешивание ключей и виртуальных узлов
+uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+RTPReactor& RTPReactor::instance() {
+    static RTPReactor reactor;
+    return reactor;
+}
+
+bool RTPReactor::isSupported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+RTPReactor::RTPReactor() : running_(false), stopping_(false) {}
+
+RTPReactor::~RTPReactor() {
+    shutdown();
+}
+
+int RTPReactor::threadCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(workers_.size());
+}
+
+void RTPReactor::buildRing(int threadCount) {
+    ring_.clear();
+    for (int t = 0; t < threadCount; t++) {
+        for (int v = 0; v < kVirtualNodesPerThread; v++) {
+            uint64_t node = (static_cast<uint64_t>(t) << 32) | static_cast<uint64_t>(v);
+            ring_[mix64(node)] = t;
+        }
+    }
+}
+
+int RTPReactor::threadForKey(uint64_t key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ring_.empty()) return -1;
+    auto it = ring_.lower_bound(mix64(key));
+    if (it == ring_.end()) it = ring_.begin();
+    return it->second;
+}
+
+bool RTPReactor::start(int threadCount) {
+#ifdef __linux__
+    if (threadCount <= 0) {
+        threadCount = static_cast<int>(std::thread::hardware_concurrency());
+        if (threadCount <= 0) threadCount = 1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            if (static_cast<int>(workers_.size()) == threadCount) return true;
+            if (!registrations_.empty()) return false;
+        }
+    }
+
+    // Перезапуск с другим числом потоков (сокетов нет)
+    shutdown();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < threadCount; i++) {
+        std::shared_ptr<Worker> worker(new Worker());
+        worker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        worker->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        worker->iterations = 0;
+        worker->stopped = false;
+
+        if (worker->epollFd < 0 || worker->wakeFd < 0) {
+            if (worker->epollFd >= 0) close(worker->epollFd);
+            if (worker->wakeFd >= 0) close(worker->wakeFd);
+            break;
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;  // nullptr - событие пробуждения
+        epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, worker->wakeFd, &ev);
+
+        workers_.push_back(std::move(worker));
+    }
+
+    if (workers_.empty()) return false;
+
+    buildRing(static_cast<int>(workers_.size()));
+    stopping_ = false;
+    running_ = true;
+
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&RTPReactor::run, this, worker.get());
+    }
+    return true;
+#else
+    (void)threadCount;
+    return false;
+#endif
+}
+
+void RTPReactor::shutdown() {
+#ifdef __linux__
+    std::vector<std::shared_ptr<Worker>> workers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        stopping_ = true;
+        for (auto& worker : workers_) {
+            wake(worker.get());
+        }
+        workers.swap(workers_);
+    }
+
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        worker->stopped.store(true, std::memory_order_release);
+        for (auto* reg : worker->graveyard) {
+            delete reg;
+        }
+        close(worker->epollFd);
+        close(worker->wakeFd);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Оставшиеся регистрации больше не обслуживаются
+    for (auto& pair : registrations_) {
+        delete pair.second;
+    }
+    registrations_.clear();
+    ring_.clear();
+    running_ = false;
+    stopping_ = false;
+#endif
+}
+
+void RTPReactor::wake(Worker* worker) {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t written = write(worker->wakeFd, &one, sizeof(one));
+    (void)written;
+#else
+    (void)worker;
+#endif
+}
+
+bool RTPReactor::registerSocket(int fd, uint64_t clientKey, ReadyHandler handler, void* context) {
+#ifdef __linux__
+    if (fd < 0 || !handler) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_ || ring_.empty() || registrations_.count(fd)) return false;
+
+    auto it = ring_.lower_bound(mix64(clientKey));
+    if (it == ring_.end()) it = ring_.begin();
+    int threadIndex = it->second;
+
+    Registration* reg = new Registration();
+    reg->fd = fd;
+    reg->handler = handler;
+    reg->context = context;
+    reg->alive = true;
+    reg->threadIndex = threadIndex;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = reg;
+    if (epoll_ctl(workers_[threadIndex]->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        delete reg;
+        return false;
+    }
+
+    registrations_[fd] = reg;
+    return true;
+#else
+    (void)fd;
+    (void)clientKey;
+    (void)handler;
+    (void)context;
+    return false;
+#endif
+}
+
+void RTPReactor::unregisterSocket(int fd) {
+#ifdef __linux__
+    std::shared_ptr<Worker> worker;
+    Registration* reg = nullptr;
+    uint64_t iteration = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = registrations_.find(fd);
+        if (it == registrations_.end()) return;
+
+        reg = it->second;
+        registrations_.erase(it);
+        reg->alive.store(false, std::memory_order_release);
+
+        worker = workers_[reg->threadIndex];
+        epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, fd, nullptr);
+
+        if (worker->thread.get_id() == std::this_thread::get_id()) {
+            // Вызов из обработчика: удаление после завершения текущей итерации
+            std::lock_guard<std::mutex> graveyardLock(worker->graveyardMutex);
+            worker->graveyard.push_back(reg);
+            return;
+        }
+
+        iteration = worker->iterations.load(std::memory_order_acquire);
+        wake(worker.get());
+    }
+
+    // Ожидание завершения итерации, в которой обработчик мог выполняться
+    while (worker->iterations.load(std::memory_order_acquire) == iteration &&
+           !worker->stopped.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    delete reg;
+#else
+    (void)fd;
+#endif
+}
+
+void RTPReactor::run(Worker* worker) {
+#ifdef __linux__
+    struct epoll_event events[kMaxEventsPerWait];
+
+    while (!stopping_.load(std::memory_order_acquire)) {
+        int count = epoll_wait(worker->epollFd, events, kMaxEventsPerWait, kWaitTimeoutMs);
+
+        for (int i = 0; i < count; i++) {
+            Registration* reg = static_cast<Registration*>(events[i].data.ptr);
+            if (!reg) {
+                uint64_t value;
+                ssize_t readBytes = read(worker->wakeFd, &value, sizeof(value));
+                (void)readBytes;
+                continue;
+            }
+            if (reg->alive.load(std::memory_order_acquire)) {
+                reg->handler(reg->fd, reg->context);
+            }
+        }
+
+        worker->iterations.fetch_add(1, std::memory_order_release);
+
+        std::lock_guard<std::mutex> graveyardLock(worker->graveyardMutex);
+        for (auto* reg : worker->graveyard) {
+            delete reg;
+        }
+        worker->graveyard.clear();
+    }
+#else
+    (void)worker;
+#endif
+}
@@ -0,0 +1,85 @@
+#ifndef RTP_REACTOR_H
+#define RTP_REACTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Общий реактор ввода-вывода для RTP/RTCP сокетов всех RTSP клиентов.
+// N потоков epoll (по умолчанию по числу ядер) вместо потока на каждую камеру.
+// Клиент закрепляется за потоком по consistent hashing своего ключа, поэтому
+// все его сокеты обслуживаются одним потоком, а при изменении числа потоков
+// переезжает лишь небольшая часть клиентов.
+// Доступен только на Linux; на других платформах isSupported() == false.
+class RTPReactor {
+public:
+    // Обработчик готовности сокета к чтению (вызывается в потоке реактора)
+    typedef void (*ReadyHandler)(int fd, void* context);
+
+    static RTPReactor& instance();
+
+    static bool isSupported();
+
+    // Запуск потоков реактора (0 = число ядер). Повторный вызов с другим
+    // числом потоков допустим только когда нет зарегистрированных сокетов.
+    bool start(int threadCount);
+
+    // Остановка потоков реактора
+    void shutdown();
+
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+
+    int threadCount() const;
+
+    // Индекс потока, за которым закреплен клиент с данным ключом
+    int threadForKey(uint64_t key) const;
+
+    // Регистрация сокета в потоке клиента (level-triggered EPOLLIN)
+    bool registerSocket(int fd, uint64_t clientKey, ReadyHandler handler, void* context);
+
+    // Снятие сокета с обслуживания. После возврата обработчик для fd
+    // гарантированно не выполняется и не будет вызван.
+    void unregisterSocket(int fd);
+
+    ~RTPReactor();
+
+private:
+    RTPReactor();
+    RTPReactor(const RTPReactor&) = delete;
+    RTPReactor& operator=(const RTPReactor&) = delete;
+
+    struct Registration {
+        int fd;
+        ReadyHandler handler;
+        void* context;
+        std::atomic<bool> alive;
+        int threadIndex;
+    };
+
+    struct Worker {
+        int epollFd;
+        int wakeFd;
+        std::thread thread;
+        std::atomic<uint64_t> iterations;
+        std::atomic<bool> stopped;              // Поток реактора завершен
+        std::vector<Registration*> graveyard;   // Удаляются в конце итерации
+        std::mutex graveyardMutex;
+    };
+
+    void run(Worker* worker);
+    void wake(Worker* worker);
+    void buildRing(int threadCount);
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<Worker>> workers_;
+    std::map<uint64_t, int> ring_;              // Кольцо consistent hashing
+    std::map<int, Registration*> registrations_;
+    std::atomic<bool> running_;
+    std::atomic<bool> stopping_;
+};
+
+#endif // RTP_REACTOR_H
@@ -0,0 +1,414 @@
+#include "rtsp_auth.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+const uint32_t kMd5K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+const int kMd5Shift[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+const uint32_t kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+uint32_t rotate_left(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+uint32_t rotate_right(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+// Дополнение сообщения до блоков по 64 байта: 0x80, нули и длина в битах
+std::vector<uint8_t> pad_message(const std::string& data, bool bigEndianLength) {
+    std::vector<uint8_t> message(data.begin(), data.end());
+    uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+    message.push_back(0x80);
+    while (message.size() % 64 != 56) {
+        message.push_back(0);
+    }
+    for (int i = 0; i < 8; i++) {
+        int shift = bigEndianLength ? (7 - i) * 8 : i * 8;
+        message.push_back(static_cast<uint8_t>(bits >> shift));
+    }
+    return message;
+}
+
+std::string to_hex(const uint8_t* data, size_t size) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++) {
+        hex.push_back(kDigits[data[i] >> 4]);
+        hex.push_back(kDigits[data[i] & 0x0F]);
+    }
+    return hex;
+}
+
+std::string to_lower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+std::string base64_encode(const std::string& input) {
+    static const char kChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string encoded;
+    size_t i = 0;
+    for (; i + 2 < input.size(); i += 3) {
+        uint32_t value = (static_cast<uint8_t>(input[i]) << 16) |
+                         (static_cast<uint8_t>(input[i + 1]) << 8) | static_cast<uint8_t>(input[i + 2]);
+        encoded.push_back(kChars[(value >> 18) & 0x3F]);
+        encoded.push_back(kChars[(value >> 12) & 0x3F]);
+        encoded.push_back(kChars[(value >> 6) & 0x3F]);
+        encoded.push_back(kChars[value & 0x3F]);
+    }
+    if (i < input.size()) {
+        uint32_t value = static_cast<uint8_t>(input[i]) << 16;
+        if (i + 1 < input.size()) value |= static_cast<uint8_t>(input[i + 1]) << 8;
+        encoded.push_back(kChars[(value >> 18) & 0x3F]);
+        encoded.push_back(kChars[(value >> 12) & 0x3F]);
+        encoded.push_back(i + 1 < input.size() ? kChars[(value >> 6) & 0x3F] : '=');
+        encoded.push_back('=');
+    }
+    return encoded;
+}
+
+// Строка в кавычках для параметров Authorization (RFC 7230, quoted-string)
+std::string quoted(const std::string& value) {
+    std::string result = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') result.push_back('\\');
+        result.push_back(c);
+    }
+    result.push_back('"');
+    return result;
+}
+
+// Вызов сервера: схема и параметры (имена в нижнем регистре)
+struct Challenge {
+    std::string scheme;
+    std::map<std::string, std::string> params;
+
+    std::string param(const std::string& name) const {
+        auto it = params.find(name);
+        return it != params.end() ? it->second : std::string();
+    }
+};
+
+// Разбор значения WWW-Authenticate: <схема> name=value, name="quoted", ...
+Challenge parse_challenge(const std::string& value) {
+    Challenge challenge;
+    size_t pos = value.find_first_not_of(" \t");
+    if (pos == std::string::npos) return challenge;
+
+    size_t schemeEnd = value.find_first_of(" \t", pos);
+    if (schemeEnd == std::string::npos) schemeEnd = value.size();
+    challenge.scheme = to_lower(value.substr(pos, schemeEnd - pos));
+    pos = schemeEnd;
+
+    while (pos < value.size()) {
+        pos = value.find_first_not_of(" \t,", pos);
+        if (pos == std::string::npos) break;
+
+        size_t equals = value.find('=', pos);
+        if (equals == std::string::npos) break;
+        std::string name = value.substr(pos, equals - pos);
+        name.erase(name.find_last_not_of(" \t") + 1);
+        pos = value.find_first_not_of(" \t", equals + 1);
+        if (pos == std::string::npos) pos = value.size();
+
+        std::string paramValue;
+        if (pos < value.size() && value[pos] == '"') {
+            for (pos++; pos < value.size() && value[pos] != '"'; pos++) {
+                if (value[pos] == '\\' && pos + 1 < value.size()) pos++;
+                paramValue.push_back(value[pos]);
+            }
+            pos++;
+        } else {
+            size_t end = value.find(',', pos);
+            if (end == std::string::npos) end = value.size();
+            paramValue = value.substr(pos, end - pos);
+            paramValue.erase(paramValue.find_last_not_of(" \t") + 1);
+            pos = end;
+        }
+        challenge.params[to_lower(name)] = paramValue;
+    }
+    return challenge;
+}
+
+// Стойкость вызова: 0 - не поддерживается
+int challenge_rank(const Challenge& challenge) {
+    if (challenge.scheme == "basic") return 1;
+    if (challenge.scheme != "digest" || challenge.param("nonce").empty()) return 0;
+
+    std::string algorithm = to_lower(challenge.param("algorithm"));
+    if (algorithm.empty() || algorithm == "md5" || algorithm == "md5-sess") return 2;
+    if (algorithm == "sha-256" || algorithm == "sha-256-sess") return 3;
+    return 0;
+}
+
+// Значения всех заголовков WWW-Authenticate ответа
+std::vector<std::string> authenticate_headers(const std::string& response) {
+    static const char kName[] = "www-authenticate";
+    const size_t nameLength = sizeof(kName) - 1;
+
+    std::vector<std::string> values;
+    size_t headerEnd = response.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) headerEnd = response.size();
+
+    size_t lineStart = response.find("\r\n");
+    while (lineStart != std::string::npos && lineStart < headerEnd) {
+        lineStart += 2;
+        size_t lineEnd = response.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos) lineEnd = response.size();
+
+        if (lineEnd - lineStart > nameLength && response[lineStart + nameLength] == ':' &&
+            to_lower(response.substr(lineStart, nameLength)) == kName) {
+            values.push_back(response.substr(lineStart + nameLength + 1, lineEnd - lineStart - nameLength - 1));
+        }
+        lineStart = lineEnd;
+    }
+    return values;
+}
+
+std::string random_client_nonce() {
+    static thread_local std::mt19937_64 generator(std::random_device{}());
+    uint8_t bytes[16];
+    for (size_t i = 0; i < sizeof(bytes); i += 8) {
+        uint64_t value = generator();
+        memcpy(bytes + i, &value, 8);
+    }
+    return to_hex(bytes, sizeof(bytes));
+}
+
+} // namespace
+
+std::string RTSPAuthenticator::md5Hex(const std::string& data) {
+    uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    std::vector<uint8_t> message = pad_message(data, false);
+
+    for (size_t offset = 0; offset < message.size(); offset += 64) {
+        uint32_t words[16];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = &message[offset + i * 4];
+            words[i] = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        for (int i = 0; i < 64; i++) {
+            uint32_t f;
+            int g;
+            if (i < 16) {
+                f = (b & c) | (~b & d);
+                g = i;
+            } else if (i < 32) {
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+            } else if (i < 48) {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+            } else {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+            uint32_t rotated = rotate_left(a + f + kMd5K[i] + words[g], kMd5Shift[(i / 16) * 4 + i % 4]);
+            a = d;
+            d = c;
+            c = b;
+            b += rotated;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+    uint8_t digest[16];
+    for (int i = 0; i < 16; i++) {
+        digest[i] = static_cast<uint8_t>(state[i / 4] >> ((i % 4) * 8));
+    }
+    return to_hex(digest, sizeof(digest));
+}
+
+std::string RTSPAuthenticator::sha256Hex(const std::string& data) {
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::vector<uint8_t> message = pad_message(data, true);
+
+    for (size_t offset = 0; offset < message.size(); offset += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = &message[offset + i * 4];
+            w[i] = (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t v[8];
+        memcpy(v, state, sizeof(v));
+        for (int i = 0; i < 64; i++) {
+            uint32_t s1 = rotate_right(v[4], 6) ^ rotate_right(v[4], 11) ^ rotate_right(v[4], 25);
+            uint32_t choice = (v[4] & v[5]) ^ (~v[4] & v[6]);
+            uint32_t t1 = v[7] + s1 + choice + kSha256K[i] + w[i];
+            uint32_t s0 = rotate_right(v[0], 2) ^ rotate_right(v[0], 13) ^ rotate_right(v[0], 22);
+            uint32_t majority = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+            uint32_t t2 = s0 + majority;
+            memmove(v + 1, v, 7 * sizeof(uint32_t));
+            v[4] += t1;
+            v[0] = t1 + t2;
+        }
+        for (int i = 0; i < 8; i++) {
+            state[i] += v[i];
+        }
+    }
+
+    uint8_t digest[32];
+    for (int i = 0; i < 32; i++) {
+        digest[i] = static_cast<uint8_t>(state[i / 4] >> ((3 - i % 4) * 8));
+    }
+    return to_hex(digest, sizeof(digest));
+}
+
+RTSPAuthenticator::RTSPAuthenticator()
+    : scheme_(Scheme::None), sha256_(false), session_(false), qopAuth_(false), nonceCount_(0) {}
+
+void RTSPAuthenticator::setCredentials(const std::string& username, const std::string& password) {
+    if (username == username_ && password == password_) return;
+    username_ = username;
+    password_ = password;
+    reset();
+}
+
+void RTSPAuthenticator::reset() {
+    scheme_ = Scheme::None;
+    realm_.clear();
+    nonce_.clear();
+    opaque_.clear();
+    algorithm_.clear();
+    sha256_ = false;
+    session_ = false;
+    qopAuth_ = false;
+    nonceCount_ = 0;
+    cnonce_.clear();
+}
+
+bool RTSPAuthenticator::handleUnauthorized(const std::string& response) {
+    if (!hasCredentials()) return false;
+
+    Challenge best;
+    int bestRank = 0;
+    for (const std::string& value : authenticate_headers(response)) {
+        Challenge challenge = parse_challenge(value);
+        int rank = challenge_rank(challenge);
+        if (rank > bestRank) {
+            best = challenge;
+            bestRank = rank;
+        }
+    }
+    if (bestRank == 0) return false;
+
+    if (best.scheme == "basic") {
+        // Basic отправляется до первого вызова: повторный 401 - неверный пароль
+        if (scheme_ != Scheme::Digest) return false;
+        reset();
+        scheme_ = Scheme::Basic;
+        return true;
+    }
+
+    // Тот же nonce без stale=true - сервер отверг сам пароль
+    bool stale = to_lower(best.param("stale")) == "true";
+    std::string nonce = best.param("nonce");
+    if (scheme_ == Scheme::Digest && nonce == nonce_ && !stale) return false;
+
+    std::string algorithm = to_lower(best.param("algorithm"));
+    std::string qop = to_lower(best.param("qop"));
+
+    scheme_ = Scheme::Digest;
+    realm_ = best.param("realm");
+    nonce_ = nonce;
+    opaque_ = best.param("opaque");
+    algorithm_ = best.param("algorithm");
+    sha256_ = algorithm.compare(0, 7, "sha-256") == 0;
+    session_ = algorithm.size() > 5 && algorithm.compare(algorithm.size() - 5, 5, "-sess") == 0;
+
+    // qop - список через запятую; auth-int (хеш тела) не поддерживается
+    qopAuth_ = false;
+    size_t start = 0;
+    while (start <= qop.size()) {
+        size_t end = qop.find(',', start);
+        if (end == std::string::npos) end = qop.size();
+        std::string option = qop.substr(start, end - start);
+        option.erase(0, option.find_first_not_of(" \t"));
+        option.erase(option.find_last_not_of(" \t") + 1);
+        if (option == "auth") qopAuth_ = true;
+        start = end + 1;
+    }
+
+    nonceCount_ = 0;
+    cnonce_ = random_client_nonce();
+    return true;
+}
+
+std::string RTSPAuthenticator::hash(const std::string& data) const {
+    return sha256_ ? sha256Hex(data) : md5Hex(data);
+}
+
+std::string RTSPAuthenticator::authorization(const std::string& method, const std::string& uri) {
+    if (!hasCredentials()) return "";
+    if (scheme_ != Scheme::Digest) {
+        return "Basic " + base64_encode(username_ + ":" + password_);
+    }
+
+    std::string ha1 = hash(username_ + ":" + realm_ + ":" + password_);
+    if (session_) {
+        ha1 = hash(ha1 + ":" + nonce_ + ":" + cnonce_);
+    }
+    std::string ha2 = hash(method + ":" + uri);
+
+    std::string header = "Digest username=" + quoted(username_) + ", realm=" + quoted(realm_) +
+                         ", nonce=" + quoted(nonce_) + ", uri=" + quoted(uri);
+    if (!algorithm_.empty()) {
+        header += ", algorithm=" + algorithm_;
+    }
+
+    if (qopAuth_) {
+        char nc[9];
+        snprintf(nc, sizeof(nc), "%08x", ++nonceCount_);
+        std::string response = hash(ha1 + ":" + nonce_ + ":" + nc + ":" + cnonce_ + ":auth:" + ha2);
+        header += ", response=" + quoted(response) + ", qop=auth, nc=" + nc + ", cnonce=" + quoted(cnonce_);
+    } else {
+        // RFC 2069: без qop счетчик и cnonce не передаются
+        header += ", response=" + quoted(hash(ha1 + ":" + nonce_ + ":" + ha2));
+    }
+
+    if (!opaque_.empty()) {
+        header += ", opaque=" + quoted(opaque_);
+    }
+    return header;
+}
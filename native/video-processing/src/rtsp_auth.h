@@ -0,0 +1,70 @@
+#ifndef RTSP_AUTH_H
+#define RTSP_AUTH_H
+
+#include <cstdint>
+#include <string>
+
+// Авторизация RTSP запросов: Basic (RFC 7617) и Digest с MD5/SHA-256
+// (RFC 2617, RFC 7616), включая варианты -sess и qop=auth.
+//
+// Вызов сервера (WWW-Authenticate из ответа 401) запоминается и используется
+// во всех следующих запросах и после переподключения: пока nonce действителен,
+// сервер принимает запрос сразу и установка сессии не тратит RTT на 401.
+// Устаревший nonce (stale=true) заменяется без повторной проверки пароля.
+// Не потокобезопасен: вызывается под мьютексом клиента.
+class RTSPAuthenticator {
+public:
+    enum class Scheme {
+        None,       // Вызова еще не было
+        Basic,
+        Digest
+    };
+
+    RTSPAuthenticator();
+
+    // Учетные данные. Смена пользователя или пароля сбрасывает сохраненный вызов.
+    void setCredentials(const std::string& username, const std::string& password);
+    bool hasCredentials() const { return !username_.empty() && !password_.empty(); }
+
+    // Разбор заголовков WWW-Authenticate ответа 401; из нескольких вызовов
+    // выбирается самый стойкий (SHA-256, MD5, Basic). true - запрос стоит
+    // повторить с новой авторизацией; false - учетные данные отвергнуты
+    // (тот же nonce без stale) или схема не поддерживается.
+    bool handleUnauthorized(const std::string& response);
+
+    // Значение заголовка Authorization для запроса ("" - без авторизации).
+    // До первого вызова сервера отправляется Basic. Счетчик nc растет с каждым
+    // запросом, поэтому заголовок строится для каждого запроса заново.
+    std::string authorization(const std::string& method, const std::string& uri);
+
+    Scheme scheme() const { return scheme_; }
+    const std::string& nonce() const { return nonce_; }
+
+    // Забыть вызов сервера (новый сервер или учетные данные)
+    void reset();
+
+    // Фиксированный cnonce текущего вызова вместо случайного (воспроизводимые тесты)
+    void setClientNonce(const std::string& cnonce) { cnonce_ = cnonce; }
+
+    static std::string md5Hex(const std::string& data);
+    static std::string sha256Hex(const std::string& data);
+
+private:
+    std::string hash(const std::string& data) const;
+
+    std::string username_;
+    std::string password_;
+
+    Scheme scheme_;
+    std::string realm_;
+    std::string nonce_;
+    std::string opaque_;
+    std::string algorithm_;     // Как в вызове ("" - MD5 по умолчанию)
+    bool sha256_;
+    bool session_;              // Вариант -sess: HA1 зависит от nonce и cnonce
+    bool qopAuth_;
+    uint32_t nonceCount_;
+    std::string cnonce_;
+};
+
+#endif // RTSP_AUTH_H
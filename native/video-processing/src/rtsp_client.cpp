@@ -1,4 +1,21 @@
 #include "rtsp_client.h"
+#include "rtp_depacketizer.h"
+#include "rtp_jitter_buffer.h"
+#include "sdp_parameter_sets.h"
+#include "rtcp_session.h"
+#include "frame_pool.h"
+#include "frame_queue.h"
+#include "gop_cache.h"
+#include "client_stats.h"
+#include "rtp_reactor.h"
+#include "multicast_receiver.h"
+#include "udp_batch_receiver.h"
+#include "rtsp_interleaved.h"
+#include "rtsp_connector.h"
+#include "rtsp_auth.h"
+#include "dns_resolver.h"
+#include "timer_wheel.h"
+#include "session_workers.h"
 #include <string>
 #include <vector>
 #include <thread>
@@ -6,6 +23,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <memory>
+#include <deque>
 #include <sstream>
 #include <algorithm>
 #include <cstring>
@@ -15,6 +33,8 @@
 #include <regex>
 #include <cstdint>
 #include <chrono>
+#include <functional>
+#include <random>
 
 // Платформо-специфичные заголовки для сокетов
 #ifdef _WIN32
@@ -32,6 +52,7 @@
     #include <unistd.h>
     #include <fcntl.h>
     #include <errno.h>
+    #include <poll.h>
     #define INVALID_SOCKET -1
     #define SOCKET_ERROR -1
     typedef int SOCKET;
@@ -57,6 +78,9 @@ struct RTPStream {
     int serverRtcpPort;
     std::string transport;
     std::string codec;
+    std::string fmtp;           // Значение a=fmtp (параметры кодека)
+    int bitrateKbps;            // b=AS/b=TIAS из SDP (0 - не указан)
+    int receiveBufferBytes;     // Фактический SO_RCVBUF RTP сокета (0 - системный)
     int payloadType;
     int clockRate;
     int width;
@@ -64,15 +88,29 @@ struct RTPStream {
     int fps;
     SOCKET rtpSocket;
     SOCKET rtcpSocket;
+    int interleavedRtpChannel;  // Каналы RTP/RTCP в RTSP соединении (-1 - UDP)
+    int interleavedRtcpChannel;
+    std::string multicastGroup; // Группа из ответа SETUP (порты - serverRtpPort/serverRtcpPort)
+    int multicastTtl;
+    uint64_t rtpSubscription;   // Подписки MulticastReceiver (0 - нет)
+    uint64_t rtcpSubscription;
     uint16_t rtpSequence;
     uint32_t rtpSSRC;
     uint32_t rtpTimestamp;
     std::vector<uint8_t> buffer;
+    RTPDepacketizer depacketizer;
+    std::unique_ptr<RTPJitterBuffer> jitterBuffer;
+    std::unique_ptr<RTCPSession> rtcp;
+    RTSPClient* owner;  // Клиент-владелец (контекст обработчиков реактора)
 
     RTPStream() : clientRtpPort(0), clientRtcpPort(0), serverRtpPort(0), serverRtcpPort(0),
+                  bitrateKbps(0), receiveBufferBytes(0),
                   payloadType(96), clockRate(90000), width(0), height(0), fps(0),
                   rtpSocket(INVALID_SOCKET), rtcpSocket(INVALID_SOCKET),
-                  rtpSequence(0), rtpSSRC(0), rtpTimestamp(0) {}
+                  interleavedRtpChannel(-1), interleavedRtcpChannel(-1), multicastTtl(0),
+                  rtpSubscription(0), rtcpSubscription(0), rtpSequence(0), rtpSSRC(0), rtpTimestamp(0),
+                  jitterBuffer(new RTPJitterBuffer()), rtcp(new RTCPSession()),
+                  owner(nullptr) {}
 };
 
 // Структура для парсинга URL
@@ -85,6 +123,64 @@ struct RTSPUrl {
     std::string password;
 };
 
+struct RTSPStream {
+    RTSPStreamType type;
+    int width;
+    int height;
+    int fps;
+    std::string codec;
+    std::vector<uint8_t> extradata;     // VPS/SPS/PPS из SDP в формате Annex-B
+};
+
+static void stop_rtp_reception(RTSPClient* client);
+static void release_rtp_streams(RTSPClient* client);
+static void schedule_keepalive(RTSPClient* client, int delayMs);
+static void handle_connection_lost(RTSPClient* client, const char* message);
+static void schedule_keyframe_request(RTSPClient* client, int delayMs);
+
+// Время ожидания первого RTP пакета по UDP в режиме AUTO
+static const int kDefaultUdpFallbackTimeoutMs = 3000;
+
+// Таймаут сессии, если сервер его не указал (RFC 2326, 12.37)
+static const int kDefaultSessionTimeoutSec = 60;
+
+// Повтор keepalive, пока клиент занят другим запросом
+static const int kKeepaliveRetryMs = 1000;
+
+// Средний интервал RTCP receiver report (RFC 3550, 6.2)
+static const int kRtcpReportIntervalMs = 5000;
+
+// Повтор отправки запроса ключевого кадра, пока мьютекс клиента занят
+static const int kKeyframeRequestRetryMs = 20;
+
+// Запись в разорванное соединение не должна завершать процесс по SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+// Шаги установки RTSP сессии. Один автомат используется синхронным подключением
+// (блокирующий сокет) и асинхронным (неблокирующий цикл RTSPConnector).
+enum RTSPHandshakeStep {
+    HANDSHAKE_OPTIONS,
+    HANDSHAKE_DESCRIBE,
+    HANDSHAKE_SETUP,
+    HANDSHAKE_DONE
+};
+
+// Отправленный запрос установки сессии, ожидающий ответа
+struct RTSPPendingRequest {
+    RTSPHandshakeStep step;
+    size_t setupIndex;
+    long cseq;
+    bool pipelined;     // Отправлен конвейером вместе с другими запросами
+    bool ignored;       // Ответ не нужен: запрос будет отправлен повторно
+};
+
+// Повторы запроса установки сессии после 401 (новый или устаревший nonce)
+static const int kMaxAuthRetries = 3;
+
 struct RTSPClient {
     std::string url;
     std::string username;
@@ -105,7 +201,6 @@ struct RTSPClient {
     std::mutex mutex;
     std::thread receiveThread;
     std::thread rtpThread;
-    std::thread reconnectThread;
 
     // Параметры автоматического переподключения
     RTSPReconnectParams reconnectParams;
@@ -113,7 +208,54 @@ struct RTSPClient {
     std::atomic<int> reconnectAttempts;
     std::atomic<bool> isReconnecting;
 
+    // Глубина jitter буфера RTP потоков (мс)
+    int jitterBufferDepthMs;
+
+    // SO_RCVBUF RTP сокетов по типу потока (0 - по битрейту из SDP, -1 - системный)
+    int receiveBufferSize[3];
+
+    // Прием RTP через общий реактор вместо отдельного потока
+    bool useSharedReactor;
+    bool reactorRegistered;
+
+    // Транспорт RTP: выбранный режим и фактически согласованный в SETUP
+    RTSPTransport transport;
+    int udpFallbackTimeoutMs;
+    bool fallbackToTcp;         // AUTO: UDP не работает, используется TCP
+    bool interleaved;           // RTP передается внутри RTSP соединения
+    bool multicast;             // RTP принимается из multicast группы
+    std::string multicastInterface;
+    std::unique_ptr<RTSPInterleavedReader> interleavedReader;
+    int timeoutMs;
+
+    // Состояние установки сессии и асинхронного подключения: следующий запрос
+    // и запросы, отправленные конвейером и ожидающие ответа
+    RTSPHandshakeStep handshakeStep;
+    size_t handshakeSetupIndex;
+    std::deque<RTSPPendingRequest> handshakePending;
+    int handshakeAuthRetries;
+    bool pipelineRequests;          // Конвейер разрешен (снимается, если сервер его не принял)
+    uint64_t connectOperation;      // Операция RTSPConnector (0 - нет)
+    RTSPConnectCallback connectCallback;
+    void* connectUserData;
+    bool connectSucceeded;          // Результат асинхронного подключения для deliver_connect_result
+    std::string connectMessage;
+
+    // Keepalive и переподключение через общий TimerService (блокирующие шаги - в SessionWorkers)
+    std::mutex timerMutex;          // Защищает keepSession, таймеры и reconnectParams; захватывается после mutex
+    bool keepSession;               // Сессия поддерживается: от подключения до rtsp_client_disconnect
+    uint64_t keepaliveTimer;
+    uint64_t recoveryTimer;         // Переподключение или возобновление воспроизведения
+    SessionTask recoveryStep;       // Шаг, который recoveryTimer ставит в SessionWorkers
+    uint64_t rtcpTimer;             // RTCP receiver report во время воспроизведения
+    uint64_t keyframeRequestTimer;  // Отправка PLI/FIR после потери пакетов
+    uint64_t udpFallbackTimer;      // AUTO: проверка прихода RTP по UDP после PLAY
+    int sessionTimeoutSec;
+    bool keepaliveGetParameter;     // Сервер поддерживает GET_PARAMETER
+    bool resumePlayback;            // Возобновить воспроизведение после переподключения
+
     // RTSP протокол
+    RTSPAuthenticator auth;         // Вызов сервера сохраняется между запросами и переподключениями
     RTSPUrl rtspUrl;
     SOCKET rtspSocket;
     std::string sessionId;
@@ -121,6 +263,26 @@ struct RTSPClient {
     std::string baseUrl;
     std::vector<RTPStream> rtpStreams;
 
+    // Пул буферов кадров (переживает клиента, пока кадры не освобождены)
+    FramePool* framePool;
+
+    // Очередь кадров между приемом и callback (nullptr - callback в потоке приема).
+    // rtsp_client_dispatch_frames держит свою ссылку, пока выдает кадры.
+    std::shared_ptr<FrameQueue> frameQueue;
+    bool externalDispatch;          // Кадры выдает rtsp_client_dispatch_frames
+    std::thread dispatchThread;
+    // Извлечение кадров в режиме externalDispatch и замена очереди. Захватывается
+    // после mutex; под ним не ждут кадров и не вызывают callback'и.
+    std::mutex dispatchMutex;
+
+    // Последний GOP видео для мгновенного старта нового подписчика
+    GopCache gopCache;
+    std::atomic<bool> gopReplayPending;     // Выдать GOP текущему callback перед следующим кадром
+    std::atomic<uint64_t> gopReplays;
+
+    // Статистика для мониторинга (rtsp_client_get_stats)
+    ClientStats stats;
+
 #ifdef ENABLE_FFMPEG
     AVFormatContext* formatContext;
     AVCodecContext* videoCodecContext;
@@ -134,12 +296,26 @@ struct RTSPClient {
                    shouldStop(false), videoCallback(nullptr), audioCallback(nullptr),
                    statusCallback(nullptr), videoUserData(nullptr), audioUserData(nullptr),
                    statusUserData(nullptr), rtspSocket(INVALID_SOCKET), cseq(1),
-                   reconnectEnabled(false), reconnectAttempts(0), isReconnecting(false)
+                   reconnectEnabled(false), reconnectAttempts(0), isReconnecting(false),
+                   jitterBufferDepthMs(RTPJitterBuffer::kDefaultDepthMs),
+                   useSharedReactor(false), reactorRegistered(false),
+                   transport(RTSP_TRANSPORT_UDP), udpFallbackTimeoutMs(kDefaultUdpFallbackTimeoutMs),
+                   fallbackToTcp(false), interleaved(false), multicast(false), timeoutMs(5000),
+                   handshakeStep(HANDSHAKE_DONE), handshakeSetupIndex(0), handshakeAuthRetries(0),
+                   pipelineRequests(true), connectOperation(0),
+                   connectCallback(nullptr), connectUserData(nullptr), connectSucceeded(false),
+                   keepSession(false), keepaliveTimer(0), recoveryTimer(0), recoveryStep(nullptr), rtcpTimer(0),
+                   keyframeRequestTimer(0), udpFallbackTimer(0),
+                   sessionTimeoutSec(kDefaultSessionTimeoutSec), keepaliveGetParameter(false),
+                   resumePlayback(false),
+                   framePool(FramePool::create()), externalDispatch(false),
+                   gopReplayPending(false), gopReplays(0)
 #ifdef ENABLE_FFMPEG
                    , formatContext(nullptr), videoCodecContext(nullptr), audioCodecContext(nullptr),
                    swsContext(nullptr), videoStreamIndex(-1), audioStreamIndex(-1)
 #endif
     {
+        std::fill(std::begin(receiveBufferSize), std::end(receiveBufferSize), 0);
 #ifdef _WIN32
         WSADATA wsaData;
         WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -150,31 +326,24 @@ struct RTSPClient {
         shouldStop = true;
         reconnectEnabled = false;
 
-        // Ожидание завершения потока переподключения
-        if (reconnectThread.joinable()) {
-            reconnectThread.join();
-        }
+        // Остановка приема RTP до закрытия сокетов
+        playing = false;
+        stop_rtp_reception(this);
 
         // Отключение от сервера
         if (rtspSocket != INVALID_SOCKET) {
             close(rtspSocket);
             rtspSocket = INVALID_SOCKET;
         }
-        for (auto* stream : streams) {
-            delete stream;
-        }
-        streams.clear();
 
         // Закрытие RTP сокетов
-        for (auto& rtpStream : rtpStreams) {
-            if (rtpStream.rtpSocket != INVALID_SOCKET) {
-                close(rtpStream.rtpSocket);
-            }
-            if (rtpStream.rtcpSocket != INVALID_SOCKET) {
-                close(rtpStream.rtcpSocket);
-            }
-        }
-        rtpStreams.clear();
+        release_rtp_streams(this);
+
+        // Оставшиеся в очереди кадры возвращаются в пул до отказа от него
+        frameQueue.reset();
+        gopCache.clear();
+        framePool->detach();
+        framePool = nullptr;
 
 #ifdef _WIN32
         WSACleanup();
@@ -182,14 +351,6 @@ struct RTSPClient {
     }
 };
 
-struct RTSPStream {
-    RTSPStreamType type;
-    int width;
-    int height;
-    int fps;
-    std::string codec;
-};
-
 // Вспомогательные функции для работы с RTSP протоколом
 
 // Парсинг RTSP URL
@@ -232,19 +393,13 @@ static SOCKET create_tcp_socket(const std::string& host, int port, int timeout_m
     setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
 #endif
 
-    // Получение адреса
+    // Получение адреса через общий кэширующий резолвер
     struct sockaddr_in serverAddr;
-    memset(&serverAddr, 0, sizeof(serverAddr));
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(port);
-
-    struct hostent* hostEntry = gethostbyname(host.c_str());
-    if (!hostEntry) {
+    if (!DNSResolver::instance().resolve(host, serverAddr, timeout_ms)) {
         close(sock);
         return INVALID_SOCKET;
     }
-
-    memcpy(&serverAddr.sin_addr, hostEntry->h_addr_list[0], hostEntry->h_length);
+    serverAddr.sin_port = htons(port);
 
     // Подключение
     if (connect(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
@@ -281,45 +436,26 @@ static SOCKET create_udp_socket(int& port) {
     return sock;
 }
 
-// Base64 кодировка
-static std::string base64_encode(const std::string& input) {
-    static const char base64_chars[] =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-    std::string encoded;
-    int val = 0, valb = -6;
-
-    for (unsigned char c : input) {
-        val = (val << 8) + c;
-        valb += 8;
-        while (valb >= 0) {
-            encoded.push_back(base64_chars[(val >> valb) & 0x3F]);
-            valb -= 6;
-        }
-    }
-
-    if (valb > -6) {
-        encoded.push_back(base64_chars[((val << 8) >> (valb + 8)) & 0x3F]);
-    }
-
-    while (encoded.size() % 4) {
-        encoded.push_back('=');
-    }
-
-    return encoded;
+// Размер приемного буфера RTP сокета потока: заданный для типа потока
+// или по битрейту из SDP (0 - системный размер)
+static int rtp_receive_buffer_size(RTSPClient* client, const RTPStream& stream) {
+    int requested = client->receiveBufferSize[stream.type];
+    if (requested < 0) return 0;
+    return requested > 0 ? requested : UDPBatchReceiver::receiveBufferForBitrate(stream.bitrateKbps);
 }
 
-// Генерация базовой HTTP аутентификации
-static std::string generate_basic_auth(const std::string& username, const std::string& password) {
-    std::string credentials = username + ":" + password;
-    std::string encoded = base64_encode(credentials);
-    return "Basic " + encoded;
+// Настройка RTP сокета: приемный буфер и счетчик отброшенных ядром датаграмм
+static void configure_rtp_socket(RTSPClient* client, RTPStream& stream) {
+    UDPBatchReceiver::enableDropCounter(stream.rtpSocket);
+    int bufferSize = rtp_receive_buffer_size(client, stream);
+    if (bufferSize > 0) {
+        stream.receiveBufferBytes = UDPBatchReceiver::setReceiveBufferSize(stream.rtpSocket, bufferSize);
+    }
 }
 
-// Отправка RTSP запроса
-static bool send_rtsp_request(SOCKET sock, const std::string& method, const std::string& url,
-                              const std::string& headers, const std::string& body,
-                              std::string& response) {
+// Формирование RTSP запроса
+static std::string build_rtsp_request(const std::string& method, const std::string& url,
+                                      const std::string& headers, const std::string& body) {
     std::ostringstream request;
     request << method << " " << url << " RTSP/1.0\r\n";
     request << headers;
@@ -330,63 +466,134 @@ static bool send_rtsp_request(SOCKET sock, const std::string& method, const std:
     if (!body.empty()) {
         request << body;
     }
+    return request.str();
+}
 
-    std::string requestStr = request.str();
-    int sent = send(sock, requestStr.c_str(), static_cast<int>(requestStr.length()), 0);
-    if (sent == SOCKET_ERROR) {
-        return false;
+// Значение заголовка RTSP сообщения (имя без учета регистра); пустая строка - нет заголовка
+static std::string rtsp_header_value(const std::string& message, const std::string& name) {
+    size_t headerEnd = message.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) headerEnd = message.length();
+
+    // Первая строка - стартовая строка запроса или ответа
+    size_t lineStart = message.find("\r\n");
+    while (lineStart != std::string::npos && lineStart < headerEnd) {
+        lineStart += 2;
+        size_t lineEnd = message.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos) lineEnd = message.length();
+
+        if (lineEnd - lineStart > name.length() && message[lineStart + name.length()] == ':' &&
+            std::equal(name.begin(), name.end(), message.begin() + lineStart,
+                       [](char a, char b) { return tolower(a) == tolower(b); })) {
+            size_t valueStart = message.find_first_not_of(' ', lineStart + name.length() + 1);
+            if (valueStart == std::string::npos || valueStart > lineEnd) return "";
+            return message.substr(valueStart, lineEnd - valueStart);
+        }
+        lineStart = lineEnd;
     }
+    return "";
+}
+
+static long rtsp_cseq(const std::string& message) {
+    std::string value = rtsp_header_value(message, "CSeq");
+    return value.empty() ? -1 : strtol(value.c_str(), nullptr, 10);
+}
 
-    // Чтение ответа
+// Чтение ответа с заданным CSeq (-1 - любого).
+// При interleaved транспорте перед ответом могут прийти RTP пакеты ('$' кадры),
+// они пропускаются, как и ответы на более ранние запросы (keepalive).
+// pending - принятые, но еще не разобранные байты; после ответа в нем остается
+// начало следующих сообщений (ответы на запросы конвейера, RTP после PLAY).
+static bool receive_rtsp_response(SOCKET sock, long expectedCSeq, std::string& pending,
+                                  std::string& response) {
     char buffer[4096];
     response.clear();
 
     while (true) {
-        int received = recv(sock, buffer, sizeof(buffer) - 1, 0);
-        if (received <= 0) {
-            break;
+        // Пропуск interleaved пакетов перед ответом
+        while (pending.length() >= 4 && pending[0] == '$') {
+            size_t length = (static_cast<uint8_t>(pending[2]) << 8) | static_cast<uint8_t>(pending[3]);
+            if (pending.length() < 4 + length) break;
+            pending.erase(0, 4 + length);
         }
 
-        buffer[received] = '\0';
-        response += buffer;
-
-        // Проверка на конец заголовков
-        if (response.find("\r\n\r\n") != std::string::npos) {
-            // Проверка наличия тела ответа
-            size_t headerEnd = response.find("\r\n\r\n");
-            std::string headerPart = response.substr(0, headerEnd);
-
-            // Поиск Content-Length
-            size_t contentLengthPos = headerPart.find("Content-Length:");
-            if (contentLengthPos != std::string::npos) {
-                size_t valueStart = contentLengthPos + 15;
-                size_t valueEnd = headerPart.find("\r\n", valueStart);
-                int contentLength = std::stoi(headerPart.substr(valueStart, valueEnd - valueStart));
-
-                // Чтение тела ответа
-                size_t bodyStart = headerEnd + 4;
-                int bodyReceived = static_cast<int>(response.length() - bodyStart);
-
-                while (bodyReceived < contentLength) {
-                    int more = recv(sock, buffer, sizeof(buffer) - 1, 0);
-                    if (more <= 0) break;
-                    buffer[more] = '\0';
-                    response += buffer;
-                    bodyReceived += more;
+        if (!pending.empty() && pending[0] != '$') {
+            size_t length = rtsp_message_length(reinterpret_cast<const uint8_t*>(pending.data()),
+                                                pending.length());
+            if (length > 0) {
+                long cseq = rtsp_cseq(pending.substr(0, length));
+                if (expectedCSeq >= 0 && cseq >= 0 && cseq != expectedCSeq) {
+                    pending.erase(0, length);
+                    continue;
                 }
+                response = pending.substr(0, length);
+                pending.erase(0, length);
+                break;
+            }
+        }
+
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            // Соединение закрыто или таймаут: возвращаем то, что успели получить
+            if (!pending.empty() && pending[0] != '$') {
+                response = pending;
+                pending.clear();
             }
             break;
         }
+        pending.append(buffer, received);
     }
 
     return !response.empty();
 }
 
+// Отправка готового RTSP запроса и чтение ответа.
+// Байты, полученные после ответа, возвращаются в leftover.
+static bool transact_rtsp_request(SOCKET sock, const std::string& requestStr, std::string& response,
+                                  std::string* leftover = nullptr) {
+    int sent = send(sock, requestStr.c_str(), static_cast<int>(requestStr.length()), kSendFlags);
+    if (sent == SOCKET_ERROR) {
+        return false;
+    }
+
+    std::string pending;
+    bool received = receive_rtsp_response(sock, rtsp_cseq(requestStr), pending, response);
+    if (leftover) {
+        leftover->swap(pending);
+    }
+    return received;
+}
+
+// Отправка RTSP запроса
+static bool send_rtsp_request(SOCKET sock, const std::string& method, const std::string& url,
+                              const std::string& headers, const std::string& body,
+                              std::string& response, std::string* leftover = nullptr) {
+    return transact_rtsp_request(sock, build_rtsp_request(method, url, headers, body), response, leftover);
+}
+
 // Парсинг SDP ответа
+// Битрейт из значения b= (кбит/с, 0 - не поддерживаемый модификатор)
+static int parse_sdp_bandwidth(const std::string& value) {
+    size_t colonPos = value.find(':');
+    if (colonPos == std::string::npos) return 0;
+
+    std::string modifier = value.substr(0, colonPos);
+    long long bandwidth = strtoll(value.c_str() + colonPos + 1, nullptr, 10);
+    if (bandwidth <= 0) return 0;
+
+    if (modifier == "AS") {
+        return static_cast<int>(std::min<long long>(bandwidth, INT32_MAX));
+    }
+    if (modifier == "TIAS") {
+        return static_cast<int>(std::min<long long>((bandwidth + 999) / 1000, INT32_MAX));
+    }
+    return 0;
+}
+
 static bool parse_sdp(const std::string& sdp, std::vector<RTPStream>& streams, RTSPClient* client) {
     std::istringstream sdpStream(sdp);
     std::string line;
     RTPStream* currentStream = nullptr;
+    int sessionBitrateKbps = 0;
 
     while (std::getline(sdpStream, line)) {
         // Удаление \r если есть
@@ -407,9 +614,15 @@ static bool parse_sdp(const std::string& sdp, std::vector<RTPStream>& streams, R
                 stream.type = (mediaType == "video") ? RTSP_STREAM_VIDEO : RTSP_STREAM_AUDIO;
                 stream.payloadType = std::stoi(payloadType);
                 currentStream = &stream;
-                streams.push_back(stream);
+                streams.push_back(std::move(stream));
                 currentStream = &streams.back();
             }
+        } else if (line[0] == 'b' && line[1] == '=') {
+            // Bandwidth: b=AS:<кбит/с> или b=TIAS:<бит/с>, уровня сессии или потока
+            int bitrateKbps = parse_sdp_bandwidth(line.substr(2));
+            if (bitrateKbps > 0) {
+                (currentStream ? currentStream->bitrateKbps : sessionBitrateKbps) = bitrateKbps;
+            }
         } else if (line[0] == 'a' && line[1] == '=' && currentStream) {
             // Attribute
             size_t colonPos = line.find(':');
@@ -442,20 +655,33 @@ static bool parse_sdp(const std::string& sdp, std::vector<RTPStream>& streams, R
                     currentStream->controlUrl = attrValue;
                 } else if (attrName == "fmtp") {
                     // a=fmtp:96 profile-level-id=...;sprop-parameter-sets=...
-                    // Парсинг параметров кодека
+                    // Разбирается после a=rtpmap, когда известен кодек
+                    currentStream->fmtp = attrValue;
                 }
             }
         }
     }
 
     // Создание RTSPStream для каждого найденного потока
-    for (const auto& rtpStream : streams) {
+    for (auto& rtpStream : streams) {
+        if (rtpStream.bitrateKbps == 0) {
+            rtpStream.bitrateKbps = sessionBitrateKbps;
+        }
+        rtpStream.depacketizer.setCodec(rtp_payload_codec_from_name(rtpStream.codec));
+        rtpStream.jitterBuffer->setDepth(client->jitterBufferDepthMs);
+
         RTSPStream* stream = new RTSPStream();
         stream->type = rtpStream.type;
         stream->codec = rtpStream.codec;
         stream->width = rtpStream.width;
         stream->height = rtpStream.height;
         stream->fps = rtpStream.fps;
+
+        // Наборы параметров из SDP: декодер открывается без ожидания in-band SPS/PPS
+        SDPParameterSets parameterSets;
+        if (sdp_parse_parameter_sets(rtpStream.fmtp, rtpStream.depacketizer.codec(), parameterSets)) {
+            stream->extradata = sdp_build_annexb_extradata(parameterSets);
+        }
         client->streams.push_back(stream);
     }
 
@@ -496,51 +722,387 @@ static bool parse_rtsp_response(const std::string& response, int& statusCode, st
     return true;
 }
 
+// Контекст доставки собранных кадров
+struct RTPDeliveryContext {
+    RTSPClient* client;
+    RTPStream* stream;
+};
+
+// Монотонное время в микросекундах
+static int64_t steady_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Unix время в микросекундах (RTCP и время кадров)
+static int64_t wall_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Вызов callback кадра с учетом времени его выполнения
+static void invoke_frame_callback(RTSPClient* client, RTSPFrame* frame, RTSPFrameCallback callback,
+                                  void* userData) {
+    int64_t startUs = steady_now_us();
+    callback(frame, userData);
+    client->stats.recordCallbackLatency(steady_now_us() - startUs);
+}
+
+// Передача кадра подписчику: через очередь (callback вызовет поток доставки) или сразу
+static void dispatch_frame(RTSPClient* client, RTSPFrame* frame, RTSPFrameCallback callback, void* userData) {
+    if (client->frameQueue) {
+        client->frameQueue->push(frame);
+    } else {
+        invoke_frame_callback(client, frame, callback, userData);
+    }
+}
+
+// Выдача кэшированного GOP подписчику
+static void replay_gop(RTSPClient* client, RTSPFrameCallback callback, void* userData) {
+    std::vector<RTSPFrame*> frames;
+    if (client->gopCache.snapshot(frames) == 0) return;
+
+    client->gopReplays.fetch_add(1, std::memory_order_relaxed);
+    for (RTSPFrame* frame : frames) {
+        dispatch_frame(client, frame, callback, userData);
+    }
+}
+
+// Доставка собранного кадра в callback
+static void deliver_access_unit(const AccessUnit& au, void* context) {
+    RTPDeliveryContext* ctx = static_cast<RTPDeliveryContext*>(context);
+    RTSPClient* client = ctx->client;
+    RTPStream& stream = *ctx->stream;
+
+    RTSPFrameCallback callback = nullptr;
+    void* userData = nullptr;
+    if (stream.type == RTSP_STREAM_VIDEO) {
+        callback = client->videoCallback;
+        userData = client->videoUserData;
+    } else if (stream.type == RTSP_STREAM_AUDIO) {
+        callback = client->audioCallback;
+        userData = client->audioUserData;
+    }
+
+    client->stats.onFrame(stream.type == RTSP_STREAM_VIDEO);
+
+    // Без сборки по кодеку (аудио, MJPEG) каждый кадр независим
+    bool keyframe = au.keyframe || stream.depacketizer.codec() == RTPPayloadCodec::Unknown;
+
+    if (stream.type == RTSP_STREAM_VIDEO) {
+        // Ключевой кадр завершает восстановление после потери, иначе запрос повторяется
+        int64_t nowUs = wall_now_us();
+        stream.rtcp->onFrame(keyframe, nowUs);
+        if (stream.rtcp->keyframeRequestDue(nowUs)) {
+            schedule_keyframe_request(client, 0);
+        }
+    }
+
+    // Без callback кадр не создается, если его не нужно сохранить в GOP
+    bool cacheGop = stream.type == RTSP_STREAM_VIDEO && client->gopCache.enabled();
+    if (!callback && !cacheGop) return;
+
+    RTSPFrame* frame = client->framePool->acquire(au.size);
+    memcpy(frame->data, au.data, au.size);
+    frame->timestamp = stream.rtcp->frameTime(au.rtpTimestamp, frame->timestampSynchronized);
+    frame->type = stream.type;
+    frame->width = stream.width;
+    frame->height = stream.height;
+    frame->keyframe = keyframe;
+
+    if (cacheGop) {
+        // Новому подписчику сначала выдается текущий GOP (в потоке приема,
+        // чтобы кадры шли строго по порядку). С ключевого кадра он начнет и так.
+        if (client->gopReplayPending.exchange(false) && callback && !frame->keyframe) {
+            replay_gop(client, callback, userData);
+        }
+        client->gopCache.push(frame);
+    }
+
+    if (!callback) {
+        FramePool::release(frame);
+        return;
+    }
+
+    dispatch_frame(client, frame, callback, userData);
+}
+
+// Доставка кадров из очереди в callback (потребитель очереди). popMutex -
+// мьютекс извлечения, если потребителей может быть несколько; callback
+// вызывается без него.
+static int deliver_queued_frames(RTSPClient* client, FrameQueue& queue, int maxFrames,
+                                 std::mutex* popMutex) {
+    int delivered = 0;
+    while (delivered < maxFrames) {
+        RTSPFrame* frame;
+        if (popMutex) {
+            std::lock_guard<std::mutex> lock(*popMutex);
+            frame = queue.pop();
+        } else {
+            frame = queue.pop();
+        }
+        if (!frame) break;
+
+        RTSPFrameCallback callback = nullptr;
+        void* userData = nullptr;
+        if (frame->type == RTSP_STREAM_VIDEO) {
+            callback = client->videoCallback;
+            userData = client->videoUserData;
+        } else if (frame->type == RTSP_STREAM_AUDIO) {
+            callback = client->audioCallback;
+            userData = client->audioUserData;
+        }
+
+        // Callback мог быть снят, пока кадр ждал в очереди
+        if (callback) {
+            invoke_frame_callback(client, frame, callback, userData);
+            delivered++;
+        } else {
+            FramePool::release(frame);
+        }
+    }
+    return delivered;
+}
+
+// Таймаут ожидания потока доставки, после которого проверяется закрытие очереди
+static const int kDispatchWaitMs = 200;
+
+static void frame_dispatch_thread(RTSPClient* client) {
+    FrameQueue& queue = *client->frameQueue;
+    while (!queue.isClosed()) {
+        if (queue.waitForFrames(kDispatchWaitMs)) {
+            deliver_queued_frames(client, queue, queue.capacity(), nullptr);
+        }
+    }
+}
+
+// Обработка пакета, выданного jitter буфером по порядку
+static void process_ordered_packet(const RTPOrderedPacket& packet, bool discontinuity, void* context) {
+    RTPDeliveryContext* ctx = static_cast<RTPDeliveryContext*>(context);
+    RTPStream& stream = *ctx->stream;
+    RTPStreamCounters& counters = stream.jitterBuffer->counters();
+
+    if (discontinuity) {
+        // Потеря пакетов: неполные кадры отбрасываются, а не уходят в декодер
+        int dropped = stream.depacketizer.onPacketLoss(packet.payload, packet.size, packet.timestamp);
+        counters.framesDropped.fetch_add(static_cast<uint64_t>(dropped), std::memory_order_relaxed);
+
+        // Кадры после потери не декодируются до ключевого: кэш GOP сбрасывается,
+        // у камеры запрашивается ключевой кадр
+        if (stream.type == RTSP_STREAM_VIDEO) {
+            ctx->client->gopCache.clear();
+            stream.rtcp->onFrameLoss(wall_now_us());
+            schedule_keyframe_request(ctx->client, 0);
+        }
+    }
+
+    // Сборка NAL-единиц в кадры, callback вызывается один раз на кадр
+    stream.depacketizer.push(packet.payload, packet.size, packet.timestamp, packet.marker,
+                             deliver_access_unit, context);
+}
+
+// Потери всех потоков и jitter видео для статистики клиента (поток приема,
+// раз в окно скорости)
+static void publish_stream_state(RTSPClient* client) {
+    uint64_t packetsLost = 0;
+    int64_t jitterUs = 0;
+    for (auto& stream : client->rtpStreams) {
+        packetsLost += stream.jitterBuffer->counters().packetsLost.load(std::memory_order_relaxed);
+        if (stream.type == RTSP_STREAM_VIDEO && stream.clockRate > 0) {
+            jitterUs = static_cast<int64_t>(stream.rtcp->jitter()) * 1000000 / stream.clockRate;
+        }
+    }
+    client->stats.publishStreamState(packetsLost, jitterUs);
+}
+
 // Обработка RTP пакета
 static void process_rtp_packet(const uint8_t* data, int size, RTPStream& stream, RTSPClient* client) {
     if (size < 12) return; // Минимальный размер RTP заголовка
 
+    int64_t nowUs = steady_now_us();
+    if (client->stats.onPacket(static_cast<size_t>(size), nowUs)) {
+        publish_stream_state(client);
+    }
+
     // Парсинг RTP заголовка
     uint8_t version = (data[0] >> 6) & 0x3;
     uint8_t padding = (data[0] >> 5) & 0x1;
     uint8_t extension = (data[0] >> 4) & 0x1;
     uint8_t csrcCount = data[0] & 0xF;
     uint8_t marker = (data[1] >> 7) & 0x1;
-    uint8_t payloadType = data[1] & 0x7F;
     uint16_t sequence = (data[2] << 8) | data[3];
-    uint32_t timestamp = (data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
-    uint32_t ssrc = (data[8] << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
+    uint32_t timestamp = (static_cast<uint32_t>(data[4]) << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
+    uint32_t ssrc = (static_cast<uint32_t>(data[8]) << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
+
+    if (version != 2) return;
 
     int headerSize = 12 + (csrcCount * 4);
     if (extension) {
+        if (size < headerSize + 4) return;
         uint16_t extensionLength = (data[headerSize + 2] << 8) | data[headerSize + 3];
         headerSize += 4 + (extensionLength * 4);
     }
 
+    // Удаление padding (последний байт содержит его длину)
+    if (padding) {
+        size -= data[size - 1];
+    }
+
     if (size <= headerSize) return;
 
-    int payloadSize = size - headerSize;
-    const uint8_t* payload = data + headerSize;
+    if (ssrc != stream.rtpSSRC) {
+        // Новый источник: нумерация и кадры начинаются заново
+        if (stream.rtpSSRC != 0) {
+            stream.jitterBuffer->reset();
+            stream.depacketizer.reset();
+        }
+        stream.rtpSSRC = ssrc;
+    }
+    stream.rtpSequence = sequence;
+    stream.rtpTimestamp = timestamp;
+    stream.rtcp->onRtpPacket(ssrc, sequence, timestamp, wall_now_us());
 
-    // Создание RTSPFrame
-    RTSPFrame* frame = new RTSPFrame();
-    frame->data = new uint8_t[payloadSize];
-    memcpy(frame->data, payload, payloadSize);
-    frame->size = payloadSize;
-    frame->timestamp = timestamp;
-    frame->type = stream.type;
-    frame->width = stream.width;
-    frame->height = stream.height;
+    // Переупорядочивание и обнаружение потерь перед сборкой кадров
+    RTPDeliveryContext context = {client, &stream};
+    stream.jitterBuffer->insert(data + headerSize, static_cast<size_t>(size - headerSize),
+                                sequence, timestamp, marker != 0, nowUs,
+                                process_ordered_packet, &context);
+}
 
-    // Вызов callback
-    if (stream.type == RTSP_STREAM_VIDEO && client->videoCallback) {
-        client->videoCallback(frame, client->videoUserData);
-    } else if (stream.type == RTSP_STREAM_AUDIO && client->audioCallback) {
-        client->audioCallback(frame, client->audioUserData);
-    } else {
-        // Освобождение если callback не установлен
-        delete[] frame->data;
-        delete frame;
+// Максимальное число пакетов, читаемых из сокета за одно событие готовности
+static const int kMaxPacketsPerWakeup = 64;
+
+// Пакетный прием RTP: датаграммы читаются пачками (recvmmsg на Linux)
+// и передаются депакетизатору одной серией.
+static void receive_rtp_packets(RTPStream& stream, RTSPClient* client, int maxPackets) {
+    UDPBatchReceiver& receiver = UDPBatchReceiver::forCurrentThread();
+
+    int total = 0;
+    while (total < maxPackets) {
+        int count = receiver.receive(stream.rtpSocket);
+        if (count <= 0) break;
+
+        uint32_t kernelDrops;
+        if (receiver.dropCounter(kernelDrops)) {
+            stream.jitterBuffer->counters().kernelDrops.store(kernelDrops, std::memory_order_relaxed);
+        }
+
+        for (int i = 0; i < count; i++) {
+            const UDPDatagram& datagram = receiver.datagram(i);
+            if (datagram.truncated) continue;
+            process_rtp_packet(datagram.data, datagram.size, stream, client);
+        }
+
+        total += count;
+        if (count < UDPBatchReceiver::kMaxBatch) break;
+    }
+}
+
+// Чтение RTCP пакетов из сокета
+static void receive_rtcp_packets(RTPStream& stream, int maxPackets) {
+    UDPBatchReceiver& receiver = UDPBatchReceiver::forCurrentThread();
+
+    int total = 0;
+    while (total < maxPackets) {
+        int count = receiver.receive(stream.rtcpSocket);
+        if (count <= 0) break;
+
+        int64_t nowUs = wall_now_us();
+        for (int i = 0; i < count; i++) {
+            const UDPDatagram& datagram = receiver.datagram(i);
+            if (datagram.truncated) continue;
+            stream.rtcp->onRtcpPacket(datagram.data, static_cast<size_t>(datagram.size), nowUs);
+        }
+        total += count;
+        if (count < UDPBatchReceiver::kMaxBatch) break;
+    }
+}
+
+// Обработчики реактора: сокет готов к чтению
+static void on_rtp_socket_ready(int fd, void* context) {
+    (void)fd;
+    RTPStream* stream = static_cast<RTPStream*>(context);
+    receive_rtp_packets(*stream, stream->owner, kMaxPacketsPerWakeup);
+}
+
+static void on_rtcp_socket_ready(int fd, void* context) {
+    (void)fd;
+    RTPStream* stream = static_cast<RTPStream*>(context);
+    receive_rtcp_packets(*stream, kMaxPacketsPerWakeup);
+}
+
+// Обработчики общего приема multicast: датаграмма в буфере потока реактора
+static void on_multicast_rtp_packet(const uint8_t* data, int size, void* context) {
+    RTPStream* stream = static_cast<RTPStream*>(context);
+    process_rtp_packet(data, size, *stream, stream->owner);
+}
+
+static void on_multicast_rtcp_packet(const uint8_t* data, int size, void* context) {
+    RTPStream* stream = static_cast<RTPStream*>(context);
+    stream->rtcp->onRtcpPacket(data, static_cast<size_t>(size), wall_now_us());
+}
+
+// Максимальное число чтений RTSP сокета за одно событие готовности
+static const int kMaxInterleavedReadsPerWakeup = 16;
+
+// Пакет из interleaved канала: RTP обрабатывается прямо в буфере приема
+static void dispatch_interleaved_packet(uint8_t channel, const uint8_t* data, size_t size,
+                                        void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    for (auto& stream : client->rtpStreams) {
+        if (channel == stream.interleavedRtpChannel) {
+            process_rtp_packet(data, static_cast<int>(size), stream, client);
+            return;
+        }
+        if (channel == stream.interleavedRtcpChannel) {
+            stream.rtcp->onRtcpPacket(data, size, wall_now_us());
+            return;
+        }
+    }
+}
+
+// Чтение interleaved данных из RTSP соединения.
+// Возвращает false, если сервер закрыл соединение.
+static bool receive_interleaved(RTSPClient* client, int maxReads) {
+    RTSPInterleavedReader& reader = *client->interleavedReader;
+#ifdef _WIN32
+    int flags = 0;
+#else
+    int flags = MSG_DONTWAIT;
+#endif
+
+    for (int i = 0; i < maxReads; i++) {
+        size_t space = reader.writableSize();
+        int received = recv(client->rtspSocket, reinterpret_cast<char*>(reader.writePointer()),
+                            static_cast<int>(space), flags);
+        if (received == 0) return false;
+        if (received < 0) {
+#ifdef _WIN32
+            int error = WSAGetLastError();
+            return error == WSAEWOULDBLOCK || error == WSAETIMEDOUT;
+#else
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+        }
+
+        reader.commit(static_cast<size_t>(received));
+        reader.parse(dispatch_interleaved_packet, client);
+        if (static_cast<size_t>(received) < space) break;
+    }
+    return true;
+}
+
+// Сервер закрыл RTSP соединение во время interleaved приема
+static void report_interleaved_connection_lost(RTSPClient* client) {
+    handle_connection_lost(client, "RTSP connection closed by server");
+}
+
+static void on_rtsp_socket_ready(int fd, void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    if (!receive_interleaved(client, kMaxInterleavedReadsPerWakeup)) {
+        // Закрытый сокет всегда готов к чтению: снимаем его с реактора
+        RTPReactor::instance().unregisterSocket(fd);
+        report_interleaved_connection_lost(client);
     }
 }
 
@@ -548,12 +1110,18 @@ static void process_rtp_packet(const uint8_t* data, int size, RTPStream& stream,
 static void receive_rtp_thread(RTSPClient* client) {
     if (!client) return;
 
+#ifdef _WIN32
     fd_set readfds;
     struct timeval tv;
 
     while (!client->shouldStop && client->playing) {
         FD_ZERO(&readfds);
-        int maxFd = 0;
+        SOCKET maxFd = 0;
+
+        if (client->interleaved) {
+            FD_SET(client->rtspSocket, &readfds);
+            maxFd = client->rtspSocket;
+        }
 
         for (auto& stream : client->rtpStreams) {
             if (stream.rtpSocket != INVALID_SOCKET) {
@@ -571,71 +1139,382 @@ static void receive_rtp_thread(RTSPClient* client) {
         tv.tv_sec = 1;
         tv.tv_usec = 0;
 
-        int activity = select(maxFd + 1, &readfds, nullptr, nullptr, &tv);
+        int activity = select(static_cast<int>(maxFd + 1), &readfds, nullptr, nullptr, &tv);
         if (activity <= 0) continue;
 
+        if (client->interleaved && FD_ISSET(client->rtspSocket, &readfds)) {
+            if (!receive_interleaved(client, 1)) {
+                report_interleaved_connection_lost(client);
+                break;
+            }
+        }
+
         for (auto& stream : client->rtpStreams) {
             if (stream.rtpSocket != INVALID_SOCKET && FD_ISSET(stream.rtpSocket, &readfds)) {
-                uint8_t buffer[65536];
-                struct sockaddr_in fromAddr;
-                socklen_t fromLen = sizeof(fromAddr);
-
-                int received = recvfrom(stream.rtpSocket, (char*)buffer, sizeof(buffer), 0,
-                                       (struct sockaddr*)&fromAddr, &fromLen);
-                if (received > 0) {
-                    process_rtp_packet(buffer, received, stream, client);
-                }
+                receive_rtp_packets(stream, client, 1);
             }
-
             if (stream.rtcpSocket != INVALID_SOCKET && FD_ISSET(stream.rtcpSocket, &readfds)) {
-                uint8_t buffer[1500];
-                struct sockaddr_in fromAddr;
-                socklen_t fromLen = sizeof(fromAddr);
+                receive_rtcp_packets(stream, 1);
+            }
+        }
+    }
+#else
+    // poll вместо select: нет ограничения FD_SETSIZE на номера дескрипторов
+    std::vector<struct pollfd> pollFds;
+    std::vector<RTPStream*> pollStreams;
+    std::vector<bool> pollIsRtcp;
+
+    // Interleaved: RTP приходит в RTSP соединении (pollStreams = nullptr)
+    if (client->interleaved) {
+        pollFds.push_back({client->rtspSocket, POLLIN, 0});
+        pollStreams.push_back(nullptr);
+        pollIsRtcp.push_back(false);
+    }
+
+    for (auto& stream : client->rtpStreams) {
+        if (stream.rtpSocket != INVALID_SOCKET) {
+            pollFds.push_back({stream.rtpSocket, POLLIN, 0});
+            pollStreams.push_back(&stream);
+            pollIsRtcp.push_back(false);
+        }
+        if (stream.rtcpSocket != INVALID_SOCKET) {
+            pollFds.push_back({stream.rtcpSocket, POLLIN, 0});
+            pollStreams.push_back(&stream);
+            pollIsRtcp.push_back(true);
+        }
+    }
+
+    if (pollFds.empty()) return;
+
+    while (!client->shouldStop && client->playing) {
+        int activity = poll(pollFds.data(), pollFds.size(), 1000);
+        if (activity <= 0) continue;
 
-                recvfrom(stream.rtcpSocket, (char*)buffer, sizeof(buffer), 0,
-                        (struct sockaddr*)&fromAddr, &fromLen);
-                // Обработка RTCP пакетов (можно добавить позже)
+        for (size_t i = 0; i < pollFds.size(); i++) {
+            if (!(pollFds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (!pollStreams[i]) {
+                if (!receive_interleaved(client, kMaxInterleavedReadsPerWakeup)) {
+                    report_interleaved_connection_lost(client);
+                    return;
+                }
+            } else if (pollIsRtcp[i]) {
+                receive_rtcp_packets(*pollStreams[i], kMaxPacketsPerWakeup);
+            } else {
+                receive_rtp_packets(*pollStreams[i], client, kMaxPacketsPerWakeup);
             }
         }
     }
+#endif
 }
 
-extern "C" {
+// Открытие очереди кадров и запуск потока доставки
+static void start_frame_dispatch(RTSPClient* client) {
+    if (!client->frameQueue) return;
 
-RTSPClient* rtsp_client_create() {
-    return new RTSPClient();
+    if (client->dispatchThread.joinable()) {
+        client->dispatchThread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(client->dispatchMutex);
+        client->frameQueue->open();
+    }
+    if (!client->externalDispatch) {
+        client->dispatchThread = std::thread(frame_dispatch_thread, client);
+    }
 }
 
-void rtsp_client_destroy(RTSPClient* client) {
-    if (client) {
-        delete client;
+static void unsubscribe_multicast_streams(RTSPClient* client) {
+    MulticastReceiver& receiver = MulticastReceiver::instance();
+    for (auto& stream : client->rtpStreams) {
+        if (stream.rtpSubscription != 0) {
+            receiver.unsubscribe(stream.rtpSubscription);
+            stream.rtpSubscription = 0;
+        }
+        if (stream.rtcpSubscription != 0) {
+            receiver.unsubscribe(stream.rtcpSubscription);
+            stream.rtcpSubscription = 0;
+        }
     }
 }
 
-bool rtsp_client_connect(
-    RTSPClient* client,
-    const char* url,
-    const char* username,
-    const char* password,
-    int timeout_ms
-) {
-    if (!client || !url) return false;
+// Подписка потоков на общий прием multicast групп. Группы камеры
+// закрепляются за одним потоком реактора по ключу - адресу камеры,
+// поэтому все потоки клиента обрабатываются в одном потоке.
+static bool subscribe_multicast_streams(RTSPClient* client) {
+    MulticastReceiver& receiver = MulticastReceiver::instance();
+    uint64_t cameraKey = std::hash<std::string>()(client->rtspUrl.host);
 
-    std::lock_guard<std::mutex> lock(client->mutex);
+    for (auto& stream : client->rtpStreams) {
+        stream.owner = client;
+        stream.rtpSubscription = receiver.subscribe(stream.multicastGroup, stream.serverRtpPort,
+                                                    client->multicastInterface, cameraKey,
+                                                    on_multicast_rtp_packet, &stream);
+        stream.rtcpSubscription = receiver.subscribe(stream.multicastGroup, stream.serverRtcpPort,
+                                                     client->multicastInterface, cameraKey,
+                                                     on_multicast_rtcp_packet, &stream);
+        if (stream.rtpSubscription == 0 || stream.rtcpSubscription == 0) {
+            unsubscribe_multicast_streams(client);
+            return false;
+        }
+
+        int bufferSize = rtp_receive_buffer_size(client, stream);
+        if (bufferSize > 0) {
+            stream.receiveBufferBytes = receiver.setReceiveBufferSize(stream.rtpSubscription, bufferSize);
+        }
+    }
+    return true;
+}
+
+// Собственные сокеты группы клиента (общий прием недоступен)
+static void open_multicast_sockets(RTSPClient* client) {
+    for (auto& stream : client->rtpStreams) {
+        if (stream.rtpSocket == INVALID_SOCKET) {
+            stream.rtpSocket = multicast_open_socket(stream.multicastGroup, stream.serverRtpPort,
+                                                     client->multicastInterface);
+            if (stream.rtpSocket != INVALID_SOCKET) {
+                configure_rtp_socket(client, stream);
+            }
+        }
+        if (stream.rtcpSocket == INVALID_SOCKET) {
+            stream.rtcpSocket = multicast_open_socket(stream.multicastGroup, stream.serverRtcpPort,
+                                                      client->multicastInterface);
+            if (stream.rtcpSocket != INVALID_SOCKET && stream.multicastTtl > 0) {
+                int ttl = stream.multicastTtl;
+                setsockopt(stream.rtcpSocket, IPPROTO_IP, IP_MULTICAST_TTL,
+                           reinterpret_cast<const char*>(&ttl), sizeof(ttl));
+            }
+        }
+    }
+}
+
+// Запуск приема RTP: через общий реактор или в отдельном потоке
+static void start_rtp_reception(RTSPClient* client) {
+    // GOP прежней сессии не продолжается новыми кадрами
+    client->gopCache.clear();
+    start_frame_dispatch(client);
+
+    if (client->multicast) {
+        if (MulticastReceiver::isSupported() && subscribe_multicast_streams(client)) return;
+        open_multicast_sockets(client);
+    }
+
+    if (client->useSharedReactor && RTPReactor::isSupported()) {
+        RTPReactor& reactor = RTPReactor::instance();
+        if (reactor.isRunning() || reactor.start(0)) {
+            uint64_t clientKey = std::hash<std::string>()(client->url);
+            bool registered = true;
+
+            if (client->interleaved) {
+                registered &= reactor.registerSocket(client->rtspSocket, clientKey,
+                                                     on_rtsp_socket_ready, client);
+            }
+
+            for (auto& stream : client->rtpStreams) {
+                stream.owner = client;
+                if (stream.rtpSocket != INVALID_SOCKET) {
+                    registered &= reactor.registerSocket(stream.rtpSocket, clientKey,
+                                                         on_rtp_socket_ready, &stream);
+                }
+                if (stream.rtcpSocket != INVALID_SOCKET) {
+                    registered &= reactor.registerSocket(stream.rtcpSocket, clientKey,
+                                                         on_rtcp_socket_ready, &stream);
+                }
+            }
+
+            client->reactorRegistered = true;
+            if (registered) return;
+
+            // Не все сокеты удалось зарегистрировать: откат к отдельному потоку
+            if (client->interleaved) {
+                reactor.unregisterSocket(client->rtspSocket);
+            }
+            for (auto& stream : client->rtpStreams) {
+                reactor.unregisterSocket(stream.rtpSocket);
+                reactor.unregisterSocket(stream.rtcpSocket);
+            }
+            client->reactorRegistered = false;
+        }
+    }
+
+    if (client->rtpThread.joinable()) {
+        client->rtpThread.join();
+    }
+    client->rtpThread = std::thread(receive_rtp_thread, client);
+}
+
+// Остановка приема RTP. После возврата обработчики пакетов не выполняются.
+static void stop_rtp_reception(RTSPClient* client) {
+    // Закрытие очереди освобождает поток приема, ждущий места (RTSP_FRAME_QUEUE_BLOCK)
+    if (client->frameQueue) {
+        client->frameQueue->close();
+    }
+
+    unsubscribe_multicast_streams(client);
+
+    if (client->reactorRegistered) {
+        RTPReactor& reactor = RTPReactor::instance();
+        if (client->interleaved) {
+            reactor.unregisterSocket(client->rtspSocket);
+        }
+        for (auto& stream : client->rtpStreams) {
+            reactor.unregisterSocket(stream.rtpSocket);
+            reactor.unregisterSocket(stream.rtcpSocket);
+        }
+        client->reactorRegistered = false;
+    }
 
+    if (client->rtpThread.joinable() && client->rtpThread.get_id() != std::this_thread::get_id()) {
+        client->rtpThread.join();
+    }
+
+    // Поток доставки может сам вызвать остановку из callback
+    if (client->dispatchThread.joinable() && client->dispatchThread.get_id() != std::this_thread::get_id()) {
+        client->dispatchThread.join();
+    }
+}
+
+// Закрытие RTP сокетов и удаление потоков сессии (прием должен быть остановлен)
+static void release_rtp_streams(RTSPClient* client) {
+    for (auto& stream : client->rtpStreams) {
+        if (stream.rtpSocket != INVALID_SOCKET) {
+            close(stream.rtpSocket);
+            stream.rtpSocket = INVALID_SOCKET;
+        }
+        if (stream.rtcpSocket != INVALID_SOCKET) {
+            close(stream.rtcpSocket);
+            stream.rtcpSocket = INVALID_SOCKET;
+        }
+    }
+    client->rtpStreams.clear();
+
+    for (auto* stream : client->streams) {
+        delete stream;
+    }
+    client->streams.clear();
+}
+
+// Параметры interleaved=a-b из заголовка Transport ответа SETUP
+static bool parse_interleaved_channels(const std::string& transportLine, int& rtpChannel, int& rtcpChannel) {
+    size_t pos = transportLine.find("interleaved=");
+    if (pos == std::string::npos) return false;
+
+    const char* value = transportLine.c_str() + pos + 12;
+    char* end = nullptr;
+    long first = strtol(value, &end, 10);
+    if (end == value || first < 0 || first > 255) return false;
+
+    long second = first + 1;
+    if (*end == '-') {
+        const char* secondValue = end + 1;
+        second = strtol(secondValue, &end, 10);
+        if (end == secondValue || second < 0 || second > 255) return false;
+    }
+
+    rtpChannel = static_cast<int>(first);
+    rtcpChannel = static_cast<int>(second);
+    return true;
+}
+
+// Заголовки авторизации и User-Agent, общие для запросов клиента.
+// Digest зависит от метода и URI запроса и строится для каждого запроса заново.
+static void append_client_headers(RTSPClient* client, std::ostringstream& headers,
+                                  const char* method, const std::string& uri) {
+    std::string authorization = client->auth.authorization(method, uri);
+    if (!authorization.empty()) {
+        headers << "Authorization: " << authorization << "\r\n";
+    }
+    headers << "User-Agent: IP-CSS RTSP Client\r\n";
+}
+
+// Запрос в рамках установленной сессии (PLAY, PAUSE, TEARDOWN). После 401 с
+// новым вызовом (истек nonce) запрос повторяется один раз.
+static bool send_session_request(RTSPClient* client, const char* method, const std::string& extraHeaders,
+                                 std::string& response, std::string* leftover = nullptr) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::ostringstream headers;
+        headers << "CSeq: " << client->cseq++ << "\r\n";
+        if (!client->sessionId.empty()) {
+            headers << "Session: " << client->sessionId << "\r\n";
+        }
+        append_client_headers(client, headers, method, client->rtspUrl.path);
+        headers << extraHeaders;
+
+        if (!send_rtsp_request(client->rtspSocket, method, client->rtspUrl.path,
+                               headers.str(), "", response, leftover)) {
+            return false;
+        }
+
+        int statusCode;
+        std::string sessionId;
+        if (!parse_rtsp_response(response, statusCode, sessionId) || statusCode != 401 ||
+            !client->auth.handleUnauthorized(response)) {
+            break;
+        }
+    }
+    return true;
+}
+
+static const char* handshake_method(RTSPHandshakeStep step) {
+    switch (step) {
+        case HANDSHAKE_OPTIONS: return "OPTIONS";
+        case HANDSHAKE_DESCRIBE: return "DESCRIBE";
+        case HANDSHAKE_SETUP: return "SETUP";
+        default: return "RTSP";
+    }
+}
+
+// Остановка приема предыдущей сессии перед подключением. Как в rtsp_client_stop,
+// потоки приема и доставки присоединяются без мьютекса клиента: их callback'и
+// могут ждать этот мьютекс.
+static void stop_previous_session(RTSPClient* client) {
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->shouldStop = true;
+        client->playing = false;
+    }
+    stop_rtp_reception(client);
+}
+
+// Подготовка клиента к новой сессии (вызывается под мьютексом клиента после
+// stop_previous_session). false - некорректный URL (текст в error, статус
+// сообщает вызывающий).
+static bool begin_handshake(RTSPClient* client, const char* url, const char* username,
+                            const char* password, int timeout_ms, std::string& error) {
+    // Вызов авторизации и отказ сервера от конвейера запоминаются для
+    // переподключений к той же камере
+    if (client->url != url) {
+        client->auth.reset();
+        client->pipelineRequests = true;
+    }
     client->url = url;
     client->username = username ? username : "";
     client->password = password ? password : "";
     client->status = RTSP_STATUS_CONNECTING;
     client->shouldStop = false;
     client->cseq = 1;
+    client->timeoutMs = timeout_ms;
+
+    // Повторное подключение: ресурсы предыдущей сессии освобождаются
+    client->playing = false;
+    client->connected = false;
+    release_rtp_streams(client);
+    if (client->rtspSocket != INVALID_SOCKET) {
+        close(client->rtspSocket);
+        client->rtspSocket = INVALID_SOCKET;
+    }
+    client->sessionId.clear();
+    client->sessionTimeoutSec = kDefaultSessionTimeoutSec;
+    client->keepaliveGetParameter = false;
+
+    // TCP выбран явно или UDP в режиме AUTO уже не получил пакетов
+    client->interleaved = client->transport == RTSP_TRANSPORT_TCP ||
+                          (client->transport == RTSP_TRANSPORT_AUTO && client->fallbackToTcp);
+    client->multicast = client->transport == RTSP_TRANSPORT_UDP_MULTICAST;
 
     // Парсинг URL
     if (!parse_rtsp_url(url, client->rtspUrl)) {
         client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "Invalid RTSP URL", client->statusUserData);
-        }
+        error = "Invalid RTSP URL";
         return false;
     }
 
@@ -644,223 +1523,1144 @@ bool rtsp_client_connect(
         client->username = client->rtspUrl.username;
         client->password = client->rtspUrl.password;
     }
+    client->auth.setCredentials(client->username, client->password);
 
-    // Подключение к RTSP серверу
-    client->rtspSocket = create_tcp_socket(client->rtspUrl.host, client->rtspUrl.port, timeout_ms);
-    if (client->rtspSocket == INVALID_SOCKET) {
-        client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "Failed to connect to RTSP server", client->statusUserData);
+    client->handshakeStep = HANDSHAKE_OPTIONS;
+    client->handshakeSetupIndex = 0;
+    client->handshakePending.clear();
+    client->handshakeAuthRetries = 0;
+    return true;
+}
+
+// Запрос шага установки сессии (SETUP - для дорожки streamIndex)
+static bool build_handshake_request(RTSPClient* client, RTSPHandshakeStep step, size_t streamIndex,
+                                    std::string& request, std::string& error) {
+    std::ostringstream headers;
+    headers << "CSeq: " << client->cseq++ << "\r\n";
+
+    switch (step) {
+        case HANDSHAKE_OPTIONS:
+            // OPTIONS (опционально, для проверки соединения)
+            append_client_headers(client, headers, "OPTIONS", client->rtspUrl.path);
+            request = build_rtsp_request("OPTIONS", client->rtspUrl.path, headers.str(), "");
+            return true;
+
+        case HANDSHAKE_DESCRIBE:
+            headers << "Accept: application/sdp\r\n";
+            append_client_headers(client, headers, "DESCRIBE", client->rtspUrl.path);
+            request = build_rtsp_request("DESCRIBE", client->rtspUrl.path, headers.str(), "");
+            return true;
+
+        case HANDSHAKE_SETUP: {
+            RTPStream& stream = client->rtpStreams[streamIndex];
+
+            if (client->interleaved) {
+                // Каналы 2i/2i+1 в RTSP соединении, сервер может назначить другие
+                stream.interleavedRtpChannel = static_cast<int>(streamIndex * 2);
+                stream.interleavedRtcpChannel = static_cast<int>(streamIndex * 2 + 1);
+            } else if (!client->multicast && stream.rtpSocket == INVALID_SOCKET) {
+                // (сокеты повторного SETUP после 401 или отказа от конвейера уже открыты)
+                // Создание UDP сокетов для RTP/RTCP (сокеты multicast группы
+                // открываются при запуске приема, когда группа известна)
+                stream.rtpSocket = create_udp_socket(stream.clientRtpPort);
+                stream.rtcpSocket = create_udp_socket(stream.clientRtcpPort);
+                if (stream.rtpSocket == INVALID_SOCKET || stream.rtcpSocket == INVALID_SOCKET) {
+                    error = "Failed to create RTP sockets";
+                    return false;
+                }
+                configure_rtp_socket(client, stream);
+            }
+
+            // Формирование control URL
+            std::string controlUrl = stream.controlUrl;
+            if (controlUrl.empty() || controlUrl[0] != '/') {
+                controlUrl = client->rtspUrl.path + "/" + controlUrl;
+            }
+
+            if (client->interleaved) {
+                headers << "Transport: RTP/AVP/TCP;unicast;interleaved="
+                        << stream.interleavedRtpChannel << "-" << stream.interleavedRtcpChannel << "\r\n";
+            } else if (client->multicast) {
+                // Группу и порты назначает сервер
+                headers << "Transport: RTP/AVP;multicast\r\n";
+            } else {
+                headers << "Transport: RTP/AVP/UDP;unicast;client_port="
+                        << stream.clientRtpPort << "-" << stream.clientRtcpPort << "\r\n";
+            }
+            // Все SETUP после первого выполняются в рамках одной сессии
+            if (!client->sessionId.empty()) {
+                headers << "Session: " << client->sessionId << "\r\n";
+            }
+            append_client_headers(client, headers, "SETUP", controlUrl);
+            request = build_rtsp_request("SETUP", controlUrl, headers.str(), "");
+            return true;
         }
-        return false;
+
+        default:
+            error = "Unexpected RTSP handshake state";
+            return false;
     }
+}
 
-    // Отправка OPTIONS запроса (опционально, для проверки соединения)
-    std::ostringstream optionsHeaders;
-    optionsHeaders << "CSeq: " << client->cseq++ << "\r\n";
-    if (!client->username.empty() && !client->password.empty()) {
-        optionsHeaders << "Authorization: " << generate_basic_auth(client->username, client->password) << "\r\n";
+// Следующая группа запросов установки сессии. Запросы, не зависящие от ответа
+// на предыдущий, отправляются конвейером: OPTIONS вместе с DESCRIBE и SETUP
+// второй и следующих дорожек вместе (им нужен только Session из ответа на
+// первый SETUP). Сессия с одной дорожкой устанавливается за два RTT.
+static bool handshake_requests(RTSPClient* client, std::string& requests, std::string& error) {
+    requests.clear();
+    RTSPHandshakeStep step = client->handshakeStep;
+    size_t streamIndex = client->handshakeSetupIndex;
+    size_t first = client->handshakePending.size();
+
+    while (true) {
+        std::string request;
+        if (!build_handshake_request(client, step, streamIndex, request, error)) {
+            return false;
+        }
+        requests += request;
+
+        RTSPPendingRequest pending = {step, streamIndex, client->cseq - 1, false, false};
+        client->handshakePending.push_back(pending);
+
+        if (step == HANDSHAKE_OPTIONS) {
+            step = HANDSHAKE_DESCRIBE;
+        } else if (step == HANDSHAKE_SETUP && !client->sessionId.empty() &&
+                   streamIndex + 1 < client->rtpStreams.size()) {
+            streamIndex++;
+        } else {
+            break;
+        }
+        if (!client->pipelineRequests) break;
     }
-    optionsHeaders << "User-Agent: IP-CSS RTSP Client\r\n";
 
-    std::string optionsResponse;
-    if (!send_rtsp_request(client->rtspSocket, "OPTIONS", client->rtspUrl.path,
-                          optionsHeaders.str(), "", optionsResponse)) {
-        close(client->rtspSocket);
-        client->rtspSocket = INVALID_SOCKET;
-        client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "Failed to send OPTIONS request", client->statusUserData);
+    if (client->handshakePending.size() - first > 1) {
+        for (size_t i = first; i < client->handshakePending.size(); i++) {
+            client->handshakePending[i].pipelined = true;
         }
-        return false;
     }
+    return true;
+}
 
-    // Отправка DESCRIBE запроса
-    std::ostringstream describeHeaders;
-    describeHeaders << "CSeq: " << client->cseq++ << "\r\n";
-    describeHeaders << "Accept: application/sdp\r\n";
-    if (!client->username.empty() && !client->password.empty()) {
-        describeHeaders << "Authorization: " << generate_basic_auth(client->username, client->password) << "\r\n";
+// Повтор запроса установки сессии: ответы на запросы, отправленные после
+// него, не нужны, следующая группа начнется с него
+static void retry_handshake_request(RTSPClient* client, const RTSPPendingRequest& request) {
+    for (RTSPPendingRequest& pending : client->handshakePending) {
+        pending.ignored = true;
     }
-    describeHeaders << "User-Agent: IP-CSS RTSP Client\r\n";
+    client->handshakeStep = request.step;
+    client->handshakeSetupIndex = request.setupIndex;
+}
 
-    std::string describeResponse;
-    if (!send_rtsp_request(client->rtspSocket, "DESCRIBE", client->rtspUrl.path,
-                          describeHeaders.str(), "", describeResponse)) {
-        close(client->rtspSocket);
-        client->rtspSocket = INVALID_SOCKET;
-        client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "Failed to send DESCRIBE request", client->statusUserData);
+// Значение параметра Transport (name=value до ';'), "" - параметра нет
+static std::string transport_parameter(const std::string& transportLine, const std::string& name) {
+    size_t pos = 0;
+    while ((pos = transportLine.find(name + "=", pos)) != std::string::npos) {
+        // Только целый параметр: "port=" не должен совпасть с "client_port="
+        if (pos == 0 || transportLine[pos - 1] == ';' || transportLine[pos - 1] == ' ' ||
+            transportLine[pos - 1] == ':') {
+            size_t start = pos + name.size() + 1;
+            size_t end = transportLine.find(';', start);
+            if (end == std::string::npos) end = transportLine.length();
+            std::string value = transportLine.substr(start, end - start);
+            value.erase(value.find_last_not_of(" \t") + 1);
+            return value;
         }
+        pos += name.size();
+    }
+    return "";
+}
+
+// Multicast транспорт: destination=<группа>;port=<RTP>-<RTCP>;ttl=<n>
+static void parse_multicast_transport(const std::string& transportLine, RTPStream& stream) {
+    if (transportLine.find("multicast") == std::string::npos) return;
+
+    stream.multicastGroup = transport_parameter(transportLine, "destination");
+
+    std::string ports = transport_parameter(transportLine, "port");
+    if (!ports.empty()) {
+        size_t dash = ports.find('-');
+        stream.serverRtpPort = std::stoi(ports.substr(0, dash));
+        stream.serverRtcpPort = dash != std::string::npos ? std::stoi(ports.substr(dash + 1))
+                                                          : stream.serverRtpPort + 1;
+    }
+
+    std::string ttl = transport_parameter(transportLine, "ttl");
+    if (!ttl.empty()) {
+        stream.multicastTtl = std::stoi(ttl);
+    }
+}
+
+// Разбор Transport из ответа SETUP: server_port (UDP), interleaved (TCP)
+// или группа multicast
+static void parse_setup_transport(RTSPClient* client, RTPStream& stream, const std::string& setupResponse) {
+    size_t transportPos = setupResponse.find("Transport:");
+    if (transportPos == std::string::npos) return;
+
+    std::string transportLine = setupResponse.substr(transportPos);
+    size_t lineEnd = transportLine.find("\r\n");
+    if (lineEnd == std::string::npos) return;
+
+    transportLine = transportLine.substr(0, lineEnd);
+    if (client->interleaved) {
+        parse_interleaved_channels(transportLine, stream.interleavedRtpChannel,
+                                   stream.interleavedRtcpChannel);
+    }
+
+    // Парсинг server_port=xxxx-xxxx
+    size_t serverPortPos = transportLine.find("server_port=");
+    if (serverPortPos != std::string::npos) {
+        size_t portStart = serverPortPos + 12;
+        size_t portEnd = transportLine.find("-", portStart);
+        if (portEnd != std::string::npos) {
+            stream.serverRtpPort = std::stoi(transportLine.substr(portStart, portEnd - portStart));
+            size_t rtcpStart = portEnd + 1;
+            size_t rtcpEnd = transportLine.find(";", rtcpStart);
+            if (rtcpEnd == std::string::npos) rtcpEnd = transportLine.length();
+            stream.serverRtcpPort = std::stoi(transportLine.substr(rtcpStart, rtcpEnd - rtcpStart));
+        }
+    }
+
+    if (client->multicast) {
+        parse_multicast_transport(transportLine, stream);
+    }
+}
+
+// Таймаут сессии из заголовка Session: <id>;timeout=<секунды>
+static int parse_session_timeout(const std::string& response) {
+    std::string session = rtsp_header_value(response, "Session");
+    size_t pos = session.find("timeout=");
+    if (pos == std::string::npos) return kDefaultSessionTimeoutSec;
+
+    long timeout = strtol(session.c_str() + pos + 8, nullptr, 10);
+    return timeout > 0 ? static_cast<int>(timeout) : kDefaultSessionTimeoutSec;
+}
+
+// Интервал keepalive: половина таймаута сессии
+static int keepalive_interval_ms(RTSPClient* client) {
+    return std::max(client->sessionTimeoutSec * 1000 / 2, 1000);
+}
+
+// Обработка ответа на самый ранний ожидающий запрос и переход к следующему шагу
+static bool handshake_response(RTSPClient* client, const std::string& response, std::string& error) {
+    if (client->handshakePending.empty()) {
+        error = "Unexpected RTSP response";
         return false;
     }
+    RTSPPendingRequest request = client->handshakePending.front();
+    client->handshakePending.pop_front();
+    if (request.ignored) {
+        return true;
+    }
 
-    // Парсинг ответа DESCRIBE
-    int statusCode;
+    int statusCode = 0;
     std::string sessionId;
-    if (!parse_rtsp_response(describeResponse, statusCode, sessionId)) {
-        close(client->rtspSocket);
-        client->rtspSocket = INVALID_SOCKET;
-        client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "Failed to parse DESCRIBE response", client->statusUserData);
+    bool parsed = parse_rtsp_response(response, statusCode, sessionId);
+
+    // Вызов авторизации: запрос повторяется с Digest (новый nonce после
+    // устаревшего - без повторной проверки пароля сервером)
+    if (parsed && statusCode == 401) {
+        if (client->handshakeAuthRetries >= kMaxAuthRetries || !client->auth.handleUnauthorized(response)) {
+            error = "RTSP authentication failed";
+            return false;
         }
+        client->handshakeAuthRetries++;
+        retry_handshake_request(client, request);
+        return true;
+    }
+
+    // Отказ на запрос конвейера: сервер мог не принять сам конвейер,
+    // запрос повторяется отдельно, и дальше запросы идут по одному
+    if (parsed && statusCode != 200 && request.pipelined && request.step != HANDSHAKE_OPTIONS) {
+        client->pipelineRequests = false;
+        retry_handshake_request(client, request);
+        return true;
+    }
+
+    try {
+        switch (request.step) {
+            case HANDSHAKE_OPTIONS:
+                // Ответ на OPTIONS подтверждает, что сервер отвечает; по Public
+                // выбирается метод keepalive
+                client->keepaliveGetParameter =
+                    rtsp_header_value(response, "Public").find("GET_PARAMETER") != std::string::npos;
+                client->handshakeStep = HANDSHAKE_DESCRIBE;
+                return true;
+
+            case HANDSHAKE_DESCRIBE: {
+                if (!parsed) {
+                    error = "Failed to parse DESCRIBE response";
+                    return false;
+                }
+                if (statusCode != 200) {
+                    error = "DESCRIBE request failed";
+                    return false;
+                }
+
+                // Извлечение SDP из ответа
+                size_t sdpStart = response.find("\r\n\r\n");
+                if (sdpStart == std::string::npos) {
+                    error = "No SDP in DESCRIBE response";
+                    return false;
+                }
+
+                // Парсинг SDP и создание RTP потоков
+                if (!parse_sdp(response.substr(sdpStart + 4), client->rtpStreams, client)) {
+                    error = "Failed to parse SDP";
+                    return false;
+                }
+
+                client->handshakeStep = HANDSHAKE_SETUP;
+                client->handshakeSetupIndex = 0;
+                return true;
+            }
+
+            case HANDSHAKE_SETUP: {
+                RTPStream& stream = client->rtpStreams[request.setupIndex];
+
+                if (!parsed) {
+                    error = "Failed to parse SETUP response";
+                    return false;
+                }
+                if (statusCode != 200) {
+                    error = "SETUP request failed";
+                    return false;
+                }
+
+                // Сохранение Session ID и таймаута сессии
+                if (!sessionId.empty()) {
+                    client->sessionId = sessionId;
+                    client->sessionTimeoutSec = parse_session_timeout(response);
+                }
+
+                parse_setup_transport(client, stream, response);
+                stream.rtcp->setClockRate(stream.clockRate);
+
+                // Сервер, не поддерживающий multicast, отвечает unicast транспортом
+                if (client->multicast && (!multicast_is_group_address(stream.multicastGroup) ||
+                                          stream.serverRtpPort <= 0 || stream.serverRtcpPort <= 0)) {
+                    error = "Server did not provide a multicast group in SETUP";
+                    return false;
+                }
+
+                client->handshakeSetupIndex = request.setupIndex + 1;
+                if (client->handshakeSetupIndex >= client->rtpStreams.size()) {
+                    client->handshakeStep = HANDSHAKE_DONE;
+                }
+                return true;
+            }
+
+            default:
+                error = "Unexpected RTSP handshake state";
+                return false;
+        }
+    } catch (const std::exception&) {
+        // std::stoi на некорректных числовых полях ответа
+        error = std::string("Malformed ") + handshake_method(request.step) + " response";
         return false;
     }
+}
 
-    if (statusCode != 200) {
-        close(client->rtspSocket);
-        client->rtspSocket = INVALID_SOCKET;
-        client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "DESCRIBE request failed", client->statusUserData);
+// Ошибка установки сессии (под мьютексом клиента; статус вызывающий сообщает
+// через notify_status после освобождения мьютекса)
+static void fail_handshake(RTSPClient* client) {
+    // Нет ответа на конвейер (таймаут, разрыв): следующие попытки - по одному запросу
+    for (const RTSPPendingRequest& pending : client->handshakePending) {
+        if (pending.pipelined) {
+            client->pipelineRequests = false;
+            break;
         }
-        return false;
     }
+    client->handshakePending.clear();
 
-    // Извлечение SDP из ответа
-    size_t sdpStart = describeResponse.find("\r\n\r\n");
-    if (sdpStart == std::string::npos) {
+    if (client->rtspSocket != INVALID_SOCKET) {
         close(client->rtspSocket);
         client->rtspSocket = INVALID_SOCKET;
-        client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "No SDP in DESCRIBE response", client->statusUserData);
+    }
+    client->status = RTSP_STATUS_ERROR;
+}
+
+// Успешное завершение установки сессии (под мьютексом клиента, статус - как
+// в fail_handshake)
+static void complete_handshake(RTSPClient* client) {
+    if (client->interleaved) {
+        if (!client->interleavedReader) {
+            client->interleavedReader.reset(new RTSPInterleavedReader());
         }
+        client->interleavedReader->reset();
+    }
+
+    client->status = RTSP_STATUS_CONNECTED;
+    client->connected = true;
+    schedule_keepalive(client, keepalive_interval_ms(client));
+}
+
+// Callback статуса вызывается без мьютекса клиента: callback приложения может
+// обращаться к этому же клиенту (rtsp_client_play, получение статистики)
+static void notify_status(RTSPClient* client, RTSPStatus status, const char* message) {
+    RTSPStatusCallback callback;
+    void* userData;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        callback = client->statusCallback;
+        userData = client->statusUserData;
+    }
+    if (callback) {
+        callback(status, message, userData);
+    }
+}
+
+// Асинхронное подключение: ответы обрабатываются в потоке RTSPConnector
+static bool on_async_handshake_response(const std::string& response, std::string& nextRequest,
+                                        std::string& error, void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    std::lock_guard<std::mutex> lock(client->mutex);
+
+    if (!handshake_response(client, response, error)) {
         return false;
     }
+    // Следующая группа - после ответов на все запросы текущей
+    nextRequest.clear();
+    if (!client->handshakePending.empty() || client->handshakeStep == HANDSHAKE_DONE) {
+        return true;
+    }
+    return handshake_requests(client, nextRequest, error);
+}
 
-    std::string sdp = describeResponse.substr(sdpStart + 4);
+// Выдача результата асинхронного подключения (в SessionWorkers): callback'и
+// статуса и подключения вызываются без мьютекса клиента и не задерживают
+// цикл RTSPConnector. stop_session_timers отменяет выдачу и ждет ее.
+static void deliver_connect_result(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    RTSPConnectCallback callback;
+    void* userData;
+    bool success;
+    std::string message;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        callback = client->connectCallback;
+        userData = client->connectUserData;
+        client->connectCallback = nullptr;
+        client->connectUserData = nullptr;
+        success = client->connectSucceeded;
+        message = client->connectMessage;
+    }
 
-    // Парсинг SDP и создание RTP потоков
-    if (!parse_sdp(sdp, client->rtpStreams, client)) {
-        close(client->rtspSocket);
-        client->rtspSocket = INVALID_SOCKET;
-        client->status = RTSP_STATUS_ERROR;
-        if (client->statusCallback) {
-            client->statusCallback(RTSP_STATUS_ERROR, "Failed to parse SDP", client->statusUserData);
+    notify_status(client, success ? RTSP_STATUS_CONNECTED : RTSP_STATUS_ERROR, message.c_str());
+    if (callback) {
+        callback(client, success, message.c_str(), userData);
+    }
+}
+
+static void on_async_handshake_done(RTSPSocket sock, const char* error, void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->connectOperation = 0;
+        if (error) {
+            fail_handshake(client);
+        } else {
+            client->rtspSocket = sock;
+            complete_handshake(client);
         }
+        client->connectSucceeded = error == nullptr;
+        client->connectMessage = error ? error : "Connected successfully";
+    }
+
+    // Обработчик выполняется под callbackMutex_ единственного потока
+    // RTSPConnector: callback'и приложения вызываются уже вне его
+    SessionWorkers::instance().post(client, deliver_connect_result, client);
+}
+
+// Отмена незавершенного асинхронного подключения (без мьютекса клиента:
+// обработчики подключения сами захватывают его)
+static void cancel_async_connect(RTSPClient* client) {
+    uint64_t operation;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        operation = client->connectOperation;
+        client->connectOperation = 0;
+        client->connectCallback = nullptr;
+        client->connectUserData = nullptr;
+    }
+    if (operation != 0) {
+        RTSPConnector::instance().cancel(operation);
+    }
+}
+
+// Запуск асинхронного подключения в RTSPConnector
+static bool start_async_connect(RTSPClient* client, const char* url, const char* username,
+                                const char* password, int timeout_ms,
+                                RTSPConnectCallback callback, void* userData) {
+    cancel_async_connect(client);
+    stop_previous_session(client);
+
+    RTSPConnectRequest request;
+    std::string error;
+    bool started;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+
+        started = begin_handshake(client, url, username, password, timeout_ms, error);
+        if (started && !handshake_requests(client, request.firstRequest, error)) {
+            fail_handshake(client);
+            started = false;
+        }
+        if (started) {
+            request.host = client->rtspUrl.host;
+            request.port = client->rtspUrl.port;
+            request.timeoutMs = timeout_ms > 0 ? timeout_ms : 5000;
+            request.onResponse = on_async_handshake_response;
+            request.onDone = on_async_handshake_done;
+            request.context = client;
+            client->connectCallback = callback;
+            client->connectUserData = userData;
+        }
+    }
+    if (!started) {
+        notify_status(client, RTSP_STATUS_ERROR, error.c_str());
         return false;
     }
 
-    // SETUP для каждого потока
-    for (auto& stream : client->rtpStreams) {
-        // Создание UDP сокетов для RTP/RTCP
-        stream.rtpSocket = create_udp_socket(stream.clientRtpPort);
-        stream.rtcpSocket = create_udp_socket(stream.clientRtcpPort);
 
-        if (stream.rtpSocket == INVALID_SOCKET || stream.rtcpSocket == INVALID_SOCKET) {
-            close(client->rtspSocket);
-            client->rtspSocket = INVALID_SOCKET;
-            client->status = RTSP_STATUS_ERROR;
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "Failed to create RTP sockets", client->statusUserData);
+    uint64_t operation = RTSPConnector::instance().submit(request);
+
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        if (operation != 0) {
+            // Операция могла завершиться до этой точки: тогда статус уже не CONNECTING
+            if (client->status == RTSP_STATUS_CONNECTING) {
+                client->connectOperation = operation;
             }
+            return true;
+        }
+        client->connectCallback = nullptr;
+        client->connectUserData = nullptr;
+        fail_handshake(client);
+    }
+    notify_status(client, RTSP_STATUS_ERROR, "Failed to start RTSP connection");
+    return false;
+}
+
+// Синхронная установка сессии (под мьютексом клиента). false - ошибка, текст в error.
+static bool connect_blocking(RTSPClient* client, const char* url, const char* username,
+                             const char* password, int timeout_ms, std::string& error) {
+    if (!begin_handshake(client, url, username, password, timeout_ms, error)) {
+        return false;
+    }
+
+    // Подключение к RTSP серверу
+    client->rtspSocket = create_tcp_socket(client->rtspUrl.host, client->rtspUrl.port, timeout_ms);
+    if (client->rtspSocket == INVALID_SOCKET) {
+        error = "Failed to connect to RTSP server";
+        fail_handshake(client);
+        return false;
+    }
+
+    // OPTIONS, DESCRIBE и SETUP для каждого потока, группами конвейера
+    std::string received;
+    while (client->handshakeStep != HANDSHAKE_DONE) {
+        std::string requests;
+
+        if (!handshake_requests(client, requests, error)) {
+            fail_handshake(client);
+            return false;
+        }
+        int sent = send(client->rtspSocket, requests.c_str(), static_cast<int>(requests.length()), kSendFlags);
+        if (sent != static_cast<int>(requests.length())) {
+            error = std::string("Failed to send ") + handshake_method(client->handshakeStep) + " request";
+            fail_handshake(client);
             return false;
         }
 
-        // Формирование control URL
-        std::string controlUrl = stream.controlUrl;
-        if (controlUrl.empty() || controlUrl[0] != '/') {
-            controlUrl = client->rtspUrl.path + "/" + controlUrl;
+        while (!client->handshakePending.empty()) {
+            const RTSPPendingRequest& pending = client->handshakePending.front();
+            std::string response;
+            if (!receive_rtsp_response(client->rtspSocket, pending.cseq, received, response)) {
+                error = std::string("No response to ") + handshake_method(pending.step) + " request";
+                fail_handshake(client);
+                return false;
+            }
+            if (!handshake_response(client, response, error)) {
+                fail_handshake(client);
+                return false;
+            }
         }
+    }
 
-        // Отправка SETUP запроса
-        std::ostringstream setupHeaders;
-        setupHeaders << "CSeq: " << client->cseq++ << "\r\n";
-        setupHeaders << "Transport: RTP/AVP/UDP;unicast;client_port="
-                     << stream.clientRtpPort << "-" << stream.clientRtcpPort << "\r\n";
-        if (!client->username.empty() && !client->password.empty()) {
-            setupHeaders << "Authorization: " << generate_basic_auth(client->username, client->password) << "\r\n";
+    complete_handshake(client);
+    return true;
+}
+
+static void on_keepalive_timer(void* context);
+
+// Планирование keepalive (заменяет ранее запланированный)
+static void schedule_keepalive(RTSPClient* client, int delayMs) {
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    if (!client->keepSession) return;
+
+    TimerService& timers = TimerService::instance();
+    if (client->keepaliveTimer != 0) {
+        timers.cancel(client->keepaliveTimer);
+    }
+    client->keepaliveTimer = timers.schedule(delayMs, on_keepalive_timer, client);
+}
+
+// Вызов авторизации из отброшенных ответов на keepalive: истекший nonce
+// заменяется до следующего запроса
+static void update_auth_challenge(RTSPClient* client, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.length()) {
+        size_t length = rtsp_message_length(reinterpret_cast<const uint8_t*>(data.data()) + offset,
+                                            data.length() - offset);
+        if (length == 0) break;
+        std::string message = data.substr(offset, length);
+        int statusCode = 0;
+        std::string sessionId;
+        if (parse_rtsp_response(message, statusCode, sessionId) && statusCode == 401) {
+            client->auth.handleUnauthorized(message);
         }
-        setupHeaders << "User-Agent: IP-CSS RTSP Client\r\n";
+        offset += length;
+    }
+}
 
-        std::string setupResponse;
-        if (!send_rtsp_request(client->rtspSocket, "SETUP", controlUrl,
-                              setupHeaders.str(), "", setupResponse)) {
-            close(client->rtspSocket);
-            client->rtspSocket = INVALID_SOCKET;
-            client->status = RTSP_STATUS_ERROR;
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "Failed to send SETUP request", client->statusUserData);
-            }
+// Отбрасывание непрочитанных данных RTSP соединения без блокировки.
+// false - соединение закрыто сервером или разорвано.
+static bool drain_rtsp_socket(RTSPClient* client) {
+    SOCKET sock = client->rtspSocket;
+    char buffer[4096];
+    std::string drained;
+    while (true) {
+#ifdef _WIN32
+        u_long available = 0;
+        if (ioctlsocket(sock, FIONREAD, &available) != 0) return false;
+        if (available == 0) break;
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+#else
+        int received = static_cast<int>(recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT));
+#endif
+        if (received == 0) return false;
+        if (received < 0) {
+#ifdef _WIN32
             return false;
+#else
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+            break;
+#endif
+        }
+        if (drained.length() < sizeof(buffer) * 4) {
+            drained.append(buffer, received);
         }
+    }
 
-        // Парсинг ответа SETUP
-        if (!parse_rtsp_response(setupResponse, statusCode, sessionId)) {
-            close(client->rtspSocket);
-            client->rtspSocket = INVALID_SOCKET;
-            client->status = RTSP_STATUS_ERROR;
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "Failed to parse SETUP response", client->statusUserData);
+    update_auth_challenge(client, drained);
+    return true;
+}
+
+// Отправка keepalive (вызывается под мьютексом клиента).
+// Ответ не ожидается: при interleaved приеме его пропускает демультиплексор,
+// иначе он отбрасывается перед следующим keepalive или пропускается
+// transact_rtsp_request по CSeq. false - соединение потеряно.
+static bool send_keepalive(RTSPClient* client) {
+    if (client->sessionId.empty()) return true;
+
+    bool receiving = client->interleaved && client->playing;
+    if (!receiving && !drain_rtsp_socket(client)) {
+        return false;
+    }
+
+    const char* method = client->keepaliveGetParameter ? "GET_PARAMETER" : "OPTIONS";
+    std::ostringstream headers;
+    headers << "CSeq: " << client->cseq++ << "\r\n";
+    headers << "Session: " << client->sessionId << "\r\n";
+    append_client_headers(client, headers, method, client->rtspUrl.path);
+
+    std::string request = build_rtsp_request(method, client->rtspUrl.path, headers.str(), "");
+    int sent = send(client->rtspSocket, request.c_str(), static_cast<int>(request.length()), kSendFlags);
+    return sent == static_cast<int>(request.length());
+}
+
+static void on_keepalive_timer(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+
+    // Клиент занят другим запросом, который и так продлевает сессию
+    std::unique_lock<std::mutex> lock(client->mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        schedule_keepalive(client, kKeepaliveRetryMs);
+        return;
+    }
+
+    if (!client->connected || client->rtspSocket == INVALID_SOCKET ||
+        client->status == RTSP_STATUS_ERROR) {
+        return;
+    }
+
+    bool alive = send_keepalive(client);
+    int interval = keepalive_interval_ms(client);
+    lock.unlock();
+
+    if (alive) {
+        schedule_keepalive(client, interval);
+    } else {
+        handle_connection_lost(client, "RTSP connection lost");
+    }
+}
+
+static void on_rtcp_report_timer(void* context);
+
+// Планирование следующего RTCP отчета со случайным разбросом интервала
+// в пределах [0.5, 1.5] (RFC 3550, 6.3.1)
+static void schedule_rtcp_report(RTSPClient* client, int delayMs) {
+    static thread_local std::minstd_rand random(
+        static_cast<unsigned>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    int jitteredMs = std::uniform_int_distribution<int>(delayMs / 2, delayMs + delayMs / 2)(random);
+
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    if (!client->keepSession) return;
+
+    TimerService& timers = TimerService::instance();
+    if (client->rtcpTimer != 0) {
+        timers.cancel(client->rtcpTimer);
+    }
+    client->rtcpTimer = timers.schedule(jitteredMs, on_rtcp_report_timer, client);
+}
+
+// Формирование RTCP пакета потока (0 - пакет не нужен)
+typedef size_t (*RTCPPacketBuilder)(RTCPSession& session, uint8_t* out, size_t capacity, int64_t nowUs);
+
+// Отправка RTCP пакета по каждому потоку: в RTSP соединении (interleaved) или
+// на RTCP порт сервера. Вызывается под мьютексом клиента: запись в RTSP сокет
+// не должна пересекаться с запросами.
+static void send_rtcp_packets(RTSPClient* client, RTCPPacketBuilder builder) {
+    // Адрес сервера для RTCP по UDP - адрес RTSP соединения
+    struct sockaddr_in serverAddr;
+    socklen_t addrLength = sizeof(serverAddr);
+    bool haveServerAddr = !client->interleaved && !client->multicast &&
+        getpeername(client->rtspSocket, reinterpret_cast<struct sockaddr*>(&serverAddr), &addrLength) == 0 &&
+        serverAddr.sin_family == AF_INET;
+
+    uint8_t packet[4 + 256];
+    int64_t nowUs = wall_now_us();
+    for (auto& stream : client->rtpStreams) {
+        size_t size = builder(*stream.rtcp, packet + 4, sizeof(packet) - 4, nowUs);
+        if (size == 0) continue;
+
+        if (client->interleaved) {
+            if (stream.interleavedRtcpChannel < 0) continue;
+            packet[0] = '$';
+            packet[1] = static_cast<uint8_t>(stream.interleavedRtcpChannel);
+            packet[2] = static_cast<uint8_t>(size >> 8);
+            packet[3] = static_cast<uint8_t>(size);
+            send(client->rtspSocket, reinterpret_cast<const char*>(packet), static_cast<int>(size + 4), kSendFlags);
+        } else if (client->multicast) {
+            // Отчеты получателей multicast адресуются RTCP порту группы
+            if (stream.rtcpSubscription != 0) {
+                MulticastReceiver::instance().send(stream.rtcpSubscription, stream.serverRtcpPort,
+                                                   stream.multicastTtl, packet + 4, size);
+            } else if (stream.rtcpSocket != INVALID_SOCKET) {
+                struct sockaddr_in groupAddr;
+                memset(&groupAddr, 0, sizeof(groupAddr));
+                groupAddr.sin_family = AF_INET;
+                groupAddr.sin_port = htons(static_cast<uint16_t>(stream.serverRtcpPort));
+                if (inet_pton(AF_INET, stream.multicastGroup.c_str(), &groupAddr.sin_addr) == 1) {
+                    sendto(stream.rtcpSocket, reinterpret_cast<const char*>(packet + 4), static_cast<int>(size), 0,
+                           reinterpret_cast<struct sockaddr*>(&groupAddr), sizeof(groupAddr));
+                }
             }
-            return false;
+        } else if (haveServerAddr && stream.rtcpSocket != INVALID_SOCKET && stream.serverRtcpPort > 0) {
+            serverAddr.sin_port = htons(static_cast<uint16_t>(stream.serverRtcpPort));
+            sendto(stream.rtcpSocket, reinterpret_cast<const char*>(packet + 4), static_cast<int>(size), 0,
+                   reinterpret_cast<struct sockaddr*>(&serverAddr), sizeof(serverAddr));
         }
+    }
+}
 
-        if (statusCode != 200) {
-            close(client->rtspSocket);
-            client->rtspSocket = INVALID_SOCKET;
+static size_t build_receiver_report(RTCPSession& session, uint8_t* out, size_t capacity, int64_t nowUs) {
+    return session.buildReceiverReport(out, capacity, nowUs);
+}
+
+static size_t build_keyframe_request(RTCPSession& session, uint8_t* out, size_t capacity, int64_t nowUs) {
+    return session.buildKeyframeRequest(out, capacity, nowUs);
+}
+
+static void on_rtcp_report_timer(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+
+    std::unique_lock<std::mutex> lock(client->mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        schedule_rtcp_report(client, kKeepaliveRetryMs);
+        return;
+    }
+
+    // Отчеты отправляются только во время воспроизведения
+    if (!client->playing || client->rtspSocket == INVALID_SOCKET) return;
+
+    send_rtcp_packets(client, build_receiver_report);
+    lock.unlock();
+    schedule_rtcp_report(client, kRtcpReportIntervalMs);
+}
+
+static void on_keyframe_request_timer(void* context);
+
+// Планирование отправки PLI/FIR. Поток приема не пишет в RTSP сокет сам:
+// запрос отправляет поток таймеров под мьютексом клиента.
+static void schedule_keyframe_request(RTSPClient* client, int delayMs) {
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    if (!client->keepSession || client->keyframeRequestTimer != 0) return;
+
+    client->keyframeRequestTimer = TimerService::instance().schedule(delayMs, on_keyframe_request_timer, client);
+}
+
+static void on_keyframe_request_timer(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    {
+        std::lock_guard<std::mutex> lock(client->timerMutex);
+        client->keyframeRequestTimer = 0;
+    }
+
+    std::unique_lock<std::mutex> lock(client->mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        schedule_keyframe_request(client, kKeyframeRequestRetryMs);
+        return;
+    }
+
+    if (!client->playing || client->rtspSocket == INVALID_SOCKET) return;
+
+    // Частоту запросов ограничивает RTCPSession каждого потока
+    send_rtcp_packets(client, build_keyframe_request);
+}
+
+static void on_recovery_timer(void* context);
+
+// Планирование шага восстановления сессии (переподключения или возобновления
+// воспроизведения), если переподключение включено и шаг еще не запланирован
+static void schedule_recovery(RTSPClient* client, int delayMs, SessionTask step) {
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    if (!client->keepSession || !client->reconnectEnabled || client->recoveryTimer != 0) return;
+
+    client->recoveryStep = step;
+    client->recoveryTimer = TimerService::instance().schedule(delayMs, on_recovery_timer, client);
+}
+
+// Шаг восстановления блокирует (PLAY, остановка приема перед подключением),
+// поэтому таймер только ставит его в SessionWorkers
+static void on_recovery_timer(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    client->recoveryTimer = 0;
+    if (!client->keepSession) return;
+
+    SessionWorkers::instance().post(client, client->recoveryStep, client);
+}
+
+// Задержка следующей попытки переподключения: экспоненциальная по числу
+// неудачных попыток, со случайным разбросом в пределах половины интервала,
+// чтобы камеры после общего сбоя не переподключались одновременно
+static int next_reconnect_delay(RTSPClient* client) {
+    // Без мьютекса клиента: вызывается и из потоков приема, которые
+    // ожидаются под ним
+    RTSPReconnectParams params;
+    {
+        std::lock_guard<std::mutex> lock(client->timerMutex);
+        params = client->reconnectParams;
+    }
+
+    double delay = params.initialDelayMs > 0 ? params.initialDelayMs : 1000;
+    double multiplier = params.backoffMultiplier > 1.0f ? params.backoffMultiplier : 1.0;
+    for (int i = 0; i < client->reconnectAttempts && (params.maxDelayMs <= 0 || delay < params.maxDelayMs); i++) {
+        delay *= multiplier;
+    }
+    if (params.maxDelayMs > 0) {
+        delay = std::min(delay, static_cast<double>(params.maxDelayMs));
+    }
+
+    static thread_local std::minstd_rand random(
+        static_cast<unsigned>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    int maxDelay = static_cast<int>(delay);
+    return std::uniform_int_distribution<int>(maxDelay / 2, maxDelay)(random);
+}
+
+static void reconnect_session(void* context);
+
+// Восстановление воспроизведения после переподключения (в SessionWorkers)
+static void resume_playback(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    {
+        std::lock_guard<std::mutex> lock(client->timerMutex);
+        if (!client->keepSession) return;
+    }
+
+    if (rtsp_client_play(client)) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->resumePlayback = false;
+        client->reconnectAttempts = 0;
+    } else {
+        schedule_recovery(client, next_reconnect_delay(client), reconnect_session);
+    }
+}
+
+// Результат попытки переподключения (в SessionWorkers)
+static void on_reconnect_done(RTSPClient* client, bool success, const char* message, void* userData) {
+    (void)message;
+    (void)userData;
+    client->isReconnecting = false;
+
+    if (!success) {
+        schedule_recovery(client, next_reconnect_delay(client), reconnect_session);
+        return;
+    }
+    client->stats.onReconnect();
+
+    bool resume;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        resume = client->resumePlayback;
+    }
+    if (resume) {
+        schedule_recovery(client, 0, resume_playback);
+    } else {
+        client->reconnectAttempts = 0;
+    }
+}
+
+// Попытка переподключения (в SessionWorkers): начало подключения
+// останавливает прием прежней сессии
+static void reconnect_session(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    int maxRetries;
+    {
+        std::lock_guard<std::mutex> lock(client->timerMutex);
+        if (!client->keepSession || !client->reconnectEnabled) return;
+        maxRetries = client->reconnectParams.maxRetries;
+    }
+
+    std::string url;
+    std::string username;
+    std::string password;
+    int timeoutMs;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        url = client->url;
+        username = client->username;
+        password = client->password;
+        timeoutMs = client->timeoutMs;
+        if (client->playing) {
+            client->resumePlayback = true;
+        }
+    }
+
+    int attempt = ++client->reconnectAttempts;
+    if (maxRetries > 0 && attempt > maxRetries) {
+        {
+            std::lock_guard<std::mutex> lock(client->mutex);
             client->status = RTSP_STATUS_ERROR;
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "SETUP request failed", client->statusUserData);
-            }
-            return false;
         }
+        notify_status(client, RTSP_STATUS_ERROR, "Max reconnection attempts reached");
+        return;
+    }
 
-        // Сохранение Session ID
-        if (!sessionId.empty()) {
-            client->sessionId = sessionId;
-        }
-
-        // Парсинг Transport из ответа для получения server портов
-        size_t transportPos = setupResponse.find("Transport:");
-        if (transportPos != std::string::npos) {
-            std::string transportLine = setupResponse.substr(transportPos);
-            size_t lineEnd = transportLine.find("\r\n");
-            if (lineEnd != std::string::npos) {
-                transportLine = transportLine.substr(0, lineEnd);
-                // Парсинг server_port=xxxx-xxxx
-                size_t serverPortPos = transportLine.find("server_port=");
-                if (serverPortPos != std::string::npos) {
-                    size_t portStart = serverPortPos + 12;
-                    size_t portEnd = transportLine.find("-", portStart);
-                    if (portEnd != std::string::npos) {
-                        stream.serverRtpPort = std::stoi(transportLine.substr(portStart, portEnd - portStart));
-                        size_t rtcpStart = portEnd + 1;
-                        size_t rtcpEnd = transportLine.find(";", rtcpStart);
-                        if (rtcpEnd == std::string::npos) rtcpEnd = transportLine.length();
-                        stream.serverRtcpPort = std::stoi(transportLine.substr(rtcpStart, rtcpEnd - rtcpStart));
-                    }
-                }
+    client->isReconnecting = true;
+    std::string msg = "Reconnecting (attempt " + std::to_string(attempt) + ")...";
+    notify_status(client, RTSP_STATUS_CONNECTING, msg.c_str());
+
+    if (!start_async_connect(client, url.c_str(), username.c_str(), password.c_str(), timeoutMs,
+                             on_reconnect_done, nullptr)) {
+        client->isReconnecting = false;
+        schedule_recovery(client, next_reconnect_delay(client), reconnect_session);
+    }
+}
+
+// Потеря RTSP соединения: статус ошибки и, если включено, переподключение.
+// Вызывается без мьютекса клиента (поток приема, реактор, таймер keepalive).
+static void handle_connection_lost(RTSPClient* client, const char* message) {
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->status = RTSP_STATUS_ERROR;
+    }
+    notify_status(client, RTSP_STATUS_ERROR, message);
+    schedule_recovery(client, next_reconnect_delay(client), reconnect_session);
+}
+
+static void on_udp_fallback_timer(void* context);
+static void check_udp_reception(void* context);
+
+// Проверка прихода RTP по UDP через udpFallbackTimeoutMs после PLAY в режиме
+// AUTO (вызывается под мьютексом клиента)
+static void schedule_udp_fallback_check(RTSPClient* client) {
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    if (!client->keepSession) return;
+
+    TimerService& timers = TimerService::instance();
+    if (client->udpFallbackTimer != 0) {
+        timers.cancel(client->udpFallbackTimer);
+    }
+    client->udpFallbackTimer = timers.schedule(client->udpFallbackTimeoutMs, on_udp_fallback_timer, client);
+}
+
+// Переход на TCP блокирует (TEARDOWN, остановка приема), поэтому таймер
+// только ставит проверку в SessionWorkers
+static void on_udp_fallback_timer(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    client->udpFallbackTimer = 0;
+    if (!client->keepSession) return;
+
+    SessionWorkers::instance().post(client, check_udp_reception, client);
+}
+
+// Результат переустановки сессии с TCP (в SessionWorkers)
+static void on_tcp_fallback_done(RTSPClient* client, bool success, const char* message, void* userData) {
+    (void)message;
+    (void)userData;
+
+    bool resume = false;
+    if (success) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        resume = client->resumePlayback;
+    }
+    if (success && !resume) return;     // Воспроизведение остановлено во время переподключения
+
+    if (resume && rtsp_client_play(client)) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->resumePlayback = false;
+    } else {
+        schedule_recovery(client, next_reconnect_delay(client), reconnect_session);
+    }
+}
+
+// Переход на interleaved TCP, когда UDP пакеты не доходят (NAT, firewall), в
+// SessionWorkers. Сессия переустанавливается асинхронно, воспроизведение
+// возобновляет on_tcp_fallback_done.
+static void check_udp_reception(void* context) {
+    RTSPClient* client = static_cast<RTSPClient*>(context);
+
+    std::string url;
+    std::string username;
+    std::string password;
+    int timeoutMs;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        // Воспроизведение остановлено или уже идет по TCP
+        if (!client->playing || client->interleaved) return;
+        for (auto& stream : client->rtpStreams) {
+            if (stream.jitterBuffer->counters().packetsReceived.load(std::memory_order_relaxed) > 0) {
+                return;
             }
         }
 
-        // Настройка адреса сервера для RTP
-        struct sockaddr_in serverAddr;
-        memset(&serverAddr, 0, sizeof(serverAddr));
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_port = htons(stream.serverRtpPort);
+        // UDP сессия закрывается на сервере, новая устанавливается с TCP
+        std::string teardownResponse;
+        send_session_request(client, "TEARDOWN", "", teardownResponse);
+
+        client->fallbackToTcp = true;
+        client->resumePlayback = true;
+        url = client->url;
+        username = client->username;
+        password = client->password;
+        timeoutMs = client->timeoutMs;
+    }
+
+    notify_status(client, RTSP_STATUS_CONNECTING, "No RTP packets over UDP, switching to TCP");
+    if (!start_async_connect(client, url.c_str(), username.c_str(), password.c_str(), timeoutMs,
+                             on_tcp_fallback_done, nullptr)) {
+        schedule_recovery(client, next_reconnect_delay(client), reconnect_session);
+    }
+}
+
+// Отмена запланированных keepalive, RTCP отчетов и шагов восстановления
+// с ожиданием выполняемых обработчиков
+static void cancel_session_timers(RTSPClient* client) {
+    {
+        std::lock_guard<std::mutex> lock(client->timerMutex);
+        TimerService& timers = TimerService::instance();
+        if (client->keepaliveTimer != 0) {
+            timers.cancel(client->keepaliveTimer);
+            client->keepaliveTimer = 0;
+        }
+        if (client->recoveryTimer != 0) {
+            timers.cancel(client->recoveryTimer);
+            client->recoveryTimer = 0;
+        }
+        if (client->rtcpTimer != 0) {
+            timers.cancel(client->rtcpTimer);
+            client->rtcpTimer = 0;
+        }
+        if (client->keyframeRequestTimer != 0) {
+            timers.cancel(client->keyframeRequestTimer);
+            client->keyframeRequestTimer = 0;
+        }
+        if (client->udpFallbackTimer != 0) {
+            timers.cancel(client->udpFallbackTimer);
+            client->udpFallbackTimer = 0;
+        }
+    }
+    TimerService::instance().waitIdle();
+    SessionWorkers::instance().cancel(client);
+}
+
+// Остановка поддержания сессии (без мьютекса клиента: обработчики таймеров,
+// шаги восстановления и подключения захватывают его сами). После возврата новые keepalive
+// и переподключения не планируются до enable_session_timers.
+static void stop_session_timers(RTSPClient* client) {
+    {
+        std::lock_guard<std::mutex> lock(client->timerMutex);
+        client->keepSession = false;
+    }
+    cancel_session_timers(client);
+    // Переподключение, начатое обработчиком таймера до остановки
+    cancel_async_connect(client);
+    cancel_session_timers(client);
+    client->isReconnecting = false;
+}
+
+// Начало поддержания сессии при подключении по запросу пользователя
+static void enable_session_timers(RTSPClient* client) {
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->resumePlayback = false;
+    }
+    client->reconnectAttempts = 0;
+
+    std::lock_guard<std::mutex> lock(client->timerMutex);
+    client->keepSession = true;
+}
 
-        struct hostent* hostEntry = gethostbyname(client->rtspUrl.host.c_str());
-        if (hostEntry) {
-            memcpy(&serverAddr.sin_addr, hostEntry->h_addr_list[0], hostEntry->h_length);
-        } else {
-            inet_pton(AF_INET, client->rtspUrl.host.c_str(), &serverAddr.sin_addr);
-        }
+extern "C" {
+
+RTSPClient* rtsp_client_create() {
+    return new RTSPClient();
+}
 
-        // Можно установить соединение для отправки RTCP, но для базовой реализации это не обязательно
+void rtsp_client_destroy(RTSPClient* client) {
+    if (client) {
+        // Обработчики подключения и таймеров не должны выполняться после удаления клиента
+        stop_session_timers(client);
+        delete client;
     }
+}
 
-    client->status = RTSP_STATUS_CONNECTED;
-    client->connected = true;
+bool rtsp_client_connect(
+    RTSPClient* client,
+    const char* url,
+    const char* username,
+    const char* password,
+    int timeout_ms
+) {
+    if (!client || !url) return false;
 
-    if (client->statusCallback) {
-        client->statusCallback(RTSP_STATUS_CONNECTED, "Connected successfully", client->statusUserData);
-    }
+    // Незавершенное асинхронное подключение и переподключение заменяются синхронным
+    stop_session_timers(client);
+    enable_session_timers(client);
+    stop_previous_session(client);
 
-    return true;
+    std::string error;
+    bool connected;
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        connected = connect_blocking(client, url, username, password, timeout_ms, error);
+    }
+    notify_status(client, connected ? RTSP_STATUS_CONNECTED : RTSP_STATUS_ERROR,
+                  connected ? "Connected successfully" : error.c_str());
+    return connected;
 
 #ifdef ENABLE_FFMPEG
     // Инициализация FFmpeg
@@ -995,83 +2795,125 @@ bool rtsp_client_connect(
 #endif
 }
 
+bool rtsp_client_connect_async(
+    RTSPClient* client,
+    const char* url,
+    const char* username,
+    const char* password,
+    int timeout_ms,
+    RTSPConnectCallback callback,
+    void* userData
+) {
+    if (!client || !url) return false;
+
+    stop_session_timers(client);
+    enable_session_timers(client);
+    return start_async_connect(client, url, username, password, timeout_ms, callback, userData);
+}
+
+void rtsp_set_max_concurrent_connects(int maxConnects) {
+    RTSPConnector::instance().setMaxConcurrent(maxConnects);
+}
+
 void rtsp_client_disconnect(RTSPClient* client) {
     if (!client) return;
 
-    std::lock_guard<std::mutex> lock(client->mutex);
-
+    // Остановка выполняется до захвата мьютекса: rtsp_client_stop, таймеры
+    // и отмена асинхронного подключения захватывают его сами
+    stop_session_timers(client);
     rtsp_client_stop(client);
-    client->shouldStop = true;
 
-    // Отправка TEARDOWN запроса
-    if (client->rtspSocket != INVALID_SOCKET && client->connected) {
-        std::ostringstream teardownHeaders;
-        teardownHeaders << "CSeq: " << client->cseq++ << "\r\n";
-        if (!client->sessionId.empty()) {
-            teardownHeaders << "Session: " << client->sessionId << "\r\n";
-        }
-        if (!client->username.empty() && !client->password.empty()) {
-            teardownHeaders << "Authorization: " << generate_basic_auth(client->username, client->password) << "\r\n";
-        }
-        teardownHeaders << "User-Agent: IP-CSS RTSP Client\r\n";
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->shouldStop = true;
 
-        std::string teardownResponse;
-        send_rtsp_request(client->rtspSocket, "TEARDOWN", client->rtspUrl.path,
-                         teardownHeaders.str(), "", teardownResponse);
+        // Отправка TEARDOWN запроса
+        if (client->rtspSocket != INVALID_SOCKET && client->connected) {
+            std::string teardownResponse;
+            send_session_request(client, "TEARDOWN", "", teardownResponse);
 
-        close(client->rtspSocket);
-        client->rtspSocket = INVALID_SOCKET;
-    }
+            close(client->rtspSocket);
+            client->rtspSocket = INVALID_SOCKET;
+        }
 
-    // Закрытие RTP сокетов
-    for (auto& stream : client->rtpStreams) {
-        if (stream.rtpSocket != INVALID_SOCKET) {
-            close(stream.rtpSocket);
-            stream.rtpSocket = INVALID_SOCKET;
+        // Закрытие RTP сокетов
+        release_rtp_streams(client);
+
+#ifdef ENABLE_FFMPEG
+        if (client->swsContext) {
+            sws_freeContext(client->swsContext);
+            client->swsContext = nullptr;
         }
-        if (stream.rtcpSocket != INVALID_SOCKET) {
-            close(stream.rtcpSocket);
-            stream.rtcpSocket = INVALID_SOCKET;
+        if (client->videoCodecContext) {
+            avcodec_free_context(&client->videoCodecContext);
+            client->videoCodecContext = nullptr;
         }
-    }
-    client->rtpStreams.clear();
+        if (client->audioCodecContext) {
+            avcodec_free_context(&client->audioCodecContext);
+            client->audioCodecContext = nullptr;
+        }
+        if (client->formatContext) {
+            avformat_close_input(&client->formatContext);
+            client->formatContext = nullptr;
+        }
+        avformat_network_deinit();
+#endif
 
-#ifdef ENABLE_FFMPEG
-    if (client->swsContext) {
-        sws_freeContext(client->swsContext);
-        client->swsContext = nullptr;
+        client->connected = false;
+        client->status = RTSP_STATUS_DISCONNECTED;
     }
-    if (client->videoCodecContext) {
-        avcodec_free_context(&client->videoCodecContext);
-        client->videoCodecContext = nullptr;
+
+    notify_status(client, RTSP_STATUS_DISCONNECTED, "Disconnected");
+}
+
+RTSPStatus rtsp_client_get_status(RTSPClient* client) {
+    if (!client) return RTSP_STATUS_DISCONNECTED;
+    return client->status;
+}
+
+// PLAY и запуск приема RTP (под мьютексом клиента). false - ошибка, текст в error.
+static bool start_playback(RTSPClient* client, const char*& error) {
+    // Отправка PLAY запроса
+    std::string playResponse;
+    std::string leftover;
+    if (!send_session_request(client, "PLAY", "Range: npt=0.000-\r\n", playResponse, &leftover)) {
+        error = "Failed to send PLAY request";
+        return false;
     }
-    if (client->audioCodecContext) {
-        avcodec_free_context(&client->audioCodecContext);
-        client->audioCodecContext = nullptr;
+
+    // Парсинг ответа PLAY
+    int statusCode;
+    std::string sessionId;
+    if (!parse_rtsp_response(playResponse, statusCode, sessionId)) {
+        error = "Failed to parse PLAY response";
+        return false;
     }
-    if (client->formatContext) {
-        avformat_close_input(&client->formatContext);
-        client->formatContext = nullptr;
+
+    if (statusCode != 200) {
+        error = "PLAY request failed";
+        return false;
     }
-    avformat_network_deinit();
-#endif
 
-    client->connected = false;
-    client->status = RTSP_STATUS_DISCONNECTED;
+    client->playing = true;
+    client->status = RTSP_STATUS_PLAYING;
 
-    if (client->statusCallback) {
-        client->statusCallback(RTSP_STATUS_DISCONNECTED, "Disconnected", client->statusUserData);
+    // Начало RTP данных, прочитанное вместе с ответом на PLAY
+    if (client->interleaved) {
+        client->interleavedReader->append(reinterpret_cast<const uint8_t*>(leftover.data()),
+                                          leftover.size());
     }
-}
 
-RTSPStatus rtsp_client_get_status(RTSPClient* client) {
-    if (!client) return RTSP_STATUS_DISCONNECTED;
-    return client->status;
+    // Запуск приема RTP пакетов и отправки RTCP отчетов
+    start_rtp_reception(client);
+    schedule_rtcp_report(client, kRtcpReportIntervalMs);
+    return true;
 }
 
 bool rtsp_client_play(RTSPClient* client) {
     if (!client || !client->connected) return false;
 
+    bool started;
+    const char* error = nullptr;
     {
         std::lock_guard<std::mutex> lock(client->mutex);
 
@@ -1083,58 +2925,39 @@ bool rtsp_client_play(RTSPClient* client) {
             return false;
         }
 
-        // Отправка PLAY запроса
-        std::ostringstream playHeaders;
-        playHeaders << "CSeq: " << client->cseq++ << "\r\n";
-        if (!client->sessionId.empty()) {
-            playHeaders << "Session: " << client->sessionId << "\r\n";
-        }
-        if (!client->username.empty() && !client->password.empty()) {
-            playHeaders << "Authorization: " << generate_basic_auth(client->username, client->password) << "\r\n";
-        }
-        playHeaders << "User-Agent: IP-CSS RTSP Client\r\n";
-        playHeaders << "Range: npt=0.000-\r\n";
-
-        std::string playResponse;
-        if (!send_rtsp_request(client->rtspSocket, "PLAY", client->rtspUrl.path,
-                              playHeaders.str(), "", playResponse)) {
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "Failed to send PLAY request", client->statusUserData);
-            }
-            return false;
-        }
-
-        // Парсинг ответа PLAY
-        int statusCode;
-        std::string sessionId;
-        if (!parse_rtsp_response(playResponse, statusCode, sessionId)) {
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "Failed to parse PLAY response", client->statusUserData);
-            }
-            return false;
+        started = start_playback(client, error);
+        if (started && client->transport == RTSP_TRANSPORT_AUTO && !client->interleaved) {
+            // Приход UDP пакетов проверяет таймер: PLAY их не ждет
+            schedule_udp_fallback_check(client);
         }
+    }
 
-        if (statusCode != 200) {
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "PLAY request failed", client->statusUserData);
-            }
-            return false;
-        }
+    // Callback статуса вызывается после освобождения мьютекса
+    if (!started) {
+        notify_status(client, RTSP_STATUS_ERROR, error);
+        return false;
+    }
 
-        client->playing = true;
-        client->status = RTSP_STATUS_PLAYING;
+    notify_status(client, RTSP_STATUS_PLAYING, "Playing");
+    return true;
+}
 
-        // Запуск потока для приема RTP пакетов
-        if (client->rtpThread.joinable()) {
-            client->rtpThread.join();
-        }
-        client->rtpThread = std::thread(receive_rtp_thread, client);
+// Отправка PAUSE для текущей сессии (вызывается под мьютексом клиента)
+static bool send_pause_request(RTSPClient* client) {
+    if (client->rtspSocket == INVALID_SOCKET || client->sessionId.empty()) {
+        return true;
     }
 
-    if (client->statusCallback) {
-        client->statusCallback(RTSP_STATUS_PLAYING, "Playing", client->statusUserData);
+    std::string pauseResponse;
+    if (!send_session_request(client, "PAUSE", "", pauseResponse)) {
+        return false;
     }
 
+    int statusCode;
+    std::string sessionId;
+    if (parse_rtsp_response(pauseResponse, statusCode, sessionId) && statusCode != 200) {
+        return false;
+    }
     return true;
 }
 
@@ -1144,36 +2967,25 @@ bool rtsp_client_stop(RTSPClient* client) {
     {
         std::lock_guard<std::mutex> lock(client->mutex);
 
+        client->resumePlayback = false;
         if (!client->playing) {
             return true; // Уже остановлен
         }
 
         client->shouldStop = true;
         client->playing = false;
-
-        // Отправка PAUSE запроса (или можно использовать TEARDOWN)
-        if (client->rtspSocket != INVALID_SOCKET && !client->sessionId.empty()) {
-            std::ostringstream pauseHeaders;
-            pauseHeaders << "CSeq: " << client->cseq++ << "\r\n";
-            pauseHeaders << "Session: " << client->sessionId << "\r\n";
-            if (!client->username.empty() && !client->password.empty()) {
-                pauseHeaders << "Authorization: " << generate_basic_auth(client->username, client->password) << "\r\n";
-            }
-            pauseHeaders << "User-Agent: IP-CSS RTSP Client\r\n";
-
-            std::string pauseResponse;
-            send_rtsp_request(client->rtspSocket, "PAUSE", client->rtspUrl.path,
-                             pauseHeaders.str(), "", pauseResponse);
-        }
     }
 
-    // Ожидание завершения потока приема RTP
-    if (client->rtpThread.joinable()) {
-        client->rtpThread.join();
-    }
+    // Ожидание завершения приема RTP до отправки PAUSE: при interleaved
+    // транспорте ответ приходит в том же сокете, что и RTP
+    stop_rtp_reception(client);
 
     {
         std::lock_guard<std::mutex> lock(client->mutex);
+
+        // Отправка PAUSE запроса (или можно использовать TEARDOWN)
+        send_pause_request(client);
+
         if (client->connected) {
             client->status = RTSP_STATUS_CONNECTED;
         } else {
@@ -1187,27 +2999,13 @@ bool rtsp_client_stop(RTSPClient* client) {
 bool rtsp_client_pause(RTSPClient* client) {
     if (!client || !client->playing) return false;
 
+    bool interleaved;
     {
         std::lock_guard<std::mutex> lock(client->mutex);
+        interleaved = client->interleaved;
 
-        if (client->rtspSocket != INVALID_SOCKET && !client->sessionId.empty()) {
-            std::ostringstream pauseHeaders;
-            pauseHeaders << "CSeq: " << client->cseq++ << "\r\n";
-            pauseHeaders << "Session: " << client->sessionId << "\r\n";
-            if (!client->username.empty() && !client->password.empty()) {
-                pauseHeaders << "Authorization: " << generate_basic_auth(client->username, client->password) << "\r\n";
-            }
-            pauseHeaders << "User-Agent: IP-CSS RTSP Client\r\n";
-
-            std::string pauseResponse;
-            if (!send_rtsp_request(client->rtspSocket, "PAUSE", client->rtspUrl.path,
-                                  pauseHeaders.str(), "", pauseResponse)) {
-                return false;
-            }
-
-            int statusCode;
-            std::string sessionId;
-            if (parse_rtsp_response(pauseResponse, statusCode, sessionId) && statusCode != 200) {
+        if (!interleaved) {
+            if (!send_pause_request(client)) {
                 return false;
             }
         }
@@ -1216,17 +3014,17 @@ bool rtsp_client_pause(RTSPClient* client) {
         client->playing = false;
     }
 
-    // Ожидание завершения потока приема RTP
-    if (client->rtpThread.joinable()) {
-        client->rtpThread.join();
-    }
+    // Ожидание завершения приема RTP
+    stop_rtp_reception(client);
 
     {
         std::lock_guard<std::mutex> lock(client->mutex);
+
+        // Interleaved: PAUSE отправляется после остановки чтения RTSP сокета
+        bool paused = !interleaved || send_pause_request(client);
         client->status = RTSP_STATUS_CONNECTED;
+        return paused;
     }
-
-    return true;
 }
 
 int rtsp_client_get_stream_count(RTSPClient* client) {
@@ -1256,6 +3054,10 @@ void rtsp_client_set_frame_callback(
     if (streamType == RTSP_STREAM_VIDEO) {
         client->videoCallback = callback;
         client->videoUserData = userData;
+        // Новый подписчик получает текущий GOP
+        if (callback && client->gopCache.enabled()) {
+            client->gopReplayPending = true;
+        }
     } else if (streamType == RTSP_STREAM_AUDIO) {
         client->audioCallback = callback;
         client->audioUserData = userData;
@@ -1301,6 +3103,27 @@ bool rtsp_client_get_stream_info(
     return true;
 }
 
+int rtsp_client_get_stream_extradata(
+    RTSPClient* client,
+    int streamIndex,
+    uint8_t* buffer,
+    int bufferSize
+) {
+    if (!client) return -1;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    if (streamIndex < 0 || streamIndex >= static_cast<int>(client->streams.size())) {
+        return -1;
+    }
+
+    const std::vector<uint8_t>& extradata = client->streams[streamIndex]->extradata;
+    int size = static_cast<int>(extradata.size());
+    if (buffer && bufferSize >= size && size > 0) {
+        memcpy(buffer, extradata.data(), extradata.size());
+    }
+    return size;
+}
+
 int rtsp_frame_get_size(RTSPFrame* frame) {
     return frame ? frame->size : 0;
 }
@@ -1313,11 +3136,26 @@ int64_t rtsp_frame_get_timestamp(RTSPFrame* frame) {
     return frame ? frame->timestamp : 0;
 }
 
+bool rtsp_frame_is_timestamp_synchronized(RTSPFrame* frame) {
+    return frame ? frame->timestampSynchronized : false;
+}
+
+bool rtsp_frame_is_keyframe(RTSPFrame* frame) {
+    return frame ? frame->keyframe : false;
+}
+
+RTSPFrame* rtsp_frame_retain(RTSPFrame* frame) {
+    return FramePool::retain(frame);
+}
+
 void rtsp_frame_release(RTSPFrame* frame) {
-    if (frame && frame->data) {
-        delete[] frame->data;
-        delete frame;
-    }
+    FramePool::release(frame);
+}
+
+bool rtsp_client_get_pool_stats(RTSPClient* client, RTSPFramePoolStats* stats) {
+    if (!client || !stats) return false;
+    client->framePool->getStats(stats);
+    return true;
 }
 
 // Функция для установки параметров автоматического переподключения
@@ -1325,6 +3163,7 @@ void rtsp_client_set_reconnect_params(RTSPClient* client, const RTSPReconnectPar
     if (!client) return;
 
     std::lock_guard<std::mutex> lock(client->mutex);
+    std::lock_guard<std::mutex> timerLock(client->timerMutex);
 
     if (params) {
         client->reconnectParams = *params;
@@ -1340,68 +3179,211 @@ void rtsp_client_set_reconnect_params(RTSPClient* client, const RTSPReconnectPar
     }
 }
 
-// Вспомогательная функция для автоматического переподключения
-static void reconnect_thread_func(RTSPClient* client) {
-    if (!client || !client->reconnectEnabled) return;
+bool rtsp_reactor_start(int threadCount) {
+    return RTPReactor::instance().start(threadCount);
+}
 
-    int attempt = 0;
-    int delay = client->reconnectParams.initialDelayMs;
+void rtsp_reactor_shutdown(void) {
+    RTPReactor::instance().shutdown();
+}
 
-    while (!client->shouldStop && client->reconnectEnabled) {
-        // Проверяем, нужно ли переподключение
-        if (client->connected && client->status != RTSP_STATUS_ERROR) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-            continue;
-        }
+void rtsp_client_set_jitter_buffer_depth(RTSPClient* client, int depthMs) {
+    if (!client) return;
 
-        // Проверяем лимит попыток
-        if (client->reconnectParams.maxRetries > 0 && attempt >= client->reconnectParams.maxRetries) {
-            if (client->statusCallback) {
-                client->statusCallback(RTSP_STATUS_ERROR, "Max reconnection attempts reached", client->statusUserData);
-            }
-            client->reconnectEnabled = false;
-            break;
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->jitterBufferDepthMs = depthMs > 0 ? depthMs : 0;
+    // Применяется к уже настроенным потокам при следующем воспроизведении
+    if (!client->playing) {
+        for (auto& stream : client->rtpStreams) {
+            stream.jitterBuffer->setDepth(client->jitterBufferDepthMs);
         }
+    }
+}
 
-        client->isReconnecting = true;
-        attempt++;
+bool rtsp_client_get_rtp_stats(RTSPClient* client, int streamIndex, RTSPStreamRTPStats* stats) {
+    if (!client || !stats) return false;
 
-        if (client->statusCallback) {
-            std::string msg = "Reconnecting (attempt " + std::to_string(attempt) + ")...";
-            client->statusCallback(RTSP_STATUS_CONNECTING, msg.c_str(), client->statusUserData);
-        }
+    std::lock_guard<std::mutex> lock(client->mutex);
+    if (streamIndex < 0 || streamIndex >= static_cast<int>(client->rtpStreams.size())) {
+        return false;
+    }
 
-        // Попытка переподключения
-        bool success = rtsp_client_connect(client, client->url.c_str(),
-                                          client->username.c_str(),
-                                          client->password.c_str(),
-                                          5000);
+    const RTPStreamCounters& counters = client->rtpStreams[streamIndex].jitterBuffer->counters();
+    stats->packetsReceived = counters.packetsReceived.load(std::memory_order_relaxed);
+    stats->packetsLost = counters.packetsLost.load(std::memory_order_relaxed);
+    stats->packetsReordered = counters.packetsReordered.load(std::memory_order_relaxed);
+    stats->packetsLate = counters.packetsLate.load(std::memory_order_relaxed);
+    stats->packetsDuplicate = counters.packetsDuplicate.load(std::memory_order_relaxed);
+    stats->framesDropped = counters.framesDropped.load(std::memory_order_relaxed);
+
+    const RTPStream& stream = client->rtpStreams[streamIndex];
+    stats->kernelDrops = stream.rtpSubscription != 0
+        ? MulticastReceiver::instance().kernelDrops(stream.rtpSubscription)
+        : counters.kernelDrops.load(std::memory_order_relaxed);
+    stats->receiveBufferBytes = stream.receiveBufferBytes;
+
+    RTCPSession::KeyframeRequestStats keyframeStats;
+    client->rtpStreams[streamIndex].rtcp->getKeyframeRequestStats(keyframeStats);
+    stats->pliSent = keyframeStats.pliSent;
+    stats->firSent = keyframeStats.firSent;
+    stats->keyframeRecoveries = keyframeStats.recoveries;
+    stats->lastRecoveryMs = static_cast<int>(keyframeStats.lastRecoveryUs / 1000);
+    stats->maxRecoveryMs = static_cast<int>(keyframeStats.maxRecoveryUs / 1000);
+    return true;
+}
 
-        if (success && client->playing) {
-            // Если было воспроизведение, возобновляем
-            rtsp_client_play(client);
-        }
+bool rtsp_client_get_stats(RTSPClient* client, RTSPClientStats* stats) {
+    if (!client || !stats) return false;
 
-        client->isReconnecting = false;
+    client->stats.snapshot(*stats, steady_now_us());
+    return true;
+}
 
-        if (success) {
-            // Успешное переподключение
-            attempt = 0;
-            delay = client->reconnectParams.initialDelayMs;
-            continue;
-        }
+void rtsp_client_set_receive_buffer_size(RTSPClient* client, RTSPStreamType type, int bytes) {
+    if (!client || type < RTSP_STREAM_VIDEO || type > RTSP_STREAM_METADATA) return;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->receiveBufferSize[type] = bytes < 0 ? -1 : bytes;
+}
+
+void rtsp_client_set_shared_reactor(RTSPClient* client, bool enabled) {
+    if (!client) return;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->useSharedReactor = enabled;
+}
+
+void rtsp_client_set_transport(RTSPClient* client, RTSPTransport transport, int udpTimeoutMs) {
+    if (!client) return;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->transport = transport;
+    client->udpFallbackTimeoutMs = udpTimeoutMs > 0 ? udpTimeoutMs : kDefaultUdpFallbackTimeoutMs;
+    client->fallbackToTcp = false;
+}
+
+void rtsp_client_set_request_pipelining(RTSPClient* client, bool enabled) {
+    if (!client) return;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->pipelineRequests = enabled;
+}
+
+RTSPTransport rtsp_client_get_transport(RTSPClient* client) {
+    if (!client) return RTSP_TRANSPORT_UDP;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    if (client->multicast) return RTSP_TRANSPORT_UDP_MULTICAST;
+    return client->interleaved ? RTSP_TRANSPORT_TCP : RTSP_TRANSPORT_UDP;
+}
+
+void rtsp_client_set_multicast_interface(RTSPClient* client, const char* interfaceAddress) {
+    if (!client) return;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->multicastInterface = interfaceAddress ? interfaceAddress : "";
+}
+
+bool rtsp_multicast_get_stats(RTSPMulticastStats* stats) {
+    if (!stats) return false;
+
+    MulticastReceiver::Stats receiverStats;
+    MulticastReceiver::instance().getStats(receiverStats);
+    stats->groups = receiverStats.groups;
+    stats->subscribers = receiverStats.subscribers;
+    stats->datagrams = receiverStats.datagrams;
+    stats->deliveries = receiverStats.deliveries;
+    return true;
+}
+
+bool rtsp_client_get_resolver_stats(RTSPClient* client, RTSPResolverStats* stats) {
+    if (!client || !stats) return false;
+
+    DNSResolver::Stats resolverStats;
+    DNSResolver::instance().getStats(resolverStats);
+    stats->hits = resolverStats.hits;
+    stats->misses = resolverStats.misses;
+    stats->failures = resolverStats.failures;
+    stats->cachedHosts = resolverStats.cachedHosts;
+    return true;
+}
+
+void rtsp_resolver_set_ttl(int ttlMs) {
+    DNSResolver::instance().setTtl(ttlMs);
+}
+
+void rtsp_client_set_gop_cache(RTSPClient* client, int maxFrames, int maxBytes) {
+    if (!client) return;
+    client->gopCache.setLimits(maxFrames, maxBytes > 0 ? static_cast<size_t>(maxBytes) : 0);
+}
+
+void rtsp_client_request_gop_replay(RTSPClient* client) {
+    if (!client || !client->gopCache.enabled()) return;
+    client->gopReplayPending = true;
+}
+
+bool rtsp_client_get_gop_cache_stats(RTSPClient* client, RTSPGopCacheStats* stats) {
+    if (!client || !stats) return false;
+
+    size_t bytes = 0;
+    client->gopCache.getStats(stats->frames, bytes);
+    stats->bytes = static_cast<int64_t>(bytes);
+    stats->replays = client->gopReplays.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool rtsp_client_set_frame_queue(RTSPClient* client, const RTSPFrameQueueParams* params) {
+    if (!client || !params) return false;
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    // Очередь используется потоком приема без блокировок
+    if (client->playing) return false;
 
-        // Ожидание перед следующей попыткой с экспоненциальной задержкой
-        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-        delay = std::min(static_cast<int>(delay * client->reconnectParams.backoffMultiplier),
-                        client->reconnectParams.maxDelayMs);
+    if (client->dispatchThread.joinable()) {
+        client->dispatchThread.join();
     }
 
-    client->isReconnecting = false;
+    std::lock_guard<std::mutex> dispatchLock(client->dispatchMutex);
+    // Прежнюю очередь может ждать rtsp_client_dispatch_frames
+    if (client->frameQueue) {
+        client->frameQueue->close();
+    }
+    if (params->enabled) {
+        client->frameQueue.reset(new FrameQueue(params->capacity, params->policy));
+        client->externalDispatch = params->externalDispatch;
+    } else {
+        client->frameQueue.reset();
+        client->externalDispatch = false;
+    }
+    return true;
+}
+
+int rtsp_client_dispatch_frames(RTSPClient* client, int maxFrames, int timeoutMs) {
+    if (!client || maxFrames <= 0) return 0;
+
+    // Ожидание и callback'и - без dispatchMutex: rtsp_client_play и
+    // rtsp_client_set_frame_queue захватывают его под мьютексом клиента
+    std::shared_ptr<FrameQueue> queue;
+    {
+        std::lock_guard<std::mutex> lock(client->dispatchMutex);
+        if (!client->frameQueue || !client->externalDispatch) return 0;
+        queue = client->frameQueue;
+    }
+
+    if (!queue->waitForFrames(timeoutMs)) return 0;
+    return deliver_queued_frames(client, *queue, maxFrames, &client->dispatchMutex);
 }
 
-// Модифицируем rtsp_client_connect для запуска потока переподключения
-// Это будет сделано через проверку в существующей функции connect
+bool rtsp_client_get_frame_queue_stats(RTSPClient* client, RTSPFrameQueueStats* stats) {
+    if (!client || !stats) return false;
+
+    // Очередь заменяется под обоими мьютексами
+    std::lock_guard<std::mutex> lock(client->mutex);
+    if (!client->frameQueue) return false;
+
+    client->frameQueue->getStats(stats);
+    return true;
+}
 
 } // extern "C"
 
@@ -0,0 +1,530 @@
+#include "rtsp_connector.h"
+#include "rtsp_interleaved.h"
+#include "dns_resolver.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <ws2tcpip.h>
+    #define poll WSAPoll
+    typedef int socklen_t;
+    #define INVALID_RTSP_SOCKET INVALID_SOCKET
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <poll.h>
+    #define INVALID_RTSP_SOCKET -1
+#endif
+
+namespace {
+
+// Максимальное ожидание в poll (на Windows нет пробуждения через pipe)
+#ifdef _WIN32
+const int kMaxWaitMs = 50;
+#else
+const int kMaxWaitMs = 1000;
+#endif
+
+void close_socket(RTSPSocket sock) {
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+bool set_nonblocking(RTSPSocket sock, bool enabled) {
+#ifdef _WIN32
+    u_long mode = enabled ? 1 : 0;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0) return false;
+    flags = enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(sock, F_SETFL, flags) == 0;
+#endif
+}
+
+void set_timeouts(RTSPSocket sock, int timeoutMs) {
+#ifdef _WIN32
+    DWORD timeout = timeoutMs;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#endif
+}
+
+// Операция не завершена и будет продолжена при следующей готовности сокета
+bool would_block() {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS || errno == EINTR;
+#endif
+}
+
+} // namespace
+
+RTSPConnector& RTSPConnector::instance() {
+    static RTSPConnector connector;
+    return connector;
+}
+
+RTSPConnector::RTSPConnector()
+    : activeCount_(0), maxConcurrent_(kDefaultMaxConcurrent), nextId_(1), stopping_(false) {
+    wakeFds_[0] = INVALID_RTSP_SOCKET;
+    wakeFds_[1] = INVALID_RTSP_SOCKET;
+#ifndef _WIN32
+    int fds[2];
+    if (pipe(fds) == 0) {
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+        wakeFds_[0] = fds[0];
+        wakeFds_[1] = fds[1];
+    }
+#endif
+}
+
+RTSPConnector::~RTSPConnector() {
+    stopping_ = true;
+    wake();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    // Незавершенные операции закрываются без вызова обработчиков
+    for (auto& pair : operations_) {
+        if (pair.second->sock != INVALID_RTSP_SOCKET) {
+            close_socket(pair.second->sock);
+        }
+    }
+    operations_.clear();
+    pending_.clear();
+
+#ifndef _WIN32
+    if (wakeFds_[0] != INVALID_RTSP_SOCKET) close(wakeFds_[0]);
+    if (wakeFds_[1] != INVALID_RTSP_SOCKET) close(wakeFds_[1]);
+#endif
+}
+
+void RTSPConnector::setMaxConcurrent(int maxConcurrent) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxConcurrent_ = maxConcurrent > 0 ? maxConcurrent : kDefaultMaxConcurrent;
+    }
+    wake();
+}
+
+int RTSPConnector::maxConcurrent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxConcurrent_;
+}
+
+int RTSPConnector::activeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return activeCount_;
+}
+
+int RTSPConnector::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(pending_.size());
+}
+
+uint64_t RTSPConnector::submit(const RTSPConnectRequest& request) {
+    if (!request.onResponse || !request.onDone || stopping_) return 0;
+
+    std::shared_ptr<Operation> op = std::make_shared<Operation>();
+    op->request = request;
+    op->state = STATE_CONNECTING;
+    op->sock = INVALID_RTSP_SOCKET;
+    op->outputOffset = 0;
+    op->awaitingResponses = 0;
+    op->cancelled = false;
+    op->resolved = false;
+    op->resolveFailed = false;
+    memset(&op->address, 0, sizeof(op->address));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        op->id = nextId_++;
+        operations_[op->id] = op;
+        pending_.push_back(op);
+
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&RTSPConnector::run, this);
+        }
+    }
+
+    wake();
+    return op->id;
+}
+
+void RTSPConnector::cancel(uint64_t id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = operations_.find(id);
+        if (it == operations_.end()) return;
+
+        std::shared_ptr<Operation> op = it->second;
+        op->cancelled = true;
+
+        // Операция еще в очереди: удаляется сразу
+        auto pendingIt = std::find(pending_.begin(), pending_.end(), op);
+        if (pendingIt != pending_.end()) {
+            pending_.erase(pendingIt);
+            operations_.erase(it);
+            return;
+        }
+    }
+
+    wake();
+
+    // Ожидание завершения обработчика, который мог выполняться в момент отмены
+    if (std::this_thread::get_id() != thread_.get_id()) {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+    }
+}
+
+void RTSPConnector::wake() {
+#ifndef _WIN32
+    if (wakeFds_[1] != INVALID_RTSP_SOCKET) {
+        char byte = 1;
+        ssize_t written = write(wakeFds_[1], &byte, 1);
+        (void)written;
+    }
+#endif
+}
+
+void RTSPConnector::onResolved(bool success, const struct sockaddr_in& addr, void* context) {
+    uint64_t* id = static_cast<uint64_t*>(context);
+    RTSPConnector& connector = instance();
+    {
+        std::lock_guard<std::mutex> lock(connector.mutex_);
+        auto it = connector.operations_.find(*id);
+        if (it != connector.operations_.end()) {
+            it->second->resolved = true;
+            it->second->resolveFailed = !success;
+            it->second->address = addr;
+        }
+    }
+    delete id;
+    connector.wake();
+}
+
+// Запросы к отправке; на каждый ожидается отдельный ответ
+void RTSPConnector::setOutput(Operation& op, const std::string& requests) {
+    op.output = requests;
+    op.outputOffset = 0;
+
+    size_t offset = 0;
+    while (offset < requests.length()) {
+        size_t length = rtsp_message_length(reinterpret_cast<const uint8_t*>(requests.data()) + offset,
+                                            requests.length() - offset);
+        op.awaitingResponses++;
+        if (length == 0) break;
+        offset += length;
+    }
+}
+
+void RTSPConnector::startOperation(Operation& op) {
+    op.state = STATE_RESOLVING;
+    setOutput(op, op.request.firstRequest);
+    op.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(op.request.timeoutMs);
+
+    // Адрес из кэша приходит сразу, иначе - из пула потоков резолвера
+    DNSResolver::instance().resolveAsync(op.request.host, onResolved, new uint64_t(op.id));
+}
+
+bool RTSPConnector::connectResolved(Operation& op, std::string& error) {
+    if (op.resolveFailed) {
+        error = "Failed to resolve RTSP server address";
+        return false;
+    }
+
+    struct sockaddr_in addr = op.address;
+    addr.sin_port = htons(static_cast<uint16_t>(op.request.port));
+
+    op.sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (op.sock == INVALID_RTSP_SOCKET || !set_nonblocking(op.sock, true)) {
+        error = "Failed to connect to RTSP server";
+        return false;
+    }
+
+    int rc = connect(op.sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    if (rc == 0) {
+        op.state = STATE_SENDING;
+    } else if (would_block()) {
+        op.state = STATE_CONNECTING;
+    } else {
+        error = "Failed to connect to RTSP server";
+        return false;
+    }
+
+    op.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(op.request.timeoutMs);
+    return true;
+}
+
+bool RTSPConnector::handleEvent(Operation& op, short revents, std::string& error, bool& done) {
+    if (op.state == STATE_CONNECTING) {
+        int socketError = 0;
+        socklen_t length = sizeof(socketError);
+        getsockopt(op.sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&socketError), &length);
+        if (socketError != 0 || (revents & POLLERR)) {
+            error = "Failed to connect to RTSP server";
+            return false;
+        }
+        op.state = STATE_SENDING;
+        op.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(op.request.timeoutMs);
+    }
+
+    if (op.state == STATE_SENDING) {
+#ifdef MSG_NOSIGNAL
+        int flags = MSG_NOSIGNAL;
+#else
+        int flags = 0;
+#endif
+        const char* data = op.output.data() + op.outputOffset;
+        int remaining = static_cast<int>(op.output.length() - op.outputOffset);
+        int sent = send(op.sock, data, remaining, flags);
+        if (sent < 0) {
+            if (would_block()) return true;
+            error = "Failed to send RTSP request";
+            return false;
+        }
+
+        op.outputOffset += static_cast<size_t>(sent);
+        if (op.outputOffset == op.output.length()) {
+            op.state = STATE_RECEIVING;
+            op.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(op.request.timeoutMs);
+            // Ответы на конвейер могли быть приняты до отправки следующих запросов
+            return handleResponse(op, error, done);
+        }
+        return true;
+    }
+
+    // STATE_RECEIVING
+    char buffer[4096];
+    while (true) {
+        int received = recv(op.sock, buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            error = "Connection closed by RTSP server";
+            return false;
+        }
+        if (received < 0) {
+            if (would_block()) break;
+            error = "Failed to receive RTSP response";
+            return false;
+        }
+        op.input.append(buffer, received);
+        if (received < static_cast<int>(sizeof(buffer))) break;
+    }
+
+    return handleResponse(op, error, done);
+}
+
+// Обработка всех полностью принятых ответов (при конвейере их может быть несколько)
+bool RTSPConnector::handleResponse(Operation& op, std::string& error, bool& done) {
+    while (op.state == STATE_RECEIVING) {
+        size_t length = rtsp_message_length(reinterpret_cast<const uint8_t*>(op.input.data()),
+                                            op.input.length());
+        if (length == 0) return true; // Ответ получен не полностью
+
+        std::string response = op.input.substr(0, length);
+        op.input.erase(0, length);
+        op.awaitingResponses--;
+
+        std::string nextRequest;
+        bool ok = true;
+        {
+            std::lock_guard<std::mutex> lock(callbackMutex_);
+            if (op.cancelled) return true;
+            ok = op.request.onResponse(response, nextRequest, error, op.request.context);
+        }
+
+        if (!ok) {
+            if (error.empty()) error = "RTSP request failed";
+            return false;
+        }
+
+        op.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(op.request.timeoutMs);
+        if (!nextRequest.empty()) {
+            setOutput(op, nextRequest);
+            op.state = STATE_SENDING;
+        } else if (op.awaitingResponses <= 0) {
+            done = true;
+            return true;
+        }
+    }
+    return true;
+}
+
+void RTSPConnector::finish(Operation& op, const char* error) {
+    RTSPSocket sock = op.sock;
+    op.sock = INVALID_RTSP_SOCKET;
+
+    bool delivered = false;
+    if (sock != INVALID_RTSP_SOCKET && !error) {
+        // Дальше сокет используется в блокирующем режиме с таймаутами
+        set_nonblocking(sock, false);
+        set_timeouts(sock, op.request.timeoutMs);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        if (!op.cancelled) {
+            op.request.onDone(error ? INVALID_RTSP_SOCKET : sock, error, op.request.context);
+            delivered = !error;
+        }
+    }
+
+    if (!delivered && sock != INVALID_RTSP_SOCKET) {
+        close_socket(sock);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    activeCount_--;
+    operations_.erase(op.id);
+}
+
+void RTSPConnector::run() {
+    std::vector<std::shared_ptr<Operation>> active;
+    std::vector<std::shared_ptr<Operation>> remaining;
+    std::vector<struct pollfd> fds;
+
+    while (!stopping_) {
+        // Запуск операций из очереди в пределах лимита
+        std::vector<std::shared_ptr<Operation>> started;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (!pending_.empty() && activeCount_ < maxConcurrent_) {
+                started.push_back(pending_.front());
+                pending_.pop_front();
+                activeCount_++;
+            }
+        }
+
+        for (auto& op : started) {
+            if (op->cancelled) {
+                finish(*op, nullptr);
+            } else {
+                startOperation(*op);
+                active.push_back(op);
+            }
+        }
+
+        // Подключение операций, для которых получен адрес
+        remaining.clear();
+        for (auto& op : active) {
+            if (op->state == STATE_RESOLVING) {
+                bool resolved;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    resolved = op->resolved;
+                }
+                std::string error;
+                if (resolved && !op->cancelled && !connectResolved(*op, error)) {
+                    finish(*op, error.c_str());
+                    continue;
+                }
+            }
+            remaining.push_back(op);
+        }
+        active.swap(remaining);
+
+        // Ожидание готовности сокетов не дольше ближайшего таймаута
+        auto now = std::chrono::steady_clock::now();
+        int waitMs = kMaxWaitMs;
+        fds.clear();
+        size_t firstOperation = 0;
+        if (wakeFds_[0] != INVALID_RTSP_SOCKET) {
+            struct pollfd wakeFd;
+            wakeFd.fd = wakeFds_[0];
+            wakeFd.events = POLLIN;
+            wakeFd.revents = 0;
+            fds.push_back(wakeFd);
+            firstOperation = 1;
+        }
+        for (auto& op : active) {
+            struct pollfd fd;
+            // Операции в ожидании DNS не имеют сокета и не опрашиваются
+            fd.fd = op->state == STATE_RESOLVING ? -1 : op->sock;
+            fd.events = op->state == STATE_RECEIVING ? POLLIN : POLLOUT;
+            fd.revents = 0;
+            fds.push_back(fd);
+
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(op->deadline - now).count();
+            waitMs = std::max(0, std::min(waitMs, static_cast<int>(left) + 1));
+        }
+
+        if (fds.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+            continue;
+        }
+
+        int ready = poll(fds.data(), static_cast<unsigned long>(fds.size()), waitMs);
+        if (ready < 0 && !would_block()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+#ifndef _WIN32
+        if (firstOperation == 1 && (fds[0].revents & POLLIN)) {
+            char drain[64];
+            while (read(wakeFds_[0], drain, sizeof(drain)) > 0) {}
+        }
+#endif
+
+        now = std::chrono::steady_clock::now();
+        remaining.clear();
+        for (size_t i = 0; i < active.size(); i++) {
+            Operation& op = *active[i];
+            short revents = ready > 0 ? fds[firstOperation + i].revents : 0;
+
+            if (op.cancelled) {
+                finish(op, nullptr);
+                continue;
+            }
+
+            std::string error;
+            bool done = false;
+            bool ok = true;
+            if (revents != 0) {
+                ok = handleEvent(op, revents, error, done);
+            } else if (now >= op.deadline) {
+                ok = false;
+                if (op.state == STATE_RESOLVING) {
+                    error = "Failed to resolve RTSP server address";
+                } else if (op.state == STATE_CONNECTING) {
+                    error = "Connection to RTSP server timed out";
+                } else {
+                    error = "RTSP response timed out";
+                }
+            }
+
+            if (!ok) {
+                finish(op, error.c_str());
+            } else if (done) {
+                finish(op, nullptr);
+            } else {
+                remaining.push_back(active[i]);
+            }
+        }
+        active.swap(remaining);
+    }
+
+    for (auto& op : active) {
+        if (op->sock != INVALID_RTSP_SOCKET) {
+            close_socket(op->sock);
+            op->sock = INVALID_RTSP_SOCKET;
+        }
+    }
+}
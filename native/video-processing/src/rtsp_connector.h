@@ -0,0 +1,130 @@
+#ifndef RTSP_CONNECTOR_H
+#define RTSP_CONNECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    typedef SOCKET RTSPSocket;
+#else
+    #include <netinet/in.h>
+    typedef int RTSPSocket;
+#endif
+
+// Обработчик RTSP ответа. Следующий запрос записывается в nextRequest;
+// несколько запросов подряд отправляются конвейером (RFC 2326, 1.3), и
+// обработчик вызывается для каждого ответа по порядку. Пустой nextRequest при
+// полученных ответах на все запросы - обмен успешно завершен; пока ответы
+// ожидаются, пустой nextRequest означает продолжение приема.
+// false - ошибка (текст в error).
+typedef bool (*RTSPResponseHandler)(const std::string& response, std::string& nextRequest,
+                                    std::string& error, void* context);
+
+// Завершение обмена. При успехе sock - подключенный блокирующий сокет с
+// таймаутами, передается во владение; при ошибке sock невалиден, error != nullptr.
+typedef void (*RTSPExchangeDoneHandler)(RTSPSocket sock, const char* error, void* context);
+
+// Параметры асинхронного подключения и обмена запросами
+struct RTSPConnectRequest {
+    std::string host;
+    int port;
+    int timeoutMs;                  // Таймаут каждого шага: подключения и ожидания ответа
+    std::string firstRequest;       // Один или несколько запросов подряд
+    RTSPResponseHandler onResponse;
+    RTSPExchangeDoneHandler onDone;
+    void* context;
+};
+
+// Цикл событий для неблокирующего установления RTSP сессий.
+// Один поток ведет все подключения как конечные автоматы
+// (DNS -> connect -> отправка запроса -> прием ответа -> ...), поэтому сотни
+// камер подключаются параллельно. Одновременно выполняется не больше
+// maxConcurrent операций, остальные ждут в очереди.
+// Обработчики вызываются в потоке цикла и не должны надолго блокировать его.
+class RTSPConnector {
+public:
+    static const int kDefaultMaxConcurrent = 64;
+
+    static RTSPConnector& instance();
+
+    void setMaxConcurrent(int maxConcurrent);
+    int maxConcurrent() const;
+
+    // Постановка операции в очередь. Возвращает ее идентификатор (0 - ошибка).
+    uint64_t submit(const RTSPConnectRequest& request);
+
+    // Отмена операции. После возврата ее обработчики не выполняются и не будут
+    // вызваны (при вызове из обработчика - после его завершения). Сокет закрывается.
+    void cancel(uint64_t id);
+
+    int activeCount() const;
+    int pendingCount() const;
+
+    ~RTSPConnector();
+
+private:
+    RTSPConnector();
+    RTSPConnector(const RTSPConnector&) = delete;
+    RTSPConnector& operator=(const RTSPConnector&) = delete;
+
+    enum State {
+        STATE_RESOLVING,
+        STATE_CONNECTING,
+        STATE_SENDING,
+        STATE_RECEIVING
+    };
+
+    struct Operation {
+        uint64_t id;
+        RTSPConnectRequest request;
+        State state;
+        RTSPSocket sock;
+        std::string output;
+        size_t outputOffset;
+        int awaitingResponses;      // Отправленные запросы без ответа
+        std::string input;
+        std::chrono::steady_clock::time_point deadline;
+        std::atomic<bool> cancelled;
+
+        // Результат DNSResolver (под mutex_)
+        bool resolved;
+        bool resolveFailed;
+        struct sockaddr_in address;
+    };
+
+    static void onResolved(bool success, const struct sockaddr_in& addr, void* context);
+
+    void run();
+    void wake();
+    void startOperation(Operation& op);
+    bool connectResolved(Operation& op, std::string& error);
+    bool handleEvent(Operation& op, short revents, std::string& error, bool& done);
+    bool handleResponse(Operation& op, std::string& error, bool& done);
+    void setOutput(Operation& op, const std::string& requests);
+    void finish(Operation& op, const char* error);
+
+    mutable std::mutex mutex_;
+    std::deque<std::shared_ptr<Operation>> pending_;
+    std::map<uint64_t, std::shared_ptr<Operation>> operations_;
+    int activeCount_;
+    int maxConcurrent_;
+    uint64_t nextId_;
+
+    // Обработчики выполняются под этим мьютексом: cancel() ждет завершения текущего
+    std::mutex callbackMutex_;
+
+    std::thread thread_;
+    std::atomic<bool> stopping_;
+    RTSPSocket wakeFds_[2];
+};
+
+#endif // RTSP_CONNECTOR_H
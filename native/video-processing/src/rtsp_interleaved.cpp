@@ -0,0 +1,103 @@
+#include "rtsp_interleaved.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const uint8_t kInterleavedMagic = '$';
+const size_t kInterleavedHeaderSize = 4;
+
+// Начало RTSP сообщения сервера ("RTSP/1.0 200 OK" или запрос "ANNOUNCE ...")
+bool looks_like_rtsp_message(const uint8_t* data, size_t size) {
+    static const char kPrefix[] = "RTSP/";
+    size_t n = std::min(size, sizeof(kPrefix) - 1);
+    if (memcmp(data, kPrefix, n) == 0) return true;
+    return data[0] >= 'A' && data[0] <= 'Z';
+}
+
+} // namespace
+
+RTSPInterleavedReader::RTSPInterleavedReader(size_t capacity)
+    : buffer_(new uint8_t[capacity]), capacity_(capacity), filled_(0), skippedBytes_(0) {}
+
+void RTSPInterleavedReader::commit(size_t size) {
+    filled_ = std::min(filled_ + size, capacity_);
+}
+
+void RTSPInterleavedReader::append(const uint8_t* data, size_t size) {
+    size = std::min(size, writableSize());
+    memcpy(writePointer(), data, size);
+    filled_ += size;
+}
+
+void RTSPInterleavedReader::reset() {
+    filled_ = 0;
+}
+
+size_t rtsp_message_length(const uint8_t* data, size_t size) {
+    const char* text = reinterpret_cast<const char*>(data);
+    const char* end = text + size;
+    static const char kHeaderEnd[] = "\r\n\r\n";
+    const char* headerEnd = std::search(text, end, kHeaderEnd, kHeaderEnd + 4);
+    if (headerEnd == end) return 0;
+
+    size_t headerSize = static_cast<size_t>(headerEnd - text) + 4;
+    std::string headers(text, headerSize);
+
+    size_t contentLength = 0;
+    size_t pos = headers.find("Content-Length:");
+    if (pos != std::string::npos) {
+        contentLength = static_cast<size_t>(strtoul(headers.c_str() + pos + 15, nullptr, 10));
+    }
+
+    if (headerSize + contentLength > size) return 0;
+    return headerSize + contentLength;
+}
+
+void RTSPInterleavedReader::parse(InterleavedPacketHandler handler, void* context) {
+    const uint8_t* data = buffer_.get();
+    size_t pos = 0;
+
+    while (pos < filled_) {
+        size_t available = filled_ - pos;
+
+        if (data[pos] == kInterleavedMagic) {
+            if (available < kInterleavedHeaderSize) break;
+            uint8_t channel = data[pos + 1];
+            size_t length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+            if (available < kInterleavedHeaderSize + length) break;
+
+            if (handler) handler(channel, data + pos + kInterleavedHeaderSize, length, context);
+            pos += kInterleavedHeaderSize + length;
+            continue;
+        }
+
+        if (looks_like_rtsp_message(data + pos, available)) {
+            size_t length = rtsp_message_length(data + pos, available);
+            if (length > 0) {
+                pos += length;
+                continue;
+            }
+            // Сообщение не получено целиком; если оно не помещается в буфер,
+            // это не RTSP и поток нужно синхронизировать заново
+            if (pos > 0 || filled_ < capacity_) break;
+        }
+
+        // Рассинхронизация: поиск следующего маркера '$'
+        const uint8_t* next = static_cast<const uint8_t*>(
+            memchr(data + pos + 1, kInterleavedMagic, available - 1));
+        size_t skip = next ? static_cast<size_t>(next - (data + pos)) : available;
+        skippedBytes_ += skip;
+        pos += skip;
+    }
+
+    // Неполный пакет переносится в начало буфера
+    if (pos > 0) {
+        filled_ -= pos;
+        if (filled_ > 0) {
+            memmove(buffer_.get(), buffer_.get() + pos, filled_);
+        }
+    }
+}
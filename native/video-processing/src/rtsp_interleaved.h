@@ -0,0 +1,55 @@
+#ifndef RTSP_INTERLEAVED_H
+#define RTSP_INTERLEAVED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Длина RTSP сообщения (заголовки и тело по Content-Length) с начала data.
+// 0 - сообщение получено не полностью.
+size_t rtsp_message_length(const uint8_t* data, size_t size);
+
+// Обработчик пакета из канала interleaved. Данные указывают прямо в буфер
+// приема и действительны только на время вызова.
+typedef void (*InterleavedPacketHandler)(uint8_t channel, const uint8_t* data, size_t size,
+                                         void* context);
+
+// Демультиплексор RTP/RTCP, передаваемых внутри RTSP соединения
+// (RFC 2326, 10.12): '$' <канал:1> <длина:2> <данные>.
+// Данные читаются из сокета прямо в буфер, пакеты выдаются без копирования.
+// RTSP сообщения сервера между пакетами (ответы на keepalive) пропускаются.
+class RTSPInterleavedReader {
+public:
+    static const size_t kDefaultCapacity = 256 * 1024;
+
+    explicit RTSPInterleavedReader(size_t capacity = kDefaultCapacity);
+
+    // Свободное место в конце буфера для чтения из сокета
+    uint8_t* writePointer() { return buffer_.get() + filled_; }
+    size_t writableSize() const { return capacity_ - filled_; }
+
+    // Учет прочитанных в writePointer() байт
+    void commit(size_t size);
+
+    // Добавление уже прочитанных байт (остаток после ответа на PLAY)
+    void append(const uint8_t* data, size_t size);
+
+    // Выдача всех полных пакетов; неполный хвост переносится в начало буфера
+    void parse(InterleavedPacketHandler handler, void* context);
+
+    void reset();
+
+    // Байты, пропущенные при поиске начала пакета (рассинхронизация потока)
+    uint64_t skippedBytes() const { return skippedBytes_; }
+
+private:
+    RTSPInterleavedReader(const RTSPInterleavedReader&) = delete;
+    RTSPInterleavedReader& operator=(const RTSPInterleavedReader&) = delete;
+
+    std::unique_ptr<uint8_t[]> buffer_;
+    size_t capacity_;
+    size_t filled_;
+    uint64_t skippedBytes_;
+};
+
+#endif // RTSP_INTERLEAVED_H
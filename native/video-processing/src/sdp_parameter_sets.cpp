@@ -0,0 +1,146 @@
+#include "sdp_parameter_sets.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+
+// Типы NAL наборов параметров
+const int kH264NalSps = 7;
+const int kH264NalPps = 8;
+const int kH265NalVps = 32;
+const int kH265NalSps = 33;
+const int kH265NalPps = 34;
+
+int base64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1;
+}
+
+std::string trim(const std::string& value) {
+    size_t start = value.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return std::string();
+    size_t end = value.find_last_not_of(" \t\r\n");
+    return value.substr(start, end - start + 1);
+}
+
+std::string to_lower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+// Распределение NAL-единицы по типу из заголовка
+void add_nal(const std::vector<uint8_t>& nal, RTPPayloadCodec codec, SDPParameterSets& sets) {
+    if (nal.empty()) return;
+
+    if (codec == RTPPayloadCodec::H264) {
+        int type = nal[0] & 0x1F;
+        if (type == kH264NalSps) sets.sps.push_back(nal);
+        else if (type == kH264NalPps) sets.pps.push_back(nal);
+    } else if (codec == RTPPayloadCodec::H265) {
+        if (nal.size() < 2) return;
+        int type = (nal[0] >> 1) & 0x3F;
+        if (type == kH265NalVps) sets.vps.push_back(nal);
+        else if (type == kH265NalSps) sets.sps.push_back(nal);
+        else if (type == kH265NalPps) sets.pps.push_back(nal);
+    }
+}
+
+// Список NAL-единиц в base64 через запятую
+void add_nal_list(const std::string& value, RTPPayloadCodec codec, SDPParameterSets& sets) {
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        if (comma == std::string::npos) comma = value.size();
+
+        std::vector<uint8_t> nal;
+        if (base64_decode(value.substr(start, comma - start), nal)) {
+            add_nal(nal, codec, sets);
+        }
+        start = comma + 1;
+    }
+}
+
+void append_nal_units(const std::vector<std::vector<uint8_t>>& units, std::vector<uint8_t>& out) {
+    for (const auto& nal : units) {
+        out.insert(out.end(), kStartCode, kStartCode + sizeof(kStartCode));
+        out.insert(out.end(), nal.begin(), nal.end());
+    }
+}
+
+} // namespace
+
+bool base64_decode(const std::string& input, std::vector<uint8_t>& output) {
+    output.clear();
+    uint32_t accumulator = 0;
+    int bits = 0;
+
+    for (char c : input) {
+        if (c == '=') break;
+        if (std::isspace(static_cast<unsigned char>(c))) continue;
+
+        int value = base64_value(c);
+        if (value < 0) {
+            output.clear();
+            return false;
+        }
+        accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            output.push_back(static_cast<uint8_t>(accumulator >> bits));
+        }
+    }
+    return true;
+}
+
+bool sdp_parse_parameter_sets(const std::string& fmtp, RTPPayloadCodec codec, SDPParameterSets& sets) {
+    sets = SDPParameterSets();
+    if (codec == RTPPayloadCodec::Unknown) return false;
+
+    // Пропуск номера payload type перед параметрами
+    size_t start = fmtp.find_first_not_of(" \t");
+    if (start != std::string::npos && std::isdigit(static_cast<unsigned char>(fmtp[start]))) {
+        start = fmtp.find_first_of(" \t", start);
+    }
+    if (start == std::string::npos) return false;
+
+    std::string parameters = fmtp.substr(start);
+    size_t position = 0;
+    while (position < parameters.size()) {
+        size_t semicolon = parameters.find(';', position);
+        if (semicolon == std::string::npos) semicolon = parameters.size();
+
+        std::string parameter = parameters.substr(position, semicolon - position);
+        position = semicolon + 1;
+
+        size_t equals = parameter.find('=');
+        if (equals == std::string::npos) continue;
+
+        std::string name = to_lower(trim(parameter.substr(0, equals)));
+        std::string value = trim(parameter.substr(equals + 1));
+
+        if (codec == RTPPayloadCodec::H264 && name == "sprop-parameter-sets") {
+            add_nal_list(value, codec, sets);
+        } else if (codec == RTPPayloadCodec::H265 &&
+                   (name == "sprop-vps" || name == "sprop-sps" || name == "sprop-pps")) {
+            add_nal_list(value, codec, sets);
+        }
+    }
+
+    return !sets.empty();
+}
+
+std::vector<uint8_t> sdp_build_annexb_extradata(const SDPParameterSets& sets) {
+    std::vector<uint8_t> extradata;
+    append_nal_units(sets.vps, extradata);
+    append_nal_units(sets.sps, extradata);
+    append_nal_units(sets.pps, extradata);
+    return extradata;
+}
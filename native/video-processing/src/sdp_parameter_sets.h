@@ -0,0 +1,31 @@
+#ifndef SDP_PARAMETER_SETS_H
+#define SDP_PARAMETER_SETS_H
+
+#include "rtp_depacketizer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Наборы параметров кодека, переданные в SDP (a=fmtp):
+// sprop-parameter-sets для H.264 (RFC 6184), sprop-vps/sps/pps для H.265 (RFC 7798).
+// Позволяют открыть декодер до прихода in-band SPS/PPS.
+struct SDPParameterSets {
+    std::vector<std::vector<uint8_t>> vps;
+    std::vector<std::vector<uint8_t>> sps;
+    std::vector<std::vector<uint8_t>> pps;
+
+    bool empty() const { return vps.empty() && sps.empty() && pps.empty(); }
+};
+
+// Разбор значения a=fmtp ("96 packetization-mode=1;sprop-parameter-sets=...").
+// NAL-единицы распределяются по типу из заголовка. false - наборов нет.
+bool sdp_parse_parameter_sets(const std::string& fmtp, RTPPayloadCodec codec, SDPParameterSets& sets);
+
+// Extradata для декодера в формате Annex-B: VPS, SPS, PPS со стартовыми кодами
+// (принимается FFmpeg как extradata и MediaCodec как csd).
+std::vector<uint8_t> sdp_build_annexb_extradata(const SDPParameterSets& sets);
+
+// Декодирование base64 (RFC 4648), пробелы пропускаются. false - недопустимый символ.
+bool base64_decode(const std::string& input, std::vector<uint8_t>& output);
+
+#endif // SDP_PARAMETER_SETS_H
@@ -0,0 +1,99 @@
+#include "session_workers.h"
+
+namespace {
+
+// Ключ задачи, выполняемой текущим потоком
+thread_local const void* current_key = nullptr;
+
+} // namespace
+
+const int SessionWorkers::kWorkerCount;
+
+SessionWorkers& SessionWorkers::instance() {
+    static SessionWorkers workers;
+    return workers;
+}
+
+SessionWorkers::SessionWorkers() : stopping_(false) {}
+
+SessionWorkers::~SessionWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queueCondition_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void SessionWorkers::startWorkers() {
+    // Вызывается под mutex_
+    if (!workers_.empty()) return;
+    for (int i = 0; i < kWorkerCount; i++) {
+        workers_.emplace_back(&SessionWorkers::run, this);
+    }
+}
+
+void SessionWorkers::post(const void* key, SessionTask task, void* context) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        startWorkers();
+        Entry entry = {key, task, context};
+        queue_.push_back(entry);
+    }
+    queueCondition_.notify_one();
+}
+
+void SessionWorkers::cancel(const void* key) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto it = queue_.begin(); it != queue_.end();) {
+        if (it->key == key) {
+            it = queue_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (current_key == key) return;
+    idleCondition_.wait(lock, [this, key] { return running_.count(key) == 0; });
+}
+
+size_t SessionWorkers::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void SessionWorkers::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Первая задача, ключ которой сейчас не выполняется
+        auto next = queue_.end();
+        queueCondition_.wait(lock, [this, &next] {
+            if (stopping_) return true;
+            for (next = queue_.begin(); next != queue_.end(); ++next) {
+                if (running_.count(next->key) == 0) return true;
+            }
+            return false;
+        });
+        if (stopping_) return;
+
+        Entry entry = *next;
+        queue_.erase(next);
+        auto running = running_.insert(entry.key).first;
+        lock.unlock();
+
+        current_key = entry.key;
+        entry.task(entry.context);
+        current_key = nullptr;
+
+        lock.lock();
+        running_.erase(running);
+        // Ожидающие отмены и задачи того же ключа в очереди
+        idleCondition_.notify_all();
+        queueCondition_.notify_all();
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef SESSION_WORKERS_H
+#define SESSION_WORKERS_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Задача пула (вызывается в потоке пула)
+typedef void (*SessionTask)(void* context);
+
+// Общий для процесса пул потоков для блокирующих шагов RTSP сессий: PLAY
+// с ожиданием ответа, переподключение с остановкой приема. Потоки таймеров
+// и подключений только ставят такие шаги в очередь и не ждут камер.
+// Задачи одного ключа (клиента, пакетного запуска) выполняются по очереди
+// в порядке постановки; задачи разных ключей - параллельно, не больше
+// kWorkerCount одновременно.
+class SessionWorkers {
+public:
+    static const int kWorkerCount = 16;
+
+    static SessionWorkers& instance();
+
+    void post(const void* key, SessionTask task, void* context);
+
+    // Отмена задач ключа в очереди и ожидание выполняемой. При вызове из
+    // задачи этого ключа выполняемая не ожидается.
+    void cancel(const void* key);
+
+    size_t pendingCount() const;
+
+    ~SessionWorkers();
+
+private:
+    SessionWorkers();
+    SessionWorkers(const SessionWorkers&) = delete;
+    SessionWorkers& operator=(const SessionWorkers&) = delete;
+
+    struct Entry {
+        const void* key;
+        SessionTask task;
+        void* context;
+    };
+
+    void run();
+    void startWorkers();
+
+    mutable std::mutex mutex_;
+    std::condition_variable queueCondition_;
+    std::condition_variable idleCondition_;
+    std::deque<Entry> queue_;
+    std::set<const void*> running_;         // Ключи выполняемых задач
+    std::vector<std::thread> workers_;
+    bool stopping_;
+};
+
+#endif // SESSION_WORKERS_H
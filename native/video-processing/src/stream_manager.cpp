@@ -1,35 +1,210 @@
 #include "stream_manager.h"
 #include "rtsp_client.h"
-#include <map>
+#include "stream_subscriber.h"
+#include "file_source.h"
+#include "pipeline_shards.h"
+#include "session_workers.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iterator>
 #include <mutex>
 #include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+typedef std::shared_ptr<StreamSubscriber> SubscriberRef;
+typedef std::shared_ptr<const std::vector<SubscriberRef>> SubscriberList;
+
+// Число сегментов реестра: поиск потоков из разных сегментов не конкурирует
+// даже за короткую блокировку таблицы
+static const int kRegistryShards = 16;
+
+// Одновременно устанавливаемых сессий пакетного запуска по умолчанию
+static const int kDefaultBatchConcurrency = 32;
+
+// Период проверки статусов потоков пакета: отмененное подключение (удаление
+// или отключение потока) не вызывает callback подключения
+static const std::chrono::milliseconds kBatchPollInterval(50);
+
+// Ожидание первого ключевого кадра нового профиля при переключении
+// (интервал ключевых кадров камер - до нескольких секунд)
+static const std::chrono::milliseconds kProfileKeyframeTimeout(10000);
+
+struct StreamInfo;
+
+// Callback статуса менеджера (stream_manager_set_status_callback). Общий с
+// записями потоков: статус клиента может прийти и после уничтожения менеджера.
+struct ManagerStatusCallback {
+    std::mutex mutex;
+    StreamStatusCallback callback;
+    void* userData;
+
+    ManagerStatusCallback() : callback(nullptr), userData(nullptr) {}
+};
+
+// Профиль RTSP потока: основной url или альтернативный из StreamConfig::profiles.
+// Адрес передается callback'ам клиента и не меняется до уничтожения записи потока.
+struct StreamProfileSource {
+    StreamInfo* stream;
+    int index;                          // 0 - основной url
+    RTSPClient* client;
+    std::string url;
+    int width;                          // 0 - основной профиль (наибольшее разрешение)
+    int height;
+};
+
+// Поток менеджера. Запись живет, пока на нее есть ссылки: операция, начатая до
+// удаления потока, завершается на ней безопасно (removed == true).
 struct StreamInfo {
     int id;
     StreamType type;
     StreamConfig config;
-    StreamStatus status;
-    RTSPClient* rtspClient;
+    std::atomic<StreamStatus> status;   // Читается без блокировок
+    std::unique_ptr<FileSource> fileSource; // Источник STREAM_TYPE_FILE
+
+    // Очередь кадров к шарду потока (менеджер с шардами): кадры источника
+    // раздаются потребителям в потоке шарда
+    std::shared_ptr<PipelineLane> lane;
+    PipelineShards* pipeline;
+
+    // Клиенты профилей RTSP потока ([0] - основной url) создаются вместе с
+    // записью и уничтожаются с ней. Кадры и статус выдает активный профиль;
+    // при переключении сессия нового профиля устанавливается заранее
+    // (pendingProfile) и становится активной на своем первом ключевом кадре.
+    std::vector<std::unique_ptr<StreamProfileSource>> profiles;
+    std::atomic<int> activeProfile;     // Меняется под controlMutex или deliveryMutex
+    std::atomic<int> pendingProfile;    // -1 - переключения нет
+    std::mutex deliveryMutex;           // Выдача кадров при нескольких профилях: кадры двух сессий не перемешиваются
+
+    // Управление потоком (подключение, воспроизведение, удаление). Удерживается
+    // на время сетевых операций, но блокирует только этот поток.
+    std::mutex controlMutex;
+    bool removed;                       // Поток удален из реестра (под controlMutex)
+
+    // Callback'и (копируются под мьютексом и вызываются без него)
+    std::mutex callbackMutex;
     StreamFrameCallback frameCallback;
     StreamStatusCallback statusCallback;
     void* userData;
-    
-    StreamInfo() : id(-1), type(STREAM_TYPE_RTSP), status(STREAM_STATUS_IDLE),
-                   rtspClient(nullptr), frameCallback(nullptr),
-                   statusCallback(nullptr), userData(nullptr) {}
+    void* statusUserData;
+    std::string statusMessage;          // Сообщение последнего статуса
+    std::shared_ptr<ManagerStatusCallback> managerStatus;
+
+    // Подписчики: список заменяется целиком (копирование при записи), поток
+    // приема берет ссылку на текущий список под callbackMutex
+    SubscriberList subscribers;
+    bool subscribersClosed;             // Поток удален, новые подписки не принимаются
+
+    // Переключение профилей по спросу потребителей: отдельный поток, пока
+    // desiredProfile не станет активным (или переключение не удастся)
+    std::mutex profileMutex;
+    std::condition_variable profileCondition;
+    std::thread profileThread;
+    int desiredProfile;
+    int failedProfile;                  // Не удалось переключиться, повтор - при смене спроса
+    bool profileRunning;
+    bool profileClosed;                 // Поток удален, переключения не начинаются
+
+    StreamInfo() : id(-1), type(STREAM_TYPE_RTSP), status(STREAM_STATUS_IDLE), pipeline(nullptr),
+                   activeProfile(0), pendingProfile(-1), removed(false), frameCallback(nullptr),
+                   statusCallback(nullptr), userData(nullptr), statusUserData(nullptr), subscribersClosed(false),
+                   desiredProfile(0), failedProfile(-1), profileRunning(false), profileClosed(false) {}
+
+    ~StreamInfo() {
+        for (const auto& profile : profiles) {
+            rtsp_client_destroy(profile->client);
+        }
+    }
 };
 
-struct StreamManager {
-    std::map<int, StreamInfo> streams;
+typedef std::shared_ptr<StreamInfo> StreamRef;
+
+// Сегмент реестра. Мьютекс защищает только таблицу и никогда не удерживается
+// во время сетевых операций.
+struct StreamShard {
+    std::mutex mutex;
+    std::unordered_map<int, StreamRef> streams;
+};
+
+// События подключений пакетных запусков. Общие для всех менеджеров: callback
+// завершенного подключения может выполняться и после уничтожения менеджера.
+struct BatchSignal {
     std::mutex mutex;
-    int nextStreamId;
-    StreamStatusCallback globalStatusCallback;
-    
-    StreamManager() : nextStreamId(1), globalStatusCallback(nullptr) {}
+    std::condition_variable condition;
+    uint64_t events;
+
+    BatchSignal() : events(0) {}
+};
+
+static BatchSignal& batch_signal() {
+    static BatchSignal signal;
+    return signal;
+}
+
+struct StreamBatch;
+
+// Запуск воспроизведения потока пакета в SessionWorkers (контекст и ключ задачи)
+struct BatchPlay {
+    StreamManager* manager;
+    StreamBatch* batch;
+    size_t index;
+    bool started;                       // Задача поставлена (поток пакета)
+    bool done;                          // Результат записан (под мьютексом batch_signal())
+};
+
+// Пакетный запуск потоков (stream_manager_start_streams)
+struct StreamBatch {
+    std::vector<StreamRef> streams;
+    std::vector<StreamStartResult> results;
+    std::vector<BatchPlay> plays;
+    std::atomic<size_t> playing;        // Незавершенные PLAY; уменьшается под мьютексом batch_signal()
+    StreamBatchParams params;
+    std::thread thread;
+    bool finished;                      // Поток пакета завершается (под StreamManager::batchMutex)
+
+    StreamBatch() : playing(0), params(), finished(false) {}
+};
+
+struct StreamManager {
+    StreamShard shards[kRegistryShards];
+    std::atomic<int> nextStreamId;      // Идентификаторы не используются повторно
+    std::atomic<int> nextSubscriberId;
+    std::atomic<int> streamCount;
+
+    std::shared_ptr<ManagerStatusCallback> statusCallback;
+
+    std::mutex batchMutex;              // Защищает batches
+    std::vector<std::unique_ptr<StreamBatch>> batches;
+    bool destroying;                    // Под мьютексом batch_signal()
+
+    // Потоки-шарды обработки кадров (nullptr - кадры раздаются в потоках приема)
+    std::unique_ptr<PipelineShards> pipeline;
+    StreamShardParams pipelineParams;
+
+    StreamManager() : nextStreamId(1), nextSubscriberId(1), streamCount(0),
+                      statusCallback(std::make_shared<ManagerStatusCallback>()), destroying(false),
+                      pipelineParams() {}
 };
 
+static StreamShard& stream_shard(StreamManager* manager, int streamId) {
+    return manager->shards[static_cast<unsigned>(streamId) % kRegistryShards];
+}
+
+// Ссылка на поток (nullptr - нет такого потока)
+static StreamRef find_stream(StreamManager* manager, int streamId) {
+    StreamShard& shard = stream_shard(manager, streamId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.streams.find(streamId);
+    return it != shard.streams.end() ? it->second : StreamRef();
+}
+
 // Вспомогательная функция для конвертации RTSP статуса в StreamStatus
 static StreamStatus rtsp_status_to_stream_status(RTSPStatus rtspStatus) {
     switch (rtspStatus) {
@@ -48,20 +223,201 @@ static StreamStatus rtsp_status_to_stream_status(RTSPStatus rtspStatus) {
     }
 }
 
-// Callback для RTSP клиента
-static void rtsp_frame_callback_wrapper(RTSPFrame* frame, void* userData) {
+// Раздача кадра потока подписчикам и callback'у потока (в потоке приема
+// или в потоке шарда потока)
+static void deliver_stream_frame(RTSPFrame* frame, void* userData) {
+    StreamInfo* streamInfo = static_cast<StreamInfo*>(userData);
+    StreamFrameCallback callback;
+    void* callbackData;
+    SubscriberList subscribers;
+    {
+        std::lock_guard<std::mutex> lock(streamInfo->callbackMutex);
+        callback = streamInfo->frameCallback;
+        callbackData = streamInfo->userData;
+        subscribers = streamInfo->subscribers;
+    }
+
+    // Каждый подписчик получает свою ссылку на тот же буфер
+    if (subscribers) {
+        for (const SubscriberRef& subscriber : *subscribers) {
+            subscriber->offer(frame);
+        }
+    }
+
+    if (callback) {
+        callback(frame, callbackData);
+    } else {
+        rtsp_frame_release(frame);
+    }
+}
+
+// Кадр потока (от активного профиля RTSP или от файла): раздается сразу или
+// передается в очередь шарда потока
+static void stream_frame_callback_wrapper(RTSPFrame* frame, void* userData) {
     StreamInfo* streamInfo = static_cast<StreamInfo*>(userData);
-    if (streamInfo && streamInfo->frameCallback) {
-        streamInfo->frameCallback(frame, streamInfo->userData);
+    if (streamInfo->lane) {
+        streamInfo->lane->push(frame);
+    } else {
+        deliver_stream_frame(frame, streamInfo);
     }
 }
 
-static void rtsp_status_callback_wrapper(RTSPStatus status, const char* message, void* userData) {
+static void stream_status_callback_wrapper(StreamStatus streamStatus, const char* message, void* userData) {
     StreamInfo* streamInfo = static_cast<StreamInfo*>(userData);
-    if (streamInfo) {
-        streamInfo->status = rtsp_status_to_stream_status(status);
-        if (streamInfo->statusCallback) {
-            streamInfo->statusCallback(streamInfo->status, message, streamInfo->userData);
+    streamInfo->status = streamStatus;
+
+    StreamStatusCallback callback;
+    void* callbackData;
+    {
+        std::lock_guard<std::mutex> lock(streamInfo->callbackMutex);
+        callback = streamInfo->statusCallback;
+        callbackData = streamInfo->statusUserData;
+        streamInfo->statusMessage = message ? message : "";
+    }
+    if (callback) {
+        callback(streamStatus, message, callbackData);
+    }
+
+    ManagerStatusCallback& manager = *streamInfo->managerStatus;
+    {
+        std::lock_guard<std::mutex> lock(manager.mutex);
+        callback = manager.callback;
+        callbackData = manager.userData;
+    }
+    if (callback) {
+        callback(streamStatus, message, callbackData);
+    }
+}
+
+// Callback кадров клиента профиля. Кадры выдает только активный профиль;
+// ожидающий становится активным на своем первом ключевом кадре, после чего
+// кадры прежнего отбрасываются.
+static void rtsp_frame_callback_wrapper(RTSPFrame* frame, void* userData) {
+    StreamProfileSource* profile = static_cast<StreamProfileSource*>(userData);
+    StreamInfo* streamInfo = profile->stream;
+    if (streamInfo->profiles.size() == 1) {
+        stream_frame_callback_wrapper(frame, streamInfo);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(streamInfo->deliveryMutex);
+    if (profile->index != streamInfo->activeProfile) {
+        if (profile->index != streamInfo->pendingProfile || !frame->keyframe) {
+            rtsp_frame_release(frame);
+            return;
+        }
+        streamInfo->activeProfile = profile->index;
+        streamInfo->pendingProfile = -1;
+
+        std::lock_guard<std::mutex> profileLock(streamInfo->profileMutex);
+        streamInfo->profileCondition.notify_all();
+    }
+    stream_frame_callback_wrapper(frame, streamInfo);
+}
+
+// Статус потока - статус активного профиля
+static void rtsp_status_callback_wrapper(RTSPStatus status, const char* message, void* userData) {
+    StreamProfileSource* profile = static_cast<StreamProfileSource*>(userData);
+    if (profile->index != profile->stream->activeProfile) {
+        return;
+    }
+    stream_status_callback_wrapper(rtsp_status_to_stream_status(status), message, profile->stream);
+}
+
+// Клиент активного профиля (nullptr - поток не RTSP)
+static RTSPClient* active_client(const StreamInfo* stream) {
+    return stream->profiles.empty() ? nullptr : stream->profiles[stream->activeProfile]->client;
+}
+
+// Отмена переключения профиля (под controlMutex): сессия ожидающего профиля
+// закрывается, поток переключения прекращает ожидание
+static void cancel_profile_switch(const StreamRef& stream) {
+    int pending;
+    {
+        std::lock_guard<std::mutex> lock(stream->deliveryMutex);
+        pending = stream->pendingProfile.exchange(-1);
+    }
+    if (pending < 0) return;
+
+    rtsp_client_disconnect(stream->profiles[pending]->client);
+    std::lock_guard<std::mutex> lock(stream->profileMutex);
+    stream->profileCondition.notify_all();
+}
+
+// Профиль для нового подключения (под controlMutex): нужный потребителям,
+// сессия прежнего активного профиля закрывается
+static StreamProfileSource* select_profile(const StreamRef& stream) {
+    cancel_profile_switch(stream);
+
+    int desired;
+    {
+        std::lock_guard<std::mutex> lock(stream->profileMutex);
+        desired = stream->desiredProfile;
+    }
+    if (desired != stream->activeProfile) {
+        rtsp_client_disconnect(active_client(stream.get()));
+        std::lock_guard<std::mutex> lock(stream->deliveryMutex);
+        stream->activeProfile = desired;
+    }
+    return stream->profiles[stream->activeProfile].get();
+}
+
+// Поток для операции управления: удерживает controlMutex. Пустая ссылка -
+// потока нет, он удален или у него нет источника (RTSP клиента или файла).
+static StreamRef lock_stream(StreamManager* manager, int streamId, std::unique_lock<std::mutex>& lock) {
+    StreamRef stream = find_stream(manager, streamId);
+    if (!stream) return stream;
+
+    lock = std::unique_lock<std::mutex>(stream->controlMutex);
+    if (stream->removed || (stream->profiles.empty() && !stream->fileSource)) {
+        lock.unlock();
+        return StreamRef();
+    }
+    return stream;
+}
+
+// Отключение удаляемого потока и его подписчиков; клиенты уничтожаются
+// с последней ссылкой на запись
+static void retire_stream(const StreamRef& stream) {
+    // Очередь шарда отключается первой: поток приема, ожидающий в ней места,
+    // не задерживает отключение клиентов
+    if (stream->lane) {
+        stream->pipeline->detach(stream->lane);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stream->controlMutex);
+        stream->removed = true;
+        cancel_profile_switch(stream);
+        for (const auto& profile : stream->profiles) {
+            rtsp_client_disconnect(profile->client);
+        }
+        if (stream->fileSource) {
+            stream->fileSource->close();
+        }
+    }
+
+    // Поток переключения завершается, не начиная новых переключений
+    std::thread profileThread;
+    {
+        std::lock_guard<std::mutex> lock(stream->profileMutex);
+        stream->profileClosed = true;
+        profileThread.swap(stream->profileThread);
+        stream->profileCondition.notify_all();
+    }
+    if (profileThread.joinable()) {
+        profileThread.join();
+    }
+
+    SubscriberList subscribers;
+    {
+        std::lock_guard<std::mutex> lock(stream->callbackMutex);
+        subscribers.swap(stream->subscribers);
+        stream->subscribersClosed = true;
+    }
+    if (subscribers) {
+        for (const SubscriberRef& subscriber : *subscribers) {
+            subscriber->close();
         }
     }
 }
@@ -70,219 +426,490 @@ StreamManager* stream_manager_create() {
     return new StreamManager();
 }
 
+StreamManager* stream_manager_create_sharded(const StreamShardParams* params) {
+    if (!params || params->shardCount < 0 || params->queueCapacity < 0) {
+        return nullptr;
+    }
+
+    StreamManager* manager = new StreamManager();
+    PipelineShards::Params shardParams;
+    shardParams.shardCount = params->shardCount;
+    shardParams.pinThreads = params->pinThreads;
+    shardParams.numaAware = params->numaAware;
+    manager->pipeline.reset(new PipelineShards(shardParams));
+    manager->pipelineParams = *params;
+    return manager;
+}
+
 void stream_manager_destroy(StreamManager* manager) {
     if (!manager) return;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    // Отключение всех потоков
-    for (auto& pair : manager->streams) {
-        StreamInfo& stream = pair.second;
-        if (stream.rtspClient) {
-            rtsp_client_disconnect(stream.rtspClient);
-            rtsp_client_destroy(stream.rtspClient);
+
+    // Пакетные запуски останавливаются первыми: их потоки обращаются к менеджеру
+    BatchSignal& signal = batch_signal();
+    {
+        std::lock_guard<std::mutex> lock(signal.mutex);
+        manager->destroying = true;
+    }
+    signal.condition.notify_all();
+
+    std::vector<std::unique_ptr<StreamBatch>> batches;
+    {
+        std::lock_guard<std::mutex> lock(manager->batchMutex);
+        batches.swap(manager->batches);
+    }
+    for (const auto& batch : batches) {
+        batch->thread.join();
+    }
+    batches.clear();
+
+    std::vector<StreamRef> streams;
+    for (StreamShard& shard : manager->shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto& pair : shard.streams) {
+            streams.push_back(pair.second);
         }
+        shard.streams.clear();
+    }
+
+    // Отключение всех потоков
+    for (const StreamRef& stream : streams) {
+        retire_stream(stream);
+    }
+    streams.clear();
+
+    // Статусы, пришедшие позже, не передаются приложению
+    {
+        std::lock_guard<std::mutex> lock(manager->statusCallback->mutex);
+        manager->statusCallback->callback = nullptr;
     }
-    
-    manager->streams.clear();
+
     delete manager;
 }
 
-int stream_manager_add_stream(StreamManager* manager, const StreamConfig* config) {
-    if (!manager || !config) {
-        return -1;
+// Профиль, которого достаточно потребителям (под callbackMutex): наименьший
+// по площади из покрывающих наибольшее нужное разрешение. -1 - потребителей
+// нет, профиль не меняется.
+static int desired_profile(const StreamInfo& stream) {
+    if (stream.frameCallback) return 0;
+    if (!stream.subscribers || stream.subscribers->empty()) return -1;
+
+    int width = 0;
+    int height = 0;
+    for (const SubscriberRef& subscriber : *stream.subscribers) {
+        if (subscriber->width() == 0 || subscriber->height() == 0) return 0;
+        width = std::max(width, subscriber->width());
+        height = std::max(height, subscriber->height());
     }
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    StreamInfo streamInfo;
-    streamInfo.id = manager->nextStreamId++;
-    streamInfo.type = config->type;
-    streamInfo.config = *config;
-    streamInfo.status = STREAM_STATUS_IDLE;
-    
-    // Создание RTSP клиента для RTSP потоков
+
+    int best = 0;
+    long long bestArea = LLONG_MAX;
+    for (size_t i = 1; i < stream.profiles.size(); i++) {
+        const StreamProfileSource& profile = *stream.profiles[i];
+        long long area = static_cast<long long>(profile.width) * profile.height;
+        if (profile.width >= width && profile.height >= height && area < bestArea) {
+            best = static_cast<int>(i);
+            bestArea = area;
+        }
+    }
+    return best;
+}
+
+// Переключение на профиль target во время воспроизведения: сессия профиля
+// устанавливается рядом с текущей, кадры переходят на нее на ключевом кадре
+// (rtsp_frame_callback_wrapper), затем прежняя сессия закрывается.
+static bool switch_profile(const StreamRef& stream, int target) {
+    int previous;
+    {
+        std::lock_guard<std::mutex> lock(stream->controlMutex);
+        previous = stream->activeProfile;
+        if (previous == target) return true;
+        if (stream->removed || stream->status != STREAM_STATUS_PLAYING) return false;
+
+        {
+            std::lock_guard<std::mutex> deliveryLock(stream->deliveryMutex);
+            stream->pendingProfile = target;
+        }
+        const StreamProfileSource& profile = *stream->profiles[target];
+        bool success = rtsp_client_connect(
+            profile.client,
+            profile.url.c_str(),
+            stream->config.username[0] ? stream->config.username : nullptr,
+            stream->config.password[0] ? stream->config.password : nullptr,
+            stream->config.timeoutMs
+        ) && rtsp_client_play(profile.client);
+        if (!success) {
+            cancel_profile_switch(stream);
+            return false;
+        }
+    }
+
+    // Ожидание ключевого кадра без блокировки управления: остановка или
+    // удаление потока отменяют переключение
+    {
+        std::unique_lock<std::mutex> lock(stream->profileMutex);
+        stream->profileCondition.wait_for(lock, kProfileKeyframeTimeout, [&stream, target] {
+            return stream->profileClosed || stream->pendingProfile != target;
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(stream->controlMutex);
+    int active = stream->activeProfile;
+    if (active == target) {
+        rtsp_client_disconnect(stream->profiles[previous]->client);
+        return true;
+    }
+    // Нет ключевого кадра или отмена; повторное подключение могло уже сменить профиль
+    cancel_profile_switch(stream);
+    if (active != previous) {
+        rtsp_client_disconnect(stream->profiles[previous]->client);
+    }
+    return false;
+}
+
+// Поток переключения профилей: работает, пока нужный профиль не активен
+static void run_profile_switch(StreamRef stream) {
+    for (;;) {
+        int target;
+        {
+            std::lock_guard<std::mutex> lock(stream->profileMutex);
+            target = stream->desiredProfile;
+            if (stream->profileClosed || target == stream->activeProfile || target == stream->failedProfile) {
+                stream->profileRunning = false;
+                return;
+            }
+        }
+
+        if (!switch_profile(stream, target)) {
+            std::lock_guard<std::mutex> lock(stream->profileMutex);
+            if (stream->desiredProfile == target) {
+                stream->failedProfile = target;
+            }
+        }
+    }
+}
+
+// Пересчет нужного профиля после изменения потребителей или начала
+// воспроизведения; при расхождении с активным запускается поток переключения
+static void update_profile_demand(const StreamRef& stream) {
+    if (stream->profiles.size() < 2) return;
+
+    int target;
+    {
+        std::lock_guard<std::mutex> lock(stream->callbackMutex);
+        target = desired_profile(*stream);
+    }
+    if (target < 0) return;
+
+    std::thread finished;
+    {
+        std::lock_guard<std::mutex> lock(stream->profileMutex);
+        if (stream->profileClosed) return;
+        stream->desiredProfile = target;
+        stream->failedProfile = -1;
+        if (stream->profileRunning || target == stream->activeProfile) return;
+
+        // Предыдущий поток переключения уже вышел из цикла
+        finished.swap(stream->profileThread);
+        stream->profileRunning = true;
+        stream->profileThread = std::thread(run_profile_switch, stream);
+    }
+    if (finished.joinable()) {
+        finished.join();
+    }
+}
+
+// Создание потока и регистрация в реестре
+static StreamRef create_stream(StreamManager* manager, const StreamConfig* config) {
+    StreamRef stream = std::make_shared<StreamInfo>();
+    stream->id = manager->nextStreamId++;
+    stream->type = config->type;
+    stream->config = *config;
+    stream->managerStatus = manager->statusCallback;
+
+    if (manager->pipeline) {
+        stream->pipeline = manager->pipeline.get();
+        stream->lane = std::make_shared<PipelineLane>(
+            manager->pipelineParams.queueCapacity, manager->pipelineParams.policy,
+            deliver_stream_frame, stream.get());
+        stream->pipeline->attach(stream->lane);
+    }
+
+    // Источник файла создается сразу: указатель не меняется до уничтожения записи
+    if (config->type == STREAM_TYPE_FILE) {
+        stream->fileSource.reset(new FileSource(
+            stream_frame_callback_wrapper, stream_status_callback_wrapper, stream.get()));
+    }
+
+    // Создание RTSP клиентов основного и альтернативных профилей. Callback'и
+    // получают адрес профиля, который не меняется до уничтожения записи.
     if (config->type == STREAM_TYPE_RTSP) {
-        streamInfo.rtspClient = rtsp_client_create();
-        if (streamInfo.rtspClient) {
+        int profileCount = std::min(std::max(config->profileCount, 0), STREAM_MAX_PROFILES);
+        for (int i = -1; i < profileCount; i++) {
+            RTSPClient* client = rtsp_client_create();
+            if (!client) {
+                if (i < 0) break;
+                continue;
+            }
+
+            std::unique_ptr<StreamProfileSource> profile(new StreamProfileSource());
+            profile->stream = stream.get();
+            profile->index = static_cast<int>(stream->profiles.size());
+            profile->client = client;
+            profile->url = i < 0 ? config->url : config->profiles[i].url;
+            profile->width = i < 0 ? 0 : config->profiles[i].width;
+            profile->height = i < 0 ? 0 : config->profiles[i].height;
+
+            rtsp_client_set_transport(client, config->transport, 0);
             rtsp_client_set_frame_callback(
-                streamInfo.rtspClient,
+                client,
                 RTSP_STREAM_VIDEO,
                 rtsp_frame_callback_wrapper,
-                &streamInfo
+                profile.get()
             );
             rtsp_client_set_status_callback(
-                streamInfo.rtspClient,
+                client,
                 rtsp_status_callback_wrapper,
-                &streamInfo
+                profile.get()
             );
+            stream->profiles.push_back(std::move(profile));
         }
     }
-    
-    manager->streams[streamInfo.id] = streamInfo;
-    
-    return streamInfo.id;
+
+    StreamShard& shard = stream_shard(manager, stream->id);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.streams[stream->id] = stream;
+    }
+    manager->streamCount++;
+
+    return stream;
+}
+
+int stream_manager_add_stream(StreamManager* manager, const StreamConfig* config) {
+    if (!manager || !config) {
+        return -1;
+    }
+
+    return create_stream(manager, config)->id;
 }
 
 bool stream_manager_remove_stream(StreamManager* manager, int streamId) {
     if (!manager) return false;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it == manager->streams.end()) {
+
+    StreamRef stream;
+    {
+        StreamShard& shard = stream_shard(manager, streamId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.streams.find(streamId);
+        if (it == shard.streams.end()) {
+            return false;
+        }
+        stream = it->second;
+        shard.streams.erase(it);
+    }
+    manager->streamCount--;
+
+    // Отключение и уничтожение клиента (после операций, начатых до удаления)
+    retire_stream(stream);
+    return true;
+}
+
+// Открытие файла потока (под controlMutex); ошибка сообщается callback'ом статуса
+static bool open_file_stream(const StreamRef& stream) {
+    stream->status = STREAM_STATUS_CONNECTING;
+    std::string error;
+    if (!stream->fileSource->open(stream->config, error)) {
+        stream_status_callback_wrapper(STREAM_STATUS_ERROR, error.c_str(), stream.get());
         return false;
     }
-    
-    StreamInfo& stream = it->second;
-    
-    // Отключение и уничтожение клиента
-    if (stream.rtspClient) {
-        rtsp_client_disconnect(stream.rtspClient);
-        rtsp_client_destroy(stream.rtspClient);
-    }
-    
-    manager->streams.erase(it);
-    
+    stream_status_callback_wrapper(STREAM_STATUS_CONNECTED, "File opened", stream.get());
     return true;
 }
 
 bool stream_manager_connect_stream(StreamManager* manager, int streamId) {
     if (!manager) return false;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it == manager->streams.end()) {
+
+    std::unique_lock<std::mutex> lock;
+    StreamRef stream = lock_stream(manager, streamId, lock);
+    if (!stream) {
         return false;
     }
-    
-    StreamInfo& stream = it->second;
-    
-    if (stream.type == STREAM_TYPE_RTSP && stream.rtspClient) {
-        stream.status = STREAM_STATUS_CONNECTING;
-        
-        bool success = rtsp_client_connect(
-            stream.rtspClient,
-            stream.config.url,
-            stream.config.username[0] ? stream.config.username : nullptr,
-            stream.config.password[0] ? stream.config.password : nullptr,
-            stream.config.timeoutMs
-        );
-        
-        if (success) {
-            stream.status = STREAM_STATUS_CONNECTED;
-        } else {
-            stream.status = STREAM_STATUS_ERROR;
-        }
-        
-        return success;
+    if (stream->fileSource) {
+        return open_file_stream(stream);
     }
-    
-    return false;
+    if (stream->type != STREAM_TYPE_RTSP) {
+        return false;
+    }
+
+    StreamProfileSource* profile = select_profile(stream);
+    stream->status = STREAM_STATUS_CONNECTING;
+
+    bool success = rtsp_client_connect(
+        profile->client,
+        profile->url.c_str(),
+        stream->config.username[0] ? stream->config.username : nullptr,
+        stream->config.password[0] ? stream->config.password : nullptr,
+        stream->config.timeoutMs
+    );
+
+    stream->status = success ? STREAM_STATUS_CONNECTED : STREAM_STATUS_ERROR;
+    return success;
+}
+
+// Начало асинхронного подключения (под controlMutex). Результат приходит
+// через callback статуса потока, callback подключения RTSP - дополнительно.
+static bool begin_connect(const StreamRef& stream, RTSPConnectCallback callback, void* userData) {
+    // Индекс файла строится быстро, результат тоже приходит через callback статуса
+    if (stream->fileSource) {
+        open_file_stream(stream);
+        return true;
+    }
+    if (stream->type != STREAM_TYPE_RTSP) {
+        return false;
+    }
+
+    StreamProfileSource* profile = select_profile(stream);
+    stream->status = STREAM_STATUS_CONNECTING;
+    return rtsp_client_connect_async(
+        profile->client,
+        profile->url.c_str(),
+        stream->config.username[0] ? stream->config.username : nullptr,
+        stream->config.password[0] ? stream->config.password : nullptr,
+        stream->config.timeoutMs,
+        callback,
+        userData
+    );
+}
+
+bool stream_manager_connect_stream_async(StreamManager* manager, int streamId) {
+    if (!manager) return false;
+
+    std::unique_lock<std::mutex> lock;
+    StreamRef stream = lock_stream(manager, streamId, lock);
+    if (!stream) {
+        return false;
+    }
+    return begin_connect(stream, nullptr, nullptr);
 }
 
 bool stream_manager_disconnect_stream(StreamManager* manager, int streamId) {
     if (!manager) return false;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it == manager->streams.end()) {
+
+    std::unique_lock<std::mutex> lock;
+    StreamRef stream = lock_stream(manager, streamId, lock);
+    if (!stream) {
         return false;
     }
-    
-    StreamInfo& stream = it->second;
-    
-    if (stream.rtspClient) {
-        rtsp_client_disconnect(stream.rtspClient);
-        stream.status = STREAM_STATUS_IDLE;
-        return true;
+
+    if (stream->fileSource) {
+        stream->fileSource->close();
+    } else if (!stream->profiles.empty()) {
+        cancel_profile_switch(stream);
+        rtsp_client_disconnect(active_client(stream.get()));
     }
-    
-    return false;
+    stream->status = STREAM_STATUS_IDLE;
+    return true;
 }
 
 bool stream_manager_play_stream(StreamManager* manager, int streamId) {
     if (!manager) return false;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it == manager->streams.end()) {
+
+    std::unique_lock<std::mutex> lock;
+    StreamRef stream = lock_stream(manager, streamId, lock);
+    if (!stream) {
         return false;
     }
-    
-    StreamInfo& stream = it->second;
-    
-    if (stream.rtspClient) {
-        bool success = rtsp_client_play(stream.rtspClient);
-        if (success) {
-            stream.status = STREAM_STATUS_PLAYING;
+
+    if (stream->fileSource) {
+        // Статус до запуска: короткий файл может закончиться раньше возврата
+        StreamStatus previous = stream->status.exchange(STREAM_STATUS_PLAYING);
+        if (!stream->fileSource->play()) {
+            stream->status = previous;
+            return false;
         }
-        return success;
+        return true;
     }
-    
-    return false;
+
+    bool success = rtsp_client_play(active_client(stream.get()));
+    if (success) {
+        stream->status = STREAM_STATUS_PLAYING;
+        lock.unlock();
+        // Спрос мог измениться, пока поток не воспроизводился
+        update_profile_demand(stream);
+    }
+    return success;
 }
 
 bool stream_manager_stop_stream(StreamManager* manager, int streamId) {
     if (!manager) return false;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it == manager->streams.end()) {
+
+    std::unique_lock<std::mutex> lock;
+    StreamRef stream = lock_stream(manager, streamId, lock);
+    if (!stream) {
         return false;
     }
-    
-    StreamInfo& stream = it->second;
-    
-    if (stream.rtspClient) {
-        bool success = rtsp_client_stop(stream.rtspClient);
-        if (success) {
-            stream.status = STREAM_STATUS_CONNECTED;
-        }
-        return success;
+
+    bool success = true;
+    if (stream->fileSource) {
+        stream->fileSource->stop();
+    } else {
+        cancel_profile_switch(stream);
+        success = rtsp_client_stop(active_client(stream.get()));
     }
-    
-    return false;
+    if (success) {
+        stream->status = STREAM_STATUS_CONNECTED;
+    }
+    return success;
 }
 
 bool stream_manager_pause_stream(StreamManager* manager, int streamId) {
     if (!manager) return false;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it == manager->streams.end()) {
+
+    std::unique_lock<std::mutex> lock;
+    StreamRef stream = lock_stream(manager, streamId, lock);
+    if (!stream) {
         return false;
     }
-    
-    StreamInfo& stream = it->second;
-    
-    if (stream.rtspClient) {
-        bool success = rtsp_client_pause(stream.rtspClient);
-        if (success) {
-            stream.status = STREAM_STATUS_PAUSED;
-        }
-        return success;
+
+    bool success = true;
+    if (stream->fileSource) {
+        stream->fileSource->pause();
+    } else {
+        cancel_profile_switch(stream);
+        success = rtsp_client_pause(active_client(stream.get()));
     }
-    
-    return false;
+    if (success) {
+        stream->status = STREAM_STATUS_PAUSED;
+    }
+    return success;
 }
 
 StreamStatus stream_manager_get_status(StreamManager* manager, int streamId) {
     if (!manager) return STREAM_STATUS_ERROR;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it == manager->streams.end()) {
-        return STREAM_STATUS_ERROR;
+
+    // Не ждет операций управления: статус атомарный
+    StreamRef stream = find_stream(manager, streamId);
+    return stream ? stream->status.load() : STREAM_STATUS_ERROR;
+}
+
+bool stream_manager_get_stream_stats(StreamManager* manager, int streamId, RTSPClientStats* stats) {
+    if (!manager || !stats) return false;
+
+    // Статистика читается без блокировок, источник жив, пока есть ссылка
+    StreamRef stream = find_stream(manager, streamId);
+    if (!stream) {
+        return false;
+    }
+    if (stream->fileSource) {
+        stream->fileSource->getStats(stats);
+        return true;
+    }
+    if (stream->profiles.empty()) {
+        return false;
     }
-    
-    return it->second.status;
+
+    return rtsp_client_get_stats(active_client(stream.get()), stats);
 }
 
 void stream_manager_set_frame_callback(
@@ -292,33 +919,391 @@ void stream_manager_set_frame_callback(
     void* userData
 ) {
     if (!manager) return;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    
-    auto it = manager->streams.find(streamId);
-    if (it != manager->streams.end()) {
-        it->second.frameCallback = callback;
-        it->second.userData = userData;
+
+    StreamRef stream = find_stream(manager, streamId);
+    if (!stream) return;
+
+    {
+        std::lock_guard<std::mutex> lock(stream->callbackMutex);
+        stream->frameCallback = callback;
+        stream->userData = userData;
+    }
+    update_profile_demand(stream);
+
+    // Новый потребитель начинает с кэшированного GOP, если кэш включен
+    if (callback && !stream->profiles.empty()) {
+        rtsp_client_request_gop_replay(active_client(stream.get()));
     }
 }
 
+int stream_manager_subscribe(StreamManager* manager, int streamId, const StreamSubscriberParams* params) {
+    if (!manager || !params || !params->callback) return -1;
+
+    StreamRef stream = find_stream(manager, streamId);
+    if (!stream) return -1;
+
+    SubscriberRef subscriber = StreamSubscriber::create(manager->nextSubscriberId++, *params);
+    bool added = false;
+    {
+        std::lock_guard<std::mutex> lock(stream->callbackMutex);
+        if (!stream->subscribersClosed) {
+            auto subscribers = std::make_shared<std::vector<SubscriberRef>>();
+            if (stream->subscribers) {
+                *subscribers = *stream->subscribers;
+            }
+            subscribers->push_back(subscriber);
+            stream->subscribers = subscribers;
+            added = true;
+        }
+    }
+
+    if (!added) {
+        // Поток удален во время подписки
+        subscriber->close();
+        return -1;
+    }
+    update_profile_demand(stream);
+    return subscriber->id();
+}
+
+bool stream_manager_unsubscribe(StreamManager* manager, int streamId, int subscriberId) {
+    if (!manager) return false;
+
+    StreamRef stream = find_stream(manager, streamId);
+    if (!stream) return false;
+
+    SubscriberRef subscriber;
+    {
+        std::lock_guard<std::mutex> lock(stream->callbackMutex);
+        if (!stream->subscribers) return false;
+
+        auto subscribers = std::make_shared<std::vector<SubscriberRef>>();
+        for (const SubscriberRef& current : *stream->subscribers) {
+            if (current->id() == subscriberId) {
+                subscriber = current;
+            } else {
+                subscribers->push_back(current);
+            }
+        }
+        if (!subscriber) return false;
+        stream->subscribers = subscribers;
+    }
+
+    // Поток приема мог взять старый список: кадры после закрытия отбрасываются
+    subscriber->close();
+    update_profile_demand(stream);
+    return true;
+}
+
+int stream_manager_get_active_profile(StreamManager* manager, int streamId) {
+    if (!manager) return -1;
+
+    StreamRef stream = find_stream(manager, streamId);
+    return stream ? stream->activeProfile.load() : -1;
+}
+
+bool stream_manager_get_subscriber_stats(
+    StreamManager* manager,
+    int streamId,
+    int subscriberId,
+    RTSPFrameQueueStats* stats
+) {
+    if (!manager || !stats) return false;
+
+    StreamRef stream = find_stream(manager, streamId);
+    if (!stream) return false;
+
+    SubscriberList subscribers;
+    {
+        std::lock_guard<std::mutex> lock(stream->callbackMutex);
+        subscribers = stream->subscribers;
+    }
+    if (!subscribers) return false;
+
+    for (const SubscriberRef& subscriber : *subscribers) {
+        if (subscriber->id() == subscriberId) {
+            subscriber->getStats(stats);
+            return true;
+        }
+    }
+    return false;
+}
+
 void stream_manager_set_status_callback(
     StreamManager* manager,
     StreamStatusCallback callback,
     void* userData
 ) {
     if (!manager) return;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    manager->globalStatusCallback = callback;
+
+    std::lock_guard<std::mutex> lock(manager->statusCallback->mutex);
+    manager->statusCallback->callback = callback;
+    manager->statusCallback->userData = userData;
+}
+
+void stream_manager_set_stream_status_callback(
+    StreamManager* manager,
+    int streamId,
+    StreamStatusCallback callback,
+    void* userData
+) {
+    if (!manager) return;
+
+    StreamRef stream = find_stream(manager, streamId);
+    if (!stream) return;
+
+    std::lock_guard<std::mutex> lock(stream->callbackMutex);
+    stream->statusCallback = callback;
+    stream->statusUserData = userData;
 }
 
 int stream_manager_get_stream_count(StreamManager* manager) {
     if (!manager) return 0;
-    
-    std::lock_guard<std::mutex> lock(manager->mutex);
-    return static_cast<int>(manager->streams.size());
+
+    return manager->streamCount.load();
+}
+
+int stream_manager_get_shard_count(StreamManager* manager) {
+    if (!manager || !manager->pipeline) return 0;
+
+    return manager->pipeline->shardCount();
+}
+
+int stream_manager_get_stream_shard(StreamManager* manager, int streamId) {
+    if (!manager) return -1;
+
+    StreamRef stream = find_stream(manager, streamId);
+    return stream && stream->lane ? stream->lane->shard() : -1;
+}
+
+bool stream_manager_get_shard_stats(StreamManager* manager, int shard, StreamShardStats* stats) {
+    if (!manager || !manager->pipeline || !stats) return false;
+
+    PipelineShardStats shardStats;
+    if (!manager->pipeline->getStats(shard, &shardStats)) {
+        return false;
+    }
+    stats->cpu = shardStats.cpu;
+    stats->numaNode = shardStats.numaNode;
+    stats->streams = shardStats.lanes;
+    stats->frames = shardStats.frames;
+    stats->busyUs = shardStats.busyUs;
+    return true;
 }
 
+int stream_manager_rebalance_shards(StreamManager* manager) {
+    if (!manager || !manager->pipeline) return 0;
 
+    return manager->pipeline->rebalance();
+}
 
+// Callback подключения потока пакета: только будит потоки пакетов, результат
+// они читают из статуса потока
+static void batch_connect_callback(RTSPClient*, bool, const char*, void*) {
+    BatchSignal& signal = batch_signal();
+    {
+        std::lock_guard<std::mutex> lock(signal.mutex);
+        signal.events++;
+    }
+    signal.condition.notify_all();
+}
+
+// Запись результата запуска. reason - причина ошибки, если поток не сообщил свою.
+static void finish_batch_start(StreamBatch* batch, size_t index, bool success, const char* reason) {
+    const StreamRef& stream = batch->streams[index];
+    StreamStartResult& result = batch->results[index];
+    result.success = success;
+    result.status = stream->status;
+
+    std::string message;
+    {
+        std::lock_guard<std::mutex> lock(stream->callbackMutex);
+        message = stream->statusMessage;
+    }
+    if (!success && reason && (result.status != STREAM_STATUS_ERROR || message.empty())) {
+        message = reason;
+    }
+    snprintf(result.message, sizeof(result.message), "%s", message.c_str());
+}
+
+// Воспроизведение потока пакета (в SessionWorkers)
+static void batch_play(void* context) {
+    BatchPlay* play = static_cast<BatchPlay*>(context);
+    StreamBatch* batch = play->batch;
+    bool success = stream_manager_play_stream(play->manager, batch->streams[play->index]->id);
+    finish_batch_start(batch, play->index, success, "Failed to start playback");
+
+    BatchSignal& signal = batch_signal();
+    {
+        std::lock_guard<std::mutex> lock(signal.mutex);
+        play->done = true;
+        batch->playing--;
+        signal.events++;
+    }
+    signal.condition.notify_all();
+}
+
+// Подключение потока пакета завершено (статус сменился с CONNECTING)
+static void complete_batch_start(StreamManager* manager, StreamBatch* batch, size_t index) {
+    const StreamRef& stream = batch->streams[index];
+    if (!find_stream(manager, stream->id)) {
+        finish_batch_start(batch, index, false, "Stream removed");
+        return;
+    }
+    if (stream->status != STREAM_STATUS_CONNECTED) {
+        finish_batch_start(batch, index, false, "Connection cancelled");
+        return;
+    }
+    if (!batch->params.play) {
+        finish_batch_start(batch, index, true, nullptr);
+        return;
+    }
+
+    BatchPlay& play = batch->plays[index];
+    play.manager = manager;
+    play.batch = batch;
+    play.index = index;
+    play.started = true;
+    batch->playing++;
+    SessionWorkers::instance().post(&play, batch_play, &play);
+}
+
+// Поток пакета: начинает подключения по мере освобождения мест и интервала
+// запуска, по завершении подключения запускает воспроизведение. PLAY ждет
+// ответа камеры (в режиме AUTO - и UDP пакетов), поэтому выполняется в
+// SessionWorkers; место в maxConcurrent занято до его завершения.
+static void run_batch(StreamManager* manager, StreamBatch* batch) {
+    typedef std::chrono::steady_clock Clock;
+    const size_t count = batch->streams.size();
+    const size_t maxConcurrent = static_cast<size_t>(
+        batch->params.maxConcurrent > 0 ? batch->params.maxConcurrent : kDefaultBatchConcurrency);
+    const std::chrono::milliseconds stagger(std::max(batch->params.staggerMs, 0));
+
+    std::vector<size_t> connecting;
+    size_t next = 0;
+    Clock::time_point nextStart = Clock::now();
+    BatchSignal& signal = batch_signal();
+    uint64_t events;
+    bool destroying;
+    {
+        std::lock_guard<std::mutex> lock(signal.mutex);
+        events = signal.events;
+        destroying = manager->destroying;
+    }
+
+    while (!destroying && (next < count || !connecting.empty() || batch->playing > 0)) {
+        for (size_t i = 0; i < connecting.size();) {
+            size_t index = connecting[i];
+            const StreamRef& stream = batch->streams[index];
+            if (stream->status == STREAM_STATUS_CONNECTING && find_stream(manager, stream->id)) {
+                i++;
+                continue;
+            }
+            connecting.erase(connecting.begin() + i);
+            complete_batch_start(manager, batch, index);
+        }
+
+        Clock::time_point now = Clock::now();
+        while (next < count && connecting.size() + batch->playing < maxConcurrent && now >= nextStart) {
+            std::unique_lock<std::mutex> lock;
+            StreamRef stream = lock_stream(manager, batch->streams[next]->id, lock);
+            if (stream && begin_connect(stream, batch_connect_callback, nullptr)) {
+                connecting.push_back(next);
+            } else {
+                finish_batch_start(batch, next, false, "Failed to start connection");
+            }
+            next++;
+            nextStart = now + stagger;
+        }
+
+        // Файл подключается сразу: проверка без ожидания
+        bool completed = std::any_of(connecting.begin(), connecting.end(), [batch](size_t index) {
+            return batch->streams[index]->status != STREAM_STATUS_CONNECTING;
+        });
+
+        Clock::time_point deadline = now + kBatchPollInterval;
+        if (next < count && connecting.size() + batch->playing < maxConcurrent) {
+            deadline = std::min(deadline, nextStart);
+        }
+        std::unique_lock<std::mutex> lock(signal.mutex);
+        if (!completed) {
+            signal.condition.wait_until(lock, deadline, [&signal, manager, events] {
+                return manager->destroying || signal.events != events;
+            });
+        }
+        events = signal.events;
+        destroying = manager->destroying;
+    }
+
+    // Менеджер уничтожается: незавершенные запуски - ошибки. Выполняемые PLAY
+    // дожидаются, поставленные в очередь отменяются.
+    if (destroying) {
+        for (BatchPlay& play : batch->plays) {
+            if (!play.started) continue;
+            SessionWorkers::instance().cancel(&play);
+            bool done;
+            {
+                std::lock_guard<std::mutex> lock(signal.mutex);
+                done = play.done;
+            }
+            if (!done) {
+                finish_batch_start(batch, play.index, false, "Stream manager destroyed");
+            }
+        }
+        for (size_t index : connecting) {
+            finish_batch_start(batch, index, false, "Stream manager destroyed");
+        }
+        for (; next < count; next++) {
+            finish_batch_start(batch, next, false, "Stream manager destroyed");
+        }
+    }
+
+    if (batch->params.callback) {
+        batch->params.callback(batch->results.data(), static_cast<int>(count), batch->params.userData);
+    }
+    batch->streams.clear();
+
+    std::lock_guard<std::mutex> lock(manager->batchMutex);
+    batch->finished = true;
+}
+
+bool stream_manager_start_streams(
+    StreamManager* manager,
+    const StreamConfig* configs,
+    int count,
+    const StreamBatchParams* params,
+    int* streamIds
+) {
+    if (!manager || !configs || count <= 0 || !params) return false;
+
+    std::unique_ptr<StreamBatch> batch(new StreamBatch());
+    batch->params = *params;
+    batch->results.resize(count);
+    batch->plays.resize(count, BatchPlay());
+    for (int i = 0; i < count; i++) {
+        StreamRef stream = create_stream(manager, &configs[i]);
+        batch->results[i].streamId = stream->id;
+        batch->results[i].status = STREAM_STATUS_IDLE;
+        batch->streams.push_back(stream);
+        if (streamIds) {
+            streamIds[i] = stream->id;
+        }
+    }
+
+    // Потоки завершенных пакетов присоединяются при следующем запуске
+    std::vector<std::unique_ptr<StreamBatch>> finished;
+    {
+        std::lock_guard<std::mutex> lock(manager->batchMutex);
+        auto it = std::partition(manager->batches.begin(), manager->batches.end(),
+                                 [](const std::unique_ptr<StreamBatch>& current) { return !current->finished; });
+        std::move(it, manager->batches.end(), std::back_inserter(finished));
+        manager->batches.erase(it, manager->batches.end());
+
+        batch->thread = std::thread(run_batch, manager, batch.get());
+        manager->batches.push_back(std::move(batch));
+    }
+    for (const auto& done : finished) {
+        done->thread.join();
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#include "stream_subscriber.h"
+#include "frame_pool.h"
+
+// Таймаут ожидания потока доставки, после которого проверяется закрытие очереди
+static const int kDeliveryWaitMs = 200;
+
+StreamSubscriber::StreamSubscriber(int id, const StreamSubscriberParams& params)
+    : id_(id), width_(params.width > 0 ? params.width : 0), height_(params.height > 0 ? params.height : 0),
+      callback_(params.callback), userData_(params.userData),
+      queue_(params.queueCapacity, params.policy), waitingForKeyframe_(true) {}
+
+std::shared_ptr<StreamSubscriber> StreamSubscriber::create(int id, const StreamSubscriberParams& params) {
+    std::shared_ptr<StreamSubscriber> subscriber(new StreamSubscriber(id, params));
+    subscriber->queue_.open();
+
+    // Поток доставки держит ссылку: подписчик переживает отписку из своего callback
+    std::shared_ptr<StreamSubscriber> self = subscriber;
+    subscriber->thread_ = std::thread([self] { self->run(); });
+    return subscriber;
+}
+
+StreamSubscriber::~StreamSubscriber() {
+    // Последняя ссылка может уйти в самом потоке доставки
+    if (thread_.joinable()) {
+        if (thread_.get_id() == std::this_thread::get_id()) {
+            thread_.detach();
+        } else {
+            queue_.close();
+            thread_.join();
+        }
+    }
+}
+
+void StreamSubscriber::offer(RTSPFrame* frame) {
+    if (waitingForKeyframe_) {
+        if (!frame->keyframe) return;
+        waitingForKeyframe_ = false;
+    }
+    queue_.push(FramePool::retain(frame));
+}
+
+void StreamSubscriber::close() {
+    queue_.close();
+
+    std::lock_guard<std::mutex> lock(threadMutex_);
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+        thread_.join();
+    }
+}
+
+void StreamSubscriber::run() {
+    while (!queue_.isClosed()) {
+        if (!queue_.waitForFrames(kDeliveryWaitMs)) continue;
+
+        // Callback получает ссылку на кадр и освобождает ее сам
+        while (!queue_.isClosed()) {
+            RTSPFrame* frame = queue_.pop();
+            if (!frame) break;
+            callback_(frame, userData_);
+        }
+    }
+}
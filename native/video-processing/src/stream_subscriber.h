@@ -0,0 +1,57 @@
+#ifndef STREAM_SUBSCRIBER_H
+#define STREAM_SUBSCRIBER_H
+
+#include "stream_manager.h"
+#include "frame_queue.h"
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Подписчик потока менеджера: своя ограниченная очередь кадров и свой поток
+// доставки в callback. Все подписчики потока получают ссылки на один и тот же
+// буфер кадра (rtsp_frame_retain), данные не копируются.
+// offer() вызывает только производитель (поток, выдающий кадры потока),
+// close() и getStats() - любой поток.
+class StreamSubscriber : public std::enable_shared_from_this<StreamSubscriber> {
+public:
+    static std::shared_ptr<StreamSubscriber> create(int id, const StreamSubscriberParams& params);
+    ~StreamSubscriber();
+
+    StreamSubscriber(const StreamSubscriber&) = delete;
+    StreamSubscriber& operator=(const StreamSubscriber&) = delete;
+
+    int id() const { return id_; }
+
+    // Разрешение, достаточное подписчику (0 - полное)
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    // Постановка ссылки на кадр в очередь подписчика (кадр остается у вызывающего).
+    // До первого ключевого кадра кадры пропускаются: декодер начнет с целой картинки.
+    void offer(RTSPFrame* frame);
+
+    // Остановка доставки: оставшиеся кадры освобождаются, после возврата callback
+    // не вызывается (из самого callback - после его завершения)
+    void close();
+
+    void getStats(RTSPFrameQueueStats* stats) const { queue_.getStats(stats); }
+
+private:
+    StreamSubscriber(int id, const StreamSubscriberParams& params);
+
+    void run();
+
+    const int id_;
+    const int width_;
+    const int height_;
+    const StreamFrameCallback callback_;
+    void* const userData_;
+
+    FrameQueue queue_;
+    bool waitingForKeyframe_;   // Состояние производителя
+
+    std::mutex threadMutex_;    // Защищает thread_ от одновременного close()
+    std::thread thread_;        // Держит ссылку на подписчика до выхода
+};
+
+#endif // STREAM_SUBSCRIBER_H
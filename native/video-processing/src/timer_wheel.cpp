@@ -0,0 +1,205 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+namespace {
+
+const uint64_t kSlotMask = HierarchicalTimerWheel::kSlots - 1;
+
+} // namespace
+
+const uint64_t HierarchicalTimerWheel::kNoTimers;
+
+HierarchicalTimerWheel::HierarchicalTimerWheel(uint64_t startTick)
+    : currentTick_(startTick) {}
+
+void HierarchicalTimerWheel::place(uint64_t id, Timer& timer) {
+    uint64_t expiry = std::max(timer.expiry, currentTick_ + 1);
+    uint64_t delta = expiry - currentTick_;
+
+    int level = 0;
+    if (delta >= (1ull << (2 * kSlotBits))) {
+        level = 2;
+        // Дальше диапазона колеса: последний слот уровня 2, затем повторный перенос
+        uint64_t lastBlock = (currentTick_ >> (2 * kSlotBits)) + kSlots - 1;
+        expiry = std::min(expiry, lastBlock << (2 * kSlotBits));
+    } else if (delta >= (1ull << kSlotBits)) {
+        level = 1;
+    }
+
+    int slot = static_cast<int>((expiry >> (level * kSlotBits)) & kSlotMask);
+    std::list<uint64_t>& list = slots_[level][slot];
+    timer.level = level;
+    timer.slot = slot;
+    timer.position = list.insert(list.end(), id);
+}
+
+void HierarchicalTimerWheel::add(uint64_t id, uint64_t expiryTick) {
+    remove(id);
+    Timer& timer = timers_[id];
+    timer.expiry = expiryTick;
+    place(id, timer);
+}
+
+bool HierarchicalTimerWheel::remove(uint64_t id) {
+    auto it = timers_.find(id);
+    if (it == timers_.end()) return false;
+
+    slots_[it->second.level][it->second.slot].erase(it->second.position);
+    timers_.erase(it);
+    return true;
+}
+
+void HierarchicalTimerWheel::cascade(int level, int slot) {
+    std::list<uint64_t> moved;
+    moved.swap(slots_[level][slot]);
+    for (uint64_t id : moved) {
+        place(id, timers_[id]);
+    }
+}
+
+void HierarchicalTimerWheel::advance(uint64_t tick, std::vector<uint64_t>& expired) {
+    while (currentTick_ < tick) {
+        if (timers_.empty()) {
+            // Пустое колесо продвигается сразу
+            currentTick_ = tick;
+            break;
+        }
+
+        currentTick_++;
+        int slot = static_cast<int>(currentTick_ & kSlotMask);
+        if (slot == 0) {
+            int slot1 = static_cast<int>((currentTick_ >> kSlotBits) & kSlotMask);
+            if (slot1 == 0) {
+                cascade(2, static_cast<int>((currentTick_ >> (2 * kSlotBits)) & kSlotMask));
+            }
+            cascade(1, slot1);
+        }
+
+        std::list<uint64_t>& due = slots_[0][slot];
+        while (!due.empty()) {
+            uint64_t id = due.front();
+            due.pop_front();
+            timers_.erase(id);
+            expired.push_back(id);
+        }
+    }
+}
+
+uint64_t HierarchicalTimerWheel::nextEventTick() const {
+    if (timers_.empty()) return kNoTimers;
+
+    // Ближайший непустой слот уровня 0 до конца текущего блока,
+    // иначе - граница блока, на которой переносятся таймеры верхних уровней
+    uint64_t blockEnd = ((currentTick_ >> kSlotBits) + 1) << kSlotBits;
+    for (uint64_t tick = currentTick_ + 1; tick < blockEnd; tick++) {
+        if (!slots_[0][tick & kSlotMask].empty()) {
+            return tick;
+        }
+    }
+    return blockEnd;
+}
+
+TimerService& TimerService::instance() {
+    static TimerService service;
+    return service;
+}
+
+TimerService::TimerService()
+    : nextId_(1), start_(std::chrono::steady_clock::now()), stopping_(false) {}
+
+TimerService::~TimerService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint64_t TimerService::tickNow() const {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+    return static_cast<uint64_t>(elapsed) / kTickMs;
+}
+
+uint64_t TimerService::schedule(int delayMs, TimerCallback callback, void* context) {
+    if (!callback) return 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) return 0;
+
+    uint64_t ticks = static_cast<uint64_t>((std::max(delayMs, 0) + kTickMs - 1) / kTickMs);
+    uint64_t id = nextId_++;
+    timers_[id] = {callback, context};
+    wheel_.add(id, tickNow() + std::max<uint64_t>(ticks, 1));
+
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&TimerService::run, this);
+    }
+    condition_.notify_one();
+    return id;
+}
+
+bool TimerService::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timers_.erase(id) == 0) return false;
+    wheel_.remove(id);
+    return true;
+}
+
+void TimerService::waitIdle() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::this_thread::get_id() == thread_.get_id()) return;
+    }
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+}
+
+size_t TimerService::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timers_.size();
+}
+
+void TimerService::run() {
+    std::vector<uint64_t> expired;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stopping_) {
+        uint64_t next = wheel_.nextEventTick();
+        if (next == HierarchicalTimerWheel::kNoTimers) {
+            condition_.wait(lock);
+            continue;
+        }
+
+        // Сон до ближайшего события; новый таймер будит поток для пересчета
+        auto wakeTime = start_ + std::chrono::milliseconds(next * kTickMs);
+        if (std::chrono::steady_clock::now() < wakeTime) {
+            condition_.wait_until(lock, wakeTime);
+            continue;
+        }
+
+        expired.clear();
+        wheel_.advance(tickNow(), expired);
+        if (expired.empty()) continue;
+
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> callbackLock(callbackMutex_);
+            for (uint64_t id : expired) {
+                Timer timer;
+                {
+                    // Таймер мог быть отменен после извлечения из колеса
+                    std::lock_guard<std::mutex> timersLock(mutex_);
+                    auto it = timers_.find(id);
+                    if (it == timers_.end()) continue;
+                    timer = it->second;
+                    timers_.erase(it);
+                }
+                timer.callback(timer.context);
+            }
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Иерархическое колесо таймеров (без синхронизации).
+// Три уровня по 256 слотов: уровень 0 - отдельные тики, уровень 1 - по 256
+// тиков, уровень 2 - по 65536 тиков. Добавление и удаление O(1); таймер
+// верхнего уровня переносится на нижний, когда до его срабатывания остается
+// меньше диапазона нижнего уровня.
+class HierarchicalTimerWheel {
+public:
+    static const int kLevels = 3;
+    static const int kSlotBits = 8;
+    static const int kSlots = 1 << kSlotBits;
+    static const uint64_t kNoTimers = UINT64_MAX;
+
+    explicit HierarchicalTimerWheel(uint64_t startTick = 0);
+
+    // Добавление таймера, срабатывающего на тике expiryTick (прошедший тик -
+    // на следующем). Таймеры дальше диапазона колеса переносятся повторно.
+    void add(uint64_t id, uint64_t expiryTick);
+
+    // Удаление таймера. false - таймер не найден (уже сработал или удален).
+    bool remove(uint64_t id);
+
+    // Продвижение колеса до тика tick; сработавшие таймеры добавляются в expired
+    // в порядке тиков срабатывания.
+    void advance(uint64_t tick, std::vector<uint64_t>& expired);
+
+    // Тик, до которого нужно продвинуть колесо для обработки ближайшего
+    // события (срабатывания или переноса), kNoTimers - таймеров нет
+    uint64_t nextEventTick() const;
+
+    uint64_t currentTick() const { return currentTick_; }
+    size_t size() const { return timers_.size(); }
+
+private:
+    struct Timer {
+        uint64_t expiry;
+        int level;
+        int slot;
+        std::list<uint64_t>::iterator position;
+    };
+
+    void place(uint64_t id, Timer& timer);
+    void cascade(int level, int slot);
+
+    std::list<uint64_t> slots_[kLevels][kSlots];
+    std::unordered_map<uint64_t, Timer> timers_;
+    uint64_t currentTick_;
+};
+
+// Обработчик таймера (вызывается в потоке сервиса таймеров)
+typedef void (*TimerCallback)(void* context);
+
+// Общий для процесса сервис таймеров на колесе с тиком kTickMs.
+// Один поток обслуживает keepalive и переподключения всех RTSP клиентов
+// и спит до ближайшего события колеса. Обработчики должны быть короткими:
+// они задерживают остальные таймеры.
+class TimerService {
+public:
+    static const int kTickMs = 10;
+
+    static TimerService& instance();
+
+    // Запуск обработчика через delayMs. Возвращает идентификатор таймера.
+    uint64_t schedule(int delayMs, TimerCallback callback, void* context);
+
+    // Отмена таймера. true - обработчик не будет вызван; false - таймер уже
+    // сработал (обработчик мог еще выполняться, см. waitIdle).
+    bool cancel(uint64_t id);
+
+    // Ожидание завершения выполняемых обработчиков (не ждет при вызове
+    // из обработчика)
+    void waitIdle();
+
+    size_t pendingCount() const;
+
+    ~TimerService();
+
+private:
+    TimerService();
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    struct Timer {
+        TimerCallback callback;
+        void* context;
+    };
+
+    uint64_t tickNow() const;
+    void run();
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    HierarchicalTimerWheel wheel_;
+    std::map<uint64_t, Timer> timers_;
+    uint64_t nextId_;
+    std::chrono::steady_clock::time_point start_;
+
+    // Обработчики выполняются под этим мьютексом: waitIdle() ждет их завершения
+    std::mutex callbackMutex_;
+
+    std::thread thread_;
+    bool stopping_;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,144 @@
+#include "udp_batch_receiver.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <sys/uio.h>
+#endif
+
+const int UDPBatchReceiver::kReceiveBufferWindowMs;
+const int UDPBatchReceiver::kMinReceiveBuffer;
+const int UDPBatchReceiver::kMaxReceiveBuffer;
+const int UDPBatchReceiver::kDefaultReceiveBuffer;
+
+namespace {
+
+#if defined(__linux__) && defined(SO_RXQ_OVFL)
+// Управляющие данные датаграммы: счетчик SO_RXQ_OVFL (uint32)
+const size_t kControlSize = CMSG_SPACE(sizeof(uint32_t));
+#endif
+
+} // namespace
+
+int UDPBatchReceiver::receiveBufferForBitrate(int bitrateKbps) {
+    if (bitrateKbps <= 0) return kDefaultReceiveBuffer;
+
+    int64_t bytes = static_cast<int64_t>(bitrateKbps) * 1000 / 8 * kReceiveBufferWindowMs / 1000;
+    return static_cast<int>(std::min<int64_t>(std::max<int64_t>(bytes, kMinReceiveBuffer), kMaxReceiveBuffer));
+}
+
+int UDPBatchReceiver::setReceiveBufferSize(UDPSocket sock, int bytes) {
+    if (bytes <= 0) return 0;
+
+    bool applied = false;
+#if defined(__linux__) && defined(SO_RCVBUFFORCE)
+    applied = setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) == 0;
+#endif
+    if (!applied) {
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+    }
+
+    int actual = 0;
+    socklen_t length = sizeof(actual);
+    if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<char*>(&actual), &length) != 0) {
+        return 0;
+    }
+    return actual;
+}
+
+bool UDPBatchReceiver::enableDropCounter(UDPSocket sock) {
+#if defined(__linux__) && defined(SO_RXQ_OVFL)
+    int enable = 1;
+    return setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) == 0;
+#else
+    (void)sock;
+    return false;
+#endif
+}
+
+UDPBatchReceiver::UDPBatchReceiver()
+    : slots_(new uint8_t[kMaxBatch * kSlotSize]), truncatedCount_(0),
+      dropCounter_(0), dropCounterValid_(false) {
+    for (int i = 0; i < kMaxBatch; i++) {
+        datagrams_[i].data = slots_.get() + i * kSlotSize;
+        datagrams_[i].size = 0;
+        datagrams_[i].truncated = false;
+    }
+}
+
+UDPBatchReceiver::~UDPBatchReceiver() {}
+
+UDPBatchReceiver& UDPBatchReceiver::forCurrentThread() {
+    static thread_local UDPBatchReceiver receiver;
+    return receiver;
+}
+
+int UDPBatchReceiver::receive(UDPSocket sock) {
+#if defined(__linux__)
+    struct mmsghdr messages[kMaxBatch];
+    struct iovec iovecs[kMaxBatch];
+#ifdef SO_RXQ_OVFL
+    // Выравнивание как у struct cmsghdr
+    union {
+        struct cmsghdr align;
+        uint8_t data[kMaxBatch][kControlSize];
+    } control;
+#endif
+
+    memset(messages, 0, sizeof(messages));
+    for (int i = 0; i < kMaxBatch; i++) {
+        iovecs[i].iov_base = slots_.get() + i * kSlotSize;
+        iovecs[i].iov_len = kSlotSize;
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+#ifdef SO_RXQ_OVFL
+        messages[i].msg_hdr.msg_control = control.data[i];
+        messages[i].msg_hdr.msg_controllen = kControlSize;
+#endif
+    }
+
+    dropCounterValid_ = false;
+    int count = recvmmsg(sock, messages, kMaxBatch, MSG_DONTWAIT, nullptr);
+    if (count <= 0) return 0;
+
+    for (int i = 0; i < count; i++) {
+        datagrams_[i].size = static_cast<int>(messages[i].msg_len);
+        datagrams_[i].truncated = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        if (datagrams_[i].truncated) truncatedCount_++;
+    }
+
+#ifdef SO_RXQ_OVFL
+    // Счетчик накопительный: достаточно значения последней датаграммы
+    struct msghdr& last = messages[count - 1].msg_hdr;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&last); cmsg; cmsg = CMSG_NXTHDR(&last, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(&dropCounter_, CMSG_DATA(cmsg), sizeof(dropCounter_));
+            dropCounterValid_ = true;
+        }
+    }
+#endif
+    return count;
+#else
+    dropCounterValid_ = false;
+    struct sockaddr_in fromAddr;
+    socklen_t fromLen = sizeof(fromAddr);
+#ifdef _WIN32
+    int flags = 0;
+#else
+    int flags = MSG_DONTWAIT;
+#endif
+
+    // Без recvmmsg слоты используются как один буфер на датаграмму до 64 КБ
+    int received = recvfrom(sock, reinterpret_cast<char*>(slots_.get()), 65536,
+                            flags, reinterpret_cast<struct sockaddr*>(&fromAddr), &fromLen);
+    if (received <= 0) return 0;
+
+    datagrams_[0].size = received;
+    datagrams_[0].truncated = false;
+    return 1;
+#endif
+}
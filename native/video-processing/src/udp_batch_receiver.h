@@ -0,0 +1,83 @@
+#ifndef UDP_BATCH_RECEIVER_H
+#define UDP_BATCH_RECEIVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    typedef SOCKET UDPSocket;
+#else
+    typedef int UDPSocket;
+#endif
+
+// Принятая датаграмма. Данные действительны до следующего вызова receive().
+struct UDPDatagram {
+    const uint8_t* data;
+    int size;
+    bool truncated;         // Датаграмма больше слота и была обрезана
+};
+
+// Пакетный прием UDP датаграмм в заранее выделенные буферы.
+// На Linux используется recvmmsg (до kMaxBatch датаграмм за системный вызов),
+// на остальных платформах - recvfrom по одной датаграмме, как раньше.
+// Экземпляр не потокобезопасен; forCurrentThread() возвращает буферы потока.
+class UDPBatchReceiver {
+public:
+    static const int kMaxBatch = 32;
+    static const size_t kSlotSize = 9216;   // Jumbo кадр
+
+    // Автоматический размер приемного буфера сокета: запас на kReceiveBufferWindowMs
+    // потока (пачка пакетов ключевого кадра приходит быстрее, чем ее разбирают)
+    static const int kReceiveBufferWindowMs = 1000;
+    static const int kMinReceiveBuffer = 256 * 1024;
+    static const int kMaxReceiveBuffer = 16 * 1024 * 1024;
+    static const int kDefaultReceiveBuffer = 2 * 1024 * 1024;  // Битрейт неизвестен
+
+    // Размер буфера для потока с битрейтом bitrateKbps (0 - неизвестен)
+    static int receiveBufferForBitrate(int bitrateKbps);
+
+    // Установка SO_RCVBUF. На Linux сначала SO_RCVBUFFORCE (CAP_NET_ADMIN),
+    // иначе размер ограничен net.core.rmem_max. Возвращает фактический размер
+    // по getsockopt (на Linux включает служебные данные ядра) или 0.
+    static int setReceiveBufferSize(UDPSocket sock, int bytes);
+
+    // Включение счетчика датаграмм, отброшенных ядром из-за переполнения
+    // буфера сокета (SO_RXQ_OVFL, только Linux)
+    static bool enableDropCounter(UDPSocket sock);
+
+    UDPBatchReceiver();
+    ~UDPBatchReceiver();
+
+    // Буферы приема текущего потока (выделяются при первом обращении)
+    static UDPBatchReceiver& forCurrentThread();
+
+    // Неблокирующий прием доступных датаграмм (на Windows - одна блокирующая,
+    // вызывать только после сигнала готовности). Возвращает их количество.
+    int receive(UDPSocket sock);
+
+    const UDPDatagram& datagram(int index) const { return datagrams_[index]; }
+
+    // Число обрезанных датаграмм за время жизни буферов
+    uint64_t truncatedCount() const { return truncatedCount_; }
+
+    // Счетчик отброшенных ядром датаграмм сокета (накопительный, с момента
+    // создания сокета) по последнему receive(). false - счетчик не получен.
+    bool dropCounter(uint32_t& drops) const {
+        drops = dropCounter_;
+        return dropCounterValid_;
+    }
+
+private:
+    UDPBatchReceiver(const UDPBatchReceiver&) = delete;
+    UDPBatchReceiver& operator=(const UDPBatchReceiver&) = delete;
+
+    std::unique_ptr<uint8_t[]> slots_;
+    UDPDatagram datagrams_[kMaxBatch];
+    uint64_t truncatedCount_;
+    uint32_t dropCounter_;
+    bool dropCounterValid_;
+};
+
+#endif // UDP_BATCH_RECEIVER_H
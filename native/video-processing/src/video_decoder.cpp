@@ -35,6 +35,16 @@ struct VideoDecoder {
 };
 
 VideoDecoder* video_decoder_create(VideoCodec codec, int width, int height) {
+    return video_decoder_create_with_extradata(codec, width, height, nullptr, 0);
+}
+
+VideoDecoder* video_decoder_create_with_extradata(
+    VideoCodec codec,
+    int width,
+    int height,
+    const uint8_t* extradata,
+    size_t extradataSize
+) {
     AVCodecID avCodecId;
     
     switch (codec) {
@@ -70,6 +80,18 @@ VideoDecoder* video_decoder_create(VideoCodec codec, int width, int height) {
     decoder->codecContext->height = height;
     decoder->codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
     
+    // Extradata освобождается avcodec_free_context, FFmpeg требует нулевой отступ в конце
+    if (extradata && extradataSize > 0) {
+        decoder->codecContext->extradata = static_cast<uint8_t*>(
+            av_mallocz(extradataSize + AV_INPUT_BUFFER_PADDING_SIZE));
+        if (!decoder->codecContext->extradata) {
+            avcodec_free_context(&decoder->codecContext);
+            return nullptr;
+        }
+        memcpy(decoder->codecContext->extradata, extradata, extradataSize);
+        decoder->codecContext->extradata_size = static_cast<int>(extradataSize);
+    }
+    
     if (avcodec_open2(decoder->codecContext, avCodec, nullptr) < 0) {
         avcodec_free_context(&decoder->codecContext);
         return nullptr;
@@ -213,6 +235,16 @@ VideoDecoder* video_decoder_create(VideoCodec codec, int width, int height) {
     return nullptr;
 }
 
+VideoDecoder* video_decoder_create_with_extradata(
+    VideoCodec codec,
+    int width,
+    int height,
+    const uint8_t* extradata,
+    size_t extradataSize
+) {
+    return nullptr;
+}
+
 void video_decoder_destroy(VideoDecoder* decoder) {
 }
 